@@ -92,14 +92,15 @@ QVariant SheetModel::data(const QModelIndex &index, int role) const
     Cell *cell = d->sheet->cellAt(index.row() + 1, index.column() + 1);
     if (!cell)
         return QVariant();
-    QVariant userFriendlyValue = d->sheet->read(index.row() + 1, index.column() + 1);
 
+    // The views ask for many roles of each cell, only two need the value
+    // converted by read()
     if (role == Qt::DisplayRole) {
         if (cell->isDateTime())
-            return userFriendlyValue;
+            return d->sheet->read(index.row() + 1, index.column() + 1);
         return cell->value();
     } else if (role == Qt::EditRole) {
-        return userFriendlyValue;
+        return d->sheet->read(index.row() + 1, index.column() + 1);
     } else if (role == Qt::TextAlignmentRole) {
         Qt::Alignment align;
         switch (cell->format().horizontalAlignment()) {
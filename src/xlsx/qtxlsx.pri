@@ -1,8 +1,12 @@
 INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
 
-QT += core gui gui-private
+QT += core gui gui-private concurrent
 !build_xlsx_lib:DEFINES += XLSX_NO_LIB
+win32:LIBS += -lpsapi
+
+# Record spans in the Chrome trace event format, see xlsxtrace_p.h
+xlsx_trace:DEFINES += XLSX_TRACE
 
 HEADERS += $$PWD/xlsxdocpropscore_p.h \
     $$PWD/xlsxdocpropsapp_p.h \
@@ -28,8 +32,14 @@ HEADERS += $$PWD/xlsxdocpropscore_p.h \
     $$PWD/xlsxzipreader_p.h \
     $$PWD/xlsxdocument.h \
     $$PWD/xlsxdocument_p.h \
+    $$PWD/xlsxdocumentstatistics.h \
+    $$PWD/xlsxdocumentstatistics_p.h \
+    $$PWD/xlsxdocumenttemplate.h \
     $$PWD/xlsxcell.h \
     $$PWD/xlsxcell_p.h \
+    $$PWD/xlsxcellarena_p.h \
+    $$PWD/xlsxcelliterator.h \
+    $$PWD/xlsxcelliterator_p.h \
     $$PWD/xlsxdatavalidation.h \
     $$PWD/xlsxdatavalidation_p.h \
     $$PWD/xlsxcellreference.h \
@@ -40,6 +50,7 @@ HEADERS += $$PWD/xlsxdocpropscore_p.h \
     $$PWD/xlsxconditionalformatting_p.h \
     $$PWD/xlsxcolor_p.h \
     $$PWD/xlsxnumformatparser_p.h \
+    $$PWD/xlsxnumformatrenderer_p.h \
     $$PWD/xlsxdrawinganchor_p.h \
     $$PWD/xlsxmediafile_p.h \
     $$PWD/xlsxabstractooxmlfile.h \
@@ -48,7 +59,9 @@ HEADERS += $$PWD/xlsxdocpropscore_p.h \
     $$PWD/xlsxchart_p.h \
     $$PWD/xlsxsimpleooxmlfile_p.h \
     $$PWD/xlsxcellformula.h \
-    $$PWD/xlsxcellformula_p.h
+    $$PWD/xlsxcellformula_p.h \
+    $$PWD/xlsxformulaengine_p.h \
+    $$PWD/xlsxtrace_p.h
 
 SOURCES += $$PWD/xlsxdocpropscore.cpp \
     $$PWD/xlsxdocpropsapp.cpp \
@@ -67,7 +80,11 @@ SOURCES += $$PWD/xlsxdocpropscore.cpp \
     $$PWD/xlsxdrawing.cpp \
     $$PWD/xlsxzipreader.cpp \
     $$PWD/xlsxdocument.cpp \
+    $$PWD/xlsxdocumentstatistics.cpp \
+    $$PWD/xlsxdocumenttemplate.cpp \
     $$PWD/xlsxcell.cpp \
+    $$PWD/xlsxcellarena.cpp \
+    $$PWD/xlsxcelliterator.cpp \
     $$PWD/xlsxdatavalidation.cpp \
     $$PWD/xlsxcellreference.cpp \
     $$PWD/xlsxcellrange.cpp \
@@ -75,10 +92,13 @@ SOURCES += $$PWD/xlsxdocpropscore.cpp \
     $$PWD/xlsxconditionalformatting.cpp \
     $$PWD/xlsxcolor.cpp \
     $$PWD/xlsxnumformatparser.cpp \
+    $$PWD/xlsxnumformatrenderer.cpp \
     $$PWD/xlsxdrawinganchor.cpp \
     $$PWD/xlsxmediafile.cpp \
     $$PWD/xlsxabstractooxmlfile.cpp \
     $$PWD/xlsxchart.cpp \
     $$PWD/xlsxsimpleooxmlfile.cpp \
-    $$PWD/xlsxcellformula.cpp
+    $$PWD/xlsxcellformula.cpp \
+    $$PWD/xlsxformulaengine.cpp \
+    $$PWD/xlsxtrace.cpp
 
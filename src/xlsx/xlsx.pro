@@ -10,6 +10,9 @@ include(qtxlsx.pri)
 #Define this macro if you want to run tests, so more AIPs will get exported.
 CONFIG(debug, debug|release):DEFINES += XLSX_TEST
 
+#Run qmake with CONFIG+=xlsx_tsan to check the tests for data races with ThreadSanitizer.
+xlsx_tsan:CONFIG += sanitizer sanitize_thread
+
 QMAKE_TARGET_COMPANY = "Debao Zhang"
 QMAKE_TARGET_COPYRIGHT = "Copyright (C) 2013-2014 Debao Zhang <hello@debao.me>"
 QMAKE_TARGET_DESCRIPTION = ".Xlsx file wirter for Qt5"
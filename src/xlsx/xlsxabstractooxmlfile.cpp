@@ -105,6 +105,42 @@ QString AbstractOOXmlFile::filePath() const
     return d->filePathInPackage;
 }
 
+/*!
+ * \internal
+ *
+ * Returns the zip entry the part was last loaded from or saved to, as it is
+ * stored, or an invalid entry if the part has been modified since or nothing
+ * was kept.
+ */
+ZipEntry AbstractOOXmlFile::cachedEntry() const
+{
+    Q_D(const AbstractOOXmlFile);
+    return d->cachedEntry;
+}
+
+/*!
+ * \internal
+ *
+ * Keeps the zip \a entry the part has just been loaded from or saved to, so
+ * that it can be copied as it is stored as long as the part is not modified.
+ */
+void AbstractOOXmlFile::setCachedEntry(const ZipEntry &entry)
+{
+    Q_D(AbstractOOXmlFile);
+    d->cachedEntry = entry;
+}
+
+/*!
+ * \internal
+ *
+ * Drops the kept zip entry, to be called by every change of the part.
+ */
+void AbstractOOXmlFile::setModified()
+{
+    Q_D(AbstractOOXmlFile);
+    d->cachedEntry = ZipEntry();
+}
+
 /*!
  * \internal
  */
@@ -34,6 +34,7 @@ class QByteArray;
 QT_BEGIN_NAMESPACE_XLSX
 class Relationships;
 class AbstractOOXmlFilePrivate;
+struct ZipEntry;
 
 class Q_XLSX_EXPORT AbstractOOXmlFile
 {
@@ -54,6 +55,10 @@ public:
     void setFilePath(const QString path);
     QString filePath() const;
 
+    ZipEntry cachedEntry() const;
+    void setCachedEntry(const ZipEntry &entry);
+    void setModified();
+
 protected:
     AbstractOOXmlFile(CreateFlag flag);
     AbstractOOXmlFile(AbstractOOXmlFilePrivate *d);
@@ -39,7 +39,9 @@
 
 #include "xlsxabstractooxmlfile.h"
 #include "xlsxrelationships_p.h"
+#include "xlsxzipreader_p.h"
 
+#include <QByteArray>
 #include <QString>
 
 QT_BEGIN_NAMESPACE_XLSX
@@ -55,6 +57,7 @@ public:
     QString filePathInPackage; // such as "xl/worksheets/sheet1.xml"
                                // used when load the .xlsx file
     Relationships *relationships;
+    ZipEntry cachedEntry; // as last loaded or saved, invalid once modified
     AbstractOOXmlFile::CreateFlag flag;
     AbstractOOXmlFile *q_ptr;
 };
@@ -56,6 +56,7 @@ protected:
     friend class Workbook;
     AbstractSheet(const QString &sheetName, int sheetId, Workbook *book, AbstractSheetPrivate *d);
     virtual AbstractSheet *copy(const QString &distName, int distId) const = 0;
+    virtual AbstractSheet *snapshot(Workbook *workbook) const = 0;
     void setSheetName(const QString &sheetName);
     void setSheetType(SheetType type);
     int sheetId() const;
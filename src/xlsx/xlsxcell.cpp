@@ -29,12 +29,18 @@
 #include "xlsxutility_p.h"
 #include "xlsxworksheet.h"
 #include "xlsxworkbook.h"
+#include "xlsxstyles_p.h"
+#include "xlsxsharedstrings_p.h"
+#include "xlsxnumformatrenderer_p.h"
 #include <QDateTime>
 
 QT_BEGIN_NAMESPACE_XLSX
 
 CellPrivate::CellPrivate(Cell *p)
-    : q_ptr(p)
+    : sharedStringIndex(-1)
+    , arena(0)
+    , generation(0)
+    , q_ptr(p)
 {
 }
 
@@ -44,7 +50,10 @@ CellPrivate::CellPrivate(const CellPrivate *const cp)
     , cellType(cp->cellType)
     , format(cp->format)
     , richString(cp->richString)
+    , sharedStringIndex(cp->sharedStringIndex)
     , parent(cp->parent)
+    , arena(0)
+    , generation(0)
 {
 }
 
@@ -87,12 +96,25 @@ Cell::Cell(const Cell *const cell)
     d_ptr->q_ptr = this;
 }
 
+/*!
+ * \internal
+ * Created by CellArena, which allocated \a d.
+ */
+Cell::Cell(CellPrivate *d)
+    : d_ptr(d)
+{
+}
+
 /*!
  * Destroys the Cell and cleans up.
  */
 Cell::~Cell()
 {
-    delete d_ptr;
+    // The memory of the cells of an arena is owned by the arena
+    if (d_ptr->arena)
+        d_ptr->~CellPrivate();
+    else
+        delete d_ptr;
 }
 
 /*!
@@ -122,6 +144,84 @@ Format Cell::format() const
     return d->format;
 }
 
+/*!
+ * Returns the number of a number cell, or of the cached result of its
+ * formula, without converting a QVariant. If \a ok is not 0, \c *ok is set
+ * to false for the other cells, and 0 is returned.
+ *
+ * \sa Worksheet::readDouble()
+ */
+double Cell::numericValue(bool *ok) const
+{
+    Q_D(const Cell);
+    if (d->cellType == NumberType && d->value.userType() == QMetaType::Double) {
+        if (ok)
+            *ok = true;
+        return *static_cast<const double *>(d->value.constData());
+    }
+    if (d->cellType == NumberType && d->value.isValid())
+        return d->value.toDouble(ok);
+
+    if (ok)
+        *ok = false;
+    return 0;
+}
+
+/*!
+ * Returns the index of the string of a shared string cell in the shared
+ * string table of the workbook, or -1 for the other cells.
+ */
+int Cell::sharedStringIndex() const
+{
+    Q_D(const Cell);
+    if (d->cellType != SharedStringType || !d->parent)
+        return -1;
+    return d->sharedStringIndexIn(d->parent->workbook()->sharedStrings());
+}
+
+/*
+    Returns the index of the string of this shared string cell in \a sst,
+    which is the table of the workbook being saved, not necessarily the one
+    of the parent: a snapshot saved by another thread has its own table.
+    The index known when the cell was loaded or written is only a hint,
+    which holds unless strings have been removed from the table since.
+ */
+int CellPrivate::sharedStringIndexIn(const SharedStrings *sst) const
+{
+    if (richString.isRichString()) {
+        if (sst->isSharedString(sharedStringIndex, richString))
+            return sharedStringIndex;
+        return sst->getSharedStringIndex(richString);
+    }
+    const QString text = value.toString();
+    if (sst->isSharedString(sharedStringIndex, text))
+        return sharedStringIndex;
+    return sst->getSharedStringIndex(text);
+}
+
+/*!
+ * Returns a view of the text of a string cell, or a null reference for
+ * the other cells. The view refers to the value held by the cell, so it is
+ * valid until the cell changes.
+ */
+QStringRef Cell::stringView() const
+{
+    Q_D(const Cell);
+    if (d->value.userType() != QMetaType::QString)
+        return QStringRef();
+    return QStringRef(static_cast<const QString *>(d->value.constData()));
+}
+
+/*!
+ * Returns the index of the style of the cell in the workbook, 0 being the
+ * default style.
+ */
+int Cell::xfIndex() const
+{
+    Q_D(const Cell);
+    return d->format.xfIndexValid() ? d->format.xfIndex() : 0;
+}
+
 /*!
  * Returns true if the cell has one formula.
  */
@@ -146,22 +246,31 @@ CellFormula Cell::formula() const
 bool Cell::isDateTime() const
 {
     Q_D(const Cell);
-    if (d->cellType == NumberType && d->value.toDouble() >= 0 && d->format.isValid()
-        && d->format.isDateTimeFormat()) {
-        return true;
-    }
-    return false;
+    if (d->cellType != NumberType || d->value.toDouble() < 0 || !d->format.isValid())
+        return false;
+
+    // The number format of a style is classified once by the styles
+    if (d->parent)
+        return NumFormatParser::isDateTimeKind(
+            d->parent->workbook()->styles()->xfNumberKind(d->format));
+    return d->format.isDateTimeFormat();
 }
 
 /*!
  * Return the data time value.
+ *
+ * The QDateTime is in local time, or in UTC when
+ * Workbook::isNaiveDateTimeEnabled() is true so that it always holds the
+ * date and time of the cell as they are.
  */
 QDateTime Cell::dateTime() const
 {
     Q_D(const Cell);
     if (!isDateTime())
         return QDateTime();
-    return datetimeFromNumber(d->value.toDouble(), d->parent->workbook()->isDate1904());
+    const Workbook *workbook = d->parent->workbook();
+    return datetimeFromNumber(d->value.toDouble(), workbook->isDate1904(),
+                              workbook->isNaiveDateTimeEnabled() ? Qt::UTC : Qt::LocalTime);
 }
 
 /*!
@@ -177,4 +286,37 @@ bool Cell::isRichString() const
     return d->richString.isRichString();
 }
 
+/*!
+ * Returns the value of the cell as shown by its number format, such as
+ * "1,234.50" for 1234.5 shown with "#,##0.00". Numbers, dates and times
+ * are shown as in the en-US locale.
+ *
+ * \sa Worksheet::displayTexts()
+ */
+QString Cell::displayText() const
+{
+    Q_D(const Cell);
+    if (!d->value.isValid())
+        return QString();
+    if (d->cellType == BooleanType)
+        return d->value.toBool() ? QStringLiteral("TRUE") : QStringLiteral("FALSE");
+    if (d->cellType == ErrorType)
+        return d->value.toString();
+
+    QSharedPointer<const NumFormatRenderer> renderer;
+    bool is1904 = false;
+    if (d->parent) {
+        renderer = d->parent->workbook()->styles()->xfRenderer(d->format);
+        is1904 = d->parent->workbook()->isDate1904();
+    } else {
+        const QString formatCode = d->format.numberFormat().isEmpty()
+            ? NumFormatRenderer::builtinFormatCode(d->format.numberFormatIndex())
+            : d->format.numberFormat();
+        renderer = QSharedPointer<const NumFormatRenderer>(new NumFormatRenderer(formatCode));
+    }
+    if (d->cellType != NumberType)
+        return renderer->renderText(d->value.toString());
+    return renderer->render(d->value.toDouble(), is1904);
+}
+
 QT_END_NAMESPACE_XLSX
@@ -35,6 +35,7 @@ class Worksheet;
 class Format;
 class CellFormula;
 class CellPrivate;
+class CellArena;
 class WorksheetPrivate;
 
 class Q_XLSX_EXPORT Cell
@@ -54,6 +55,11 @@ public:
     QVariant value() const;
     Format format() const;
 
+    double numericValue(bool *ok = 0) const;
+    int sharedStringIndex() const;
+    QStringRef stringView() const;
+    int xfIndex() const;
+
     bool hasFormula() const;
     CellFormula formula() const;
 
@@ -62,15 +68,19 @@ public:
 
     bool isRichString() const;
 
+    QString displayText() const;
+
     ~Cell();
 
 private:
     friend class Worksheet;
     friend class WorksheetPrivate;
+    friend class CellArena;
 
     Cell(const QVariant &data = QVariant(), CellType type = NumberType,
          const Format &format = Format(), Worksheet *parent = 0);
     Cell(const Cell *const cell);
+    Cell(CellPrivate *d);
     CellPrivate *const d_ptr;
 };
 
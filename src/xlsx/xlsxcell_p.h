@@ -46,6 +46,9 @@
 
 QT_BEGIN_NAMESPACE_XLSX
 
+class CellArena;
+class SharedStrings;
+
 class CellPrivate
 {
     Q_DECLARE_PUBLIC(Cell)
@@ -53,6 +56,8 @@ public:
     CellPrivate(Cell *p);
     CellPrivate(const CellPrivate *const cp);
 
+    int sharedStringIndexIn(const SharedStrings *sst) const;
+
     QVariant value;
     CellFormula formula;
     Cell::CellType cellType;
@@ -60,7 +65,10 @@ public:
 
     RichString richString;
 
+    int sharedStringIndex; // in the table, when last known, or -1
     Worksheet *parent;
+    CellArena *arena; // which allocated the cell, or 0 for the heap
+    int generation; // of the arena when the cell was created, or -1 once shared
     Cell *q_ptr;
 };
 
@@ -0,0 +1,149 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxcellarena_p.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+/*
+  The cells of a worksheet, with their private data, are allocated in
+  chunks of records by the arena of the worksheet. Loading a sheet then
+  allocates once per chunk instead of twice per cell, and the memory is
+  given back in bulk.
+
+  Cells may be shared by the copies of a sheet and outlive it, so each cell
+  holds a reference on its arena, and the arena is deleted with the last of
+  the worksheet and its cells.
+
+  Cells are only created by the thread which modifies the worksheet, but
+  the last reference on a shared cell may be dropped by any thread, such
+  as the one saving a snapshot. Released records are therefore pushed onto
+  a lock free list, which the allocating thread takes over as a whole once
+  its own free list is empty.
+
+  The arena also counts the times its worksheet shared its cells with a
+  copy. Each cell is stamped with the generation it was created in, so the
+  worksheet can tell the cells it may still modify in place, those created
+  since the last share, from the ones it must copy first. Iterators share
+  the cells from the const read paths, which several threads may run at
+  once, so the generation is atomic.
+ */
+
+CellArena::CellArena()
+    : m_chunkUsed(ChunkSize)
+    , m_freeList(0)
+    , m_generation(0)
+    , m_releasedList(0)
+    , m_cellCount(0)
+    , m_ref(1)
+{
+}
+
+CellArena::~CellArena()
+{
+    Q_ASSERT(m_cellCount.loadAcquire() == 0);
+    foreach (Record *chunk, m_chunks)
+        delete[] chunk;
+}
+
+/*
+  Gives up the reference of the worksheet owning the arena.
+ */
+void CellArena::release()
+{
+    if (!m_ref.deref())
+        delete this;
+}
+
+CellArena::Record *CellArena::allocate()
+{
+    Record *record;
+    if (!m_freeList)
+        m_freeList = m_releasedList.fetchAndStoreAcquire(0);
+    if (m_freeList) {
+        record = m_freeList;
+        m_freeList = record->next;
+    } else {
+        if (m_chunkUsed == ChunkSize) {
+            m_chunks.append(new Record[ChunkSize]);
+            m_chunkUsed = 0;
+        }
+        record = m_chunks.last() + m_chunkUsed++;
+    }
+    m_cellCount.ref();
+    m_ref.ref();
+    return record;
+}
+
+QSharedPointer<Cell> CellArena::adopt(Record *record, CellPrivate *d)
+{
+    d->arena = this;
+    d->generation = m_generation.loadAcquire();
+    Cell *cell = new (&record->cell) Cell(d);
+    d->q_ptr = cell;
+    return QSharedPointer<Cell>(cell, &CellArena::destroyCell);
+}
+
+/*
+  Creates a cell of \a parent in the arena.
+ */
+QSharedPointer<Cell> CellArena::createCell(const QVariant &data, Cell::CellType type,
+                                           const Format &format, Worksheet *parent)
+{
+    Record *record = allocate();
+    CellPrivate *d = new (&record->d) CellPrivate(0);
+    d->value = data;
+    d->cellType = type;
+    d->format = format;
+    d->parent = parent;
+    return adopt(record, d);
+}
+
+/*
+  Creates a copy of \a cell in the arena.
+ */
+QSharedPointer<Cell> CellArena::createCell(const Cell *cell)
+{
+    Record *record = allocate();
+    return adopt(record, new (&record->d) CellPrivate(cell->d_ptr));
+}
+
+void CellArena::destroyCell(Cell *cell)
+{
+    CellArena *arena = cell->d_ptr->arena;
+    cell->~Cell();
+
+    // The cell is the first member of its record
+    Record *record = reinterpret_cast<Record *>(cell);
+    Record *head;
+    do {
+        head = arena->m_releasedList.loadAcquire();
+        record->next = head;
+    } while (!arena->m_releasedList.testAndSetRelease(head, record));
+    arena->m_cellCount.deref();
+    if (!arena->m_ref.deref())
+        delete arena;
+}
+
+QT_END_NAMESPACE_XLSX
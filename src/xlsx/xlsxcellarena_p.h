@@ -0,0 +1,100 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef XLSXCELLARENA_P_H
+#define XLSXCELLARENA_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+#include "xlsxcell.h"
+#include "xlsxcell_p.h"
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <new>
+#include <type_traits>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class Worksheet;
+
+class XLSX_AUTOTEST_EXPORT CellArena
+{
+public:
+    CellArena();
+
+    void release();
+
+    QSharedPointer<Cell> createCell(const QVariant &data, Cell::CellType type,
+                                    const Format &format, Worksheet *parent);
+    QSharedPointer<Cell> createCell(const Cell *cell);
+
+    int cellCount() const { return m_cellCount.loadAcquire(); }
+    int chunkCount() const { return m_chunks.size(); }
+
+    int generation() const { return m_generation.loadAcquire(); }
+    void nextGeneration() { m_generation.ref(); }
+
+private:
+    Q_DISABLE_COPY(CellArena)
+    ~CellArena();
+
+    // A cell and its private data, or a link of the free list
+    struct Record
+    {
+        std::aligned_storage<sizeof(Cell), Q_ALIGNOF(Cell)>::type cell;
+        std::aligned_storage<sizeof(CellPrivate), Q_ALIGNOF(CellPrivate)>::type d;
+        Record *next;
+    };
+    enum { ChunkSize = 512 };
+
+    Record *allocate();
+    QSharedPointer<Cell> adopt(Record *record, CellPrivate *d);
+    static void destroyCell(Cell *cell);
+
+    QVector<Record *> m_chunks;
+    int m_chunkUsed;
+    Record *m_freeList; // only used by the thread allocating cells
+    QAtomicInt m_generation; // stamped on new cells, advanced by readers too
+    QAtomicPointer<Record> m_releasedList; // pushed to by any thread
+    QAtomicInt m_cellCount;
+    QAtomicInt m_ref;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // XLSXCELLARENA_P_H
@@ -0,0 +1,363 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxcelliterator.h"
+#include "xlsxcelliterator_p.h"
+#include "xlsxworksheet.h"
+#include "xlsxworksheet_p.h"
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+static bool entryColumnLessThan(const CellIteratorEntry &e1, const CellIteratorEntry &e2)
+{
+    return e1.column < e2.column;
+}
+
+CellIteratorPrivate::CellIteratorPrivate(const Worksheet *sheet, const CellRange &range,
+                                         CellIterator::Order order)
+    : cellTable(WorksheetPrivate::get(sheet)->cellTable)
+    , range(range.isValid() ? range : CellRange(1, 1, XLSX_ROW_MAX, XLSX_COLUMN_MAX))
+    , order(order)
+{
+    // The cells are modified in place by the sheet no longer
+    WorksheetPrivate::get(sheet)->markCellsShared();
+    toFront();
+    if (order == CellIterator::ColumnMajor) {
+        while (nextCell()) {
+            CellIteratorEntry entry = { column, row, cell };
+            entries.append(entry);
+        }
+        std::stable_sort(entries.begin(), entries.end(), entryColumnLessThan);
+        toFront();
+    }
+}
+
+void CellIteratorPrivate::toFront()
+{
+    rowIt = cellTable.lowerBound(range.firstRow());
+    rowStarted = false;
+    row = 0;
+    column = 0;
+    cell = 0;
+    entryIndex = -1;
+}
+
+bool CellIteratorPrivate::isCellInRange() const
+{
+    return cellIt != rowIt->constEnd() && cellIt.key() <= range.lastColumn();
+}
+
+void CellIteratorPrivate::setCurrent(int currentRow, int currentColumn, Cell *currentCell)
+{
+    row = currentRow;
+    column = currentColumn;
+    cell = currentCell;
+}
+
+/*
+  Moves to the next cell of the range in row major order.
+ */
+bool CellIteratorPrivate::nextCell()
+{
+    for (; rowIt != cellTable.constEnd() && rowIt.key() <= range.lastRow(); ++rowIt) {
+        if (!rowStarted) {
+            cellIt = rowIt->lowerBound(range.firstColumn());
+            rowStarted = true;
+        } else if (isCellInRange()) {
+            ++cellIt;
+        }
+        if (isCellInRange()) {
+            setCurrent(rowIt.key(), cellIt.key(), cellIt->data());
+            return true;
+        }
+        rowStarted = false;
+    }
+    setCurrent(0, 0, 0);
+    return false;
+}
+
+RowCursorPrivate::RowCursorPrivate(const Worksheet *sheet, const CellRange &range)
+    : CellIteratorPrivate(sheet, range, CellIterator::RowMajor)
+    , onRow(false)
+{
+}
+
+/*!
+  \class CellIterator
+  \inmodule QtXlsx
+  \brief The CellIterator class visits the cells of a worksheet.
+
+  Only the cells which exist are visited, in row major or column major
+  order, so scanning a sheet costs as much as the cells it has, and not
+  as much as the rows times the columns of its dimension.
+
+  \code
+  CellIterator it(sheet, CellRange("A1:C100"));
+  while (it.next())
+      qDebug() << it.row() << it.column() << it.value();
+  \endcode
+
+  The iterator works on a snapshot of the cells of the sheet, which
+  changes to the sheet do not affect. The cells it holds are copied by the
+  sheet before being modified, once each.
+
+  \sa RowCursor
+*/
+
+/*!
+  \enum CellIterator::Order
+
+  \value RowMajor The cells are visited row by row, from left to right.
+  \value ColumnMajor The cells are visited column by column, from top to
+         bottom. The cells of the range are sorted by column once.
+*/
+
+/*!
+  Creates an iterator over all the cells of \a sheet, in the \a order.
+ */
+CellIterator::CellIterator(const Worksheet *sheet, Order order)
+    : d_ptr(new CellIteratorPrivate(sheet, CellRange(), order))
+{
+}
+
+/*!
+  Creates an iterator over the cells of \a sheet in \a range, in the
+  \a order. An invalid \a range stands for the whole sheet.
+ */
+CellIterator::CellIterator(const Worksheet *sheet, const CellRange &range, Order order)
+    : d_ptr(new CellIteratorPrivate(sheet, range, order))
+{
+}
+
+/*!
+  Destroys the iterator.
+ */
+CellIterator::~CellIterator()
+{
+    delete d_ptr;
+}
+
+/*!
+  Moves to the next cell, the first one after construction or toFront().
+  Returns false when there are no more cells.
+ */
+bool CellIterator::next()
+{
+    Q_D(CellIterator);
+    if (d->order == RowMajor)
+        return d->nextCell();
+
+    if (d->entryIndex + 1 >= d->entries.size()) {
+        d->entryIndex = d->entries.size();
+        d->setCurrent(0, 0, 0);
+        return false;
+    }
+    const CellIteratorEntry &entry = d->entries[++d->entryIndex];
+    d->setCurrent(entry.row, entry.column, entry.cell);
+    return true;
+}
+
+/*!
+  Moves the iterator back before the first cell.
+ */
+void CellIterator::toFront()
+{
+    Q_D(CellIterator);
+    d->toFront();
+}
+
+/*!
+  Returns the row of the current cell, or 0 if there is none.
+ */
+int CellIterator::row() const
+{
+    Q_D(const CellIterator);
+    return d->row;
+}
+
+/*!
+  Returns the column of the current cell, or 0 if there is none.
+ */
+int CellIterator::column() const
+{
+    Q_D(const CellIterator);
+    return d->column;
+}
+
+/*!
+  Returns the current cell, or 0 if there is none.
+ */
+Cell *CellIterator::cell() const
+{
+    Q_D(const CellIterator);
+    return d->cell;
+}
+
+/*!
+  Returns the type of the current cell.
+ */
+Cell::CellType CellIterator::cellType() const
+{
+    Q_D(const CellIterator);
+    return d->cell ? d->cell->cellType() : Cell::NumberType;
+}
+
+/*!
+  Returns the value of the current cell, as Cell::value() does.
+ */
+QVariant CellIterator::value() const
+{
+    Q_D(const CellIterator);
+    return d->cell ? d->cell->value() : QVariant();
+}
+
+/*!
+  \class RowCursor
+  \inmodule QtXlsx
+  \brief The RowCursor class visits the cells of a worksheet row by row.
+
+  The cursor moves to the rows which have cells with nextRow(), and to the
+  cells of the current row with next(). Empty rows are skipped.
+
+  \code
+  RowCursor cursor(sheet);
+  while (cursor.nextRow()) {
+      while (cursor.next())
+          qDebug() << cursor.row() << cursor.column() << cursor.value();
+  }
+  \endcode
+
+  \sa CellIterator
+*/
+
+/*!
+  Creates a cursor over the cells of \a sheet in \a range. An invalid
+  \a range stands for the whole sheet.
+ */
+RowCursor::RowCursor(const Worksheet *sheet, const CellRange &range)
+    : d_ptr(new RowCursorPrivate(sheet, range))
+{
+}
+
+/*!
+  Destroys the cursor.
+ */
+RowCursor::~RowCursor()
+{
+    delete d_ptr;
+}
+
+/*!
+  Moves to the next row which has cells in the range, before its first
+  cell. Returns false when there are no more rows.
+ */
+bool RowCursor::nextRow()
+{
+    Q_D(RowCursor);
+    if (d->onRow)
+        ++d->rowIt;
+    d->setCurrent(0, 0, 0);
+    for (; d->rowIt != d->cellTable.constEnd() && d->rowIt.key() <= d->range.lastRow(); ++d->rowIt) {
+        d->cellIt = d->rowIt->lowerBound(d->range.firstColumn());
+        if (d->isCellInRange()) {
+            d->onRow = true;
+            d->rowStarted = false;
+            d->row = d->rowIt.key();
+            return true;
+        }
+    }
+    d->onRow = false;
+    return false;
+}
+
+/*!
+  Moves to the next cell of the current row. Returns false when there are
+  no more cells in the row.
+ */
+bool RowCursor::next()
+{
+    Q_D(RowCursor);
+    if (!d->onRow || !d->isCellInRange())
+        return false;
+
+    if (d->rowStarted) {
+        ++d->cellIt;
+        if (!d->isCellInRange()) {
+            d->setCurrent(d->row, 0, 0);
+            return false;
+        }
+    }
+    d->rowStarted = true;
+    d->setCurrent(d->row, d->cellIt.key(), d->cellIt->data());
+    return true;
+}
+
+/*!
+  Returns the current row, or 0 if there is none.
+ */
+int RowCursor::row() const
+{
+    Q_D(const RowCursor);
+    return d->row;
+}
+
+/*!
+  Returns the column of the current cell, or 0 if there is none.
+ */
+int RowCursor::column() const
+{
+    Q_D(const RowCursor);
+    return d->column;
+}
+
+/*!
+  Returns the current cell, or 0 if there is none.
+ */
+Cell *RowCursor::cell() const
+{
+    Q_D(const RowCursor);
+    return d->cell;
+}
+
+/*!
+  Returns the type of the current cell.
+ */
+Cell::CellType RowCursor::cellType() const
+{
+    Q_D(const RowCursor);
+    return d->cell ? d->cell->cellType() : Cell::NumberType;
+}
+
+/*!
+  Returns the value of the current cell, as Cell::value() does.
+ */
+QVariant RowCursor::value() const
+{
+    Q_D(const RowCursor);
+    return d->cell ? d->cell->value() : QVariant();
+}
+
+QT_END_NAMESPACE_XLSX
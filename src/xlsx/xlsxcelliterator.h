@@ -0,0 +1,86 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef QXLSX_XLSXCELLITERATOR_H
+#define QXLSX_XLSXCELLITERATOR_H
+
+#include "xlsxglobal.h"
+#include "xlsxcell.h"
+#include "xlsxcellrange.h"
+#include <QVariant>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class Worksheet;
+class CellIteratorPrivate;
+class RowCursorPrivate;
+
+class Q_XLSX_EXPORT CellIterator
+{
+    Q_DECLARE_PRIVATE(CellIterator)
+public:
+    enum Order { RowMajor, ColumnMajor };
+
+    explicit CellIterator(const Worksheet *sheet, Order order = RowMajor);
+    CellIterator(const Worksheet *sheet, const CellRange &range, Order order = RowMajor);
+    ~CellIterator();
+
+    bool next();
+    void toFront();
+
+    int row() const;
+    int column() const;
+    Cell *cell() const;
+    Cell::CellType cellType() const;
+    QVariant value() const;
+
+private:
+    Q_DISABLE_COPY(CellIterator)
+    CellIteratorPrivate *const d_ptr;
+};
+
+class Q_XLSX_EXPORT RowCursor
+{
+    Q_DECLARE_PRIVATE(RowCursor)
+public:
+    explicit RowCursor(const Worksheet *sheet, const CellRange &range = CellRange());
+    ~RowCursor();
+
+    bool nextRow();
+    bool next();
+
+    int row() const;
+    int column() const;
+    Cell *cell() const;
+    Cell::CellType cellType() const;
+    QVariant value() const;
+
+private:
+    Q_DISABLE_COPY(RowCursor)
+    RowCursorPrivate *const d_ptr;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXCELLITERATOR_H
@@ -0,0 +1,97 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef XLSXCELLITERATOR_P_H
+#define XLSXCELLITERATOR_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+#include "xlsxcelliterator.h"
+
+#include <QMap>
+#include <QSharedPointer>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+struct CellIteratorEntry
+{
+    int column;
+    int row;
+    Cell *cell;
+};
+
+class CellIteratorPrivate
+{
+public:
+    typedef QMap<int, QMap<int, QSharedPointer<Cell>>> CellTable;
+
+    CellIteratorPrivate(const Worksheet *sheet, const CellRange &range,
+                        CellIterator::Order order);
+
+    void toFront();
+    bool nextCell();
+    bool isCellInRange() const;
+    void setCurrent(int currentRow, int currentColumn, Cell *currentCell);
+
+    // A snapshot of the cells, implicitly shared with the sheet. It is only
+    // read through const functions, which never duplicate it.
+    const CellTable cellTable;
+    CellRange range;
+    CellTable::const_iterator rowIt;
+    QMap<int, QSharedPointer<Cell>>::const_iterator cellIt;
+    bool rowStarted; // whether cellIt is positioned in the row of rowIt
+    int row;
+    int column;
+    Cell *cell;
+
+    // Column major order, the cells of the range sorted by column
+    CellIterator::Order order;
+    QVector<CellIteratorEntry> entries;
+    int entryIndex;
+};
+
+class RowCursorPrivate : public CellIteratorPrivate
+{
+public:
+    RowCursorPrivate(const Worksheet *sheet, const CellRange &range);
+
+    bool onRow;
+};
+
+QT_END_NAMESPACE_XLSX
+
+Q_DECLARE_TYPEINFO(QXlsx::CellIteratorEntry, Q_PRIMITIVE_TYPE);
+
+#endif // XLSXCELLITERATOR_P_H
@@ -47,22 +47,19 @@ int intPow(int x, int p)
 
 QString col_to_name(int col_num)
 {
-    static QMap<int, QString> col_cache;
-
-    if (!col_cache.contains(col_num)) {
-        QString col_str;
-        int remainder;
-        while (col_num) {
-            remainder = col_num % 26;
-            if (remainder == 0)
-                remainder = 26;
-            col_str.prepend(QChar('A' + remainder - 1));
-            col_num = (col_num - 1) / 26;
-        }
-        col_cache.insert(col_num, col_str);
+    // No shared cache here: building a name of a few letters is cheap, and
+    // this must stay callable from several threads at once.
+    QChar buffer[7];
+    int pos = 7;
+    while (col_num > 0) {
+        int remainder = col_num % 26;
+        if (remainder == 0)
+            remainder = 26;
+        buffer[--pos] = QChar('A' + remainder - 1);
+        col_num = (col_num - 1) / 26;
     }
 
-    return col_cache[col_num];
+    return QString(buffer + pos, 7 - pos);
 }
 
 int col_from_name(const QString &col_str)
@@ -95,6 +95,7 @@ Chart::~Chart()
 void Chart::addSeries(const CellRange &range, AbstractSheet *sheet)
 {
     Q_D(Chart);
+    setModified();
     if (!range.isValid())
         return;
     if (sheet && sheet->sheetType() != AbstractSheet::ST_WorkSheet)
@@ -159,6 +160,7 @@ void Chart::addSeries(const CellRange &range, AbstractSheet *sheet)
 void Chart::setChartType(ChartType type)
 {
     Q_D(Chart);
+    setModified();
     d->chartType = type;
 }
 
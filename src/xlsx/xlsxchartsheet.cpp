@@ -91,6 +91,22 @@ Chartsheet *Chartsheet::copy(const QString &distName, int distId) const
     return 0;
 }
 
+/*!
+ * \internal
+ *
+ * Make a frozen copy of this sheet for the snapshot \a workbook of an
+ * asynchronous save.
+ */
+Chartsheet *Chartsheet::snapshot(Workbook *workbook) const
+{
+    Q_D(const Chartsheet);
+    Chartsheet *sheet = new Chartsheet(sheetName(), sheetId(), workbook, F_LoadFromExists);
+    sheet->setSheetState(sheetState());
+    if (d->drawing)
+        sheet->d_func()->drawing = QSharedPointer<Drawing>(d->drawing->clone(sheet));
+    return sheet;
+}
+
 /*!
  * Destroys this workssheet.
  */
@@ -46,6 +46,7 @@ private:
     friend class Workbook;
     Chartsheet(const QString &sheetName, int sheetId, Workbook *book, CreateFlag flag);
     Chartsheet *copy(const QString &distName, int distId) const;
+    Chartsheet *snapshot(Workbook *workbook) const;
 
     void saveToXmlFile(QIODevice *device) const;
     bool loadFromXmlFile(QIODevice *device);
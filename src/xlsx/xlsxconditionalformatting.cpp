@@ -42,6 +42,8 @@ ConditionalFormattingPrivate::ConditionalFormattingPrivate()
 ConditionalFormattingPrivate::ConditionalFormattingPrivate(
     const ConditionalFormattingPrivate &other)
     : QSharedData(other)
+    , cfRules(other.cfRules)
+    , ranges(other.ranges)
 {
 }
 
@@ -43,6 +43,15 @@ ContentTypes::ContentTypes(CreateFlag flag)
     m_defaults.insert(QStringLiteral("xml"), QStringLiteral("application/xml"));
 }
 
+ContentTypes::ContentTypes(const ContentTypes &other)
+    : AbstractOOXmlFile(F_NewFromScratch)
+    , m_defaults(other.m_defaults)
+    , m_overrides(other.m_overrides)
+    , m_package_prefix(other.m_package_prefix)
+    , m_document_prefix(other.m_document_prefix)
+{
+}
+
 void ContentTypes::addDefault(const QString &key, const QString &value)
 {
     m_defaults.insert(key, value);
@@ -148,6 +157,11 @@ void ContentTypes::addVbaProject()
     addOverride(QStringLiteral("bin"), QStringLiteral("application/vnd.ms-office.vbaProject"));
 }
 
+QString ContentTypes::overrideType(const QString &partName) const
+{
+    return m_overrides.value(partName);
+}
+
 void ContentTypes::clearOverrides()
 {
     m_overrides.clear();
@@ -50,6 +50,7 @@ class ContentTypes : public AbstractOOXmlFile
 {
 public:
     ContentTypes(CreateFlag flag);
+    ContentTypes(const ContentTypes &other);
 
     void addDefault(const QString &key, const QString &value);
     void addOverride(const QString &key, const QString &value);
@@ -72,6 +73,7 @@ public:
     void addCalcChain();
     void addVbaProject();
 
+    QString overrideType(const QString &partName) const;
     void clearOverrides();
 
     void saveToXmlFile(QIODevice *device) const;
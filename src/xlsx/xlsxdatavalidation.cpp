@@ -33,6 +33,72 @@
 
 QT_BEGIN_NAMESPACE_XLSX
 
+/*
+  Lookup tables between the enums of DataValidation and their names in the
+  worksheet xml, built once so that they can be shared between threads.
+*/
+struct ValidationStrings
+{
+    ValidationStrings();
+
+    QMap<DataValidation::ValidationType, QString> typeStrings;
+    QMap<DataValidation::ValidationOperator, QString> operatorStrings;
+    QMap<DataValidation::ErrorStyle, QString> errorStyleStrings;
+    QMap<QString, DataValidation::ValidationType> typeValues;
+    QMap<QString, DataValidation::ValidationOperator> operatorValues;
+    QMap<QString, DataValidation::ErrorStyle> errorStyleValues;
+};
+
+ValidationStrings::ValidationStrings()
+{
+    typeStrings.insert(DataValidation::None, QStringLiteral("none"));
+    typeStrings.insert(DataValidation::Whole, QStringLiteral("whole"));
+    typeStrings.insert(DataValidation::Decimal, QStringLiteral("decimal"));
+    typeStrings.insert(DataValidation::List, QStringLiteral("list"));
+    typeStrings.insert(DataValidation::Date, QStringLiteral("date"));
+    typeStrings.insert(DataValidation::Time, QStringLiteral("time"));
+    typeStrings.insert(DataValidation::TextLength, QStringLiteral("textLength"));
+    typeStrings.insert(DataValidation::Custom, QStringLiteral("custom"));
+
+    operatorStrings.insert(DataValidation::Between, QStringLiteral("between"));
+    operatorStrings.insert(DataValidation::NotBetween, QStringLiteral("notBetween"));
+    operatorStrings.insert(DataValidation::Equal, QStringLiteral("equal"));
+    operatorStrings.insert(DataValidation::NotEqual, QStringLiteral("notEqual"));
+    operatorStrings.insert(DataValidation::LessThan, QStringLiteral("lessThan"));
+    operatorStrings.insert(DataValidation::LessThanOrEqual, QStringLiteral("lessThanOrEqual"));
+    operatorStrings.insert(DataValidation::GreaterThan, QStringLiteral("greaterThan"));
+    operatorStrings.insert(DataValidation::GreaterThanOrEqual,
+                           QStringLiteral("greaterThanOrEqual"));
+
+    errorStyleStrings.insert(DataValidation::Stop, QStringLiteral("stop"));
+    errorStyleStrings.insert(DataValidation::Warning, QStringLiteral("warning"));
+    errorStyleStrings.insert(DataValidation::Information, QStringLiteral("information"));
+
+    typeValues.insert(QStringLiteral("none"), DataValidation::None);
+    typeValues.insert(QStringLiteral("whole"), DataValidation::Whole);
+    typeValues.insert(QStringLiteral("decimal"), DataValidation::Decimal);
+    typeValues.insert(QStringLiteral("list"), DataValidation::List);
+    typeValues.insert(QStringLiteral("date"), DataValidation::Date);
+    typeValues.insert(QStringLiteral("time"), DataValidation::Time);
+    typeValues.insert(QStringLiteral("textLength"), DataValidation::TextLength);
+    typeValues.insert(QStringLiteral("custom"), DataValidation::Custom);
+
+    operatorValues.insert(QStringLiteral("between"), DataValidation::Between);
+    operatorValues.insert(QStringLiteral("notBetween"), DataValidation::NotBetween);
+    operatorValues.insert(QStringLiteral("equal"), DataValidation::Equal);
+    operatorValues.insert(QStringLiteral("notEqual"), DataValidation::NotEqual);
+    operatorValues.insert(QStringLiteral("lessThan"), DataValidation::LessThan);
+    operatorValues.insert(QStringLiteral("lessThanOrEqual"), DataValidation::LessThanOrEqual);
+    operatorValues.insert(QStringLiteral("greaterThan"), DataValidation::GreaterThan);
+    operatorValues.insert(QStringLiteral("greaterThanOrEqual"), DataValidation::GreaterThanOrEqual);
+
+    errorStyleValues.insert(QStringLiteral("stop"), DataValidation::Stop);
+    errorStyleValues.insert(QStringLiteral("warning"), DataValidation::Warning);
+    errorStyleValues.insert(QStringLiteral("information"), DataValidation::Information);
+}
+
+Q_GLOBAL_STATIC(ValidationStrings, validationStrings)
+
 DataValidationPrivate::DataValidationPrivate()
     : validationType(DataValidation::None)
     , validationOperator(DataValidation::Between)
@@ -60,12 +126,19 @@ DataValidationPrivate::DataValidationPrivate(DataValidation::ValidationType type
 
 DataValidationPrivate::DataValidationPrivate(const DataValidationPrivate &other)
     : QSharedData(other)
-    , validationType(DataValidation::None)
-    , validationOperator(DataValidation::Between)
-    , errorStyle(DataValidation::Stop)
-    , allowBlank(false)
-    , isPromptMessageVisible(true)
-    , isErrorMessageVisible(true)
+    , validationType(other.validationType)
+    , validationOperator(other.validationOperator)
+    , errorStyle(other.errorStyle)
+    , allowBlank(other.allowBlank)
+    , isPromptMessageVisible(other.isPromptMessageVisible)
+    , isErrorMessageVisible(other.isErrorMessageVisible)
+    , formula1(other.formula1)
+    , formula2(other.formula2)
+    , errorMessage(other.errorMessage)
+    , errorMessageTitle(other.errorMessageTitle)
+    , promptMessage(other.promptMessage)
+    , promptMessageTitle(other.promptMessageTitle)
+    , ranges(other.ranges)
 {
 }
 
@@ -398,32 +471,10 @@ void DataValidation::addRange(const CellRange &range)
  */
 bool DataValidation::saveToXml(QXmlStreamWriter &writer) const
 {
-    static QMap<DataValidation::ValidationType, QString> typeMap;
-    static QMap<DataValidation::ValidationOperator, QString> opMap;
-    static QMap<DataValidation::ErrorStyle, QString> esMap;
-    if (typeMap.isEmpty()) {
-        typeMap.insert(DataValidation::None, QStringLiteral("none"));
-        typeMap.insert(DataValidation::Whole, QStringLiteral("whole"));
-        typeMap.insert(DataValidation::Decimal, QStringLiteral("decimal"));
-        typeMap.insert(DataValidation::List, QStringLiteral("list"));
-        typeMap.insert(DataValidation::Date, QStringLiteral("date"));
-        typeMap.insert(DataValidation::Time, QStringLiteral("time"));
-        typeMap.insert(DataValidation::TextLength, QStringLiteral("textLength"));
-        typeMap.insert(DataValidation::Custom, QStringLiteral("custom"));
-
-        opMap.insert(DataValidation::Between, QStringLiteral("between"));
-        opMap.insert(DataValidation::NotBetween, QStringLiteral("notBetween"));
-        opMap.insert(DataValidation::Equal, QStringLiteral("equal"));
-        opMap.insert(DataValidation::NotEqual, QStringLiteral("notEqual"));
-        opMap.insert(DataValidation::LessThan, QStringLiteral("lessThan"));
-        opMap.insert(DataValidation::LessThanOrEqual, QStringLiteral("lessThanOrEqual"));
-        opMap.insert(DataValidation::GreaterThan, QStringLiteral("greaterThan"));
-        opMap.insert(DataValidation::GreaterThanOrEqual, QStringLiteral("greaterThanOrEqual"));
-
-        esMap.insert(DataValidation::Stop, QStringLiteral("stop"));
-        esMap.insert(DataValidation::Warning, QStringLiteral("warning"));
-        esMap.insert(DataValidation::Information, QStringLiteral("information"));
-    }
+    const QMap<DataValidation::ValidationType, QString> &typeMap = validationStrings()->typeStrings;
+    const QMap<DataValidation::ValidationOperator, QString> &opMap =
+        validationStrings()->operatorStrings;
+    const QMap<DataValidation::ErrorStyle, QString> &esMap = validationStrings()->errorStyleStrings;
 
     writer.writeStartElement(QStringLiteral("dataValidation"));
     if (validationType() != DataValidation::None)
@@ -471,32 +522,10 @@ DataValidation DataValidation::loadFromXml(QXmlStreamReader &reader)
 {
     Q_ASSERT(reader.name() == QLatin1String("dataValidation"));
 
-    static QMap<QString, DataValidation::ValidationType> typeMap;
-    static QMap<QString, DataValidation::ValidationOperator> opMap;
-    static QMap<QString, DataValidation::ErrorStyle> esMap;
-    if (typeMap.isEmpty()) {
-        typeMap.insert(QStringLiteral("none"), DataValidation::None);
-        typeMap.insert(QStringLiteral("whole"), DataValidation::Whole);
-        typeMap.insert(QStringLiteral("decimal"), DataValidation::Decimal);
-        typeMap.insert(QStringLiteral("list"), DataValidation::List);
-        typeMap.insert(QStringLiteral("date"), DataValidation::Date);
-        typeMap.insert(QStringLiteral("time"), DataValidation::Time);
-        typeMap.insert(QStringLiteral("textLength"), DataValidation::TextLength);
-        typeMap.insert(QStringLiteral("custom"), DataValidation::Custom);
-
-        opMap.insert(QStringLiteral("between"), DataValidation::Between);
-        opMap.insert(QStringLiteral("notBetween"), DataValidation::NotBetween);
-        opMap.insert(QStringLiteral("equal"), DataValidation::Equal);
-        opMap.insert(QStringLiteral("notEqual"), DataValidation::NotEqual);
-        opMap.insert(QStringLiteral("lessThan"), DataValidation::LessThan);
-        opMap.insert(QStringLiteral("lessThanOrEqual"), DataValidation::LessThanOrEqual);
-        opMap.insert(QStringLiteral("greaterThan"), DataValidation::GreaterThan);
-        opMap.insert(QStringLiteral("greaterThanOrEqual"), DataValidation::GreaterThanOrEqual);
-
-        esMap.insert(QStringLiteral("stop"), DataValidation::Stop);
-        esMap.insert(QStringLiteral("warning"), DataValidation::Warning);
-        esMap.insert(QStringLiteral("information"), DataValidation::Information);
-    }
+    const QMap<QString, DataValidation::ValidationType> &typeMap = validationStrings()->typeValues;
+    const QMap<QString, DataValidation::ValidationOperator> &opMap =
+        validationStrings()->operatorValues;
+    const QMap<QString, DataValidation::ErrorStyle> &esMap = validationStrings()->errorStyleValues;
 
     DataValidation validation;
     QXmlStreamAttributes attrs = reader.attributes();
@@ -101,6 +101,7 @@ public:
     static DataValidation loadFromXml(QXmlStreamReader &reader);
 
 private:
+    friend class WorksheetPrivate;
     QSharedDataPointer<DataValidationPrivate> d;
 };
 
@@ -49,14 +49,12 @@ void DocPropsApp::addHeadingPair(const QString &name, int value)
     m_headingPairsList.append(qMakePair(name, value));
 }
 
+Q_GLOBAL_STATIC_WITH_ARGS(QStringList, validAppKeys,
+                          (QStringList() << QStringLiteral("manager") << QStringLiteral("company")))
+
 bool DocPropsApp::setProperty(const QString &name, const QString &value)
 {
-    static QStringList validKeys;
-    if (validKeys.isEmpty()) {
-        validKeys << QStringLiteral("manager") << QStringLiteral("company");
-    }
-
-    if (!validKeys.contains(name))
+    if (!validAppKeys()->contains(name))
         return false;
 
     if (value.isEmpty())
@@ -39,17 +39,17 @@ DocPropsCore::DocPropsCore(CreateFlag flag)
 {
 }
 
+Q_GLOBAL_STATIC_WITH_ARGS(QStringList, validCoreKeys,
+                          (QStringList() << QStringLiteral("title") << QStringLiteral("subject")
+                                         << QStringLiteral("keywords")
+                                         << QStringLiteral("description")
+                                         << QStringLiteral("category") << QStringLiteral("status")
+                                         << QStringLiteral("created")
+                                         << QStringLiteral("creator")))
+
 bool DocPropsCore::setProperty(const QString &name, const QString &value)
 {
-    static QStringList validKeys;
-    if (validKeys.isEmpty()) {
-        validKeys << QStringLiteral("title") << QStringLiteral("subject")
-                  << QStringLiteral("keywords") << QStringLiteral("description")
-                  << QStringLiteral("category") << QStringLiteral("status")
-                  << QStringLiteral("created") << QStringLiteral("creator");
-    }
-
-    if (!validKeys.contains(name))
+    if (!validCoreKeys()->contains(name))
         return false;
 
     if (value.isEmpty())
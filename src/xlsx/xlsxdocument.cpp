@@ -25,6 +25,7 @@
 
 #include "xlsxdocument.h"
 #include "xlsxdocument_p.h"
+#include "xlsxdocumenttemplate.h"
 #include "xlsxworkbook.h"
 #include "xlsxworksheet.h"
 #include "xlsxcontenttypes_p.h"
@@ -41,8 +42,14 @@
 #include "xlsxchart.h"
 #include "xlsxzipreader_p.h"
 #include "xlsxzipwriter_p.h"
+#include "xlsxdocumentstatistics_p.h"
+#include "xlsxworksheet_p.h"
+#include "xlsxtrace_p.h"
 
 #include <QFile>
+#include <QSaveFile>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QPointF>
 #include <QBuffer>
 #include <QDir>
@@ -87,6 +94,10 @@ QT_BEGIN_NAMESPACE_XLSX
 DocumentPrivate::DocumentPrivate(Document *p)
     : q_ptr(p)
     , defaultPackageName(QStringLiteral("Book1.xlsx"))
+    , loadTarget(0)
+    , valuesOnlyLoadEnabled(false)
+    , incrementalSaveEnabled(false)
+    , statisticsEnabled(false)
 {
 }
 
@@ -100,23 +111,36 @@ void DocumentPrivate::init()
         workbook = QSharedPointer<Workbook>(new Workbook(Workbook::F_NewFromScratch));
 }
 
-bool DocumentPrivate::loadPackage(QIODevice *device)
+bool DocumentPrivate::loadPackage(QIODevice *device, QFutureInterfaceBase *job)
 {
-    Q_Q(Document);
+    XLSX_TRACE_SPAN("Document::loadPackage");
+    DocumentStatisticsRecorder recorder(statisticsEnabled ? &statistics : 0,
+                                        DocumentStatistics::LoadOperation, device);
     ZipReader zipReader(device);
     QStringList filePaths = zipReader.filePaths();
+    passthroughParts.clear();
+    passthroughRelationships.clear();
+    workbookContentType.clear();
 
     // Load the Content_Types file
     if (!filePaths.contains(QLatin1String("[Content_Types].xml")))
         return false;
     contentTypes = QSharedPointer<ContentTypes>(new ContentTypes(ContentTypes::F_LoadFromExists));
-    contentTypes->loadFromXmlData(zipReader.fileData(QStringLiteral("[Content_Types].xml")));
+    contentTypes->loadFromXmlData(
+        recorder.readFile(zipReader, QStringLiteral("[Content_Types].xml")));
 
     // Load root rels file
     if (!filePaths.contains(QLatin1String("_rels/.rels")))
         return false;
     Relationships rootRels;
-    rootRels.loadFromXmlData(zipReader.fileData(QStringLiteral("_rels/.rels")));
+    rootRels.loadFromXmlData(recorder.readFile(zipReader, QStringLiteral("_rels/.rels")));
+    foreach (const XlsxRelationship &relationship, rootRels.allRelationships()) {
+        if (!relationship.type.endsWith(QLatin1String("/officeDocument"))
+            && !relationship.type.endsWith(QLatin1String("/metadata/core-properties"))
+            && !relationship.type.endsWith(QLatin1String("/extended-properties"))) {
+            passthroughRelationships.append(relationship);
+        }
+    }
 
     // load core property
     QList<XlsxRelationship> rels_core =
@@ -127,9 +151,9 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
         QString docPropsCore_Name = rels_core[0].target;
 
         DocPropsCore props(DocPropsCore::F_LoadFromExists);
-        props.loadFromXmlData(zipReader.fileData(docPropsCore_Name));
+        props.loadFromXmlData(recorder.readFile(zipReader, docPropsCore_Name));
         foreach (QString name, props.propertyNames())
-            q->setDocumentProperty(name, props.property(name));
+            documentProperties[name] = props.property(name);
     }
 
     // load app property
@@ -141,23 +165,29 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
         QString docPropsApp_Name = rels_app[0].target;
 
         DocPropsApp props(DocPropsApp::F_LoadFromExists);
-        props.loadFromXmlData(zipReader.fileData(docPropsApp_Name));
+        props.loadFromXmlData(recorder.readFile(zipReader, docPropsApp_Name));
         foreach (QString name, props.propertyNames())
-            q->setDocumentProperty(name, props.property(name));
+            documentProperties[name] = props.property(name);
     }
 
     // load workbook now, Get the workbook file path from the root rels file
     // In normal case, this should be "xl/workbook.xml"
     workbook = QSharedPointer<Workbook>(new Workbook(Workbook::F_LoadFromExists));
+    workbook->d_func()->valuesOnlyLoad = valuesOnlyLoadEnabled;
+    workbook->d_func()->loadRange = loadRange;
+    foreach (int column, loadColumns)
+        workbook->d_func()->loadColumns.insert(column);
     QList<XlsxRelationship> rels_xl =
         rootRels.documentRelationships(QStringLiteral("/officeDocument"));
     if (rels_xl.isEmpty())
         return false;
     QString xlworkbook_Path = rels_xl[0].target;
     QString xlworkbook_Dir = splitPath(xlworkbook_Path)[0];
-    workbook->relationships()->loadFromXmlData(zipReader.fileData(getRelFilePath(xlworkbook_Path)));
+    workbook->relationships()->loadFromXmlData(
+        recorder.readFile(zipReader, getRelFilePath(xlworkbook_Path)));
     workbook->setFilePath(xlworkbook_Path);
-    workbook->loadFromXmlData(zipReader.fileData(xlworkbook_Path));
+    workbook->loadFromXmlData(recorder.readFile(zipReader, xlworkbook_Path));
+    workbookContentType = contentTypes->overrideType(QLatin1Char('/') + xlworkbook_Path);
 
     // load styles
     QList<XlsxRelationship> rels_styles =
@@ -167,7 +197,8 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
         QString name = rels_styles[0].target;
         QString path = xlworkbook_Dir + QLatin1String("/") + name;
         QSharedPointer<Styles> styles(new Styles(Styles::F_LoadFromExists));
-        styles->loadFromXmlData(zipReader.fileData(path));
+        styles->loadFromXmlData(recorder.readFile(zipReader, path));
+        keepEntry(styles.data(), zipReader, path);
         workbook->d_func()->styles = styles;
     }
 
@@ -178,7 +209,10 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
         // In normal case this should be sharedStrings.xml which in xl
         QString name = rels_sharedStrings[0].target;
         QString path = xlworkbook_Dir + QLatin1String("/") + name;
-        workbook->d_func()->sharedStrings->loadFromXmlData(zipReader.fileData(path));
+        SharedStrings *sharedStrings = workbook->d_func()->sharedStrings.data();
+        sharedStrings->setRichTextLoadEnabled(!valuesOnlyLoadEnabled);
+        sharedStrings->loadFromXmlData(recorder.readFile(zipReader, path));
+        keepEntry(sharedStrings, zipReader, path);
     }
 
     // load theme
@@ -188,18 +222,31 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
         // In normal case this should be theme/theme1.xml which in xl
         QString name = rels_theme[0].target;
         QString path = xlworkbook_Dir + QLatin1String("/") + name;
-        workbook->theme()->loadFromXmlData(zipReader.fileData(path));
+        workbook->theme()->loadFromXmlData(recorder.readFile(zipReader, path));
     }
 
-    // load sheets
+    // load sheets, an asynchronous load reports each of them once loaded
+    if (job)
+        job->setProgressRange(0, workbook->sheetCount());
     for (int i = 0; i < workbook->sheetCount(); ++i) {
+        if (job && job->isCanceled())
+            return false;
         AbstractSheet *sheet = workbook->sheet(i);
         QString rel_path = getRelFilePath(sheet->filePath());
         // If the .rel file exists, load it.
         if (zipReader.filePaths().contains(rel_path))
-            sheet->relationships()->loadFromXmlData(zipReader.fileData(rel_path));
-        sheet->loadFromXmlData(zipReader.fileData(sheet->filePath()));
+            sheet->relationships()->loadFromXmlData(recorder.readFile(zipReader, rel_path));
+        sheet->loadFromXmlData(recorder.readFile(zipReader, sheet->filePath()));
+        if (sheet->sheetType() == AbstractSheet::ST_WorkSheet)
+            keepEntry(sheet, zipReader, sheet->filePath());
+        if (job) {
+            job->setProgressValue(i + 1);
+            if (loadTarget)
+                loadTarget->publishLoad(snapshot(), i);
+        }
     }
+    if (job && job->isCanceled())
+        return false;
 
     // load external links
     for (int i = 0; i < workbook->d_func()->externalLinks.count(); ++i) {
@@ -207,8 +254,8 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
         QString rel_path = getRelFilePath(link->filePath());
         // If the .rel file exists, load it.
         if (zipReader.filePaths().contains(rel_path))
-            link->relationships()->loadFromXmlData(zipReader.fileData(rel_path));
-        link->loadFromXmlData(zipReader.fileData(link->filePath()));
+            link->relationships()->loadFromXmlData(recorder.readFile(zipReader, rel_path));
+        link->loadFromXmlData(recorder.readFile(zipReader, link->filePath()));
     }
 
     // load drawings
@@ -216,15 +263,16 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
         Drawing *drawing = workbook->drawings()[i];
         QString rel_path = getRelFilePath(drawing->filePath());
         if (zipReader.filePaths().contains(rel_path))
-            drawing->relationships()->loadFromXmlData(zipReader.fileData(rel_path));
-        drawing->loadFromXmlData(zipReader.fileData(drawing->filePath()));
+            drawing->relationships()->loadFromXmlData(recorder.readFile(zipReader, rel_path));
+        drawing->loadFromXmlData(recorder.readFile(zipReader, drawing->filePath()));
     }
 
     // load charts
     QList<QSharedPointer<Chart>> chartFileToLoad = workbook->chartFiles();
     for (int i = 0; i < chartFileToLoad.size(); ++i) {
         QSharedPointer<Chart> cf = chartFileToLoad[i];
-        cf->loadFromXmlData(zipReader.fileData(cf->filePath()));
+        cf->loadFromXmlData(recorder.readFile(zipReader, cf->filePath()));
+        keepEntry(cf.data(), zipReader, cf->filePath());
     }
 
     // load media files
@@ -233,15 +281,26 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
         QSharedPointer<MediaFile> mf = mediaFileToLoad[i];
         const QString path = mf->fileName();
         const QString suffix = path.mid(path.lastIndexOf(QLatin1Char('.')) + 1);
-        mf->set(zipReader.fileData(path), suffix);
+        mf->set(recorder.readFile(zipReader, path), suffix);
     }
 
+    loadPassthroughParts(zipReader, recorder);
+
+    // A loaded workbook always has a sheet, so that activeSheet() never has to
+    // add one from the const read paths.
+    if (workbook->sheetCount() == 0)
+        workbook->addSheet();
+
+    recorder.finish(cellCount(), workbook->sharedStrings()->uniqueCount(),
+                    workbook->sharedStrings()->count());
     return true;
 }
 
-bool DocumentPrivate::savePackage(QIODevice *device) const
+bool DocumentPrivate::savePackage(QIODevice *device, QFutureInterfaceBase *job) const
 {
-    Q_Q(const Document);
+    XLSX_TRACE_SPAN("Document::savePackage");
+    DocumentStatisticsRecorder recorder(statisticsEnabled ? &statistics : 0,
+                                        DocumentStatistics::SaveOperation, device);
     ZipWriter zipWriter(device);
     if (zipWriter.error())
         return false;
@@ -254,19 +313,50 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
     // save worksheet xml files
     QList<QSharedPointer<AbstractSheet>> worksheets =
         workbook->getSheetsByTypes(AbstractSheet::ST_WorkSheet);
+    if (workbook->isFormulaCalculationEnabled()) {
+        // The formulas referring to other sheets are evaluated on every pass,
+        // which is repeated until no result changes, as a sheet may refer to
+        // the results of the following ones. A chain through all the sheets
+        // takes one pass per sheet; circular references stop there.
+        for (int pass = 0; pass < worksheets.size(); ++pass) {
+            bool changed = false;
+            for (int i = 0; i < worksheets.size(); ++i) {
+                Worksheet *sheet = static_cast<Worksheet *>(worksheets[i].data());
+                if (WorksheetPrivate::get(sheet)->recalculate()) {
+                    sheet->setModified();
+                    changed = true;
+                }
+            }
+            if (!changed)
+                break;
+        }
+    }
+    // The recalculation only counts in the total time
+    recorder.restartPart();
+
+    // An asynchronous save reports one step per sheet, and one for the rest
+    int progress = 0;
+    if (job)
+        job->setProgressRange(0, workbook->sheetCount() + 1);
+
     if (!worksheets.isEmpty())
         docPropsApp.addHeadingPair(QStringLiteral("Worksheets"), worksheets.size());
     for (int i = 0; i < worksheets.size(); ++i) {
+        if (job && job->isCanceled())
+            return false;
         QSharedPointer<AbstractSheet> sheet = worksheets[i];
         contentTypes->addWorksheetName(QStringLiteral("sheet%1").arg(i + 1));
         docPropsApp.addPartTitle(sheet->sheetName());
 
-        zipWriter.addFile(QStringLiteral("xl/worksheets/sheet%1.xml").arg(i + 1),
-                          sheet->saveToXmlData());
+        addPart(recorder, zipWriter, QStringLiteral("xl/worksheets/sheet%1.xml").arg(i + 1),
+                sheet.data(), isXmlDataReusable(static_cast<Worksheet *>(sheet.data())));
         Relationships *rel = sheet->relationships();
         if (!rel->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/worksheets/_rels/sheet%1.xml.rels").arg(i + 1),
-                              rel->saveToXmlData());
+            recorder.addFile(zipWriter,
+                             QStringLiteral("xl/worksheets/_rels/sheet%1.xml.rels").arg(i + 1),
+                             rel->saveToXmlData());
+        if (job)
+            job->setProgressValue(++progress);
     }
 
     // save chartsheet xml files
@@ -275,16 +365,21 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
     if (!chartsheets.isEmpty())
         docPropsApp.addHeadingPair(QStringLiteral("Chartsheets"), chartsheets.size());
     for (int i = 0; i < chartsheets.size(); ++i) {
+        if (job && job->isCanceled())
+            return false;
         QSharedPointer<AbstractSheet> sheet = chartsheets[i];
         contentTypes->addWorksheetName(QStringLiteral("sheet%1").arg(i + 1));
         docPropsApp.addPartTitle(sheet->sheetName());
 
-        zipWriter.addFile(QStringLiteral("xl/chartsheets/sheet%1.xml").arg(i + 1),
-                          sheet->saveToXmlData());
+        recorder.addFile(zipWriter, QStringLiteral("xl/chartsheets/sheet%1.xml").arg(i + 1),
+                         sheet->saveToXmlData());
         Relationships *rel = sheet->relationships();
         if (!rel->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/chartsheets/_rels/sheet%1.xml.rels").arg(i + 1),
-                              rel->saveToXmlData());
+            recorder.addFile(zipWriter,
+                             QStringLiteral("xl/chartsheets/_rels/sheet%1.xml.rels").arg(i + 1),
+                             rel->saveToXmlData());
+        if (job)
+            job->setProgressValue(++progress);
     }
 
     // save external links xml files
@@ -292,63 +387,70 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
         SimpleOOXmlFile *link = workbook->d_func()->externalLinks[i].data();
         contentTypes->addExternalLinkName(QStringLiteral("externalLink%1").arg(i + 1));
 
-        zipWriter.addFile(QStringLiteral("xl/externalLinks/externalLink%1.xml").arg(i + 1),
-                          link->saveToXmlData());
+        recorder.addFile(zipWriter,
+                         QStringLiteral("xl/externalLinks/externalLink%1.xml").arg(i + 1),
+                         link->saveToXmlData());
         Relationships *rel = link->relationships();
         if (!rel->isEmpty())
-            zipWriter.addFile(
+            recorder.addFile(zipWriter, 
                 QStringLiteral("xl/externalLinks/_rels/externalLink%1.xml.rels").arg(i + 1),
                 rel->saveToXmlData());
     }
 
     // save workbook xml file
     contentTypes->addWorkbook();
-    zipWriter.addFile(QStringLiteral("xl/workbook.xml"), workbook->saveToXmlData());
-    zipWriter.addFile(QStringLiteral("xl/_rels/workbook.xml.rels"),
-                      workbook->relationships()->saveToXmlData());
+    if (!workbookContentType.isEmpty())
+        contentTypes->addOverride(QStringLiteral("/xl/workbook.xml"), workbookContentType);
+    recorder.addFile(zipWriter, QStringLiteral("xl/workbook.xml"), workbook->saveToXmlData());
+    recorder.addFile(zipWriter, QStringLiteral("xl/_rels/workbook.xml.rels"),
+                     workbook->relationships()->saveToXmlData());
 
     // save drawing xml files
     for (int i = 0; i < workbook->drawings().size(); ++i) {
         contentTypes->addDrawingName(QStringLiteral("drawing%1").arg(i + 1));
 
         Drawing *drawing = workbook->drawings()[i];
-        zipWriter.addFile(QStringLiteral("xl/drawings/drawing%1.xml").arg(i + 1),
-                          drawing->saveToXmlData());
+        recorder.addFile(zipWriter, QStringLiteral("xl/drawings/drawing%1.xml").arg(i + 1),
+                         drawing->saveToXmlData());
         if (!drawing->relationships()->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/drawings/_rels/drawing%1.xml.rels").arg(i + 1),
-                              drawing->relationships()->saveToXmlData());
+            recorder.addFile(zipWriter,
+                             QStringLiteral("xl/drawings/_rels/drawing%1.xml.rels").arg(i + 1),
+                             drawing->relationships()->saveToXmlData());
     }
 
     // save docProps app/core xml file
-    foreach (QString name, q->documentPropertyNames()) {
-        docPropsApp.setProperty(name, q->documentProperty(name));
-        docPropsCore.setProperty(name, q->documentProperty(name));
+    for (QMap<QString, QString>::const_iterator it = documentProperties.constBegin();
+         it != documentProperties.constEnd(); ++it) {
+        docPropsApp.setProperty(it.key(), it.value());
+        docPropsCore.setProperty(it.key(), it.value());
     }
     contentTypes->addDocPropApp();
     contentTypes->addDocPropCore();
-    zipWriter.addFile(QStringLiteral("docProps/app.xml"), docPropsApp.saveToXmlData());
-    zipWriter.addFile(QStringLiteral("docProps/core.xml"), docPropsCore.saveToXmlData());
+    recorder.addFile(zipWriter, QStringLiteral("docProps/app.xml"), docPropsApp.saveToXmlData());
+    recorder.addFile(zipWriter, QStringLiteral("docProps/core.xml"), docPropsCore.saveToXmlData());
 
     // save sharedStrings xml file
     if (!workbook->sharedStrings()->isEmpty()) {
         contentTypes->addSharedString();
-        zipWriter.addFile(QStringLiteral("xl/sharedStrings.xml"),
-                          workbook->sharedStrings()->saveToXmlData());
+        addPart(recorder, zipWriter, QStringLiteral("xl/sharedStrings.xml"),
+                workbook->sharedStrings());
     }
 
     // save styles xml file
     contentTypes->addStyles();
-    zipWriter.addFile(QStringLiteral("xl/styles.xml"), workbook->styles()->saveToXmlData());
+    addPart(recorder, zipWriter, QStringLiteral("xl/styles.xml"), workbook->styles());
 
     // save theme xml file
     contentTypes->addTheme();
-    zipWriter.addFile(QStringLiteral("xl/theme/theme1.xml"), workbook->theme()->saveToXmlData());
+    recorder.addFile(zipWriter, QStringLiteral("xl/theme/theme1.xml"),
+                     workbook->theme()->saveToXmlData());
 
     // save chart xml files
     for (int i = 0; i < workbook->chartFiles().size(); ++i) {
         contentTypes->addChartName(QStringLiteral("chart%1").arg(i + 1));
         QSharedPointer<Chart> cf = workbook->chartFiles()[i];
-        zipWriter.addFile(QStringLiteral("xl/charts/chart%1.xml").arg(i + 1), cf->saveToXmlData());
+        addPart(recorder, zipWriter, QStringLiteral("xl/charts/chart%1.xml").arg(i + 1),
+                cf.data());
     }
 
     // save image files
@@ -357,8 +459,24 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
         if (!mf->mimeType().isEmpty())
             contentTypes->addDefault(mf->suffix(), mf->mimeType());
 
-        zipWriter.addFile(QStringLiteral("xl/media/image%1.%2").arg(i + 1).arg(mf->suffix()),
-                          mf->contents());
+        recorder.addFile(zipWriter,
+                         QStringLiteral("xl/media/image%1.%2").arg(i + 1).arg(mf->suffix()),
+                         mf->contents());
+    }
+
+    // save the parts we do not model as they were loaded, unless their
+    // path has been taken by one of the parts written above
+    const QStringList writtenPaths = zipWriter.filePaths();
+    foreach (const QString &path, passthroughPartPaths()) {
+        if (writtenPaths.contains(path))
+            continue;
+        const XlsxPassthroughPart &part = passthroughParts[path];
+        if (!part.contentType.isEmpty())
+            contentTypes->addOverride(QLatin1Char('/') + path, part.contentType);
+        if (part.entry.isValid())
+            recorder.addEntry(zipWriter, path, part.entry);
+        else
+            recorder.addFile(zipWriter, path, part.data);
     }
 
     // save root .rels xml file
@@ -369,20 +487,515 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
                                     QStringLiteral("docProps/core.xml"));
     rootrels.addDocumentRelationship(QStringLiteral("/extended-properties"),
                                      QStringLiteral("docProps/app.xml"));
-    zipWriter.addFile(QStringLiteral("_rels/.rels"), rootrels.saveToXmlData());
+    foreach (const XlsxRelationship &relationship, passthroughRelationships)
+        rootrels.addRelationship(relationship.type, relationship.target, relationship.targetMode);
+    recorder.addFile(zipWriter, QStringLiteral("_rels/.rels"), rootrels.saveToXmlData());
 
     // save content types xml file
-    zipWriter.addFile(QStringLiteral("[Content_Types].xml"), contentTypes->saveToXmlData());
+    recorder.addFile(zipWriter, QStringLiteral("[Content_Types].xml"),
+                     contentTypes->saveToXmlData());
 
-    zipWriter.close();
+    if (job && job->isCanceled())
+        return false;
+    recorder.close(zipWriter);
+    recorder.finish(cellCount(), workbook->sharedStrings()->uniqueCount(),
+                    workbook->sharedStrings()->count());
+    if (job)
+        job->setProgressValue(workbook->sheetCount() + 1);
     return true;
 }
 
+/*
+    Writes the \a part to the package as \a path. With incremental saving
+    enabled, the zip entry the part was last loaded from or saved to is
+    copied as it is stored when the part has not been modified since and
+    \a reusable is true, and the entry of a part which has to be generated
+    is kept for the next save.
+*/
+void DocumentPrivate::addPart(DocumentStatisticsRecorder &recorder, ZipWriter &zipWriter,
+                              const QString &path, AbstractOOXmlFile *part, bool reusable) const
+{
+    if (incrementalSaveEnabled && reusable) {
+        const ZipEntry entry = part->cachedEntry();
+        if (entry.isValid()) {
+            recorder.addEntry(zipWriter, path, entry);
+            return;
+        }
+    }
+
+    const ZipEntry entry = recorder.addFile(zipWriter, path, part->saveToXmlData());
+    if (incrementalSaveEnabled)
+        part->setCachedEntry(entry);
+}
+
+/*
+    Returns whether the kept zip entry of the \a sheet can be saved again
+    along with its current relationships, which are only regenerated with
+    the xml. This holds when they only refer to hyperlinks and to the
+    drawing of the sheet at the place it is saved to, whereas the parts we
+    do not write would leave dangling references.
+*/
+bool DocumentPrivate::isXmlDataReusable(Worksheet *sheet) const
+{
+    Relationships *rels = sheet->relationships();
+    int count = rels->worksheetRelationships(QStringLiteral("/hyperlink")).size();
+    if (Drawing *drawing = sheet->drawing()) {
+        QList<XlsxRelationship> drawingRels =
+            rels->worksheetRelationships(QStringLiteral("/drawing"));
+        int idx = workbook->drawings().indexOf(drawing);
+        if (drawingRels.size() != 1
+            || drawingRels[0].target != QStringLiteral("../drawings/drawing%1.xml").arg(idx + 1)) {
+            return false;
+        }
+        ++count;
+    }
+    count += sheet->d_func()->passthroughRelationships.size();
+    return rels->count() == count;
+}
+
+/*
+    Returns the package paths of the targets of the \a relationships of a
+    part in the directory \a dir.
+*/
+static QStringList targetPaths(const QString &dir, const QList<XlsxRelationship> &relationships)
+{
+    QStringList paths;
+    foreach (const XlsxRelationship &relationship, relationships) {
+        if (relationship.targetMode == QLatin1String("External"))
+            continue;
+        if (relationship.target.startsWith(QLatin1Char('/')))
+            paths.append(relationship.target.mid(1));
+        else
+            paths.append(QDir::cleanPath(dir + QLatin1Char('/') + relationship.target));
+    }
+    return paths;
+}
+
+/*
+    Returns the paths of the parts we do not model which are referred to
+    directly by the package, the workbook or the worksheets.
+*/
+QStringList DocumentPrivate::passthroughTargets() const
+{
+    QStringList paths = targetPaths(QStringLiteral("."), passthroughRelationships);
+    paths += targetPaths(QStringLiteral("xl"), workbook->d_func()->passthroughRelationships);
+    foreach (const QSharedPointer<AbstractSheet> &sheet,
+             workbook->getSheetsByTypes(AbstractSheet::ST_WorkSheet)) {
+        const Worksheet *worksheet = static_cast<Worksheet *>(sheet.data());
+        paths += targetPaths(QStringLiteral("xl/worksheets"),
+                             WorksheetPrivate::get(worksheet)->passthroughRelationships);
+    }
+    return paths;
+}
+
+/*
+    Reads the parts we do not model, such as comments, tables, pivot caches,
+    the vbaProject or custom xml, and the parts they refer to in turn.
+*/
+void DocumentPrivate::loadPassthroughParts(const ZipReader &zipReader,
+                                           DocumentStatisticsRecorder &recorder)
+{
+    const QStringList filePaths = zipReader.filePaths();
+    QStringList paths = passthroughTargets();
+    while (!paths.isEmpty()) {
+        const QString path = paths.takeFirst();
+        if (passthroughParts.contains(path) || !filePaths.contains(path))
+            continue;
+        XlsxPassthroughPart part;
+        part.entry = recorder.readEntry(zipReader, path);
+        if (!part.entry.isValid())
+            part.data = recorder.readFile(zipReader, path);
+        part.contentType = contentTypes->overrideType(QLatin1Char('/') + path);
+        passthroughParts.insert(path, part);
+
+        const QString relsPath = getRelFilePath(path);
+        if (filePaths.contains(relsPath)) {
+            XlsxPassthroughPart rels;
+            rels.data = recorder.readFile(zipReader, relsPath);
+            rels.entry = zipReader.entry(relsPath);
+            Relationships relationships;
+            relationships.loadFromXmlData(rels.data);
+            rels.targets = targetPaths(splitPath(path)[0], relationships.allRelationships());
+            if (rels.entry.isValid())
+                rels.data.clear();
+            passthroughParts.insert(relsPath, rels);
+            paths += rels.targets;
+        }
+    }
+}
+
+/*
+    Returns the paths of the parts we do not model which are still referred
+    to, leaving out the ones of the sheets which have been deleted.
+*/
+QStringList DocumentPrivate::passthroughPartPaths() const
+{
+    QStringList result;
+    QStringList paths = passthroughTargets();
+    while (!paths.isEmpty()) {
+        const QString path = paths.takeFirst();
+        if (result.contains(path) || !passthroughParts.contains(path))
+            continue;
+        result.append(path);
+
+        const QString relsPath = getRelFilePath(path);
+        if (passthroughParts.contains(relsPath)) {
+            result.append(relsPath);
+            paths += passthroughParts[relsPath].targets;
+        }
+    }
+    return result;
+}
+
+/*
+    Keeps the zip entry \a path the \a part has been loaded from, as it is
+    stored, to be copied again while the part is unmodified when
+    incremental saving is enabled.
+*/
+void DocumentPrivate::keepEntry(AbstractOOXmlFile *part, const ZipReader &zipReader,
+                                const QString &path) const
+{
+    if (incrementalSaveEnabled)
+        part->setCachedEntry(zipReader.entry(path));
+}
+
+/*
+    Returns a frozen copy of the document which can be saved by another
+    thread while this one is modified.
+*/
+QSharedPointer<DocumentPrivate> DocumentPrivate::snapshot() const
+{
+    QSharedPointer<DocumentPrivate> copy(new DocumentPrivate(0));
+    copy->packageName = packageName;
+    copy->documentProperties = documentProperties;
+    copy->workbook = QSharedPointer<Workbook>(workbook->snapshot());
+    copy->contentTypes = QSharedPointer<ContentTypes>(new ContentTypes(*contentTypes));
+    copy->passthroughParts = passthroughParts;
+    copy->passthroughRelationships = passthroughRelationships;
+    copy->workbookContentType = workbookContentType;
+    copy->incrementalSaveEnabled = incrementalSaveEnabled;
+    return copy;
+}
+
+/*
+    Makes this snapshot independent of the document it was taken from: the
+    sheets take over their cells, and the cells, rows, columns and styles get
+    formats of their own. The document keeps modifying its cells and updating
+    the indexes of its formats, which this snapshot never reads afterwards.
+    Called in the thread of the document, right after snapshot().
+*/
+void DocumentPrivate::ownContents()
+{
+    workbook->styles()->detachFormats();
+
+    QHash<QByteArray, Format> formatCopies;
+    foreach (const QSharedPointer<AbstractSheet> &sheet,
+             workbook->getSheetsByTypes(AbstractSheet::ST_WorkSheet)) {
+        WorksheetPrivate::get(static_cast<Worksheet *>(sheet.data()))->adoptCells(&formatCopies);
+    }
+}
+
+/*
+    Makes this document the frozen source of a DocumentTemplate. Each part
+    is generated and compressed once, and its zip entry kept for all the
+    copies to save again.
+    Its sheets must own their cells already. Nothing is modified afterwards,
+    as copies are made by several threads.
+*/
+void DocumentPrivate::freeze()
+{
+    init();
+    incrementalSaveEnabled = true;
+
+    foreach (const QSharedPointer<AbstractSheet> &sheet,
+             workbook->getSheetsByTypes(AbstractSheet::ST_WorkSheet))
+        WorksheetPrivate::get(static_cast<Worksheet *>(sheet.data()))->frozen = true;
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    savePackage(&buffer);
+}
+
+/*
+    Makes this empty document a copy of the frozen \a source of a template.
+    The cells, formats, theme and kept zip entries are shared with the source
+    until this document modifies them.
+*/
+void DocumentPrivate::initFromTemplate(const QSharedPointer<const DocumentPrivate> &source)
+{
+    QSharedPointer<DocumentPrivate> copy = source->snapshot();
+    templateSource = source;
+    documentProperties = copy->documentProperties;
+    workbook = copy->workbook;
+    contentTypes = copy->contentTypes;
+    passthroughParts = copy->passthroughParts;
+    passthroughRelationships = copy->passthroughRelationships;
+    workbookContentType = copy->workbookContentType;
+    incrementalSaveEnabled = true;
+}
+
+namespace {
+
+class SaveTask : public QRunnable
+{
+public:
+    SaveTask(const QSharedPointer<DocumentPrivate> &snapshot, const QString &name,
+             QIODevice *device, const QFutureInterface<bool> &job)
+        : m_snapshot(snapshot)
+        , m_name(name)
+        , m_device(device)
+        , m_job(job)
+    {
+    }
+
+    void run()
+    {
+        bool ok = false;
+        if (!m_job.isCanceled()) {
+            if (m_device) {
+                ok = m_snapshot->savePackage(m_device, &m_job);
+            } else {
+                // The file is only replaced once the save succeeded
+                QSaveFile file(m_name);
+                if (file.open(QIODevice::WriteOnly))
+                    ok = m_snapshot->savePackage(&file, &m_job) && file.commit();
+            }
+        }
+        // The snapshot is released by the thread which used it
+        m_snapshot.clear();
+        m_job.reportResult(ok);
+        m_job.reportFinished();
+    }
+
+private:
+    QSharedPointer<DocumentPrivate> m_snapshot;
+    QString m_name;
+    QIODevice *m_device;
+    QFutureInterface<bool> m_job;
+};
+
+} // namespace
+
+QFuture<bool> DocumentPrivate::saveAsync(const QString &name, QIODevice *device) const
+{
+    adoptLoad();
+    QSharedPointer<DocumentPrivate> copy = snapshot();
+    copy->ownContents();
+
+    for (int i = saveJobs.size() - 1; i >= 0; --i) {
+        if (saveJobs[i].isFinished())
+            saveJobs.removeAt(i);
+    }
+    QFutureInterface<bool> job;
+    job.reportStarted();
+    QFuture<bool> future = job.future();
+    saveJobs.append(future);
+    QThreadPool::globalInstance()->start(new SaveTask(copy, name, device, job));
+    return future;
+}
+
+/*
+    Waits for the saves started by saveAsync(), as their devices and files
+    may be expected to be complete once the document is gone.
+*/
+void DocumentPrivate::waitForSaves() const
+{
+    foreach (QFuture<bool> job, saveJobs)
+        job.waitForFinished();
+    saveJobs.clear();
+}
+
+namespace {
+
+class LoadTask : public QRunnable
+{
+public:
+    LoadTask(const QSharedPointer<DocumentPrivate> &loader, const QString &name,
+             QIODevice *device, const QFutureInterface<bool> &job)
+        : m_loader(loader)
+        , m_name(name)
+        , m_device(device)
+        , m_job(job)
+    {
+    }
+
+    void run()
+    {
+        bool ok = false;
+        if (!m_job.isCanceled()) {
+            if (m_device) {
+                ok = m_loader->loadPackage(m_device, &m_job);
+            } else {
+                QFile file(m_name);
+                if (file.open(QFile::ReadOnly))
+                    ok = m_loader->loadPackage(&file, &m_job);
+            }
+        }
+        // Once complete, the loading copy itself is handed over to the document.
+        // Otherwise the document keeps the sheets published so far.
+        if (ok)
+            m_loader->loadTarget->publishLoad(m_loader, -1);
+        m_loader.clear();
+        m_job.reportResult(ok);
+        m_job.reportFinished();
+    }
+
+private:
+    QSharedPointer<DocumentPrivate> m_loader;
+    QString m_name;
+    QIODevice *m_device;
+    QFutureInterface<bool> m_job;
+};
+
+} // namespace
+
+/*
+    Empties the document before a load of the file \a name, once the
+    previous asynchronous load has stopped.
+*/
+void DocumentPrivate::clearForLoad(const QString &name)
+{
+    waitForLoad();
+    {
+        // Drop what a canceled load published before it stopped
+        QMutexLocker locker(&loadMutex);
+        publishedLoad.clear();
+        loadPublished.storeRelease(0);
+    }
+
+    if (!name.isEmpty())
+        packageName = name;
+    documentProperties.clear();
+    templateSource.clear();
+    workbook.clear();
+    contentTypes.clear();
+    passthroughParts.clear();
+    passthroughRelationships.clear();
+    workbookContentType.clear();
+    statistics = DocumentStatistics();
+    init();
+}
+
+bool DocumentPrivate::load(const QString &name, QIODevice *device)
+{
+    clearForLoad(name);
+
+    bool ok = false;
+    if (device) {
+        ok = device->isReadable() && loadPackage(device);
+    } else {
+        QFile file(name);
+        if (file.open(QFile::ReadOnly))
+            ok = loadPackage(&file);
+    }
+    return ok;
+}
+
+/*
+    Starts loading the package into a copy owned by the loading task, so
+    that the document stays usable meanwhile. The copy publishes what it
+    has read after each sheet, which the document adopts in its own thread.
+*/
+QFuture<bool> DocumentPrivate::loadAsync(const QString &name, QIODevice *device)
+{
+    clearForLoad(name);
+
+    QSharedPointer<DocumentPrivate> loader(new DocumentPrivate(0));
+    loader->loadTarget = this;
+    loader->packageName = packageName;
+    loader->valuesOnlyLoadEnabled = valuesOnlyLoadEnabled;
+    loader->loadRange = loadRange;
+    loader->loadColumns = loadColumns;
+    loader->incrementalSaveEnabled = incrementalSaveEnabled;
+    loader->statisticsEnabled = statisticsEnabled;
+
+    QFutureInterface<bool> job;
+    job.reportStarted();
+    loadJob = job.future();
+    QThreadPool::globalInstance()->start(new LoadTask(loader, name, device, job));
+    return loadJob;
+}
+
+/*
+    Called by the loading thread with the \a contents read so far, after the
+    sheet at \a sheetIndex, or with the complete loading copy when
+    \a sheetIndex is -1. The sheetLoaded() signal is queued to the thread of
+    the document.
+*/
+void DocumentPrivate::publishLoad(const QSharedPointer<DocumentPrivate> &contents,
+                                  int sheetIndex)
+{
+    {
+        QMutexLocker locker(&loadMutex);
+        publishedLoad = contents;
+        loadPublished.storeRelease(1);
+    }
+    if (sheetIndex >= 0 && q_ptr) {
+        QMetaObject::invokeMethod(q_ptr, "sheetLoaded", Qt::QueuedConnection,
+                                  Q_ARG(int, sheetIndex));
+    }
+}
+
+/*
+    Replaces the contents of the document by the ones an asynchronous load
+    published last, if any. Called by the Document functions before they
+    use the contents, in the thread of the document.
+*/
+void DocumentPrivate::adoptLoad() const
+{
+    if (!loadPublished.loadAcquire())
+        return;
+
+    QMutexLocker locker(&loadMutex);
+    QSharedPointer<DocumentPrivate> contents = publishedLoad;
+    publishedLoad.clear();
+    loadPublished.storeRelease(0);
+    locker.unlock();
+
+    if (contents)
+        const_cast<DocumentPrivate *>(this)->adoptContents(*contents);
+}
+
+void DocumentPrivate::adoptContents(const DocumentPrivate &other)
+{
+    documentProperties = other.documentProperties;
+    workbook = other.workbook;
+    contentTypes = other.contentTypes;
+    passthroughParts = other.passthroughParts;
+    passthroughRelationships = other.passthroughRelationships;
+    workbookContentType = other.workbookContentType;
+    statistics = other.statistics;
+}
+
+void DocumentPrivate::waitForLoad()
+{
+    loadJob.cancel();
+    loadJob.waitForFinished();
+}
+
+qint64 DocumentPrivate::cellCount() const
+{
+    qint64 count = 0;
+    foreach (const QSharedPointer<AbstractSheet> &sheet,
+             workbook->getSheetsByTypes(AbstractSheet::ST_WorkSheet)) {
+        const Worksheet *worksheet = static_cast<const Worksheet *>(sheet.data());
+        typedef QMap<int, QSharedPointer<Cell>> CellRow;
+        foreach (const CellRow &row, worksheet->d_func()->cellTable)
+            count += row.size();
+    }
+    return count;
+}
+
 /*!
   \class Document
   \inmodule QtXlsx
   \brief The Document class provides a API that is used to handle the contents of .xlsx files.
 
+  Once a document has been loaded, its const read functions, and those of its
+  worksheets, cells and formats, can be called from several threads at the
+  same time, as long as no thread modifies the document meanwhile. The
+  current sheet is shared by all threads, so select it before the readers
+  start, or read through Worksheet pointers instead.
 */
 
 /*!
@@ -428,6 +1041,24 @@ Document::Document(QIODevice *device, QObject *parent)
     d_ptr->init();
 }
 
+/*!
+ * \overload
+ * Creates a new document as a copy of the \a documentTemplate. The contents
+ * of the template are shared until the document modifies them, so making
+ * many documents from one template is cheap.
+ * The \a parent argument is passed to QObject's constructor.
+ *
+ * \sa DocumentTemplate
+ */
+Document::Document(const DocumentTemplate &documentTemplate, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DocumentPrivate(this))
+{
+    if (documentTemplate.d)
+        d_ptr->initFromTemplate(documentTemplate.d);
+    d_ptr->init();
+}
+
 /*!
     \overload
 
@@ -838,6 +1469,7 @@ bool Document::defineName(const QString &name, const QString &formula, const QSt
                           const QString &scope)
 {
     Q_D(Document);
+    d->adoptLoad();
 
     return d->workbook->defineName(name, formula, comment, scope);
 }
@@ -858,6 +1490,7 @@ CellRange Document::dimension() const
 QString Document::documentProperty(const QString &key) const
 {
     Q_D(const Document);
+    d->adoptLoad();
     if (d->documentProperties.contains(key))
         return d->documentProperties[key];
     else
@@ -889,6 +1522,7 @@ QString Document::documentProperty(const QString &key) const
 void Document::setDocumentProperty(const QString &key, const QString &property)
 {
     Q_D(Document);
+    d->adoptLoad();
     d->documentProperties[key] = property;
 }
 
@@ -898,6 +1532,7 @@ void Document::setDocumentProperty(const QString &key, const QString &property)
 QStringList Document::documentPropertyNames() const
 {
     Q_D(const Document);
+    d->adoptLoad();
     return d->documentProperties.keys();
 }
 
@@ -907,6 +1542,7 @@ QStringList Document::documentPropertyNames() const
 Workbook *Document::workbook() const
 {
     Q_D(const Document);
+    d->adoptLoad();
     return d->workbook.data();
 }
 
@@ -916,6 +1552,7 @@ Workbook *Document::workbook() const
 AbstractSheet *Document::sheet(const QString &sheetName) const
 {
     Q_D(const Document);
+    d->adoptLoad();
     return d->workbook->sheet(sheetNames().indexOf(sheetName));
 }
 
@@ -926,6 +1563,7 @@ AbstractSheet *Document::sheet(const QString &sheetName) const
 bool Document::addSheet(const QString &name, AbstractSheet::SheetType type)
 {
     Q_D(Document);
+    d->adoptLoad();
     return d->workbook->addSheet(name, type);
 }
 
@@ -936,6 +1574,7 @@ bool Document::addSheet(const QString &name, AbstractSheet::SheetType type)
 bool Document::insertSheet(int index, const QString &name, AbstractSheet::SheetType type)
 {
     Q_D(Document);
+    d->adoptLoad();
     return d->workbook->insertSheet(index, name, type);
 }
 
@@ -946,6 +1585,7 @@ bool Document::insertSheet(int index, const QString &name, AbstractSheet::SheetT
 bool Document::renameSheet(const QString &oldName, const QString &newName)
 {
     Q_D(Document);
+    d->adoptLoad();
     if (oldName == newName)
         return false;
     return d->workbook->renameSheet(sheetNames().indexOf(oldName), newName);
@@ -958,6 +1598,7 @@ bool Document::renameSheet(const QString &oldName, const QString &newName)
 bool Document::copySheet(const QString &srcName, const QString &distName)
 {
     Q_D(Document);
+    d->adoptLoad();
     if (srcName == distName)
         return false;
     return d->workbook->copySheet(sheetNames().indexOf(srcName), distName);
@@ -970,6 +1611,7 @@ bool Document::copySheet(const QString &srcName, const QString &distName)
 bool Document::moveSheet(const QString &srcName, int distIndex)
 {
     Q_D(Document);
+    d->adoptLoad();
     return d->workbook->moveSheet(sheetNames().indexOf(srcName), distIndex);
 }
 
@@ -980,6 +1622,7 @@ bool Document::moveSheet(const QString &srcName, int distIndex)
 bool Document::deleteSheet(const QString &name)
 {
     Q_D(Document);
+    d->adoptLoad();
     return d->workbook->deleteSheet(sheetNames().indexOf(name));
 }
 
@@ -989,6 +1632,7 @@ bool Document::deleteSheet(const QString &name)
 AbstractSheet *Document::currentSheet() const
 {
     Q_D(const Document);
+    d->adoptLoad();
 
     return d->workbook->activeSheet();
 }
@@ -1013,6 +1657,7 @@ Worksheet *Document::currentWorksheet() const
 bool Document::selectSheet(const QString &name)
 {
     Q_D(Document);
+    d->adoptLoad();
     return d->workbook->setActiveSheet(sheetNames().indexOf(name));
 }
 
@@ -1022,6 +1667,7 @@ bool Document::selectSheet(const QString &name)
 QStringList Document::sheetNames() const
 {
     Q_D(const Document);
+    d->adoptLoad();
     return d->workbook->worksheetNames();
 }
 
@@ -1059,14 +1705,287 @@ bool Document::saveAs(const QString &name) const
 bool Document::saveAs(QIODevice *device) const
 {
     Q_D(const Document);
+    d->adoptLoad();
     return d->savePackage(device);
 }
 
+/*!
+ * Replaces the contents of the document with the xlsx file named \a name,
+ * and returns whether it was loaded successfully. Unlike the constructors,
+ * the load honours the settings of the document, such as
+ * setValuesOnlyLoadEnabled(), setLoadRange() and setLoadColumns().
+ *
+ * A load which fails leaves the document with what could be read.
+ *
+ * \sa loadAsync()
+ */
+bool Document::load(const QString &name)
+{
+    Q_D(Document);
+    return d->load(name, 0);
+}
+
+/*!
+ * \overload
+ * Replaces the contents of the document with the xlsx data read from
+ * \a device, and returns whether it was loaded successfully.
+ */
+bool Document::load(QIODevice *device)
+{
+    Q_D(Document);
+    return device && d->load(QString(), device);
+}
+
+/*!
+ * Replaces the contents of the document with the xlsx file named \a name,
+ * which is read in a thread of the global QThreadPool, and returns a future
+ * holding whether it was loaded successfully.
+ *
+ * The package is read into a copy owned by the loading thread, and the
+ * document is empty until the first sheet has been read. The sheets are
+ * parsed in order. Once the sheet at a given index has been read, the
+ * progress of the future is set to the number of sheets read, the document
+ * gets the sheets read so far, and the sheetLoaded() signal is emitted with
+ * that index. The remaining contents, such as images and charts, are swapped
+ * in once the future has finished.
+ *
+ * The document can be used while it is loading, from its own thread, but
+ * the changes made meanwhile are discarded when the next sheet is handed
+ * over. Canceling the future stops the load between two sheets and
+ * releases the file; the document then holds the sheets read so far. A
+ * canceled future has no result.
+ *
+ * \sa sheetLoaded()
+ */
+QFuture<bool> Document::loadAsync(const QString &name)
+{
+    Q_D(Document);
+    return d->loadAsync(name, 0);
+}
+
+/*!
+ * \overload
+ * Replaces the contents of the document with the xlsx data read from
+ * \a device in a thread of the global QThreadPool. The \a device must not
+ * be used or destroyed before the returned future has finished.
+ */
+QFuture<bool> Document::loadAsync(QIODevice *device)
+{
+    Q_D(Document);
+    return d->loadAsync(QString(), device);
+}
+
+/*!
+ * \fn void Document::sheetLoaded(int index)
+ *
+ * This signal is emitted by loadAsync() once the sheet at \a index has
+ * been read. It is queued to the thread of the document, whose event loop
+ * delivers it.
+ */
+
+/*!
+ * Saves the document to the file with the given \a name in a thread of
+ * the global QThreadPool, and returns a future holding whether it was
+ * saved successfully.
+ *
+ * The document is frozen when this function is called: the saved copy gets
+ * its own cells, formats and shared strings, so the document can be
+ * modified right away without affecting the file being written. Destroying
+ * the document waits for the saves it started.
+ *
+ * The progress of the future advances once per sheet. Canceling the future
+ * stops the save between two sheets and leaves any existing file intact; a
+ * canceled future has no result.
+ *
+ * \note The statistics of an asynchronous save are not recorded.
+ */
+QFuture<bool> Document::saveAsync(const QString &name) const
+{
+    Q_D(const Document);
+    return d->saveAsync(name, 0);
+}
+
+/*!
+ * \overload
+ * Saves the document to the given \a device in a thread of the global
+ * QThreadPool. The \a device must not be used or destroyed before the
+ * returned future has finished.
+ */
+QFuture<bool> Document::saveAsync(QIODevice *device) const
+{
+    Q_D(const Document);
+    return d->saveAsync(QString(), device);
+}
+
+/*!
+ * Enables or disables, according to \a enable, values only loading. It is
+ * disabled by default.
+ *
+ * When enabled, the following loads only read what is needed to get the
+ * values of the cells: no format is kept for the cells, except the number
+ * format of the cells holding dates and times so that read() still returns
+ * them as such, the rich text of the strings is read as plain text, and the
+ * data validations, the conditional formatting, the drawings and the charts
+ * of the worksheets are skipped. This makes loading large documents faster and
+ * lighter, but saving such a document loses what has been skipped.
+ *
+ * As the document constructors load the package right away, enable it on
+ * an empty document before load() or loadAsync().
+ *
+ * \sa load(), loadAsync()
+ */
+void Document::setValuesOnlyLoadEnabled(bool enable)
+{
+    Q_D(Document);
+    d->valuesOnlyLoadEnabled = enable;
+}
+
+/*!
+ * Returns whether values only loading is enabled.
+ *
+ * \sa setValuesOnlyLoadEnabled()
+ */
+bool Document::isValuesOnlyLoadEnabled() const
+{
+    Q_D(const Document);
+    return d->valuesOnlyLoadEnabled;
+}
+
+/*!
+ * Restricts the following loads to the cells of \a range, which must be
+ * valid; an invalid range, the default, loads all of them.
+ *
+ * The rows and the cells of the sheets outside of the range are skipped
+ * without reading their values, so that a part of a large document is
+ * loaded faster. The dimension of the loaded sheets is the one of the cells
+ * loaded. Saving such a document loses the skipped cells.
+ *
+ * As the document constructors load the package right away, set it on an
+ * empty document before load() or loadAsync().
+ *
+ * \sa setLoadColumns(), load(), loadAsync()
+ */
+void Document::setLoadRange(const CellRange &range)
+{
+    Q_D(Document);
+    d->loadRange = range;
+}
+
+/*!
+ * Returns the range of the cells loaded, or an invalid range if all of
+ * them are.
+ *
+ * \sa setLoadRange()
+ */
+CellRange Document::loadRange() const
+{
+    Q_D(const Document);
+    return d->loadRange;
+}
+
+/*!
+ * Restricts the following loads to the cells of the given \a columns,
+ * numbered from 1; an empty list, the default, loads all of them. When a
+ * load range is set too, only the cells of the range in these columns are
+ * loaded.
+ *
+ * \sa setLoadRange(), load(), loadAsync()
+ */
+void Document::setLoadColumns(const QList<int> &columns)
+{
+    Q_D(Document);
+    d->loadColumns = columns;
+}
+
+/*!
+ * Returns the columns of the cells loaded, or an empty list if all of them
+ * are.
+ *
+ * \sa setLoadColumns()
+ */
+QList<int> Document::loadColumns() const
+{
+    Q_D(const Document);
+    return d->loadColumns;
+}
+
+/*!
+ * Enables or disables, according to \a enable, incremental saving. It is
+ * disabled by default.
+ *
+ * When enabled, the zip entries of the worksheets, the shared strings, the
+ * styles and the charts are kept, compressed as they are stored, once they
+ * have been loaded or saved, and copied as they are by the following saves
+ * as long as the part has not been modified. Saving a large document after
+ * a few changes then only generates and compresses the parts which have
+ * changed, at the cost of the memory taken by the compressed entries.
+ *
+ * As the document constructors load the package right away, enable it on
+ * an empty document before load() or loadAsync() to keep the loaded parts.
+ *
+ * \sa load(), loadAsync()
+ */
+void Document::setIncrementalSaveEnabled(bool enable)
+{
+    Q_D(Document);
+    d->incrementalSaveEnabled = enable;
+}
+
+/*!
+ * Returns whether incremental saving is enabled.
+ *
+ * \sa setIncrementalSaveEnabled()
+ */
+bool Document::isIncrementalSaveEnabled() const
+{
+    Q_D(const Document);
+    return d->incrementalSaveEnabled;
+}
+
+/*!
+ * Enables or disables, according to \a enable, the collection of
+ * statistics when the document is saved or loaded with load() or
+ * loadAsync(). It is disabled by default, so a document loaded by its
+ * constructor has no statistics.
+ *
+ * \sa statistics()
+ */
+void Document::setStatisticsEnabled(bool enable)
+{
+    Q_D(Document);
+    d->statisticsEnabled = enable;
+}
+
+/*!
+ * Returns whether statistics are collected when the document is saved or
+ * loaded.
+ */
+bool Document::isStatisticsEnabled() const
+{
+    Q_D(const Document);
+    return d->statisticsEnabled;
+}
+
+/*!
+ * Returns the statistics of the last save or load done with statistics
+ * enabled. A load clears the statistics of the previous operations.
+ *
+ * \sa setStatisticsEnabled()
+ */
+DocumentStatistics Document::statistics() const
+{
+    Q_D(const Document);
+    d->adoptLoad();
+    return d->statistics;
+}
+
 /*!
  * Destroys the document and cleans up.
  */
 Document::~Document()
 {
+    d_ptr->waitForLoad();
+    d_ptr->waitForSaves();
     delete d_ptr;
 }
 
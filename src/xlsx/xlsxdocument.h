@@ -29,7 +29,9 @@
 #include "xlsxglobal.h"
 #include "xlsxformat.h"
 #include "xlsxworksheet.h"
+#include "xlsxdocumentstatistics.h"
 #include <QObject>
+#include <QFuture>
 #include <QVariant>
 class QIODevice;
 class QImage;
@@ -43,6 +45,7 @@ class DataValidation;
 class ConditionalFormatting;
 class Chart;
 class CellReference;
+class DocumentTemplate;
 
 class DocumentPrivate;
 class Q_XLSX_EXPORT Document : public QObject
@@ -54,6 +57,7 @@ public:
     explicit Document(QObject *parent = 0);
     Document(const QString &xlsxName, QObject *parent = 0);
     Document(QIODevice *device, QObject *parent = 0);
+    Document(const DocumentTemplate &documentTemplate, QObject *parent = 0);
     ~Document();
 
     bool write(const CellReference &cell, const QVariant &value, const Format &format = Format());
@@ -125,8 +129,30 @@ public:
     bool save() const;
     bool saveAs(const QString &xlsXname) const;
     bool saveAs(QIODevice *device) const;
+    QFuture<bool> saveAsync(const QString &name) const;
+    QFuture<bool> saveAsync(QIODevice *device) const;
+    bool load(const QString &name);
+    bool load(QIODevice *device);
+    QFuture<bool> loadAsync(const QString &name);
+    QFuture<bool> loadAsync(QIODevice *device);
+
+    void setValuesOnlyLoadEnabled(bool enable);
+    bool isValuesOnlyLoadEnabled() const;
+    void setLoadRange(const CellRange &range);
+    CellRange loadRange() const;
+    void setLoadColumns(const QList<int> &columns);
+    QList<int> loadColumns() const;
+    void setIncrementalSaveEnabled(bool enable);
+    bool isIncrementalSaveEnabled() const;
+    void setStatisticsEnabled(bool enable);
+    bool isStatisticsEnabled() const;
+    DocumentStatistics statistics() const;
+
+signals:
+    void sheetLoaded(int index);
 
 private:
+    friend class DocumentTemplate;
     Q_DISABLE_COPY(Document)
     DocumentPrivate *const d_ptr;
 };
@@ -38,13 +38,30 @@
 //
 
 #include "xlsxdocument.h"
+#include "xlsxdocumentstatistics.h"
 #include "xlsxworkbook.h"
+#include "xlsxcellrange.h"
 #include "xlsxcontenttypes_p.h"
+#include "xlsxrelationships_p.h"
+#include "xlsxzipreader_p.h"
 
 #include <QMap>
+#include <QFutureInterface>
+#include <QMutex>
 
 namespace QXlsx {
 
+class ZipWriter;
+class DocumentStatisticsRecorder;
+
+struct XlsxPassthroughPart
+{
+    ZipEntry entry; // as stored, copied without being inflated
+    QByteArray data; // only when the entry can't be copied as it is
+    QString contentType; // of its Override, if any
+    QStringList targets; // of a relationships part, the paths it refers to
+};
+
 class DocumentPrivate
 {
     Q_DECLARE_PUBLIC(Document)
@@ -52,16 +69,63 @@ public:
     DocumentPrivate(Document *p);
     void init();
 
-    bool loadPackage(QIODevice *device);
-    bool savePackage(QIODevice *device) const;
+    bool loadPackage(QIODevice *device, QFutureInterfaceBase *job = 0);
+    void loadPassthroughParts(const ZipReader &zipReader, DocumentStatisticsRecorder &recorder);
+    QStringList passthroughTargets() const;
+    QStringList passthroughPartPaths() const;
+    void clearForLoad(const QString &name);
+    bool load(const QString &name, QIODevice *device);
+    QFuture<bool> loadAsync(const QString &name, QIODevice *device);
+    void publishLoad(const QSharedPointer<DocumentPrivate> &contents, int sheetIndex);
+    void adoptLoad() const;
+    void adoptContents(const DocumentPrivate &other);
+    void waitForLoad();
+    bool savePackage(QIODevice *device, QFutureInterfaceBase *job = 0) const;
+    void addPart(DocumentStatisticsRecorder &recorder, ZipWriter &zipWriter, const QString &path,
+                 AbstractOOXmlFile *part, bool reusable = true) const;
+    bool isXmlDataReusable(Worksheet *sheet) const;
+    void keepEntry(AbstractOOXmlFile *part, const ZipReader &zipReader,
+                   const QString &path) const;
+    QSharedPointer<DocumentPrivate> snapshot() const;
+    void ownContents();
+    void freeze();
+    void initFromTemplate(const QSharedPointer<const DocumentPrivate> &source);
+    QFuture<bool> saveAsync(const QString &name, QIODevice *device) const;
+    void waitForSaves() const;
+    qint64 cellCount() const;
 
     Document *q_ptr;
     const QString defaultPackageName; // default name when package name not specified
     QString packageName; // name of the .xlsx file
 
     QMap<QString, QString> documentProperties; // core, app and custom properties
+    // The frozen document of the template this one was made from, which
+    // still owns the cells and parts shared with it
+    QSharedPointer<const DocumentPrivate> templateSource;
     QSharedPointer<Workbook> workbook;
     QSharedPointer<ContentTypes> contentTypes;
+
+    // The parts we do not model by path, saved as they were loaded, and the
+    // package relationships referring to them
+    QMap<QString, XlsxPassthroughPart> passthroughParts;
+    QList<XlsxRelationship> passthroughRelationships;
+    QString workbookContentType; // as loaded, such as the one of macro-enabled workbooks
+
+    QFuture<bool> loadJob;
+    // The contents an asynchronous load has read so far, published by the
+    // loading thread and adopted by the thread of the document
+    mutable QMutex loadMutex;
+    mutable QSharedPointer<DocumentPrivate> publishedLoad;
+    mutable QAtomicInt loadPublished;
+    DocumentPrivate *loadTarget; // the document a loading copy publishes to
+    mutable QList<QFuture<bool>> saveJobs; // still running, waited for on destruction
+
+    bool valuesOnlyLoadEnabled;
+    CellRange loadRange; // of the cells to load, all of them when invalid
+    QList<int> loadColumns; // to load, all of them when empty
+    bool incrementalSaveEnabled;
+    bool statisticsEnabled;
+    mutable DocumentStatistics statistics; // of the last save or load
 };
 }
 
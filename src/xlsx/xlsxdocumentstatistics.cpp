@@ -0,0 +1,594 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "xlsxdocumentstatistics.h"
+#include "xlsxdocumentstatistics_p.h"
+#include "xlsxzipreader_p.h"
+#include "xlsxzipwriter_p.h"
+
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#if defined(Q_OS_WIN)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+QT_BEGIN_NAMESPACE_XLSX
+
+DocumentStatisticsPrivate::DocumentStatisticsPrivate()
+    : operation(DocumentStatistics::NoOperation)
+    , wallTime(0)
+    , cpuTime(0)
+    , zipWallTime(0)
+    , zipCpuTime(0)
+    , packageSize(0)
+    , cellCount(0)
+    , stringCount(0)
+    , stringReferenceCount(0)
+    , peakMemoryUsage(-1)
+{
+}
+
+/*!
+    \class DocumentStatistics
+    \inmodule QtXlsx
+    \brief The DocumentStatistics class describes where the time and bytes
+    of the last save or load of a Document went.
+
+    The statistics are split per package part: every worksheet, the shared
+    strings table, the styles and so on. For each part the wall clock and
+    CPU time spent in the xml writer or reader are reported separately from
+    the time spent in the zip compression, together with the uncompressed
+    and compressed sizes. All times are in nanoseconds and all sizes in
+    bytes.
+
+    \sa Document::setStatisticsEnabled(), Document::statistics()
+*/
+
+/*!
+    \enum DocumentStatistics::Operation
+
+    \value NoOperation No save or load has been recorded.
+    \value SaveOperation The statistics describe a save.
+    \value LoadOperation The statistics describe a load.
+*/
+
+/*!
+    \class DocumentStatistics::Part
+    \inmodule QtXlsx
+    \brief The Part class holds the statistics of one file of the package.
+
+    The compressed size of a saved part includes the zip local header of the
+    entry. It is -1 for loaded parts, as the zip reader does not report it.
+*/
+
+DocumentStatistics::Part::Part()
+    : wallTime(0)
+    , cpuTime(0)
+    , zipWallTime(0)
+    , zipCpuTime(0)
+    , uncompressedSize(0)
+    , compressedSize(-1)
+{
+}
+
+/*!
+    Returns the uncompressed size divided by the compressed size, or 0 if
+    the compressed size is unknown.
+*/
+double DocumentStatistics::Part::compressionRatio() const
+{
+    if (compressedSize <= 0)
+        return 0;
+    return double(uncompressedSize) / compressedSize;
+}
+
+/*!
+    Constructs empty statistics.
+*/
+DocumentStatistics::DocumentStatistics()
+    : d(new DocumentStatisticsPrivate)
+{
+}
+
+/*!
+    Constructs a copy of \a other.
+*/
+DocumentStatistics::DocumentStatistics(const DocumentStatistics &other)
+    : d(other.d)
+{
+}
+
+/*!
+    Destroys the statistics.
+*/
+DocumentStatistics::~DocumentStatistics()
+{
+}
+
+/*!
+    Assigns \a other to this object and returns a reference to it.
+*/
+DocumentStatistics &DocumentStatistics::operator=(const DocumentStatistics &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    Returns true if a save or a load has been recorded.
+*/
+bool DocumentStatistics::isValid() const
+{
+    return d->operation != NoOperation;
+}
+
+/*!
+    Returns the recorded operation.
+*/
+DocumentStatistics::Operation DocumentStatistics::operation() const
+{
+    return d->operation;
+}
+
+/*!
+    Returns the wall clock time of the whole operation.
+*/
+qint64 DocumentStatistics::wallTime() const
+{
+    return d->wallTime;
+}
+
+/*!
+    Returns the CPU time of the process during the whole operation.
+*/
+qint64 DocumentStatistics::cpuTime() const
+{
+    return d->cpuTime;
+}
+
+/*!
+    Returns the wall clock time spent in the zip layer, including the central
+    directory.
+*/
+qint64 DocumentStatistics::zipWallTime() const
+{
+    return d->zipWallTime;
+}
+
+/*!
+    Returns the CPU time spent in the zip layer.
+*/
+qint64 DocumentStatistics::zipCpuTime() const
+{
+    return d->zipCpuTime;
+}
+
+/*!
+    Returns the parts in the order they were written or read.
+*/
+QList<DocumentStatistics::Part> DocumentStatistics::parts() const
+{
+    return d->parts;
+}
+
+/*!
+    Returns the statistics of the part named \a path, or an empty part if
+    no such part was recorded.
+*/
+DocumentStatistics::Part DocumentStatistics::part(const QString &path) const
+{
+    foreach (const Part &part, d->parts) {
+        if (part.path == path)
+            return part;
+    }
+    return Part();
+}
+
+/*!
+    Returns the size of the whole package.
+*/
+qint64 DocumentStatistics::packageSize() const
+{
+    return d->packageSize;
+}
+
+/*!
+    Returns the sum of the uncompressed sizes of all parts.
+*/
+qint64 DocumentStatistics::uncompressedSize() const
+{
+    qint64 size = 0;
+    foreach (const Part &part, d->parts)
+        size += part.uncompressedSize;
+    return size;
+}
+
+/*!
+    Returns the uncompressed size of the largest part. Since a part is held
+    in memory as a whole while it is written or read, this is a lower bound
+    of the memory the operation needs on top of the document itself.
+*/
+qint64 DocumentStatistics::largestPartSize() const
+{
+    qint64 size = 0;
+    foreach (const Part &part, d->parts)
+        size = qMax(size, part.uncompressedSize);
+    return size;
+}
+
+/*!
+    Returns the sum of the uncompressed sizes divided by the package size.
+*/
+double DocumentStatistics::compressionRatio() const
+{
+    if (d->packageSize <= 0)
+        return 0;
+    return double(uncompressedSize()) / d->packageSize;
+}
+
+/*!
+    Returns the number of cells in all the worksheets.
+*/
+qint64 DocumentStatistics::cellCount() const
+{
+    return d->cellCount;
+}
+
+/*!
+    Returns the number of unique strings in the shared strings table.
+*/
+int DocumentStatistics::stringCount() const
+{
+    return d->stringCount;
+}
+
+/*!
+    Returns the number of cells referencing the shared strings table.
+*/
+int DocumentStatistics::stringReferenceCount() const
+{
+    return d->stringReferenceCount;
+}
+
+/*!
+    Returns the peak resident set size of the process at the end of the
+    operation, or -1 if it is not available on this platform.
+*/
+qint64 DocumentStatistics::peakMemoryUsage() const
+{
+    return d->peakMemoryUsage;
+}
+
+/*!
+    Returns the statistics as an indented JSON document.
+*/
+QByteArray DocumentStatistics::toJson() const
+{
+    QJsonObject root;
+    switch (d->operation) {
+    case SaveOperation:
+        root.insert(QStringLiteral("operation"), QStringLiteral("save"));
+        break;
+    case LoadOperation:
+        root.insert(QStringLiteral("operation"), QStringLiteral("load"));
+        break;
+    default:
+        root.insert(QStringLiteral("operation"), QStringLiteral("none"));
+        break;
+    }
+    // JSON numbers are doubles, which hold integers exactly up to 2^53
+    root.insert(QStringLiteral("wallTime"), double(d->wallTime));
+    root.insert(QStringLiteral("cpuTime"), double(d->cpuTime));
+    root.insert(QStringLiteral("zipWallTime"), double(d->zipWallTime));
+    root.insert(QStringLiteral("zipCpuTime"), double(d->zipCpuTime));
+    root.insert(QStringLiteral("packageSize"), double(d->packageSize));
+    root.insert(QStringLiteral("uncompressedSize"), double(uncompressedSize()));
+    root.insert(QStringLiteral("largestPartSize"), double(largestPartSize()));
+    root.insert(QStringLiteral("compressionRatio"), compressionRatio());
+    root.insert(QStringLiteral("cellCount"), double(d->cellCount));
+    root.insert(QStringLiteral("stringCount"), d->stringCount);
+    root.insert(QStringLiteral("stringReferenceCount"), d->stringReferenceCount);
+    root.insert(QStringLiteral("peakMemoryUsage"), double(d->peakMemoryUsage));
+
+    QJsonArray parts;
+    foreach (const Part &part, d->parts) {
+        QJsonObject object;
+        object.insert(QStringLiteral("path"), part.path);
+        object.insert(QStringLiteral("wallTime"), double(part.wallTime));
+        object.insert(QStringLiteral("cpuTime"), double(part.cpuTime));
+        object.insert(QStringLiteral("zipWallTime"), double(part.zipWallTime));
+        object.insert(QStringLiteral("zipCpuTime"), double(part.zipCpuTime));
+        object.insert(QStringLiteral("uncompressedSize"), double(part.uncompressedSize));
+        object.insert(QStringLiteral("compressedSize"), double(part.compressedSize));
+        object.insert(QStringLiteral("compressionRatio"), part.compressionRatio());
+        parts.append(object);
+    }
+    root.insert(QStringLiteral("parts"), parts);
+
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+DocumentStatisticsRecorder::DocumentStatisticsRecorder(DocumentStatistics *statistics,
+                                                       DocumentStatistics::Operation operation,
+                                                       QIODevice *device)
+    : m_statistics(statistics)
+    , m_operation(operation)
+    , m_device(device)
+    , m_startPos(0)
+    , m_totalCpuStart(0)
+    , m_partCpuStart(0)
+    , m_pendingPart(false)
+    , m_zipWallTime(0)
+    , m_zipCpuTime(0)
+{
+    if (!m_statistics)
+        return;
+    if (!m_device->isSequential())
+        m_startPos = m_device->pos();
+    m_totalTimer.start();
+    m_totalCpuStart = processCpuTime();
+    restartPart();
+}
+
+/*
+    Forgets the time spent since the last part, so that work which does not
+    belong to the next part is not charged to it.
+*/
+void DocumentStatisticsRecorder::restartPart()
+{
+    if (!m_statistics)
+        return;
+    finishPendingPart();
+    m_partTimer.start();
+    m_partCpuStart = processCpuTime();
+}
+
+ZipEntry DocumentStatisticsRecorder::addFile(ZipWriter &writer, const QString &path,
+                                             const QByteArray &data)
+{
+    ZipEntry entry;
+    if (!m_statistics) {
+        entry = writer.addFile(path, data);
+        return entry;
+    }
+
+    // ZipWriter writes the entry to the device before returning
+    const qint64 pos = m_device->isSequential() ? -1 : m_device->pos();
+    QElapsedTimer zipTimer;
+    zipTimer.start();
+    const qint64 zipCpuStart = processCpuTime();
+    entry = writer.addFile(path, data);
+    recordFile(path, data.size(), pos, zipTimer, zipCpuStart);
+    return entry;
+}
+
+/*
+    Writes the \a entry of another package as it is stored.
+*/
+void DocumentStatisticsRecorder::addEntry(ZipWriter &writer, const QString &path,
+                                          const ZipEntry &entry)
+{
+    if (!m_statistics) {
+        writer.addEntry(path, entry);
+        return;
+    }
+
+    const qint64 pos = m_device->isSequential() ? -1 : m_device->pos();
+    QElapsedTimer zipTimer;
+    zipTimer.start();
+    const qint64 zipCpuStart = processCpuTime();
+    writer.addEntry(path, entry);
+    recordFile(path, entry.uncompressedSize, pos, zipTimer, zipCpuStart);
+}
+
+/*
+    Records the part \a path just written from the device position \a pos,
+    the time since the previous part being the one spent generating it.
+*/
+void DocumentStatisticsRecorder::recordFile(const QString &path, qint64 uncompressedSize,
+                                            qint64 pos, const QElapsedTimer &zipTimer,
+                                            qint64 zipCpuStart)
+{
+    DocumentStatistics::Part part;
+    part.path = path;
+    part.zipWallTime = zipTimer.nsecsElapsed();
+    part.zipCpuTime = processCpuTime() - zipCpuStart;
+    part.wallTime = m_partTimer.nsecsElapsed() - part.zipWallTime;
+    part.cpuTime = processCpuTime() - m_partCpuStart - part.zipCpuTime;
+    part.uncompressedSize = uncompressedSize;
+    if (pos != -1)
+        part.compressedSize = m_device->pos() - pos;
+
+    m_zipWallTime += part.zipWallTime;
+    m_zipCpuTime += part.zipCpuTime;
+    m_parts.append(part);
+    restartPart();
+}
+
+void DocumentStatisticsRecorder::close(ZipWriter &writer)
+{
+    if (!m_statistics) {
+        writer.close();
+        return;
+    }
+
+    QElapsedTimer zipTimer;
+    zipTimer.start();
+    const qint64 zipCpuStart = processCpuTime();
+    writer.close();
+    m_zipWallTime += zipTimer.nsecsElapsed();
+    m_zipCpuTime += processCpuTime() - zipCpuStart;
+}
+
+QByteArray DocumentStatisticsRecorder::readFile(const ZipReader &reader, const QString &path)
+{
+    if (!m_statistics)
+        return reader.fileData(path);
+
+    finishPendingPart();
+
+    DocumentStatistics::Part part;
+    part.path = path;
+    QElapsedTimer zipTimer;
+    zipTimer.start();
+    const qint64 zipCpuStart = processCpuTime();
+    const QByteArray data = reader.fileData(path);
+    part.zipWallTime = zipTimer.nsecsElapsed();
+    part.zipCpuTime = processCpuTime() - zipCpuStart;
+    part.uncompressedSize = data.size();
+
+    m_zipWallTime += part.zipWallTime;
+    m_zipCpuTime += part.zipCpuTime;
+    m_parts.append(part);
+
+    // The parsing of this part is charged to it by the next call
+    m_pendingPart = true;
+    m_partTimer.start();
+    m_partCpuStart = processCpuTime();
+    return data;
+}
+
+/*
+    Reads the entry \a path as it is stored, to be copied without being
+    inflated. Nothing is parsed, so the part takes no time besides reading.
+*/
+ZipEntry DocumentStatisticsRecorder::readEntry(const ZipReader &reader, const QString &path)
+{
+    if (!m_statistics)
+        return reader.entry(path);
+
+    finishPendingPart();
+
+    DocumentStatistics::Part part;
+    part.path = path;
+    QElapsedTimer zipTimer;
+    zipTimer.start();
+    const qint64 zipCpuStart = processCpuTime();
+    const ZipEntry entry = reader.entry(path);
+    part.zipWallTime = zipTimer.nsecsElapsed();
+    part.zipCpuTime = processCpuTime() - zipCpuStart;
+    part.uncompressedSize = entry.uncompressedSize;
+    part.compressedSize = entry.data.size();
+
+    m_zipWallTime += part.zipWallTime;
+    m_zipCpuTime += part.zipCpuTime;
+    m_parts.append(part);
+    restartPart();
+    return entry;
+}
+
+void DocumentStatisticsRecorder::finishPendingPart()
+{
+    if (!m_pendingPart)
+        return;
+    DocumentStatistics::Part &part = m_parts.last();
+    part.wallTime = m_partTimer.nsecsElapsed();
+    part.cpuTime = processCpuTime() - m_partCpuStart;
+    m_pendingPart = false;
+}
+
+void DocumentStatisticsRecorder::finish(qint64 cellCount, int stringCount, int stringReferenceCount)
+{
+    if (!m_statistics)
+        return;
+    finishPendingPart();
+
+    DocumentStatisticsPrivate *d = m_statistics->d.data();
+    d->operation = m_operation;
+    d->wallTime = m_totalTimer.nsecsElapsed();
+    d->cpuTime = processCpuTime() - m_totalCpuStart;
+    d->zipWallTime = m_zipWallTime;
+    d->zipCpuTime = m_zipCpuTime;
+    d->parts = m_parts;
+    if (m_device->isSequential())
+        d->packageSize = -1;
+    else if (m_operation == DocumentStatistics::SaveOperation && m_device->isOpen())
+        d->packageSize = m_device->pos() - m_startPos;
+    else
+        d->packageSize = m_device->size() - m_startPos;
+    d->cellCount = cellCount;
+    d->stringCount = stringCount;
+    d->stringReferenceCount = stringReferenceCount;
+    d->peakMemoryUsage = peakMemoryUsage();
+}
+
+/*
+    Returns the user and system time consumed by the process, in nanoseconds.
+*/
+qint64 DocumentStatisticsRecorder::processCpuTime()
+{
+#if defined(Q_OS_WIN)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return 0;
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+    return qint64(kernel.QuadPart + user.QuadPart) * 100;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return (qint64(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000000
+           + (qint64(usage.ru_utime.tv_usec) + usage.ru_stime.tv_usec) * 1000;
+#else
+    return 0;
+#endif
+}
+
+/*
+    Returns the peak resident set size of the process in bytes, or -1.
+*/
+qint64 DocumentStatisticsRecorder::peakMemoryUsage()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return -1;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#if defined(Q_OS_MAC)
+    return usage.ru_maxrss;
+#else
+    return qint64(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return -1;
+#endif
+}
+
+QT_END_NAMESPACE_XLSX
@@ -0,0 +1,94 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef QXLSX_XLSXDOCUMENTSTATISTICS_H
+#define QXLSX_XLSXDOCUMENTSTATISTICS_H
+
+#include "xlsxglobal.h"
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QSharedDataPointer>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class DocumentStatisticsPrivate;
+class DocumentStatisticsRecorder;
+
+class Q_XLSX_EXPORT DocumentStatistics
+{
+public:
+    enum Operation { NoOperation, SaveOperation, LoadOperation };
+
+    struct Part
+    {
+        Part();
+        double compressionRatio() const;
+
+        QString path;
+        qint64 wallTime; // nanoseconds spent generating or parsing the xml
+        qint64 cpuTime;
+        qint64 zipWallTime; // nanoseconds spent deflating or inflating
+        qint64 zipCpuTime;
+        qint64 uncompressedSize;
+        qint64 compressedSize; // -1 when unknown
+    };
+
+    DocumentStatistics();
+    DocumentStatistics(const DocumentStatistics &other);
+    ~DocumentStatistics();
+    DocumentStatistics &operator=(const DocumentStatistics &other);
+
+    bool isValid() const;
+    Operation operation() const;
+
+    qint64 wallTime() const;
+    qint64 cpuTime() const;
+    qint64 zipWallTime() const;
+    qint64 zipCpuTime() const;
+
+    QList<Part> parts() const;
+    Part part(const QString &path) const;
+
+    qint64 packageSize() const;
+    qint64 uncompressedSize() const;
+    qint64 largestPartSize() const;
+    double compressionRatio() const;
+
+    qint64 cellCount() const;
+    int stringCount() const;
+    int stringReferenceCount() const;
+    qint64 peakMemoryUsage() const;
+
+    QByteArray toJson() const;
+
+private:
+    friend class DocumentStatisticsRecorder;
+    QSharedDataPointer<DocumentStatisticsPrivate> d;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXDOCUMENTSTATISTICS_H
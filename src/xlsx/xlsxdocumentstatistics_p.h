@@ -0,0 +1,119 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef XLSXDOCUMENTSTATISTICS_P_H
+#define XLSXDOCUMENTSTATISTICS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxdocumentstatistics.h"
+#include <QElapsedTimer>
+
+class QIODevice;
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class ZipReader;
+class ZipWriter;
+struct ZipEntry;
+
+class DocumentStatisticsPrivate : public QSharedData
+{
+public:
+    DocumentStatisticsPrivate();
+
+    DocumentStatistics::Operation operation;
+    qint64 wallTime;
+    qint64 cpuTime;
+    qint64 zipWallTime;
+    qint64 zipCpuTime;
+    QList<DocumentStatistics::Part> parts;
+    qint64 packageSize;
+    qint64 cellCount;
+    int stringCount;
+    int stringReferenceCount;
+    qint64 peakMemoryUsage;
+};
+
+/*
+    Fills a DocumentStatistics while a package is saved or loaded.
+
+    Every part goes through addFile(), addEntry(), readFile() or
+    readEntry(). The time between two of these calls is charged to the
+    xml generation of the part being written, or to the parsing of the
+    part just read. When no statistics object is given, the recorder only
+    forwards the calls.
+*/
+class XLSX_AUTOTEST_EXPORT DocumentStatisticsRecorder
+{
+public:
+    DocumentStatisticsRecorder(DocumentStatistics *statistics, DocumentStatistics::Operation operation,
+                               QIODevice *device);
+
+    bool isEnabled() const { return m_statistics != 0; }
+    void restartPart();
+
+    ZipEntry addFile(ZipWriter &writer, const QString &path, const QByteArray &data);
+    void addEntry(ZipWriter &writer, const QString &path, const ZipEntry &entry);
+    void close(ZipWriter &writer);
+    QByteArray readFile(const ZipReader &reader, const QString &path);
+    ZipEntry readEntry(const ZipReader &reader, const QString &path);
+
+    void finish(qint64 cellCount, int stringCount, int stringReferenceCount);
+
+    static qint64 processCpuTime();
+    static qint64 peakMemoryUsage();
+
+private:
+    void recordFile(const QString &path, qint64 uncompressedSize, qint64 pos,
+                    const QElapsedTimer &zipTimer, qint64 zipCpuStart);
+    void finishPendingPart();
+
+    DocumentStatistics *m_statistics;
+    DocumentStatistics::Operation m_operation;
+    QIODevice *m_device;
+    qint64 m_startPos;
+    QElapsedTimer m_totalTimer;
+    qint64 m_totalCpuStart;
+    QElapsedTimer m_partTimer;
+    qint64 m_partCpuStart;
+    QList<DocumentStatistics::Part> m_parts;
+    bool m_pendingPart;
+    qint64 m_zipWallTime;
+    qint64 m_zipCpuTime;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // XLSXDOCUMENTSTATISTICS_P_H
@@ -0,0 +1,129 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxdocumenttemplate.h"
+#include "xlsxdocument.h"
+#include "xlsxdocument_p.h"
+#include <QFile>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+/*!
+  \class DocumentTemplate
+  \inmodule QtXlsx
+  \brief The DocumentTemplate class holds a frozen document to make new documents from.
+
+  A template is loaded once, and each of its parts is generated and
+  compressed once. Each Document constructed from it then shares the cells,
+  the styles, the theme and the shared strings of the template, and
+  duplicates them only when it modifies them. The parts which are left
+  unmodified, such as the styles or a sheet holding static content, are
+  copied as they are stored in the template instead of being generated and
+  compressed for each document.
+
+  \code
+  DocumentTemplate invoice("invoice.xlsx");
+  foreach (const Customer &customer, customers) {
+      Document xlsx(invoice);
+      xlsx.write("B2", customer.name);
+      xlsx.saveAs(customer.fileName);
+  }
+  \endcode
+
+  A template is never modified once constructed, so copies of it, and
+  documents made from it, can be used by several threads at once.
+*/
+
+/*!
+  Constructs an invalid template, from which empty documents are made.
+*/
+DocumentTemplate::DocumentTemplate()
+{
+}
+
+/*!
+  Constructs a template from the xlsx file named \a xlsxName.
+  The template is invalid if the file can not be loaded.
+*/
+DocumentTemplate::DocumentTemplate(const QString &xlsxName)
+{
+    QFile xlsx(xlsxName);
+    if (!xlsx.open(QFile::ReadOnly))
+        return;
+    QSharedPointer<DocumentPrivate> source(new DocumentPrivate(0));
+    source->incrementalSaveEnabled = true;
+    if (source->loadPackage(&xlsx)) {
+        source->freeze();
+        d = source;
+    }
+}
+
+/*!
+  Constructs a template from the xlsx package read from \a device.
+  The template is invalid if the package can not be loaded.
+*/
+DocumentTemplate::DocumentTemplate(QIODevice *device)
+{
+    if (!device || !device->isReadable())
+        return;
+    QSharedPointer<DocumentPrivate> source(new DocumentPrivate(0));
+    source->incrementalSaveEnabled = true;
+    if (source->loadPackage(device)) {
+        source->freeze();
+        d = source;
+    }
+}
+
+/*!
+  Constructs a template from the current contents of \a document, which
+  can be modified or destroyed afterwards without affecting the template.
+*/
+DocumentTemplate::DocumentTemplate(const Document *document)
+{
+    if (!document)
+        return;
+    document->d_func()->adoptLoad();
+    QSharedPointer<DocumentPrivate> source = document->d_func()->snapshot();
+    source->ownContents();
+    source->freeze();
+    d = source;
+}
+
+/*!
+  Destroys the template. The documents made from it keep what they share
+  with it.
+*/
+DocumentTemplate::~DocumentTemplate()
+{
+}
+
+/*!
+  Returns whether the template has been loaded.
+*/
+bool DocumentTemplate::isValid() const
+{
+    return !d.isNull();
+}
+
+QT_END_NAMESPACE_XLSX
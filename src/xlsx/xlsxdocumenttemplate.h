@@ -0,0 +1,56 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef QXLSX_XLSXDOCUMENTTEMPLATE_H
+#define QXLSX_XLSXDOCUMENTTEMPLATE_H
+
+#include "xlsxglobal.h"
+#include <QString>
+#include <QSharedPointer>
+class QIODevice;
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class Document;
+class DocumentPrivate;
+
+class Q_XLSX_EXPORT DocumentTemplate
+{
+public:
+    DocumentTemplate();
+    explicit DocumentTemplate(const QString &xlsxName);
+    explicit DocumentTemplate(QIODevice *device);
+    explicit DocumentTemplate(const Document *document);
+    ~DocumentTemplate();
+
+    bool isValid() const;
+
+private:
+    friend class Document;
+    QSharedPointer<const DocumentPrivate> d;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXDOCUMENTTEMPLATE_H
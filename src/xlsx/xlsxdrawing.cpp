@@ -45,6 +45,18 @@ Drawing::~Drawing()
     qDeleteAll(anchors);
 }
 
+/*
+  Returns a copy of the drawing for \a sheet, whose workbook receives
+  the copies of the charts.
+ */
+Drawing *Drawing::clone(AbstractSheet *sheet) const
+{
+    Drawing *drawing = new Drawing(sheet, F_NewFromScratch);
+    foreach (DrawingAnchor *anchor, anchors)
+        anchor->clone(drawing);
+    return drawing;
+}
+
 void Drawing::saveToXmlFile(QIODevice *device) const
 {
     relationships()->clear();
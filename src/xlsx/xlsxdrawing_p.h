@@ -59,6 +59,7 @@ class Drawing : public AbstractOOXmlFile
 public:
     Drawing(AbstractSheet *sheet, CreateFlag flag);
     ~Drawing();
+    Drawing *clone(AbstractSheet *sheet) const;
     void saveToXmlFile(QIODevice *device) const;
     bool loadFromXmlFile(QIODevice *device);
 
@@ -27,6 +27,7 @@
 #include "xlsxdrawing_p.h"
 #include "xlsxmediafile_p.h"
 #include "xlsxchart.h"
+#include "xlsxchart_p.h"
 #include "xlsxworkbook.h"
 #include "xlsxutility_p.h"
 
@@ -104,6 +105,28 @@ void DrawingAnchor::setObjectGraphicFrame(QSharedPointer<Chart> chart)
     m_objectType = GraphicFrame;
 }
 
+/*
+   Gives \a anchor the object of this anchor. The picture is shared, as a
+   media file is never modified once created, while the chart is copied
+   into the workbook of \a anchor.
+ */
+void DrawingAnchor::cloneObject(DrawingAnchor *anchor) const
+{
+    anchor->m_objectType = m_objectType;
+    anchor->m_pictureFile = m_pictureFile;
+    if (m_chartFile) {
+        QSharedPointer<Chart> chart(new Chart(anchor->m_drawing->sheet, Chart::F_NewFromScratch));
+        ChartPrivate *chart_d = chart->d_func();
+        const ChartPrivate *other_d = m_chartFile->d_func();
+        chart_d->chartType = other_d->chartType;
+        chart_d->seriesList = other_d->seriesList;
+        chart_d->axisList = other_d->axisList;
+        chart->setCachedEntry(m_chartFile->cachedEntry());
+        anchor->m_chartFile = chart;
+        anchor->m_drawing->workbook->addChartFile(chart);
+    }
+}
+
 QPoint DrawingAnchor::loadXmlPos(QXmlStreamReader &reader)
 {
     Q_ASSERT(reader.name() == QLatin1String("pos"));
@@ -412,6 +435,15 @@ DrawingAbsoluteAnchor::DrawingAbsoluteAnchor(Drawing *drawing, ObjectType object
 {
 }
 
+DrawingAbsoluteAnchor *DrawingAbsoluteAnchor::clone(Drawing *drawing) const
+{
+    DrawingAbsoluteAnchor *anchor = new DrawingAbsoluteAnchor(drawing, m_objectType);
+    anchor->pos = pos;
+    anchor->ext = ext;
+    cloneObject(anchor);
+    return anchor;
+}
+
 bool DrawingAbsoluteAnchor::loadFromXml(QXmlStreamReader &reader)
 {
     Q_ASSERT(reader.name() == QLatin1String("absoluteAnchor"));
@@ -453,6 +485,15 @@ DrawingOneCellAnchor::DrawingOneCellAnchor(Drawing *drawing, ObjectType objectTy
 {
 }
 
+DrawingOneCellAnchor *DrawingOneCellAnchor::clone(Drawing *drawing) const
+{
+    DrawingOneCellAnchor *anchor = new DrawingOneCellAnchor(drawing, m_objectType);
+    anchor->from = from;
+    anchor->ext = ext;
+    cloneObject(anchor);
+    return anchor;
+}
+
 bool DrawingOneCellAnchor::loadFromXml(QXmlStreamReader &reader)
 {
     Q_ASSERT(reader.name() == QLatin1String("oneCellAnchor"));
@@ -499,6 +540,15 @@ DrawingTwoCellAnchor::DrawingTwoCellAnchor(Drawing *drawing, ObjectType objectTy
 {
 }
 
+DrawingTwoCellAnchor *DrawingTwoCellAnchor::clone(Drawing *drawing) const
+{
+    DrawingTwoCellAnchor *anchor = new DrawingTwoCellAnchor(drawing, m_objectType);
+    anchor->from = from;
+    anchor->to = to;
+    cloneObject(anchor);
+    return anchor;
+}
+
 bool DrawingTwoCellAnchor::loadFromXml(QXmlStreamReader &reader)
 {
     Q_ASSERT(reader.name() == QLatin1String("twoCellAnchor"));
@@ -73,8 +73,11 @@ public:
 
     virtual bool loadFromXml(QXmlStreamReader &reader) = 0;
     virtual void saveToXml(QXmlStreamWriter &writer) const = 0;
+    virtual DrawingAnchor *clone(Drawing *drawing) const = 0;
 
 protected:
+    void cloneObject(DrawingAnchor *anchor) const;
+
     QPoint loadXmlPos(QXmlStreamReader &reader);
     QSize loadXmlExt(QXmlStreamReader &reader);
     XlsxMarker loadXmlMarker(QXmlStreamReader &reader, const QString &node);
@@ -114,6 +117,7 @@ public:
 
     bool loadFromXml(QXmlStreamReader &reader);
     void saveToXml(QXmlStreamWriter &writer) const;
+    DrawingAbsoluteAnchor *clone(Drawing *drawing) const;
 };
 
 class DrawingOneCellAnchor : public DrawingAnchor
@@ -126,6 +130,7 @@ public:
 
     bool loadFromXml(QXmlStreamReader &reader);
     void saveToXml(QXmlStreamWriter &writer) const;
+    DrawingOneCellAnchor *clone(Drawing *drawing) const;
 };
 
 class DrawingTwoCellAnchor : public DrawingAnchor
@@ -138,6 +143,7 @@ public:
 
     bool loadFromXml(QXmlStreamReader &reader);
     void saveToXml(QXmlStreamWriter &writer) const;
+    DrawingTwoCellAnchor *clone(Drawing *drawing) const;
 };
 
 } // namespace QXlsx
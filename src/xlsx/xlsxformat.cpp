@@ -27,6 +27,7 @@
 #include "xlsxcolor_p.h"
 #include "xlsxnumformatparser_p.h"
 #include <QDataStream>
+#include <QMutexLocker>
 #include <QDebug>
 
 QT_BEGIN_NAMESPACE_XLSX
@@ -278,15 +279,8 @@ bool Format::isDateTimeFormat() const
         // Gauss from the number string
         return NumFormatParser::isDateTime(numberFormat());
     } else if (hasProperty(FormatPrivate::P_NumFmt_Id)) {
-        // Non-custom numFmt
-        int idx = numberFormatIndex();
-
-        // Is built-in date time number id?
-        if ((idx >= 14 && idx <= 22) || (idx >= 45 && idx <= 47))
-            return true;
-
-        if ((idx >= 27 && idx <= 36) || (idx >= 50 && idx <= 58)) // Used in CHS\CHT\JPN\KOR
-            return true;
+        // Non-custom numFmt, is built-in date time number id?
+        return NumFormatParser::isDateTimeKind(NumFormatParser::builtinKind(numberFormatIndex()));
     }
 
     return false;
@@ -544,6 +538,7 @@ QByteArray Format::fontKey() const
     if (isEmpty())
         return QByteArray();
 
+    QMutexLocker locker(&d->keyMutex);
     if (d->font_dirty) {
         QByteArray key;
         QDataStream stream(&key, QIODevice::WriteOnly);
@@ -552,8 +547,8 @@ QByteArray Format::fontKey() const
                 stream << i << d->properties[i];
         };
 
-        const_cast<Format *>(this)->d->font_key = key;
-        const_cast<Format *>(this)->d->font_dirty = false;
+        d->font_key = key;
+        d->font_dirty = false;
     }
 
     return d->font_key;
@@ -955,6 +950,7 @@ QByteArray Format::borderKey() const
     if (isEmpty())
         return QByteArray();
 
+    QMutexLocker locker(&d->keyMutex);
     if (d->border_dirty) {
         QByteArray key;
         QDataStream stream(&key, QIODevice::WriteOnly);
@@ -963,8 +959,8 @@ QByteArray Format::borderKey() const
                 stream << i << d->properties[i];
         };
 
-        const_cast<Format *>(this)->d->border_key = key;
-        const_cast<Format *>(this)->d->border_dirty = false;
+        d->border_key = key;
+        d->border_dirty = false;
     }
 
     return d->border_key;
@@ -1075,6 +1071,7 @@ QByteArray Format::fillKey() const
     if (isEmpty())
         return QByteArray();
 
+    QMutexLocker locker(&d->keyMutex);
     if (d->fill_dirty) {
         QByteArray key;
         QDataStream stream(&key, QIODevice::WriteOnly);
@@ -1083,8 +1080,8 @@ QByteArray Format::fillKey() const
                 stream << i << d->properties[i];
         };
 
-        const_cast<Format *>(this)->d->fill_key = key;
-        const_cast<Format *>(this)->d->fill_dirty = false;
+        d->fill_key = key;
+        d->fill_dirty = false;
     }
 
     return d->fill_key;
@@ -1201,6 +1198,7 @@ QByteArray Format::formatKey() const
     if (isEmpty())
         return QByteArray();
 
+    QMutexLocker locker(&d->keyMutex);
     if (d->dirty) {
         QByteArray key;
         QDataStream stream(&key, QIODevice::WriteOnly);
@@ -1218,6 +1216,17 @@ QByteArray Format::formatKey() const
     return d->formatKey;
 }
 
+/*!
+ * \internal
+ *  Gives this format its own copy of the properties and indexes, which
+ *  the other copies of it no longer share.
+ */
+void Format::detach()
+{
+    if (d)
+        d.detach();
+}
+
 /*!
  * \internal
  *  Called by QXlsx::Styles or some unittests.
@@ -253,6 +253,7 @@ public:
     void setFillIndex(int index);
     void setXfIndex(int index);
     void setDxfIndex(int index);
+    void detach();
 
 private:
     friend class Styles;
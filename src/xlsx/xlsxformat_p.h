@@ -38,6 +38,7 @@
 
 #include "xlsxformat.h"
 #include <QSharedData>
+#include <QMutex>
 #include <QMap>
 #include <QSet>
 
@@ -125,6 +126,10 @@ public:
     FormatPrivate(const FormatPrivate &other);
     ~FormatPrivate();
 
+    // Serializes the lazy re-generation of the keys below, which const
+    // readers of a shared format may trigger from several threads.
+    QMutex keyMutex;
+
     bool dirty; // The key re-generation is need.
     QByteArray formatKey;
 
@@ -0,0 +1,1722 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxformulaengine_p.h"
+#include "xlsxworksheet.h"
+#include "xlsxworksheet_p.h"
+#include "xlsxworkbook.h"
+#include "xlsxcell.h"
+#include "xlsxcellformula.h"
+#include "xlsxutility_p.h"
+
+#include <QDateTime>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+#include <qnumeric.h>
+
+#include <algorithm>
+#include <math.h>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+typedef QSharedPointer<const FormulaNode> FormulaNodePtr;
+
+/*
+   Levels smaller than this are evaluated in the calling thread, as
+   dispatching them to the thread pool costs more than it saves.
+*/
+static const int ParallelLevelThreshold = 128;
+
+/*
+   The ranges of cells referred to by formulas are indexed by blocks of
+   one column and this many rows, so that writing a cell only checks the
+   ranges overlapping its block. Ranges covering more blocks than
+   MaxRangeBlocks, such as whole columns, are checked on every write.
+*/
+static const int RangeBlockShift = 6;
+static const int MaxRangeBlocks = 64;
+
+struct FormulaNode
+{
+    enum Kind { Constant, Reference, Unary, Binary, Function };
+
+    explicit FormulaNode(Kind kind)
+        : kind(kind)
+        , row1(0)
+        , col1(0)
+        , row2(0)
+        , col2(0)
+        , rowAbs1(false)
+        , colAbs1(false)
+        , rowAbs2(false)
+        , colAbs2(false)
+    {
+    }
+
+    Kind kind;
+    FormulaValue value; // Constant
+    QString name;       // operator, or upper case function name
+    QString sheetName;  // Reference, empty for the owning sheet
+    int row1, col1, row2, col2;
+    bool rowAbs1, colAbs1, rowAbs2, colAbs2;
+    QVector<FormulaNodePtr> children;
+};
+
+static inline quint64 cellKey(int row, int column)
+{
+    return (quint64(row) << 32) | quint32(column);
+}
+
+static inline quint64 blockKey(int row, int column)
+{
+    return cellKey(row >> RangeBlockShift, column);
+}
+
+static inline bool isIndexedRange(const CellRange &range)
+{
+    const qint64 blockRows = (range.lastRow() >> RangeBlockShift)
+        - (range.firstRow() >> RangeBlockShift) + 1;
+    return blockRows * range.columnCount() <= MaxRangeBlocks;
+}
+
+static inline bool rangeContains(const CellRange &range, int row, int column)
+{
+    return row >= range.firstRow() && row <= range.lastRow() && column >= range.firstColumn()
+        && column <= range.lastColumn();
+}
+
+static bool rangesContain(const QVector<CellRange> &ranges, int row, int column)
+{
+    foreach (const CellRange &range, ranges) {
+        if (rangeContains(range, row, column))
+            return true;
+    }
+    return false;
+}
+
+static const Cell *cellAt(const WorksheetPrivate *sheet, int row, int column)
+{
+    QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator it =
+        sheet->cellTable.constFind(row);
+    if (it == sheet->cellTable.constEnd())
+        return 0;
+    QMap<int, QSharedPointer<Cell>>::const_iterator cit = it->constFind(column);
+    return cit == it->constEnd() ? 0 : cit->data();
+}
+
+/*
+   Resolve the reference \a node for a cell whose position is offset by
+   (\a rowOffset, \a columnOffset) from the cell the formula text was
+   written for. Returns false when the reference falls off the sheet.
+*/
+static bool resolveReference(const FormulaNode *node, int rowOffset, int columnOffset,
+                             CellRange *range)
+{
+    int row1 = node->rowAbs1 ? node->row1 : node->row1 + rowOffset;
+    int col1 = node->colAbs1 ? node->col1 : node->col1 + columnOffset;
+    int row2 = node->rowAbs2 ? node->row2 : node->row2 + rowOffset;
+    int col2 = node->colAbs2 ? node->col2 : node->col2 + columnOffset;
+    if (row1 > row2)
+        qSwap(row1, row2);
+    if (col1 > col2)
+        qSwap(col1, col2);
+    if (row1 < 1 || col1 < 1 || row2 > XLSX_ROW_MAX || col2 > XLSX_COLUMN_MAX)
+        return false;
+    *range = CellRange(row1, col1, row2, col2);
+    return true;
+}
+
+/*
+   Parse the "A1", "$A$1" or, when \a columnOnly is given, "A" / "$A"
+   reference token. A column only reference returns row 0.
+*/
+static bool parseCellToken(const QString &token, int *row, int *column, bool *rowAbs,
+                           bool *colAbs, bool columnOnly = false)
+{
+    const int n = token.size();
+    int i = 0;
+    *colAbs = i < n && token[i] == QLatin1Char('$');
+    if (*colAbs)
+        ++i;
+    int col = 0;
+    int start = i;
+    while (i < n && token[i].unicode() < 128 && token[i].isLetter()) {
+        col = col * 26 + (token[i].toUpper().unicode() - 'A' + 1);
+        ++i;
+    }
+    if (i == start || i - start > 3 || col > XLSX_COLUMN_MAX)
+        return false;
+
+    *rowAbs = i < n && token[i] == QLatin1Char('$');
+    if (*rowAbs)
+        ++i;
+    int r = 0;
+    start = i;
+    while (i < n && token[i].unicode() < 128 && token[i].isDigit()) {
+        r = r * 10 + token[i].digitValue();
+        if (r > XLSX_ROW_MAX)
+            return false;
+        ++i;
+    }
+    if (i != n)
+        return false;
+    if (i == start) {
+        if (!columnOnly || *rowAbs)
+            return false;
+    } else if (r < 1) {
+        return false;
+    }
+    *row = r;
+    *column = col;
+    return true;
+}
+
+/*
+   Recursive descent parser for the formula grammar, from the lowest
+   precedence to the highest:
+
+      comparison      = <> < > <= >=
+      concatenation   &
+      additive        + -
+      multiplicative  * /
+      power           ^
+      unary           + -
+      percent         %
+      primary         literal, reference, function call, (...)
+*/
+class FormulaParser
+{
+public:
+    explicit FormulaParser(const QString &formula)
+        : m_text(formula)
+        , m_pos(0)
+        , m_failed(false)
+    {
+    }
+
+    FormulaNodePtr parse()
+    {
+        skipSpaces();
+        if (m_pos < m_text.size() && m_text[m_pos] == QLatin1Char('='))
+            ++m_pos;
+        FormulaNodePtr node = parseComparison();
+        skipSpaces();
+        if (m_failed || m_pos != m_text.size())
+            return constant(FormulaValue::error("#NAME?"));
+        return node;
+    }
+
+private:
+    static FormulaNodePtr constant(const FormulaValue &value)
+    {
+        FormulaNode *node = new FormulaNode(FormulaNode::Constant);
+        node->value = value;
+        return FormulaNodePtr(node);
+    }
+
+    static FormulaNodePtr operation(FormulaNode::Kind kind, const QString &op,
+                                    const FormulaNodePtr &left,
+                                    const FormulaNodePtr &right = FormulaNodePtr())
+    {
+        FormulaNode *node = new FormulaNode(kind);
+        node->name = op;
+        node->children.append(left);
+        if (right)
+            node->children.append(right);
+        return FormulaNodePtr(node);
+    }
+
+    FormulaNodePtr fail()
+    {
+        m_failed = true;
+        m_pos = m_text.size();
+        return constant(FormulaValue::error("#NAME?"));
+    }
+
+    void skipSpaces()
+    {
+        while (m_pos < m_text.size() && m_text[m_pos].isSpace())
+            ++m_pos;
+    }
+
+    QChar current() const { return m_pos < m_text.size() ? m_text[m_pos] : QChar(); }
+
+    bool lookAhead(const char *s) const
+    {
+        return m_text.midRef(m_pos).startsWith(QLatin1String(s));
+    }
+
+    bool accept(char c)
+    {
+        skipSpaces();
+        if (current() == QLatin1Char(c)) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    FormulaNodePtr parseComparison()
+    {
+        FormulaNodePtr left = parseConcatenation();
+        forever {
+            skipSpaces();
+            QString op;
+            if (lookAhead("<>") || lookAhead("<=") || lookAhead(">="))
+                op = m_text.mid(m_pos, 2);
+            else if (current() == QLatin1Char('=') || current() == QLatin1Char('<')
+                     || current() == QLatin1Char('>'))
+                op = current();
+            else
+                return left;
+            m_pos += op.size();
+            left = operation(FormulaNode::Binary, op, left, parseConcatenation());
+        }
+    }
+
+    FormulaNodePtr parseConcatenation()
+    {
+        FormulaNodePtr left = parseAdditive();
+        while (accept('&'))
+            left = operation(FormulaNode::Binary, QStringLiteral("&"), left, parseAdditive());
+        return left;
+    }
+
+    FormulaNodePtr parseAdditive()
+    {
+        FormulaNodePtr left = parseMultiplicative();
+        forever {
+            skipSpaces();
+            const QChar c = current();
+            if (c != QLatin1Char('+') && c != QLatin1Char('-'))
+                return left;
+            ++m_pos;
+            left = operation(FormulaNode::Binary, c, left, parseMultiplicative());
+        }
+    }
+
+    FormulaNodePtr parseMultiplicative()
+    {
+        FormulaNodePtr left = parsePower();
+        forever {
+            skipSpaces();
+            const QChar c = current();
+            if (c != QLatin1Char('*') && c != QLatin1Char('/'))
+                return left;
+            ++m_pos;
+            left = operation(FormulaNode::Binary, c, left, parsePower());
+        }
+    }
+
+    FormulaNodePtr parsePower()
+    {
+        FormulaNodePtr left = parseUnary();
+        while (accept('^'))
+            left = operation(FormulaNode::Binary, QStringLiteral("^"), left, parseUnary());
+        return left;
+    }
+
+    FormulaNodePtr parseUnary()
+    {
+        skipSpaces();
+        const QChar c = current();
+        if (c == QLatin1Char('-') || c == QLatin1Char('+')) {
+            ++m_pos;
+            return operation(FormulaNode::Unary, c, parseUnary());
+        }
+        return parsePercent();
+    }
+
+    FormulaNodePtr parsePercent()
+    {
+        FormulaNodePtr node = parsePrimary();
+        while (accept('%'))
+            node = operation(FormulaNode::Unary, QStringLiteral("%"), node);
+        return node;
+    }
+
+    FormulaNodePtr parsePrimary()
+    {
+        skipSpaces();
+        if (m_pos >= m_text.size())
+            return fail();
+
+        const QChar c = current();
+        if (c == QLatin1Char('(')) {
+            ++m_pos;
+            FormulaNodePtr node = parseComparison();
+            if (!accept(')'))
+                return fail();
+            return node;
+        }
+        if (c.isDigit()
+            || (c == QLatin1Char('.') && m_pos + 1 < m_text.size() && m_text[m_pos + 1].isDigit()))
+            return parseNumber();
+        if (c == QLatin1Char('"'))
+            return parseString();
+        if (c == QLatin1Char('#'))
+            return parseError();
+        if (c == QLatin1Char('\'')) {
+            QString sheetName;
+            ++m_pos;
+            forever {
+                if (m_pos >= m_text.size())
+                    return fail();
+                if (m_text[m_pos] == QLatin1Char('\'')) {
+                    if (m_pos + 1 < m_text.size() && m_text[m_pos + 1] == QLatin1Char('\'')) {
+                        sheetName.append(QLatin1Char('\''));
+                        m_pos += 2;
+                        continue;
+                    }
+                    ++m_pos;
+                    break;
+                }
+                sheetName.append(m_text[m_pos++]);
+            }
+            if (current() != QLatin1Char('!'))
+                return fail();
+            ++m_pos;
+            return parseReference(sheetName, readToken());
+        }
+        if (c.isLetter() || c == QLatin1Char('$') || c == QLatin1Char('_'))
+            return parseIdentifier();
+        return fail();
+    }
+
+    QString readToken()
+    {
+        const int start = m_pos;
+        while (m_pos < m_text.size()) {
+            const QChar ch = m_text[m_pos];
+            if (!ch.isLetterOrNumber() && ch != QLatin1Char('_') && ch != QLatin1Char('.')
+                && ch != QLatin1Char('$'))
+                break;
+            ++m_pos;
+        }
+        return m_text.mid(start, m_pos - start);
+    }
+
+    FormulaNodePtr parseNumber()
+    {
+        const int start = m_pos;
+        while (m_pos < m_text.size() && (m_text[m_pos].isDigit() || m_text[m_pos] == QLatin1Char('.')))
+            ++m_pos;
+        if (m_pos < m_text.size()
+            && (m_text[m_pos] == QLatin1Char('e') || m_text[m_pos] == QLatin1Char('E'))) {
+            int pos = m_pos + 1;
+            if (pos < m_text.size()
+                && (m_text[pos] == QLatin1Char('+') || m_text[pos] == QLatin1Char('-')))
+                ++pos;
+            if (pos < m_text.size() && m_text[pos].isDigit()) {
+                m_pos = pos;
+                while (m_pos < m_text.size() && m_text[m_pos].isDigit())
+                    ++m_pos;
+            }
+        }
+        bool ok = false;
+        const double number = m_text.midRef(start, m_pos - start).toDouble(&ok);
+        if (!ok)
+            return fail();
+        return constant(FormulaValue(number));
+    }
+
+    FormulaNodePtr parseString()
+    {
+        QString text;
+        ++m_pos;
+        forever {
+            if (m_pos >= m_text.size())
+                return fail();
+            if (m_text[m_pos] == QLatin1Char('"')) {
+                if (m_pos + 1 < m_text.size() && m_text[m_pos + 1] == QLatin1Char('"')) {
+                    text.append(QLatin1Char('"'));
+                    m_pos += 2;
+                    continue;
+                }
+                ++m_pos;
+                break;
+            }
+            text.append(m_text[m_pos++]);
+        }
+        return constant(FormulaValue(text));
+    }
+
+    FormulaNodePtr parseError()
+    {
+        static const char *const codes[] = { "#NULL!", "#DIV/0!", "#VALUE!", "#REF!",
+                                             "#NAME?", "#NUM!",   "#N/A" };
+        for (size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); ++i) {
+            if (lookAhead(codes[i])) {
+                m_pos += int(qstrlen(codes[i]));
+                return constant(FormulaValue::error(codes[i]));
+            }
+        }
+        return fail();
+    }
+
+    FormulaNodePtr parseIdentifier()
+    {
+        const QString token = readToken();
+        if (current() == QLatin1Char('!')) {
+            ++m_pos;
+            return parseReference(token, readToken());
+        }
+        skipSpaces();
+        if (current() == QLatin1Char('('))
+            return parseFunction(token);
+
+        const QString upper = token.toUpper();
+        if (upper == QLatin1String("TRUE"))
+            return constant(FormulaValue::boolean(true));
+        if (upper == QLatin1String("FALSE"))
+            return constant(FormulaValue::boolean(false));
+        if (FormulaNodePtr ref = parseReference(QString(), token, false))
+            return ref;
+        // Defined names are not supported
+        return constant(FormulaValue::error("#NAME?"));
+    }
+
+    FormulaNodePtr parseFunction(const QString &token)
+    {
+        FormulaNode *node = new FormulaNode(FormulaNode::Function);
+        FormulaNodePtr ptr(node);
+        node->name = token.toUpper();
+        if (node->name.startsWith(QLatin1String("_XLFN.")))
+            node->name = node->name.mid(6);
+
+        ++m_pos; // (
+        if (accept(')'))
+            return ptr;
+        forever {
+            skipSpaces();
+            if (current() == QLatin1Char(',') || current() == QLatin1Char(')'))
+                node->children.append(constant(FormulaValue()));
+            else
+                node->children.append(parseComparison());
+            if (accept(','))
+                continue;
+            if (accept(')'))
+                return ptr;
+            return fail();
+        }
+    }
+
+    FormulaNodePtr parseReference(const QString &sheetName, const QString &token,
+                                  bool mustSucceed = true)
+    {
+        FormulaNode *node = new FormulaNode(FormulaNode::Reference);
+        FormulaNodePtr ptr(node);
+        node->sheetName = sheetName;
+        if (!parseCellToken(token, &node->row1, &node->col1, &node->rowAbs1, &node->colAbs1,
+                            true)) {
+            return mustSucceed ? fail() : FormulaNodePtr();
+        }
+
+        const bool wholeColumn = node->row1 == 0;
+        if (current() == QLatin1Char(':')) {
+            const int savedPos = m_pos;
+            ++m_pos;
+            const QString second = readToken();
+            if (parseCellToken(second, &node->row2, &node->col2, &node->rowAbs2, &node->colAbs2,
+                               wholeColumn)
+                && (node->row2 == 0) == wholeColumn) {
+                if (wholeColumn) {
+                    node->row1 = 1;
+                    node->row2 = XLSX_ROW_MAX;
+                    node->rowAbs1 = node->rowAbs2 = true;
+                }
+                return ptr;
+            }
+            m_pos = savedPos;
+        }
+        if (wholeColumn)
+            return mustSucceed ? fail() : FormulaNodePtr();
+
+        node->row2 = node->row1;
+        node->col2 = node->col1;
+        node->rowAbs2 = node->rowAbs1;
+        node->colAbs2 = node->colAbs1;
+        return ptr;
+    }
+
+    QString m_text;
+    int m_pos;
+    bool m_failed;
+};
+
+static bool toNumber(const FormulaValue &value, double *number)
+{
+    switch (value.type) {
+    case FormulaValue::Empty:
+        *number = 0;
+        return true;
+    case FormulaValue::Number:
+    case FormulaValue::Boolean:
+        *number = value.number;
+        return true;
+    case FormulaValue::String: {
+        bool ok = false;
+        *number = value.text.trimmed().toDouble(&ok);
+        return ok;
+    }
+    default:
+        return false;
+    }
+}
+
+static QString toText(const FormulaValue &value)
+{
+    switch (value.type) {
+    case FormulaValue::Number:
+        return QString::number(value.number, 'g', 15);
+    case FormulaValue::Boolean:
+        return value.number ? QStringLiteral("TRUE") : QStringLiteral("FALSE");
+    case FormulaValue::Empty:
+        return QString();
+    default:
+        return value.text;
+    }
+}
+
+static bool toBool(const FormulaValue &value, bool *b)
+{
+    switch (value.type) {
+    case FormulaValue::Empty:
+        *b = false;
+        return true;
+    case FormulaValue::Number:
+    case FormulaValue::Boolean:
+        *b = value.number != 0;
+        return true;
+    case FormulaValue::String:
+        if (value.text.compare(QLatin1String("TRUE"), Qt::CaseInsensitive) == 0) {
+            *b = true;
+            return true;
+        }
+        if (value.text.compare(QLatin1String("FALSE"), Qt::CaseInsensitive) == 0) {
+            *b = false;
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+/*
+   Compare two non error values the way Excel does: numbers sort
+   before text, which sorts before logical values. Text comparison
+   is case insensitive, and an empty value compares like 0, "" or
+   FALSE depending on the other operand.
+*/
+static int compareValues(FormulaValue a, FormulaValue b)
+{
+    if (a.type == FormulaValue::Empty)
+        a = b.type == FormulaValue::String
+            ? FormulaValue(QString())
+            : (b.type == FormulaValue::Boolean ? FormulaValue::boolean(false) : FormulaValue(0.0));
+    if (b.type == FormulaValue::Empty)
+        b = a.type == FormulaValue::String
+            ? FormulaValue(QString())
+            : (a.type == FormulaValue::Boolean ? FormulaValue::boolean(false) : FormulaValue(0.0));
+
+    if (a.type != b.type) {
+        const int rankA = a.type == FormulaValue::Number ? 0 : (a.type == FormulaValue::String ? 1 : 2);
+        const int rankB = b.type == FormulaValue::Number ? 0 : (b.type == FormulaValue::String ? 1 : 2);
+        return rankA - rankB;
+    }
+    if (a.type == FormulaValue::String)
+        return a.text.compare(b.text, Qt::CaseInsensitive);
+    return a.number < b.number ? -1 : (a.number > b.number ? 1 : 0);
+}
+
+/*
+   Evaluates a parsed formula for one cell. The evaluator only reads
+   the workbook, so several of them can run concurrently as long as
+   no cell is modified meanwhile.
+*/
+class FormulaEvaluator
+{
+public:
+    FormulaEvaluator(const FormulaEngine *engine, int rowOffset, int columnOffset)
+        : m_engine(engine)
+        , m_rowOffset(rowOffset)
+        , m_columnOffset(columnOffset)
+    {
+    }
+
+    FormulaValue evaluate(const FormulaNode *node) const
+    {
+        switch (node->kind) {
+        case FormulaNode::Constant:
+            return node->value;
+        case FormulaNode::Reference:
+            return evaluateReference(node);
+        case FormulaNode::Unary:
+            return evaluateUnary(node);
+        case FormulaNode::Binary:
+            return evaluateBinary(node);
+        case FormulaNode::Function:
+            return callFunction(node);
+        }
+        return FormulaValue::error("#VALUE!");
+    }
+
+private:
+    const WorksheetPrivate *sheetOf(const FormulaNode *node) const
+    {
+        const WorksheetPrivate *own = m_engine->m_sheet;
+        if (node->sheetName.isEmpty())
+            return own;
+        Workbook *book = own->workbook;
+        for (int i = 0; i < book->sheetCount(); ++i) {
+            AbstractSheet *sheet = book->sheet(i);
+            if (sheet->sheetType() == AbstractSheet::ST_WorkSheet
+                && sheet->sheetName().compare(node->sheetName, Qt::CaseInsensitive) == 0)
+                return WorksheetPrivate::get(static_cast<Worksheet *>(sheet));
+        }
+        return 0;
+    }
+
+    bool resolve(const FormulaNode *node, const WorksheetPrivate **sheet, CellRange *range,
+                 FormulaValue *failure) const
+    {
+        *sheet = sheetOf(node);
+        if (!*sheet || !resolveReference(node, m_rowOffset, m_columnOffset, range)) {
+            *failure = FormulaValue::error("#REF!");
+            return false;
+        }
+        return true;
+    }
+
+    static FormulaValue valueAt(const WorksheetPrivate *sheet, int row, int column)
+    {
+        return FormulaEngine::valueOfCell(cellAt(sheet, row, column));
+    }
+
+    /*
+       Append the non empty values of the range \a node refers to, in
+       row major order.
+    */
+    bool rangeValues(const FormulaNode *node, QVector<FormulaValue> &values,
+                     FormulaValue *failure) const
+    {
+        const WorksheetPrivate *sheet;
+        CellRange range;
+        if (!resolve(node, &sheet, &range, failure))
+            return false;
+
+        typedef QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator RowIterator;
+        typedef QMap<int, QSharedPointer<Cell>>::const_iterator CellIterator;
+        const RowIterator rowEnd = sheet->cellTable.constEnd();
+        for (RowIterator it = sheet->cellTable.lowerBound(range.firstRow());
+             it != rowEnd && it.key() <= range.lastRow(); ++it) {
+            const CellIterator cellEnd = it->constEnd();
+            for (CellIterator cit = it->lowerBound(range.firstColumn());
+                 cit != cellEnd && cit.key() <= range.lastColumn(); ++cit) {
+                const FormulaValue value = FormulaEngine::valueOfCell(cit->data());
+                if (value.type != FormulaValue::Empty)
+                    values.append(value);
+            }
+        }
+        return true;
+    }
+
+    FormulaValue evaluateReference(const FormulaNode *node) const
+    {
+        const WorksheetPrivate *sheet;
+        CellRange range;
+        FormulaValue failure;
+        if (!resolve(node, &sheet, &range, &failure))
+            return failure;
+        // Implicit intersection is not supported
+        if (range.rowCount() != 1 || range.columnCount() != 1)
+            return FormulaValue::error("#VALUE!");
+        return valueAt(sheet, range.firstRow(), range.firstColumn());
+    }
+
+    bool number(const FormulaNode *node, double *out, FormulaValue *failure) const
+    {
+        const FormulaValue value = evaluate(node);
+        if (value.isError()) {
+            *failure = value;
+            return false;
+        }
+        if (!toNumber(value, out)) {
+            *failure = FormulaValue::error("#VALUE!");
+            return false;
+        }
+        return true;
+    }
+
+    bool text(const FormulaNode *node, QString *out, FormulaValue *failure) const
+    {
+        const FormulaValue value = evaluate(node);
+        if (value.isError()) {
+            *failure = value;
+            return false;
+        }
+        *out = toText(value);
+        return true;
+    }
+
+    bool boolean(const FormulaNode *node, bool *out, FormulaValue *failure) const
+    {
+        const FormulaValue value = evaluate(node);
+        if (value.isError()) {
+            *failure = value;
+            return false;
+        }
+        if (!toBool(value, out)) {
+            *failure = FormulaValue::error("#VALUE!");
+            return false;
+        }
+        return true;
+    }
+
+    FormulaValue evaluateUnary(const FormulaNode *node) const
+    {
+        double n;
+        FormulaValue failure;
+        if (!number(node->children[0].data(), &n, &failure))
+            return failure;
+        if (node->name == QLatin1String("-"))
+            return FormulaValue(-n);
+        if (node->name == QLatin1String("%"))
+            return FormulaValue(n / 100);
+        return FormulaValue(n);
+    }
+
+    FormulaValue evaluateBinary(const FormulaNode *node) const
+    {
+        const QString &op = node->name;
+        const FormulaValue left = evaluate(node->children[0].data());
+        if (left.isError())
+            return left;
+        const FormulaValue right = evaluate(node->children[1].data());
+        if (right.isError())
+            return right;
+
+        if (op == QLatin1String("&"))
+            return FormulaValue(toText(left) + toText(right));
+
+        const QChar c = op[0];
+        if (c == QLatin1Char('=') || c == QLatin1Char('<') || c == QLatin1Char('>')) {
+            const int result = compareValues(left, right);
+            if (op == QLatin1String("="))
+                return FormulaValue::boolean(result == 0);
+            if (op == QLatin1String("<>"))
+                return FormulaValue::boolean(result != 0);
+            if (op == QLatin1String("<"))
+                return FormulaValue::boolean(result < 0);
+            if (op == QLatin1String(">"))
+                return FormulaValue::boolean(result > 0);
+            if (op == QLatin1String("<="))
+                return FormulaValue::boolean(result <= 0);
+            return FormulaValue::boolean(result >= 0);
+        }
+
+        double a, b;
+        if (!toNumber(left, &a) || !toNumber(right, &b))
+            return FormulaValue::error("#VALUE!");
+        switch (c.toLatin1()) {
+        case '+':
+            return FormulaValue(a + b);
+        case '-':
+            return FormulaValue(a - b);
+        case '*':
+            return FormulaValue(a * b);
+        case '/':
+            if (b == 0)
+                return FormulaValue::error("#DIV/0!");
+            return FormulaValue(a / b);
+        case '^': {
+            const double result = pow(a, b);
+            if (qIsNaN(result) || qIsInf(result))
+                return FormulaValue::error("#NUM!");
+            return FormulaValue(result);
+        }
+        default:
+            return FormulaValue::error("#VALUE!");
+        }
+    }
+
+    /*
+       Flatten the arguments of an aggregate function: references
+       contribute the values of their cells as they are, while scalar
+       arguments are coerced to numbers.
+    */
+    bool aggregateValues(const FormulaNode *node, QVector<FormulaValue> &values,
+                         FormulaValue *failure) const
+    {
+        foreach (const FormulaNodePtr &arg, node->children) {
+            if (arg->kind == FormulaNode::Reference) {
+                const int first = values.size();
+                if (!rangeValues(arg.data(), values, failure))
+                    return false;
+                for (int i = first; i < values.size(); ++i) {
+                    if (values[i].isError()) {
+                        *failure = values[i];
+                        return false;
+                    }
+                }
+                continue;
+            }
+            double n;
+            if (!number(arg.data(), &n, failure))
+                return false;
+            values.append(FormulaValue(n));
+        }
+        return true;
+    }
+
+    FormulaValue aggregate(const FormulaNode *node) const
+    {
+        QVector<FormulaValue> values;
+        FormulaValue failure;
+        if (!aggregateValues(node, values, &failure))
+            return failure;
+
+        const QString &name = node->name;
+        double sum = 0;
+        double min = 0;
+        double max = 0;
+        int numbers = 0;
+        foreach (const FormulaValue &value, values) {
+            if (value.type != FormulaValue::Number)
+                continue;
+            if (numbers == 0 || value.number < min)
+                min = value.number;
+            if (numbers == 0 || value.number > max)
+                max = value.number;
+            sum += value.number;
+            ++numbers;
+        }
+        if (name == QLatin1String("SUM"))
+            return FormulaValue(sum);
+        if (name == QLatin1String("MIN"))
+            return FormulaValue(min);
+        if (name == QLatin1String("MAX"))
+            return FormulaValue(max);
+        if (numbers == 0)
+            return FormulaValue::error("#DIV/0!");
+        return FormulaValue(sum / numbers); // AVERAGE
+    }
+
+    FormulaValue count(const FormulaNode *node, bool countAll) const
+    {
+        int result = 0;
+        foreach (const FormulaNodePtr &arg, node->children) {
+            if (arg->kind == FormulaNode::Reference) {
+                QVector<FormulaValue> values;
+                FormulaValue failure;
+                if (!rangeValues(arg.data(), values, &failure))
+                    return failure;
+                foreach (const FormulaValue &value, values) {
+                    if (countAll || value.type == FormulaValue::Number)
+                        ++result;
+                }
+                continue;
+            }
+            const FormulaValue value = evaluate(arg.data());
+            double n;
+            if (countAll ? value.type != FormulaValue::Empty
+                         : (!value.isError() && toNumber(value, &n)))
+                ++result;
+        }
+        return FormulaValue(double(result));
+    }
+
+    FormulaValue logical(const FormulaNode *node, bool isAnd) const
+    {
+        if (node->children.isEmpty())
+            return FormulaValue::error("#VALUE!");
+        bool result = isAnd;
+        foreach (const FormulaNodePtr &arg, node->children) {
+            QVector<FormulaValue> values;
+            FormulaValue failure;
+            if (arg->kind == FormulaNode::Reference) {
+                if (!rangeValues(arg.data(), values, &failure))
+                    return failure;
+            } else {
+                values.append(evaluate(arg.data()));
+            }
+            foreach (const FormulaValue &value, values) {
+                if (value.isError())
+                    return value;
+                bool b;
+                if (!toBool(value, &b)) {
+                    if (arg->kind == FormulaNode::Reference)
+                        continue; // text in references is ignored
+                    return FormulaValue::error("#VALUE!");
+                }
+                result = isAnd ? (result && b) : (result || b);
+            }
+        }
+        return FormulaValue::boolean(result);
+    }
+
+    /*
+       Returns the 1-based position of \a key along the single row or
+       column \a range, or 0 when it can not be found. \a matchType
+       follows MATCH(): 0 exact, 1 largest value not greater than, -1
+       smallest value not less than; the latter two expect sorted data.
+    */
+    static int lookup(const WorksheetPrivate *sheet, const CellRange &range, bool byRow,
+                      const FormulaValue &key, int matchType)
+    {
+        const int size = byRow ? range.columnCount() : range.rowCount();
+        int found = 0;
+        for (int i = 0; i < size; ++i) {
+            const int row = byRow ? range.firstRow() : range.firstRow() + i;
+            const int column = byRow ? range.firstColumn() + i : range.firstColumn();
+            const FormulaValue value = valueAt(sheet, row, column);
+            if (value.type == FormulaValue::Empty || value.isError())
+                continue;
+            const bool comparable = (value.type == FormulaValue::String)
+                == (key.type == FormulaValue::String);
+            if (!comparable)
+                continue;
+            const int result = compareValues(value, key);
+            if (matchType == 0) {
+                if (result == 0)
+                    return i + 1;
+            } else if (matchType > 0) {
+                if (result > 0)
+                    break;
+                found = i + 1;
+            } else {
+                if (result < 0)
+                    break;
+                found = i + 1;
+            }
+        }
+        return found;
+    }
+
+    FormulaValue vlookup(const FormulaNode *node) const
+    {
+        const int argc = node->children.size();
+        if (argc < 3 || argc > 4 || node->children[1]->kind != FormulaNode::Reference)
+            return FormulaValue::error("#VALUE!");
+        const FormulaValue key = evaluate(node->children[0].data());
+        if (key.isError())
+            return key;
+        const WorksheetPrivate *sheet;
+        CellRange range;
+        FormulaValue failure;
+        if (!resolve(node->children[1].data(), &sheet, &range, &failure))
+            return failure;
+        double columnIndex;
+        if (!number(node->children[2].data(), &columnIndex, &failure))
+            return failure;
+        bool approximate = true;
+        if (argc == 4 && !boolean(node->children[3].data(), &approximate, &failure))
+            return failure;
+        const int column = int(columnIndex);
+        if (column < 1)
+            return FormulaValue::error("#VALUE!");
+        if (column > range.columnCount())
+            return FormulaValue::error("#REF!");
+
+        const CellRange keys(range.firstRow(), range.firstColumn(), range.lastRow(),
+                             range.firstColumn());
+        const int pos = lookup(sheet, keys, false, key, approximate ? 1 : 0);
+        if (pos == 0)
+            return FormulaValue::error("#N/A");
+        return valueAt(sheet, range.firstRow() + pos - 1, range.firstColumn() + column - 1);
+    }
+
+    FormulaValue index(const FormulaNode *node) const
+    {
+        const int argc = node->children.size();
+        if (argc < 2 || argc > 3 || node->children[0]->kind != FormulaNode::Reference)
+            return FormulaValue::error("#VALUE!");
+        const WorksheetPrivate *sheet;
+        CellRange range;
+        FormulaValue failure;
+        if (!resolve(node->children[0].data(), &sheet, &range, &failure))
+            return failure;
+        double rowIndex = 0;
+        double columnIndex = 0;
+        if (!number(node->children[1].data(), &rowIndex, &failure))
+            return failure;
+        if (argc == 3 && !number(node->children[2].data(), &columnIndex, &failure))
+            return failure;
+        // A single index into a one row range selects the column
+        if (argc == 2 && range.rowCount() == 1) {
+            columnIndex = rowIndex;
+            rowIndex = 1;
+        }
+        if (rowIndex < 1 && range.rowCount() == 1)
+            rowIndex = 1;
+        if (columnIndex < 1 && range.columnCount() == 1)
+            columnIndex = 1;
+        const int row = int(rowIndex);
+        const int column = int(columnIndex);
+        if (row < 1 || column < 1 || row > range.rowCount() || column > range.columnCount())
+            return FormulaValue::error("#REF!");
+        return valueAt(sheet, range.firstRow() + row - 1, range.firstColumn() + column - 1);
+    }
+
+    FormulaValue match(const FormulaNode *node) const
+    {
+        const int argc = node->children.size();
+        if (argc < 2 || argc > 3 || node->children[1]->kind != FormulaNode::Reference)
+            return FormulaValue::error("#VALUE!");
+        const FormulaValue key = evaluate(node->children[0].data());
+        if (key.isError())
+            return key;
+        const WorksheetPrivate *sheet;
+        CellRange range;
+        FormulaValue failure;
+        if (!resolve(node->children[1].data(), &sheet, &range, &failure))
+            return failure;
+        double matchType = 1;
+        if (argc == 3 && !number(node->children[2].data(), &matchType, &failure))
+            return failure;
+        if (range.rowCount() != 1 && range.columnCount() != 1)
+            return FormulaValue::error("#N/A");
+        const int pos = lookup(sheet, range, range.rowCount() == 1, key,
+                               matchType > 0 ? 1 : (matchType < 0 ? -1 : 0));
+        if (pos == 0)
+            return FormulaValue::error("#N/A");
+        return FormulaValue(double(pos));
+    }
+
+    bool isDate1904() const { return m_engine->m_sheet->workbook->isDate1904(); }
+
+    FormulaValue callFunction(const FormulaNode *node) const
+    {
+        const QString &name = node->name;
+        const int argc = node->children.size();
+        FormulaValue failure;
+
+        if (name == QLatin1String("SUM") || name == QLatin1String("AVERAGE")
+            || name == QLatin1String("MIN") || name == QLatin1String("MAX"))
+            return aggregate(node);
+        if (name == QLatin1String("COUNT"))
+            return count(node, false);
+        if (name == QLatin1String("COUNTA"))
+            return count(node, true);
+        if (name == QLatin1String("AND"))
+            return logical(node, true);
+        if (name == QLatin1String("OR"))
+            return logical(node, false);
+        if (name == QLatin1String("VLOOKUP"))
+            return vlookup(node);
+        if (name == QLatin1String("INDEX"))
+            return index(node);
+        if (name == QLatin1String("MATCH"))
+            return match(node);
+
+        if (name == QLatin1String("IF")) {
+            if (argc < 2 || argc > 3)
+                return FormulaValue::error("#VALUE!");
+            bool condition;
+            if (!boolean(node->children[0].data(), &condition, &failure))
+                return failure;
+            if (condition)
+                return evaluate(node->children[1].data());
+            return argc == 3 ? evaluate(node->children[2].data()) : FormulaValue::boolean(false);
+        }
+        if (name == QLatin1String("IFERROR")) {
+            if (argc != 2)
+                return FormulaValue::error("#VALUE!");
+            const FormulaValue value = evaluate(node->children[0].data());
+            return value.isError() ? evaluate(node->children[1].data()) : value;
+        }
+        if (name == QLatin1String("NOT")) {
+            bool b;
+            if (argc != 1)
+                return FormulaValue::error("#VALUE!");
+            if (!boolean(node->children[0].data(), &b, &failure))
+                return failure;
+            return FormulaValue::boolean(!b);
+        }
+        if (name == QLatin1String("TRUE") && argc == 0)
+            return FormulaValue::boolean(true);
+        if (name == QLatin1String("FALSE") && argc == 0)
+            return FormulaValue::boolean(false);
+
+        // Numeric functions
+        if (name == QLatin1String("ABS") || name == QLatin1String("INT")
+            || name == QLatin1String("SQRT")) {
+            double n;
+            if (argc != 1)
+                return FormulaValue::error("#VALUE!");
+            if (!number(node->children[0].data(), &n, &failure))
+                return failure;
+            if (name == QLatin1String("ABS"))
+                return FormulaValue(fabs(n));
+            if (name == QLatin1String("INT"))
+                return FormulaValue(floor(n));
+            if (n < 0)
+                return FormulaValue::error("#NUM!");
+            return FormulaValue(sqrt(n));
+        }
+        if (name == QLatin1String("ROUND") || name == QLatin1String("MOD")) {
+            double a, b;
+            if (argc != 2)
+                return FormulaValue::error("#VALUE!");
+            if (!number(node->children[0].data(), &a, &failure)
+                || !number(node->children[1].data(), &b, &failure))
+                return failure;
+            if (name == QLatin1String("MOD")) {
+                if (b == 0)
+                    return FormulaValue::error("#DIV/0!");
+                return FormulaValue(a - b * floor(a / b));
+            }
+            const double factor = pow(10.0, int(b));
+            // Drop the binary representation noise first, so that 2.345
+            // which is stored as 2.34499999... still rounds up.
+            const double scaled = QString::number(fabs(a) * factor, 'g', 15).toDouble();
+            const double rounded = floor(scaled + 0.5) / factor;
+            return FormulaValue(a < 0 ? -rounded : rounded);
+        }
+
+        // Text functions
+        if (name == QLatin1String("CONCATENATE")) {
+            QString result;
+            foreach (const FormulaNodePtr &arg, node->children) {
+                QString s;
+                if (!text(arg.data(), &s, &failure))
+                    return failure;
+                result.append(s);
+            }
+            return FormulaValue(result);
+        }
+        if (name == QLatin1String("LEN") || name == QLatin1String("UPPER")
+            || name == QLatin1String("LOWER") || name == QLatin1String("TRIM")) {
+            QString s;
+            if (argc != 1)
+                return FormulaValue::error("#VALUE!");
+            if (!text(node->children[0].data(), &s, &failure))
+                return failure;
+            if (name == QLatin1String("LEN"))
+                return FormulaValue(double(s.size()));
+            if (name == QLatin1String("UPPER"))
+                return FormulaValue(s.toUpper());
+            if (name == QLatin1String("LOWER"))
+                return FormulaValue(s.toLower());
+            return FormulaValue(s.simplified());
+        }
+        if (name == QLatin1String("LEFT") || name == QLatin1String("RIGHT")) {
+            QString s;
+            double n = 1;
+            if (argc < 1 || argc > 2)
+                return FormulaValue::error("#VALUE!");
+            if (!text(node->children[0].data(), &s, &failure))
+                return failure;
+            if (argc == 2 && !number(node->children[1].data(), &n, &failure))
+                return failure;
+            if (n < 0)
+                return FormulaValue::error("#VALUE!");
+            return FormulaValue(name == QLatin1String("LEFT") ? s.left(int(n)) : s.right(int(n)));
+        }
+        if (name == QLatin1String("MID")) {
+            QString s;
+            double start, n;
+            if (argc != 3)
+                return FormulaValue::error("#VALUE!");
+            if (!text(node->children[0].data(), &s, &failure)
+                || !number(node->children[1].data(), &start, &failure)
+                || !number(node->children[2].data(), &n, &failure))
+                return failure;
+            if (start < 1 || n < 0)
+                return FormulaValue::error("#VALUE!");
+            return FormulaValue(s.mid(int(start) - 1, int(n)));
+        }
+
+        // Date functions, dates are serial numbers of the workbook's date system
+        if (name == QLatin1String("DATE")) {
+            double year, month, day;
+            if (argc != 3)
+                return FormulaValue::error("#VALUE!");
+            if (!number(node->children[0].data(), &year, &failure)
+                || !number(node->children[1].data(), &month, &failure)
+                || !number(node->children[2].data(), &day, &failure))
+                return failure;
+            // Rejected before the conversions below, which would overflow:
+            // no month or day beyond these can carry over to a date of 0-9999
+            if (!(year >= 0 && year < 10000) || !(qAbs(month) <= 10000 * 12)
+                || !(qAbs(day) <= 10000 * 366))
+                return FormulaValue::error("#NUM!");
+            int y = int(year);
+            if (y < 1900)
+                y += 1900;
+            if (y > 9999)
+                return FormulaValue::error("#NUM!");
+            // Months and days out of their range carry over, as in Excel
+            const qint64 days = daysFromCivil(y, int(month), 1) + qint64(day) - 1;
+            const double serial = daysToNumber(days, 0, isDate1904());
+            if (serial < 0 || days > daysFromCivil(9999, 12, 31))
+                return FormulaValue::error("#NUM!");
+            return FormulaValue(serial);
+        }
+        if (name == QLatin1String("YEAR") || name == QLatin1String("MONTH")
+            || name == QLatin1String("DAY")) {
+            double serial;
+            if (argc != 1)
+                return FormulaValue::error("#VALUE!");
+            if (!number(node->children[0].data(), &serial, &failure))
+                return failure;
+            if (serial < 0)
+                return FormulaValue::error("#NUM!");
+            qint64 msecs;
+            int y, m, d;
+            civilFromDays(daysFromNumber(serial, &msecs, isDate1904()), &y, &m, &d);
+            if (name == QLatin1String("YEAR"))
+                return FormulaValue(double(y));
+            if (name == QLatin1String("MONTH"))
+                return FormulaValue(double(m));
+            return FormulaValue(double(d));
+        }
+        if (name == QLatin1String("TODAY") && argc == 0)
+            return FormulaValue(
+                datetimeToNumber(QDateTime(QDate::currentDate(), QTime(0, 0)), isDate1904()));
+        if (name == QLatin1String("NOW") && argc == 0)
+            return FormulaValue(datetimeToNumber(QDateTime::currentDateTime(), isDate1904()));
+
+        return FormulaValue::error("#NAME?");
+    }
+
+    const FormulaEngine *m_engine;
+    int m_rowOffset;
+    int m_columnOffset;
+};
+
+struct FormulaJob
+{
+    quint64 key;
+    FormulaValue result;
+};
+
+struct FormulaJobRunner
+{
+    typedef void result_type;
+
+    explicit FormulaJobRunner(const FormulaEngine *engine)
+        : engine(engine)
+    {
+    }
+
+    void operator()(FormulaJob &job) const
+    {
+        job.result = engine->evaluateEntry(engine->m_entries.constFind(job.key).value());
+    }
+
+    const FormulaEngine *engine;
+};
+
+/*
+   Append to \a out the keys of \a sorted that lie in \a range.
+*/
+static void keysInRange(const QVector<quint64> &sorted, const CellRange &range,
+                        QVector<quint64> &out)
+{
+    typedef QVector<quint64>::const_iterator Iterator;
+    const Iterator end = sorted.constEnd();
+    if (qint64(range.rowCount()) * 4 < sorted.size()) {
+        // Few rows, binary search each of them
+        for (int row = range.firstRow(); row <= range.lastRow(); ++row) {
+            const quint64 last = cellKey(row, range.lastColumn());
+            for (Iterator it = std::lower_bound(sorted.constBegin(), end,
+                                                cellKey(row, range.firstColumn()));
+                 it != end && *it <= last; ++it)
+                out.append(*it);
+        }
+    } else {
+        const quint64 last = cellKey(range.lastRow(), range.lastColumn());
+        for (Iterator it = std::lower_bound(sorted.constBegin(), end,
+                                            cellKey(range.firstRow(), range.firstColumn()));
+             it != end && *it <= last; ++it) {
+            const int column = int(*it & 0xffffffff);
+            if (column >= range.firstColumn() && column <= range.lastColumn())
+                out.append(*it);
+        }
+    }
+}
+
+/*!
+  \class FormulaEngine
+  \internal
+
+  Computes the cached results of the formulas of one worksheet.
+
+  Formula text is parsed once into a tree which is cached by text, so
+  the cells of a shared formula all use the tree of the root formula
+  together with their offset from it. The engine keeps the graph of
+  precedents of every formula cell; writing a cell marks the formulas
+  depending on it, directly or not, as dirty, and recalculate()
+  evaluates only those. Dirty formulas are ordered in levels whose
+  members do not depend on each other, and large levels are evaluated
+  on the global thread pool.
+
+  References to other sheets are not tracked, formulas using them
+  are evaluated on each recalculation, as are TODAY() and NOW(). The
+  save repeats the recalculation of the sheets until no result changes.
+  The ranges referred to are indexed by blocks of rows of each column.
+  Circular references evaluate to 0.
+*/
+FormulaEngine::FormulaEngine(WorksheetPrivate *sheet)
+    : m_sheet(sheet)
+    , m_built(false)
+{
+}
+
+FormulaEngine::~FormulaEngine()
+{
+}
+
+/*
+   Returns the value \a cell contributes to formulas.
+*/
+FormulaValue FormulaEngine::valueOfCell(const Cell *cell)
+{
+    if (!cell)
+        return FormulaValue();
+    const QVariant value = cell->value();
+    switch (cell->cellType()) {
+    case Cell::NumberType:
+        if (!value.isValid())
+            return FormulaValue();
+        return FormulaValue(value.toDouble());
+    case Cell::BooleanType:
+        return FormulaValue::boolean(value.toBool());
+    case Cell::ErrorType:
+        return FormulaValue(value.toString(), FormulaValue::Error);
+    default:
+        return FormulaValue(value.toString());
+    }
+}
+
+FormulaValue FormulaEngine::evaluate(const QString &formula)
+{
+    const FormulaNodePtr ast = parse(formula);
+    return FormulaEvaluator(this, 0, 0).evaluate(ast.data());
+}
+
+FormulaValue FormulaEngine::evaluateEntry(const Entry &entry) const
+{
+    return FormulaEvaluator(this, entry.rowOffset, entry.columnOffset).evaluate(entry.ast.data());
+}
+
+QSharedPointer<const FormulaNode> FormulaEngine::parse(const QString &formula)
+{
+    QHash<QString, FormulaNodePtr>::const_iterator it = m_astCache.constFind(formula);
+    if (it != m_astCache.constEnd())
+        return it.value();
+    const FormulaNodePtr ast = FormulaParser(formula).parse();
+    m_astCache.insert(formula, ast);
+    return ast;
+}
+
+void FormulaEngine::collectPrecedents(const FormulaNode *node, Entry &entry) const
+{
+    if (node->kind == FormulaNode::Reference) {
+        if (!node->sheetName.isEmpty()
+            && node->sheetName.compare(m_sheet->name, Qt::CaseInsensitive) != 0) {
+            entry.isVolatile = true;
+            return;
+        }
+        CellRange range;
+        if (resolveReference(node, entry.rowOffset, entry.columnOffset, &range))
+            entry.precedents.append(range);
+        return;
+    }
+    if (node->kind == FormulaNode::Function
+        && (node->name == QLatin1String("TODAY") || node->name == QLatin1String("NOW")))
+        entry.isVolatile = true;
+    foreach (const FormulaNodePtr &child, node->children)
+        collectPrecedents(child.data(), entry);
+}
+
+void FormulaEngine::build()
+{
+    m_built = true;
+    typedef QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator RowIterator;
+    typedef QMap<int, QSharedPointer<Cell>>::const_iterator CellIterator;
+    for (RowIterator it = m_sheet->cellTable.constBegin(); it != m_sheet->cellTable.constEnd();
+         ++it) {
+        for (CellIterator cit = it->constBegin(); cit != it->constEnd(); ++cit) {
+            if (cit.value()->hasFormula())
+                registerCell(it.key(), cit.key(), cit->data());
+        }
+    }
+}
+
+void FormulaEngine::registerCell(int row, int column, const Cell *cell)
+{
+    const CellFormula formula = cell->formula();
+    QString text;
+    int anchorRow = row;
+    int anchorColumn = column;
+    if (formula.formulaType() == CellFormula::NormalType) {
+        text = formula.formulaText();
+    } else if (formula.formulaType() == CellFormula::SharedType) {
+        const CellFormula root = m_sheet->sharedFormulaMap.value(formula.sharedIndex());
+        text = root.formulaText();
+        if (root.reference().isValid()) {
+            anchorRow = root.reference().firstRow();
+            anchorColumn = root.reference().firstColumn();
+        }
+    }
+    // Array formulas and data tables keep the results they were given
+    if (text.isEmpty())
+        return;
+
+    Entry entry;
+    entry.ast = parse(text);
+    entry.row = row;
+    entry.column = column;
+    entry.rowOffset = row - anchorRow;
+    entry.columnOffset = column - anchorColumn;
+    collectPrecedents(entry.ast.data(), entry);
+
+    const quint64 key = cellKey(row, column);
+    foreach (const CellRange &range, entry.precedents) {
+        if (range.rowCount() == 1 && range.columnCount() == 1) {
+            m_cellDependents[cellKey(range.firstRow(), range.firstColumn())].insert(key);
+            continue;
+        }
+        m_rangePrecedents[key].append(range);
+        if (!isIndexedRange(range)) {
+            m_wideRangeDependents.insert(key);
+            continue;
+        }
+        for (int column = range.firstColumn(); column <= range.lastColumn(); ++column) {
+            for (int block = range.firstRow() >> RangeBlockShift;
+                 block <= range.lastRow() >> RangeBlockShift; ++block)
+                m_rangeBlocks[cellKey(block, column)].insert(key);
+        }
+    }
+    if (entry.isVolatile)
+        m_volatile.insert(key);
+    m_entries.insert(key, entry);
+    m_dirty.insert(key);
+}
+
+void FormulaEngine::unregisterCell(quint64 key)
+{
+    QHash<quint64, Entry>::iterator it = m_entries.find(key);
+    if (it == m_entries.end())
+        return;
+    foreach (const CellRange &range, it->precedents) {
+        if (range.rowCount() != 1 || range.columnCount() != 1)
+            continue;
+        QHash<quint64, QSet<quint64>>::iterator dit =
+            m_cellDependents.find(cellKey(range.firstRow(), range.firstColumn()));
+        if (dit != m_cellDependents.end()) {
+            dit->remove(key);
+            if (dit->isEmpty())
+                m_cellDependents.erase(dit);
+        }
+    }
+    foreach (const CellRange &range, m_rangePrecedents.value(key)) {
+        if (!isIndexedRange(range))
+            continue;
+        for (int column = range.firstColumn(); column <= range.lastColumn(); ++column) {
+            for (int block = range.firstRow() >> RangeBlockShift;
+                 block <= range.lastRow() >> RangeBlockShift; ++block) {
+                QHash<quint64, QSet<quint64>>::iterator bit =
+                    m_rangeBlocks.find(cellKey(block, column));
+                if (bit != m_rangeBlocks.end()) {
+                    bit->remove(key);
+                    if (bit->isEmpty())
+                        m_rangeBlocks.erase(bit);
+                }
+            }
+        }
+    }
+    m_rangePrecedents.remove(key);
+    m_wideRangeDependents.remove(key);
+    m_volatile.remove(key);
+    m_dirty.remove(key);
+    m_entries.erase(it);
+}
+
+void FormulaEngine::dependentsOf(quint64 key, QVector<quint64> &dependents) const
+{
+    QHash<quint64, QSet<quint64>>::const_iterator it = m_cellDependents.constFind(key);
+    if (it != m_cellDependents.constEnd()) {
+        foreach (quint64 dependent, it.value())
+            dependents.append(dependent);
+    }
+
+    // Only the formulas whose ranges overlap the block of the cell, and the
+    // ones with wide ranges, are checked. A formula may be appended twice.
+    const int row = int(key >> 32);
+    const int column = int(key & 0xffffffff);
+    QHash<quint64, QSet<quint64>>::const_iterator bit =
+        m_rangeBlocks.constFind(blockKey(row, column));
+    if (bit != m_rangeBlocks.constEnd()) {
+        foreach (quint64 dependent, bit.value()) {
+            if (rangesContain(m_rangePrecedents.value(dependent), row, column))
+                dependents.append(dependent);
+        }
+    }
+    foreach (quint64 dependent, m_wideRangeDependents) {
+        if (rangesContain(m_rangePrecedents.value(dependent), row, column))
+            dependents.append(dependent);
+    }
+}
+
+void FormulaEngine::invalidateDependents(quint64 key)
+{
+    QVector<quint64> queue;
+    queue.append(key);
+    while (!queue.isEmpty()) {
+        const quint64 current = queue.takeLast();
+        QVector<quint64> dependents;
+        dependentsOf(current, dependents);
+        foreach (quint64 dependent, dependents) {
+            if (!m_dirty.contains(dependent)) {
+                m_dirty.insert(dependent);
+                queue.append(dependent);
+            }
+        }
+    }
+}
+
+/*
+   Called whenever the cell (\a row, \a column) is written.
+*/
+void FormulaEngine::cellChanged(int row, int column)
+{
+    // Until the first recalculation, the whole sheet will be scanned anyway.
+    if (!m_built)
+        return;
+
+    const quint64 key = cellKey(row, column);
+    unregisterCell(key);
+    const Cell *cell = cellAt(m_sheet, row, column);
+    if (cell && cell->hasFormula())
+        registerCell(row, column, cell);
+    invalidateDependents(key);
+}
+
+bool FormulaEngine::evaluateLevel(const QVector<quint64> &level)
+{
+    QVector<FormulaJob> jobs(level.size());
+    for (int i = 0; i < level.size(); ++i)
+        jobs[i].key = level[i];
+
+    FormulaJobRunner runner(this);
+    if (jobs.size() >= ParallelLevelThreshold && QThreadPool::globalInstance()->maxThreadCount() > 1) {
+        QtConcurrent::blockingMap(jobs, runner);
+    } else {
+        for (int i = 0; i < jobs.size(); ++i)
+            runner(jobs[i]);
+    }
+
+    // Results are only stored once the whole level is done, as the
+    // evaluation threads read the cells.
+    bool changed = false;
+    foreach (const FormulaJob &job, jobs) {
+        const Entry &entry = m_entries.constFind(job.key).value();
+        if (m_sheet->setFormulaResult(entry.row, entry.column, job.result))
+            changed = true;
+    }
+    return changed;
+}
+
+/*
+   Evaluate all the formulas that are out of date, and return whether the
+   result of one of them changed.
+*/
+bool FormulaEngine::recalculate()
+{
+    if (!m_built)
+        build();
+
+    // Volatile formulas, and everything depending on them, are always recalculated.
+    foreach (quint64 key, m_volatile) {
+        if (!m_dirty.contains(key)) {
+            m_dirty.insert(key);
+            invalidateDependents(key);
+        }
+    }
+    if (m_dirty.isEmpty())
+        return false;
+
+    QVector<quint64> pending;
+    pending.reserve(m_dirty.size());
+    foreach (quint64 key, m_dirty)
+        pending.append(key);
+    std::sort(pending.begin(), pending.end());
+    m_dirty.clear();
+
+    // Edges are only needed between pending formulas, up to date cells
+    // behave like constants.
+    QHash<quint64, QVector<quint64>> dependents;
+    QHash<quint64, int> inDegree;
+    QVector<quint64> level;
+    QVector<quint64> precedents;
+    foreach (quint64 key, pending) {
+        const Entry &entry = m_entries.constFind(key).value();
+        precedents.clear();
+        foreach (const CellRange &range, entry.precedents)
+            keysInRange(pending, range, precedents);
+        foreach (quint64 precedent, precedents)
+            dependents[precedent].append(key);
+        inDegree.insert(key, precedents.size());
+        if (precedents.isEmpty())
+            level.append(key);
+    }
+
+    bool changed = false;
+    int evaluated = 0;
+    while (!level.isEmpty()) {
+        if (evaluateLevel(level))
+            changed = true;
+        evaluated += level.size();
+
+        QVector<quint64> next;
+        foreach (quint64 key, level) {
+            QHash<quint64, QVector<quint64>>::const_iterator it = dependents.constFind(key);
+            if (it == dependents.constEnd())
+                continue;
+            foreach (quint64 dependent, it.value()) {
+                if (--inDegree[dependent] == 0)
+                    next.append(dependent);
+            }
+        }
+        level = next;
+    }
+
+    if (evaluated < pending.size()) {
+        // What is left is part of, or depends on, a circular reference.
+        foreach (quint64 key, pending) {
+            if (inDegree.value(key) > 0) {
+                const Entry &entry = m_entries.constFind(key).value();
+                if (m_sheet->setFormulaResult(entry.row, entry.column, FormulaValue(0.0)))
+                    changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+QT_END_NAMESPACE_XLSX
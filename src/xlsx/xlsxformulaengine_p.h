@@ -0,0 +1,154 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef XLSXFORMULAENGINE_P_H
+#define XLSXFORMULAENGINE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+#include "xlsxcellrange.h"
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class Cell;
+class WorksheetPrivate;
+struct FormulaNode;
+
+struct FormulaValue
+{
+    enum Type { Empty, Number, String, Boolean, Error };
+
+    FormulaValue()
+        : type(Empty)
+        , number(0)
+    {
+    }
+    explicit FormulaValue(double number)
+        : type(Number)
+        , number(number)
+    {
+    }
+    explicit FormulaValue(const QString &text, Type type = String)
+        : type(type)
+        , number(0)
+        , text(text)
+    {
+    }
+    static FormulaValue boolean(bool b)
+    {
+        FormulaValue v(b ? 1.0 : 0.0);
+        v.type = Boolean;
+        return v;
+    }
+    static FormulaValue error(const char *code)
+    {
+        return FormulaValue(QString::fromLatin1(code), Error);
+    }
+    bool isError() const { return type == Error; }
+
+    Type type;
+    double number; // Number and Boolean
+    QString text;  // String, or the error code such as "#DIV/0!"
+};
+
+class XLSX_AUTOTEST_EXPORT FormulaEngine
+{
+public:
+    explicit FormulaEngine(WorksheetPrivate *sheet);
+    ~FormulaEngine();
+
+    void cellChanged(int row, int column);
+    bool recalculate();
+
+    FormulaValue evaluate(const QString &formula);
+
+    static FormulaValue valueOfCell(const Cell *cell);
+
+private:
+    friend class FormulaEvaluator;
+    friend struct FormulaJobRunner;
+
+    struct Entry
+    {
+        Entry()
+            : row(0)
+            , column(0)
+            , rowOffset(0)
+            , columnOffset(0)
+            , isVolatile(false)
+        {
+        }
+        QSharedPointer<const FormulaNode> ast;
+        int row;
+        int column;
+        // Offset of the cell from the one the formula text was written
+        // for, which is only non-zero for shared formulas.
+        int rowOffset;
+        int columnOffset;
+        QVector<CellRange> precedents;
+        bool isVolatile;
+    };
+
+    void build();
+    void registerCell(int row, int column, const Cell *cell);
+    void unregisterCell(quint64 key);
+    void invalidateDependents(quint64 key);
+    void dependentsOf(quint64 key, QVector<quint64> &dependents) const;
+    QSharedPointer<const FormulaNode> parse(const QString &formula);
+    void collectPrecedents(const FormulaNode *node, Entry &entry) const;
+    bool evaluateLevel(const QVector<quint64> &level);
+    FormulaValue evaluateEntry(const Entry &entry) const;
+
+    WorksheetPrivate *m_sheet;
+    bool m_built;
+
+    QHash<QString, QSharedPointer<const FormulaNode>> m_astCache;
+    QHash<quint64, Entry> m_entries;
+    QHash<quint64, QSet<quint64>> m_cellDependents;
+    QHash<quint64, QVector<CellRange>> m_rangePrecedents; // of more than one cell
+    QHash<quint64, QSet<quint64>> m_rangeBlocks; // formulas whose ranges overlap a block
+    QSet<quint64> m_wideRangeDependents; // formulas with ranges of too many blocks
+    QSet<quint64> m_volatile;
+    QSet<quint64> m_dirty;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // XLSXFORMULAENGINE_P_H
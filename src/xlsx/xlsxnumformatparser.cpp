@@ -30,24 +30,57 @@ namespace QXlsx {
 
 bool NumFormatParser::isDateTime(const QString &formatCode)
 {
+    return isDateTimeKind(kind(formatCode));
+}
+
+/*
+  Returns whether the "m" at \a index of \a formatCode are minutes, that is
+  whether they are followed by seconds before any other date or time token.
+ */
+static bool isMinutes(const QString &formatCode, int index)
+{
+    for (int i = index; i < formatCode.length(); ++i) {
+        switch (formatCode[i].toLower().unicode()) {
+        case 's':
+            return true;
+        case 'y':
+        case 'd':
+        case 'h':
+        case ';':
+            return false;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+NumFormatParser::NumberKind NumFormatParser::kind(const QString &formatCode)
+{
+    bool hasDate = false;
+    bool hasTime = false;
+    bool hasText = false;
+    bool afterHours = false; // so that "m" are minutes
+
     for (int i = 0; i < formatCode.length(); ++i) {
         const QChar &c = formatCode[i];
 
         switch (c.unicode()) {
-        case '[':
-            // [h], [m], [s] are valid format for time
-            if (i < formatCode.length() - 2 && formatCode[i + 2] == QLatin1Char(']')) {
-                const QChar cc = formatCode[i + 1].toLower();
-                if (cc == QLatin1Char('h') || cc == QLatin1Char('m') || cc == QLatin1Char('s'))
-                    return true;
-                i += 2;
-                break;
-            } else {
-                // condition or color: don't care, ignore
-                while (i < formatCode.length() && formatCode[i] != QLatin1Char(']'))
-                    ++i;
-                break;
+        case '[': {
+            // [h], [mm], [ss] and so on are valid format for elapsed time
+            const QChar cc = i < formatCode.length() - 1 ? formatCode[i + 1].toLower() : QChar();
+            int j = i + 1;
+            while (j < formatCode.length() && formatCode[j].toLower() == cc)
+                ++j;
+            if (j > i + 1 && j < formatCode.length() && formatCode[j] == QLatin1Char(']')
+                && (cc == QLatin1Char('h') || cc == QLatin1Char('m') || cc == QLatin1Char('s'))) {
+                return Duration;
             }
+            // condition or color: don't care, ignore
+            while (i < formatCode.length() && formatCode[i] != QLatin1Char(']'))
+                ++i;
+            break;
+        }
 
         // quoted plain text block: don't care, ignore
         case '"':
@@ -64,31 +97,92 @@ bool NumFormatParser::isDateTime(const QString &formatCode)
         // date/time can only be positive number,
         // so only the first section of the format make sense.
         case ';':
-            return false;
+            i = formatCode.length();
+            break;
+
+        case '@':
+            hasText = true;
             break;
 
-        // days
+        // days, years
         case 'D':
         case 'd':
-        // years
         case 'Y':
         case 'y':
-        // hours
+            hasDate = true;
+            afterHours = false;
+            break;
+
+        // hours, seconds
         case 'H':
         case 'h':
-        // seconds
+            hasTime = true;
+            afterHours = true;
+            break;
         case 'S':
         case 's':
+            hasTime = true;
+            afterHours = false;
+            break;
+
         // minutes or months, depending on context
         case 'M':
         case 'm':
-            return true;
+            while (i < formatCode.length() - 1 && formatCode[i + 1].toLower() == QLatin1Char('m'))
+                ++i;
+            if (afterHours || isMinutes(formatCode, i + 1))
+                hasTime = true;
+            else
+                hasDate = true;
+            afterHours = false;
+            break;
+
+        // AM/PM or A/P, time of a 12 hour clock
+        case 'A':
+        case 'a':
+            if (formatCode.midRef(i, 5).compare(QLatin1String("AM/PM"), Qt::CaseInsensitive) == 0) {
+                hasTime = true;
+                i += 4;
+            } else if (formatCode.midRef(i, 3).compare(QLatin1String("A/P"), Qt::CaseInsensitive)
+                       == 0) {
+                hasTime = true;
+                i += 2;
+            }
+            break;
 
         default:
             break;
         }
     }
-    return false;
+
+    if (hasDate && hasTime)
+        return DateTime;
+    if (hasDate)
+        return Date;
+    if (hasTime)
+        return Time;
+    return hasText ? Text : Numeric;
+}
+
+/*
+  Returns the kind of the built-in number format \a numFmtId.
+ */
+NumFormatParser::NumberKind NumFormatParser::builtinKind(int numFmtId)
+{
+    if (numFmtId >= 14 && numFmtId <= 17)
+        return Date;
+    if ((numFmtId >= 18 && numFmtId <= 21) || numFmtId == 45 || numFmtId == 47)
+        return Time;
+    if (numFmtId == 22)
+        return DateTime;
+    if (numFmtId == 46)
+        return Duration;
+    if (numFmtId == 49)
+        return Text;
+    // Used in CHS\CHT\JPN\KOR
+    if ((numFmtId >= 27 && numFmtId <= 36) || (numFmtId >= 50 && numFmtId <= 58))
+        return Date;
+    return Numeric;
 }
 
 } // namespace QXlsx
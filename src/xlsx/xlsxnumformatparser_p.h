@@ -43,7 +43,13 @@ namespace QXlsx {
 class NumFormatParser
 {
 public:
+    // What the values shown with a number format are
+    enum NumberKind { Numeric, Date, Time, DateTime, Duration, Text };
+
     static bool isDateTime(const QString &formatCode);
+    static NumberKind kind(const QString &formatCode);
+    static NumberKind builtinKind(int numFmtId);
+    static bool isDateTimeKind(NumberKind kind) { return kind >= Date && kind <= Duration; }
 };
 
 } // namespace QXlsx
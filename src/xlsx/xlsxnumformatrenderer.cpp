@@ -0,0 +1,1047 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxnumformatrenderer_p.h"
+#include "xlsxutility_p.h"
+
+#include <QStringList>
+
+#include <limits>
+#include <math.h>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+/*
+  Number formats are compiled once into sections of tokens, so that values
+  are rendered by walking the tokens of the section they select, with the
+  digits laid out on the placeholders resolved at compile time.
+  Numbers are shown as in the en-US locale of Excel.
+ */
+
+static const qint64 MSecsPerDay = 24 * 60 * 60 * 1000;
+
+static const char *const monthNames[] = { "January", "February", "March",     "April",
+                                          "May",     "June",     "July",      "August",
+                                          "September", "October", "November", "December" };
+static const char *const dayNames[] = { "Sunday",   "Monday", "Tuesday", "Wednesday",
+                                        "Thursday", "Friday", "Saturday" };
+
+NumFormatSection::NumFormatSection()
+    : kind(NumFormatParser::Numeric)
+    , condition(NoCondition)
+    , conditionValue(0)
+    , denominator(0)
+    , percents(0)
+    , scalingCommas(0)
+    , subSecondDigits(0)
+    , grouping(false)
+    , twelveHours(false)
+{
+}
+
+bool NumFormatSection::matches(double value) const
+{
+    switch (condition) {
+    case Less:
+        return value < conditionValue;
+    case LessEqual:
+        return value <= conditionValue;
+    case Greater:
+        return value > conditionValue;
+    case GreaterEqual:
+        return value >= conditionValue;
+    case Equal:
+        return value == conditionValue;
+    case NotEqual:
+        return value != conditionValue;
+    default:
+        return true;
+    }
+}
+
+/*
+  Appends the non negative \a number with at least \a width digits.
+ */
+static void appendNumber(QString &text, qint64 number, int width = 1)
+{
+    char buffer[24];
+    int length = 0;
+    do {
+        buffer[length++] = char('0' + number % 10);
+        number /= 10;
+    } while (number > 0);
+    for (int i = length; i < width; ++i)
+        text.append(QLatin1Char('0'));
+    while (length > 0)
+        text.append(QLatin1Char(buffer[--length]));
+}
+
+/*
+  Appends what the placeholder at \a index of \a placeholders shows of the
+  \a digits aligned on the right. The first placeholder shows the digits
+  in excess too.
+ */
+static void appendAligned(QString &text, const QString &digits, const QString &placeholders,
+                          int index)
+{
+    const int digit = digits.length() - (placeholders.length() - index);
+    if (index == 0 && digit > 0)
+        text.append(digits.leftRef(digit + 1));
+    else if (digit >= 0)
+        text.append(digits.at(digit));
+    else if (placeholders.at(index) == QLatin1Char('0'))
+        text.append(QLatin1Char('0'));
+    else if (placeholders.at(index) == QLatin1Char('?'))
+        text.append(QLatin1Char(' '));
+}
+
+/*
+  Rounds half away from zero as Excel does, tolerating the error of the
+  binary representation, such as the one of 1.005 * 100.
+ */
+static double roundHalfUp(double number)
+{
+    return floor(number + 0.5 + fabs(number) * 4 * std::numeric_limits<double>::epsilon());
+}
+
+/*
+  Returns the non negative \a number with \a decimals digits after the point.
+ */
+static QString fixedNumber(double number, int decimals)
+{
+    double scale = 1;
+    for (int i = 0; i < decimals; ++i)
+        scale *= 10;
+    const double scaled = roundHalfUp(number * scale);
+    if (scaled >= 1e18)
+        return QString::number(number, 'f', decimals);
+
+    QString digits;
+    appendNumber(digits, qint64(scaled), decimals + 1);
+    if (decimals > 0)
+        digits.insert(digits.length() - decimals, QLatin1Char('.'));
+    return digits;
+}
+
+static void removeTrailingZeros(QString &digits)
+{
+    if (!digits.contains(QLatin1Char('.')))
+        return;
+    int length = digits.length();
+    while (digits.at(length - 1) == QLatin1Char('0'))
+        --length;
+    if (digits.at(length - 1) == QLatin1Char('.'))
+        --length;
+    digits.truncate(length);
+}
+
+/*
+  Appends \a value as the General format shows it in a cell of the
+  default width: up to 11 characters, or a scientific notation.
+ */
+static void appendGeneral(QString &text, double value)
+{
+    if (value < 0) {
+        text.append(QLatin1Char('-'));
+        value = -value;
+    }
+    if (value == 0) {
+        text.append(QLatin1Char('0'));
+        return;
+    }
+
+    if (value >= 1e11 || value < 1e-9) {
+        int exponent = int(floor(log10(value)));
+        QString digits = fixedNumber(value / pow(10.0, exponent), 5);
+        if (digits.startsWith(QLatin1String("10"))) {
+            ++exponent;
+            digits = fixedNumber(value / pow(10.0, exponent), 5);
+        }
+        removeTrailingZeros(digits);
+        text.append(digits);
+        text.append(exponent < 0 ? QLatin1String("E-") : QLatin1String("E+"));
+        appendNumber(text, exponent < 0 ? -exponent : exponent, 2);
+        return;
+    }
+
+    const int integerDigits = value < 1 ? 1 : int(floor(log10(value))) + 1;
+    QString digits = fixedNumber(value, qMax(0, 10 - integerDigits));
+    removeTrailingZeros(digits);
+    text.append(digits);
+}
+
+static bool isDigitPlaceholder(QChar c)
+{
+    return c == QLatin1Char('0') || c == QLatin1Char('#') || c == QLatin1Char('?');
+}
+
+static bool isDateTimeToken(NumFormatToken::Type type)
+{
+    return type >= NumFormatToken::Year;
+}
+
+static bool isPlaceholderToken(NumFormatToken::Type type)
+{
+    return type == NumFormatToken::IntegerDigit || type == NumFormatToken::FractionDigit
+        || type == NumFormatToken::ExponentDigit || type == NumFormatToken::NumeratorDigit
+        || type == NumFormatToken::DenominatorDigit;
+}
+
+static void parseBracket(const QString &content, NumFormatSection &section)
+{
+    if (content.isEmpty())
+        return;
+
+    // Elapsed time, such as [h] or [mm]
+    const QChar letter = content.at(0).toLower();
+    if (letter == QLatin1Char('h') || letter == QLatin1Char('m') || letter == QLatin1Char('s')) {
+        bool elapsed = true;
+        for (int i = 1; i < content.length() && elapsed; ++i)
+            elapsed = content.at(i).toLower() == letter;
+        if (elapsed) {
+            NumFormatToken::Type type = letter == QLatin1Char('h')
+                ? NumFormatToken::ElapsedHours
+                : (letter == QLatin1Char('m') ? NumFormatToken::ElapsedMinutes
+                                              : NumFormatToken::ElapsedSeconds);
+            section.tokens.append(NumFormatToken(type, QString(), content.length()));
+            return;
+        }
+    }
+
+    // Currency symbol and locale, such as [$€-407]
+    if (letter == QLatin1Char('$')) {
+        int end = content.indexOf(QLatin1Char('-'));
+        QString symbol = content.mid(1, end == -1 ? -1 : end - 1);
+        if (!symbol.isEmpty())
+            section.tokens.append(NumFormatToken(NumFormatToken::Literal, symbol));
+        return;
+    }
+
+    // Condition, such as [>=100]
+    if (letter == QLatin1Char('<') || letter == QLatin1Char('>') || letter == QLatin1Char('=')) {
+        int length = 1;
+        if (content.length() > 1
+            && (content.at(1) == QLatin1Char('=') || content.at(1) == QLatin1Char('>')))
+            length = 2;
+        const QString op = content.left(length);
+        if (op == QLatin1String("<"))
+            section.condition = NumFormatSection::Less;
+        else if (op == QLatin1String("<="))
+            section.condition = NumFormatSection::LessEqual;
+        else if (op == QLatin1String(">"))
+            section.condition = NumFormatSection::Greater;
+        else if (op == QLatin1String(">="))
+            section.condition = NumFormatSection::GreaterEqual;
+        else if (op == QLatin1String("<>"))
+            section.condition = NumFormatSection::NotEqual;
+        else
+            section.condition = NumFormatSection::Equal;
+        section.conditionValue = content.mid(length).toDouble();
+    }
+
+    // Colors and the other ones do not change the text
+}
+
+/*
+  Splits \a part, one section of a format code, into its tokens.
+ */
+static NumFormatSection tokenize(const QString &part)
+{
+    NumFormatSection section;
+    QVector<NumFormatToken> &tokens = section.tokens;
+
+    for (int i = 0; i < part.length(); ++i) {
+        const QChar c = part.at(i);
+        const QChar lower = c.toLower();
+
+        if (c == QLatin1Char('"')) {
+            const int end = part.indexOf(QLatin1Char('"'), i + 1);
+            const int last = end == -1 ? part.length() : end;
+            tokens.append(NumFormatToken(NumFormatToken::Literal, part.mid(i + 1, last - i - 1)));
+            i = last;
+        } else if (c == QLatin1Char('\\')) {
+            if (i + 1 < part.length())
+                tokens.append(NumFormatToken(NumFormatToken::Literal, part.at(++i)));
+        } else if (c == QLatin1Char('_')) {
+            // the width of the next character
+            ++i;
+            tokens.append(NumFormatToken(NumFormatToken::Literal, QStringLiteral(" ")));
+        } else if (c == QLatin1Char('*')) {
+            // the next character fills the cell, which does not apply to texts
+            ++i;
+        } else if (c == QLatin1Char('[')) {
+            const int end = part.indexOf(QLatin1Char(']'), i + 1);
+            const int last = end == -1 ? part.length() : end;
+            parseBracket(part.mid(i + 1, last - i - 1), section);
+            i = last;
+        } else if (lower == QLatin1Char('g')
+                   && part.midRef(i, 7).compare(QLatin1String("General"), Qt::CaseInsensitive)
+                       == 0) {
+            tokens.append(NumFormatToken(NumFormatToken::General));
+            i += 6;
+        } else if (isDigitPlaceholder(c)) {
+            tokens.append(NumFormatToken(NumFormatToken::IntegerDigit, c));
+        } else if (c >= QLatin1Char('1') && c <= QLatin1Char('9') && !tokens.isEmpty()
+                   && tokens.last().type == NumFormatToken::FractionSlash) {
+            int end = i;
+            while (end < part.length() && part.at(end).isDigit())
+                ++end;
+            section.denominator = part.mid(i, end - i).toInt();
+            i = end - 1;
+        } else if (c == QLatin1Char('.')) {
+            tokens.append(NumFormatToken(NumFormatToken::DecimalPoint, c));
+        } else if (c == QLatin1Char(',')) {
+            // thousands separator or scaling, resolved once all tokens are known
+            tokens.append(NumFormatToken(NumFormatToken::Literal, c, 0));
+        } else if (c == QLatin1Char('%')) {
+            tokens.append(NumFormatToken(NumFormatToken::Literal, c));
+            ++section.percents;
+        } else if (c == QLatin1Char('@')) {
+            tokens.append(NumFormatToken(NumFormatToken::TextPlaceholder));
+        } else if (lower == QLatin1Char('e') && i + 1 < part.length()
+                   && (part.at(i + 1) == QLatin1Char('+') || part.at(i + 1) == QLatin1Char('-'))) {
+            tokens.append(NumFormatToken(NumFormatToken::Exponent, part.mid(i, 2)));
+            ++i;
+        } else if (c == QLatin1Char('/') && !tokens.isEmpty()
+                   && tokens.last().type == NumFormatToken::IntegerDigit) {
+            tokens.append(NumFormatToken(NumFormatToken::FractionSlash, c));
+        } else if (lower == QLatin1Char('a')
+                   && part.midRef(i, 5).compare(QLatin1String("AM/PM"), Qt::CaseInsensitive)
+                       == 0) {
+            tokens.append(NumFormatToken(NumFormatToken::AmPm, part.mid(i, 5)));
+            section.twelveHours = true;
+            i += 4;
+        } else if (lower == QLatin1Char('a')
+                   && part.midRef(i, 3).compare(QLatin1String("A/P"), Qt::CaseInsensitive) == 0) {
+            tokens.append(NumFormatToken(NumFormatToken::AmPm, part.mid(i, 3)));
+            section.twelveHours = true;
+            i += 2;
+        } else if (lower == QLatin1Char('y') || lower == QLatin1Char('m') || lower == QLatin1Char('d')
+                   || lower == QLatin1Char('h') || lower == QLatin1Char('s')) {
+            int count = 1;
+            while (i + 1 < part.length() && part.at(i + 1).toLower() == lower) {
+                ++count;
+                ++i;
+            }
+            NumFormatToken::Type type = NumFormatToken::Second;
+            if (lower == QLatin1Char('y'))
+                type = NumFormatToken::Year;
+            else if (lower == QLatin1Char('m'))
+                type = NumFormatToken::Month;
+            else if (lower == QLatin1Char('d'))
+                type = NumFormatToken::Day;
+            else if (lower == QLatin1Char('h'))
+                type = NumFormatToken::Hour;
+            tokens.append(NumFormatToken(type, QString(), count));
+        } else {
+            tokens.append(NumFormatToken(NumFormatToken::Literal, c));
+        }
+    }
+    return section;
+}
+
+/*
+  Tells the minutes from the months, the fractions of seconds from the
+  digits, of a date and time section.
+ */
+static void resolveDateTime(NumFormatSection &section)
+{
+    QVector<NumFormatToken> &tokens = section.tokens;
+    for (int i = 0; i < tokens.size(); ++i) {
+        NumFormatToken &token = tokens[i];
+        if (token.type == NumFormatToken::Month && token.count <= 2) {
+            // minutes after hours or before seconds
+            int previous = i - 1;
+            while (previous >= 0 && !isDateTimeToken(tokens[previous].type))
+                --previous;
+            int next = i + 1;
+            while (next < tokens.size() && !isDateTimeToken(tokens[next].type))
+                ++next;
+            if ((previous >= 0
+                 && (tokens[previous].type == NumFormatToken::Hour
+                     || tokens[previous].type == NumFormatToken::ElapsedHours))
+                || (next < tokens.size()
+                    && (tokens[next].type == NumFormatToken::Second
+                        || tokens[next].type == NumFormatToken::ElapsedSeconds))) {
+                token.type = NumFormatToken::Minute;
+            }
+        } else if (token.type == NumFormatToken::DecimalPoint && i > 0
+                   && (tokens[i - 1].type == NumFormatToken::Second
+                       || tokens[i - 1].type == NumFormatToken::ElapsedSeconds)) {
+            int zeros = 0;
+            while (i + 1 < tokens.size() && tokens[i + 1].type == NumFormatToken::IntegerDigit
+                   && tokens[i + 1].text == QLatin1String("0")) {
+                tokens.remove(i + 1);
+                ++zeros;
+            }
+            if (zeros) {
+                token.type = NumFormatToken::SubSecond;
+                token.count = zeros;
+                section.subSecondDigits = qMax(section.subSecondDigits, zeros);
+            }
+        }
+    }
+
+    // The other placeholders are shown as they are
+    for (int i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].type == NumFormatToken::IntegerDigit
+            || tokens[i].type == NumFormatToken::DecimalPoint
+            || tokens[i].type == NumFormatToken::FractionSlash
+            || tokens[i].type == NumFormatToken::Exponent) {
+            tokens[i].type = NumFormatToken::Literal;
+        }
+        tokens[i].count = qMax(tokens[i].count, 1);
+    }
+}
+
+/*
+  Assigns the digit placeholders of a number section to the parts of the
+  number, and resolves its commas.
+ */
+static void resolveNumber(NumFormatSection &section)
+{
+    QVector<NumFormatToken> &tokens = section.tokens;
+
+    int slash = -1;
+    for (int i = 0; i < tokens.size() && slash == -1; ++i) {
+        if (tokens[i].type == NumFormatToken::FractionSlash)
+            slash = i;
+    }
+
+    if (slash != -1) {
+        for (int i = slash + 1; i < tokens.size(); ++i) {
+            if (tokens[i].type == NumFormatToken::IntegerDigit)
+                tokens[i].type = NumFormatToken::DenominatorDigit;
+        }
+        for (int i = slash - 1; i >= 0 && tokens[i].type == NumFormatToken::IntegerDigit; --i)
+            tokens[i].type = NumFormatToken::NumeratorDigit;
+    } else {
+        bool afterPoint = false;
+        bool afterExponent = false;
+        for (int i = 0; i < tokens.size(); ++i) {
+            NumFormatToken &token = tokens[i];
+            if (token.type == NumFormatToken::DecimalPoint) {
+                if (afterPoint || afterExponent)
+                    token.type = NumFormatToken::Literal;
+                afterPoint = true;
+            } else if (token.type == NumFormatToken::Exponent) {
+                afterExponent = true;
+            } else if (token.type == NumFormatToken::IntegerDigit) {
+                if (afterExponent)
+                    token.type = NumFormatToken::ExponentDigit;
+                else if (afterPoint)
+                    token.type = NumFormatToken::FractionDigit;
+            }
+        }
+    }
+
+    // A comma between integer digits groups the thousands, one after the
+    // last digit divides by 1000.
+    for (int i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].type != NumFormatToken::Literal || tokens[i].count != 0)
+            continue;
+        bool digitBefore = false;
+        bool integerBefore = false;
+        for (int j = 0; j < i; ++j) {
+            digitBefore = digitBefore || isPlaceholderToken(tokens[j].type);
+            integerBefore = integerBefore || tokens[j].type == NumFormatToken::IntegerDigit;
+        }
+        bool digitAfter = false;
+        for (int j = i + 1; j < tokens.size() && !digitAfter; ++j)
+            digitAfter = isPlaceholderToken(tokens[j].type);
+
+        if (integerBefore && i + 1 < tokens.size()
+            && tokens[i + 1].type == NumFormatToken::IntegerDigit) {
+            section.grouping = true;
+            tokens.remove(i--);
+        } else if (digitBefore && !digitAfter) {
+            ++section.scalingCommas;
+            tokens.remove(i--);
+        } else {
+            tokens[i].count = 1;
+        }
+    }
+
+    foreach (const NumFormatToken &token, tokens) {
+        if (token.type == NumFormatToken::IntegerDigit)
+            section.integerPlaceholders.append(token.text);
+        else if (token.type == NumFormatToken::FractionDigit)
+            section.fractionPlaceholders.append(token.text);
+        else if (token.type == NumFormatToken::ExponentDigit)
+            section.exponentPlaceholders.append(token.text);
+        else if (token.type == NumFormatToken::NumeratorDigit)
+            section.numeratorPlaceholders.append(token.text);
+        else if (token.type == NumFormatToken::DenominatorDigit)
+            section.denominatorPlaceholders.append(token.text);
+    }
+}
+
+/*!
+  \internal
+  Compiles \a formatCode, the General format when empty.
+ */
+NumFormatRenderer::NumFormatRenderer(const QString &formatCode)
+    : m_formatCode(formatCode.isEmpty() ? QStringLiteral("General") : formatCode)
+    , m_textSection(-1)
+    , m_conditional(false)
+{
+    compile(m_formatCode);
+}
+
+QString NumFormatRenderer::formatCode() const
+{
+    return m_formatCode;
+}
+
+void NumFormatRenderer::compile(const QString &formatCode)
+{
+    // Split the sections on the semicolons which are not quoted
+    QStringList parts;
+    int start = 0;
+    for (int i = 0; i < formatCode.length(); ++i) {
+        const QChar c = formatCode.at(i);
+        if (c == QLatin1Char('"')) {
+            while (i + 1 < formatCode.length() && formatCode.at(++i) != QLatin1Char('"'))
+                ;
+        } else if (c == QLatin1Char('\\') || c == QLatin1Char('_') || c == QLatin1Char('*')) {
+            ++i;
+        } else if (c == QLatin1Char('[')) {
+            while (i + 1 < formatCode.length() && formatCode.at(++i) != QLatin1Char(']'))
+                ;
+        } else if (c == QLatin1Char(';')) {
+            parts.append(formatCode.mid(start, i - start));
+            start = i + 1;
+        }
+    }
+    parts.append(formatCode.mid(start));
+
+    for (int i = 0; i < parts.size() && i < 4; ++i) {
+        NumFormatSection section = tokenize(parts[i]);
+
+        bool hasDateTime = false;
+        bool hasText = false;
+        foreach (const NumFormatToken &token, section.tokens) {
+            hasDateTime = hasDateTime || isDateTimeToken(token.type);
+            hasText = hasText || token.type == NumFormatToken::TextPlaceholder;
+        }
+        if (hasText || i == 3) {
+            section.kind = NumFormatParser::Text;
+            if (m_textSection == -1)
+                m_textSection = i;
+        } else if (hasDateTime) {
+            section.kind = NumFormatParser::kind(parts[i]);
+            resolveDateTime(section);
+        } else {
+            resolveNumber(section);
+        }
+        m_sections.append(section);
+    }
+
+    // The sections of the numbers are selected on every render
+    for (int i = 0; i < m_sections.size(); ++i) {
+        if (i != m_textSection) {
+            m_numberSections.append(i);
+            m_conditional = m_conditional
+                || m_sections[i].condition != NumFormatSection::NoCondition;
+        }
+    }
+}
+
+/*
+  Returns the section showing \a value, or 0 if none does, and whether the
+  minus sign of negative values is shown.
+ */
+const NumFormatSection *NumFormatRenderer::numberSection(double value, bool *showSign) const
+{
+    const int count = m_numberSections.size();
+    if (count == 0)
+        return 0;
+
+    *showSign = value < 0;
+    if (m_conditional) {
+        for (int i = 0; i < count; ++i) {
+            const NumFormatSection &section = m_sections.at(m_numberSections.at(i));
+            if (section.condition != NumFormatSection::NoCondition && section.matches(value))
+                return &section;
+        }
+        for (int i = 0; i < count; ++i) {
+            const NumFormatSection &section = m_sections.at(m_numberSections.at(i));
+            if (section.condition == NumFormatSection::NoCondition)
+                return &section;
+        }
+        return 0;
+    }
+
+    if (count == 1 || value > 0 || (count == 2 && value == 0))
+        return &m_sections.at(m_numberSections.at(0));
+    *showSign = false;
+    if (value < 0)
+        return &m_sections.at(m_numberSections.at(1));
+    return &m_sections.at(m_numberSections.at(2));
+}
+
+/*!
+  \internal
+  Returns \a value as shown by the format, the dates of the workbook being
+  based on 1904 when \a is1904.
+ */
+QString NumFormatRenderer::render(double value, bool is1904) const
+{
+    QString text;
+    render(value, text, is1904);
+    return text;
+}
+
+/*!
+  \internal
+  Appends \a value as shown by the format to \a text.
+ */
+void NumFormatRenderer::render(double value, QString &text, bool is1904) const
+{
+    bool showSign = false;
+    const NumFormatSection *section = numberSection(value, &showSign);
+    if (!section)
+        appendGeneral(text, value);
+    else if (NumFormatParser::isDateTimeKind(section->kind))
+        renderDateTime(*section, value, is1904, text);
+    else
+        renderNumber(*section, value, showSign, text);
+}
+
+/*!
+  \internal
+  Appends the \a count \a values as shown by the format to \a texts.
+ */
+void NumFormatRenderer::render(const double *values, int count, QStringList &texts,
+                               bool is1904) const
+{
+    texts.reserve(texts.size() + count);
+    for (int i = 0; i < count; ++i) {
+        QString text;
+        render(values[i], text, is1904);
+        texts.append(text);
+    }
+}
+
+/*!
+  \internal
+  Returns \a text as shown by the text section of the format.
+ */
+QString NumFormatRenderer::renderText(const QString &text) const
+{
+    if (m_textSection == -1)
+        return text;
+
+    QString result;
+    foreach (const NumFormatToken &token, m_sections[m_textSection].tokens) {
+        if (token.type == NumFormatToken::TextPlaceholder)
+            result.append(text);
+        else if (token.type == NumFormatToken::Literal)
+            result.append(token.text);
+    }
+    return result;
+}
+
+void NumFormatRenderer::renderNumber(const NumFormatSection &section, double value,
+                                     bool showSign, QString &text) const
+{
+    double number = fabs(value);
+    for (int i = 0; i < section.percents; ++i)
+        number *= 100;
+    for (int i = 0; i < section.scalingCommas; ++i)
+        number /= 1000;
+
+    const int fractionDigits = section.fractionPlaceholders.length();
+    const bool isFraction = !section.numeratorPlaceholders.isEmpty();
+    const bool isScientific = !section.exponentPlaceholders.isEmpty();
+
+    QString integerPart;
+    QString fractionPart;
+    QString numerator;
+    QString denominator;
+    int exponent = 0;
+    bool blankFraction = false;
+
+    if (isFraction) {
+        double whole = 0;
+        double fraction = number;
+        if (!section.integerPlaceholders.isEmpty()) {
+            whole = floor(number);
+            fraction = number - whole;
+        }
+        qint64 num = 0;
+        qint64 den = section.denominator;
+        if (den > 0) {
+            num = qint64(roundHalfUp(fraction * den));
+        } else {
+            // The best approximation with the digits of the denominator
+            const qint64 maxDenominator =
+                qint64(pow(10.0, qMin(section.denominatorPlaceholders.length(), 4))) - 1;
+            double bestError = 2;
+            for (qint64 d = 1; d <= maxDenominator && bestError > 0; ++d) {
+                const qint64 n = qint64(floor(fraction * d + 0.5));
+                const double error = fabs(fraction - double(n) / d);
+                if (error < bestError) {
+                    bestError = error;
+                    num = n;
+                    den = d;
+                }
+            }
+        }
+        if (!section.integerPlaceholders.isEmpty() && num == den) {
+            whole += 1;
+            num = 0;
+        }
+        blankFraction = num == 0 && !section.integerPlaceholders.isEmpty();
+        if (whole > 0 || blankFraction)
+            integerPart = fixedNumber(whole, 0);
+        numerator = QString::number(num);
+        denominator = QString::number(den);
+    } else {
+        double mantissa = number;
+        if (isScientific && number != 0) {
+            const int integerDigits = qMax(1, section.integerPlaceholders.length());
+            const bool engineering =
+                integerDigits > 1 && section.integerPlaceholders.contains(QLatin1Char('#'));
+            const int step = engineering ? integerDigits : 1;
+            exponent = int(floor(log10(number)));
+            if (engineering)
+                exponent = int(floor(double(exponent) / step)) * step;
+            else
+                exponent -= integerDigits - 1;
+            mantissa = number / pow(10.0, exponent);
+            // Rounding may carry over one more integer digit
+            const QString digits = fixedNumber(mantissa, fractionDigits);
+            const int point = digits.indexOf(QLatin1Char('.'));
+            if ((point == -1 ? digits.length() : point) > (engineering ? step : integerDigits)) {
+                exponent += step;
+                mantissa = number / pow(10.0, exponent);
+            }
+        }
+        const QString digits = fixedNumber(mantissa, fractionDigits);
+        const int point = digits.indexOf(QLatin1Char('.'));
+        integerPart = point == -1 ? digits : digits.left(point);
+        if (point != -1)
+            fractionPart = digits.mid(point + 1);
+        if (integerPart == QLatin1String("0"))
+            integerPart.clear();
+    }
+
+    // The integer digits, with the thousands separators
+    QString groupedInteger;
+    if (section.grouping) {
+        QString padded;
+        for (int i = 0; i < section.integerPlaceholders.length(); ++i)
+            appendAligned(padded, integerPart, section.integerPlaceholders, i);
+        int digits = 0;
+        for (int i = padded.length() - 1; i >= 0; --i) {
+            const bool isDigit = padded.at(i).isDigit();
+            if (isDigit && digits > 0 && digits % 3 == 0)
+                groupedInteger.prepend(QLatin1Char(','));
+            groupedInteger.prepend(padded.at(i));
+            if (isDigit)
+                ++digits;
+        }
+    }
+
+    // The trailing zeros of the decimals are not shown by # and ?
+    int shownFraction = fractionPart.length();
+    while (shownFraction > 0 && fractionPart.at(shownFraction - 1) == QLatin1Char('0')
+           && section.fractionPlaceholders.at(shownFraction - 1) != QLatin1Char('0')) {
+        --shownFraction;
+    }
+
+    if (showSign)
+        text.append(QLatin1Char('-'));
+
+    const QString exponentDigits = QString::number(exponent < 0 ? -exponent : exponent);
+    int integerIndex = 0;
+    int fractionIndex = 0;
+    int exponentIndex = 0;
+    int numeratorIndex = 0;
+    int denominatorIndex = 0;
+    foreach (const NumFormatToken &token, section.tokens) {
+        switch (token.type) {
+        case NumFormatToken::Literal:
+            text.append(token.text);
+            break;
+        case NumFormatToken::General:
+            appendGeneral(text, number);
+            break;
+        case NumFormatToken::IntegerDigit:
+            if (!section.grouping)
+                appendAligned(text, integerPart, section.integerPlaceholders, integerIndex);
+            else if (integerIndex == 0)
+                text.append(groupedInteger);
+            ++integerIndex;
+            break;
+        case NumFormatToken::DecimalPoint:
+            if (section.integerPlaceholders.isEmpty())
+                text.append(integerPart);
+            text.append(QLatin1Char('.'));
+            break;
+        case NumFormatToken::FractionDigit:
+            if (fractionIndex < shownFraction)
+                text.append(fractionPart.at(fractionIndex));
+            else if (token.text == QLatin1String("?"))
+                text.append(QLatin1Char(' '));
+            ++fractionIndex;
+            break;
+        case NumFormatToken::Exponent:
+            text.append(token.text.at(0));
+            if (exponent < 0)
+                text.append(QLatin1Char('-'));
+            else if (token.text.at(1) == QLatin1Char('+'))
+                text.append(QLatin1Char('+'));
+            break;
+        case NumFormatToken::ExponentDigit:
+            appendAligned(text, exponentDigits, section.exponentPlaceholders, exponentIndex++);
+            break;
+        case NumFormatToken::NumeratorDigit:
+            if (blankFraction)
+                text.append(QLatin1Char(' '));
+            else
+                appendAligned(text, numerator, section.numeratorPlaceholders, numeratorIndex);
+            ++numeratorIndex;
+            break;
+        case NumFormatToken::FractionSlash:
+            text.append(blankFraction ? QLatin1Char(' ') : QLatin1Char('/'));
+            if (section.denominator > 0)
+                text.append(blankFraction ? QString(denominator.length(), QLatin1Char(' '))
+                                          : denominator);
+            break;
+        case NumFormatToken::DenominatorDigit: {
+            // Aligned on the left
+            const int count = section.denominatorPlaceholders.length();
+            if (blankFraction) {
+                text.append(QLatin1Char(' '));
+            } else if (denominatorIndex < denominator.length()) {
+                if (denominatorIndex == count - 1)
+                    text.append(denominator.midRef(denominatorIndex));
+                else
+                    text.append(denominator.at(denominatorIndex));
+            } else if (token.text != QLatin1String("#")) {
+                text.append(token.text == QLatin1String("0") ? QLatin1Char('0')
+                                                             : QLatin1Char(' '));
+            }
+            ++denominatorIndex;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+void NumFormatRenderer::renderDateTime(const NumFormatSection &section, double value,
+                                       bool is1904, QString &text) const
+{
+    // Excel shows hashes for the negative dates, the number is more useful
+    if (value < 0) {
+        appendGeneral(text, value);
+        return;
+    }
+
+    // Rounded to the fractions of seconds shown
+    static const qint64 unitsPerSecond[] = { 1, 10, 100, 1000 };
+    const int subSecondDigits = qMin(section.subSecondDigits, 3);
+    const qint64 units = unitsPerSecond[subSecondDigits];
+    const qint64 total = qint64(roundHalfUp(value * 86400.0 * units)) * (1000 / units);
+    const qint64 serialDays = total / MSecsPerDay;
+    const qint64 msecs = total % MSecsPerDay;
+
+    int year, month, day;
+    if (!is1904 && serialDays == 0) {
+        year = 1900;
+        month = 1;
+        day = 0;
+    } else if (!is1904 && serialDays == 60) {
+        // Excel erroneously treats 1900 as a leap year
+        year = 1900;
+        month = 2;
+        day = 29;
+    } else {
+        qint64 ignored;
+        civilFromDays(daysFromNumber(double(serialDays), &ignored, is1904), &year, &month, &day);
+    }
+    const int weekday = int((serialDays + (is1904 ? 5 : 6)) % 7); // 0 is Sunday
+    const int hour = int(msecs / 3600000);
+    const int minute = int(msecs / 60000 % 60);
+    const int second = int(msecs / 1000 % 60);
+
+    foreach (const NumFormatToken &token, section.tokens) {
+        switch (token.type) {
+        case NumFormatToken::Literal:
+            text.append(token.text);
+            break;
+        case NumFormatToken::Year:
+            if (token.count <= 2)
+                appendNumber(text, year % 100, 2);
+            else
+                appendNumber(text, year, 4);
+            break;
+        case NumFormatToken::Month:
+            if (token.count <= 2)
+                appendNumber(text, month, token.count);
+            else if (token.count == 3)
+                text.append(QLatin1String(monthNames[month - 1], 3));
+            else if (token.count == 5)
+                text.append(QLatin1Char(monthNames[month - 1][0]));
+            else
+                text.append(QLatin1String(monthNames[month - 1]));
+            break;
+        case NumFormatToken::Day:
+            if (token.count <= 2)
+                appendNumber(text, day, token.count);
+            else if (token.count == 3)
+                text.append(QLatin1String(dayNames[weekday], 3));
+            else
+                text.append(QLatin1String(dayNames[weekday]));
+            break;
+        case NumFormatToken::Hour:
+            if (section.twelveHours)
+                appendNumber(text, hour % 12 == 0 ? 12 : hour % 12, qMin(token.count, 2));
+            else
+                appendNumber(text, hour, qMin(token.count, 2));
+            break;
+        case NumFormatToken::Minute:
+            appendNumber(text, minute, qMin(token.count, 2));
+            break;
+        case NumFormatToken::Second:
+            appendNumber(text, second, qMin(token.count, 2));
+            break;
+        case NumFormatToken::SubSecond:
+            text.append(QLatin1Char('.'));
+            appendNumber(text, msecs % 1000 / (1000 / units), subSecondDigits);
+            for (int i = subSecondDigits; i < token.count; ++i)
+                text.append(QLatin1Char('0'));
+            break;
+        case NumFormatToken::AmPm: {
+            const int slash = token.text.indexOf(QLatin1Char('/'));
+            text.append(hour < 12 ? token.text.leftRef(slash) : token.text.midRef(slash + 1));
+            break;
+        }
+        case NumFormatToken::ElapsedHours:
+            appendNumber(text, total / 3600000, token.count);
+            break;
+        case NumFormatToken::ElapsedMinutes:
+            appendNumber(text, total / 60000, token.count);
+            break;
+        case NumFormatToken::ElapsedSeconds:
+            appendNumber(text, total / 1000, token.count);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/*!
+  \internal
+  Returns the format code of the built-in number format \a numFmtId, as
+  shown in the en-US locale.
+ */
+QString NumFormatRenderer::builtinFormatCode(int numFmtId)
+{
+    switch (numFmtId) {
+    case 1:
+        return QStringLiteral("0");
+    case 2:
+        return QStringLiteral("0.00");
+    case 3:
+        return QStringLiteral("#,##0");
+    case 4:
+        return QStringLiteral("#,##0.00");
+    case 5:
+        return QStringLiteral("$#,##0_);($#,##0)");
+    case 6:
+        return QStringLiteral("$#,##0_);[Red]($#,##0)");
+    case 7:
+        return QStringLiteral("$#,##0.00_);($#,##0.00)");
+    case 8:
+        return QStringLiteral("$#,##0.00_);[Red]($#,##0.00)");
+    case 9:
+        return QStringLiteral("0%");
+    case 10:
+        return QStringLiteral("0.00%");
+    case 11:
+        return QStringLiteral("0.00E+00");
+    case 12:
+        return QStringLiteral("# ?/?");
+    case 13:
+        return QStringLiteral("# ?\?/??"); // Note: "??/" is a c++ trigraph, so escape one "?"
+    case 14:
+        return QStringLiteral("m/d/yyyy");
+    case 15:
+        return QStringLiteral("d-mmm-yy");
+    case 16:
+        return QStringLiteral("d-mmm");
+    case 17:
+        return QStringLiteral("mmm-yy");
+    case 18:
+        return QStringLiteral("h:mm AM/PM");
+    case 19:
+        return QStringLiteral("h:mm:ss AM/PM");
+    case 20:
+        return QStringLiteral("h:mm");
+    case 21:
+        return QStringLiteral("h:mm:ss");
+    case 22:
+        return QStringLiteral("m/d/yyyy h:mm");
+    case 37:
+        return QStringLiteral("#,##0_);(#,##0)");
+    case 38:
+        return QStringLiteral("#,##0_);[Red](#,##0)");
+    case 39:
+        return QStringLiteral("#,##0.00_);(#,##0.00)");
+    case 40:
+        return QStringLiteral("#,##0.00_);[Red](#,##0.00)");
+    case 41:
+        return QStringLiteral("_(* #,##0_);_(* \\(#,##0\\);_(* \"-\"_);_(@_)");
+    case 42:
+        return QStringLiteral("_(\"$\"* #,##0_);_(\"$\"* \\(#,##0\\);_(\"$\"* \"-\"_);_(@_)");
+    case 43:
+        return QStringLiteral("_(* #,##0.00_);_(* \\(#,##0.00\\);_(* \"-\"?\?_);_(@_)");
+    case 44:
+        return QStringLiteral(
+            "_(\"$\"* #,##0.00_);_(\"$\"* \\(#,##0.00\\);_(\"$\"* \"-\"?\?_);_(@_)");
+    case 45:
+        return QStringLiteral("mm:ss");
+    case 46:
+        return QStringLiteral("[h]:mm:ss");
+    case 47:
+        return QStringLiteral("mmss.0");
+    case 48:
+        return QStringLiteral("##0.0E+0");
+    case 49:
+        return QStringLiteral("@");
+    default:
+        // Used in CHS\CHT\JPN\KOR, shown as dates
+        if ((numFmtId >= 27 && numFmtId <= 36) || (numFmtId >= 50 && numFmtId <= 58))
+            return QStringLiteral("yyyy/m/d");
+        return QStringLiteral("General");
+    }
+}
+
+QT_END_NAMESPACE_XLSX
@@ -0,0 +1,146 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef XLSXNUMFORMATRENDERER_P_H
+#define XLSXNUMFORMATRENDERER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+#include "xlsxnumformatparser_p.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+struct NumFormatToken
+{
+    enum Type {
+        Literal,
+        General,
+        TextPlaceholder, // @
+        IntegerDigit, // 0 # ? before the decimal point
+        DecimalPoint,
+        FractionDigit, // 0 # ? after the decimal point
+        Exponent, // E+ E- e+ e-
+        ExponentDigit,
+        NumeratorDigit,
+        FractionSlash,
+        DenominatorDigit,
+        Year,
+        Month,
+        Day,
+        Hour,
+        Minute,
+        Second,
+        SubSecond, // .0 .00 .000 after seconds
+        AmPm,
+        ElapsedHours,
+        ElapsedMinutes,
+        ElapsedSeconds
+    };
+
+    NumFormatToken(Type type = Literal, const QString &text = QString(), int count = 1)
+        : type(type)
+        , text(text)
+        , count(count)
+    {
+    }
+
+    Type type;
+    QString text; // of literals, the placeholder of digits, the AM/PM markers
+    int count; // of repeated date and time letters
+};
+
+struct NumFormatSection
+{
+    NumFormatSection();
+
+    QVector<NumFormatToken> tokens;
+    NumFormatParser::NumberKind kind;
+
+    // Condition, such as [>=100], which selects the section
+    enum Condition { NoCondition, Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual };
+    Condition condition;
+    double conditionValue;
+
+    // Layout of the numbers, the placeholders being 0 # or ?
+    QString integerPlaceholders;
+    QString fractionPlaceholders;
+    QString exponentPlaceholders;
+    QString numeratorPlaceholders;
+    QString denominatorPlaceholders;
+    int denominator; // fixed one, such as the 4 of "# ?/4", or 0
+    int percents;
+    int scalingCommas; // each one divides by 1000
+    int subSecondDigits;
+    bool grouping; // of the thousands
+    bool twelveHours;
+
+    bool matches(double value) const;
+};
+
+class XLSX_AUTOTEST_EXPORT NumFormatRenderer
+{
+public:
+    explicit NumFormatRenderer(const QString &formatCode = QString());
+
+    QString formatCode() const;
+
+    QString render(double value, bool is1904 = false) const;
+    void render(double value, QString &text, bool is1904 = false) const;
+    void render(const double *values, int count, QStringList &texts, bool is1904 = false) const;
+    QString renderText(const QString &text) const;
+
+    static QString builtinFormatCode(int numFmtId);
+
+private:
+    void compile(const QString &formatCode);
+    const NumFormatSection *numberSection(double value, bool *showSign) const;
+    void renderNumber(const NumFormatSection &section, double value, bool showSign,
+                      QString &text) const;
+    void renderDateTime(const NumFormatSection &section, double value, bool is1904,
+                        QString &text) const;
+
+    QString m_formatCode;
+    QVector<NumFormatSection> m_sections;
+    int m_textSection; // index of the section of the strings, or -1
+    QVector<int> m_numberSections; // indexes of the other sections
+    bool m_conditional; // whether one of them has a condition
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // XLSXNUMFORMATRENDERER_P_H
@@ -84,6 +84,11 @@ void Relationships::addWorksheetRelationship(const QString &relativeType, const
     addRelationship(schema_doc + relativeType, target, targetMode);
 }
 
+QList<XlsxRelationship> Relationships::allRelationships() const
+{
+    return m_relationships;
+}
+
 QList<XlsxRelationship> Relationships::relationships(const QString &type) const
 {
     QList<XlsxRelationship> res;
@@ -66,6 +66,9 @@ public:
     void addMsPackageRelationship(const QString &relativeType, const QString &target);
     void addWorksheetRelationship(const QString &relativeType, const QString &target,
                                   const QString &targetMode = QString());
+    QList<XlsxRelationship> allRelationships() const;
+    void addRelationship(const QString &type, const QString &target,
+                         const QString &targetMode = QString());
 
     void saveToXmlFile(QIODevice *device) const;
     QByteArray saveToXmlData() const;
@@ -79,8 +82,6 @@ public:
 
 private:
     QList<XlsxRelationship> relationships(const QString &type) const;
-    void addRelationship(const QString &type, const QString &target,
-                         const QString &targetMode = QString());
 
     QList<XlsxRelationship> m_relationships;
 };
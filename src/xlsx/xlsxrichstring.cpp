@@ -26,6 +26,7 @@
 #include "xlsxrichstring_p.h"
 #include "xlsxformat_p.h"
 #include <QDebug>
+#include <QMutexLocker>
 #include <QTextDocument>
 #include <QTextFragment>
 
@@ -41,7 +42,7 @@ RichStringPrivate::RichStringPrivate(const RichStringPrivate &other)
     , fragmentTexts(other.fragmentTexts)
     , fragmentFormats(other.fragmentFormats)
     , _idKey(other.idKey())
-    , _dirty(other._dirty)
+    , _dirty(false)
 {
 }
 
@@ -223,6 +224,7 @@ Format RichString::fragmentFormat(int index) const
  */
 QByteArray RichStringPrivate::idKey() const
 {
+    QMutexLocker locker(&keyMutex);
     if (_dirty) {
         RichStringPrivate *rs = const_cast<RichStringPrivate *>(this);
         QByteArray bytes;
@@ -37,6 +37,7 @@
 //
 
 #include "xlsxrichstring.h"
+#include <QMutex>
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -51,6 +52,7 @@ public:
 
     QStringList fragmentTexts;
     QList<Format> fragmentFormats;
+    mutable QMutex keyMutex; // guards the lazy _idKey of a shared string
     QByteArray _idKey;
     bool _dirty;
 };
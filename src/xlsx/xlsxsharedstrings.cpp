@@ -27,6 +27,8 @@
 #include "xlsxutility_p.h"
 #include "xlsxformat_p.h"
 #include "xlsxcolor_p.h"
+#include "xlsxtrace_p.h"
+#include "xlsxzipreader_p.h"
 #include <QXmlStreamWriter>
 #include <QXmlStreamReader>
 #include <QDir>
@@ -48,6 +50,17 @@ SharedStrings::SharedStrings(CreateFlag flag)
     : AbstractOOXmlFile(flag)
 {
     m_stringCount = 0;
+    m_richTextLoadEnabled = true;
+}
+
+SharedStrings::SharedStrings(const SharedStrings &other)
+    : AbstractOOXmlFile(F_NewFromScratch)
+    , m_stringTable(other.m_stringTable)
+    , m_stringList(other.m_stringList)
+    , m_stringCount(other.m_stringCount)
+    , m_richTextLoadEnabled(other.m_richTextLoadEnabled)
+{
+    setCachedEntry(other.cachedEntry());
 }
 
 int SharedStrings::count() const
@@ -55,6 +68,11 @@ int SharedStrings::count() const
     return m_stringCount;
 }
 
+int SharedStrings::uniqueCount() const
+{
+    return m_stringList.size();
+}
+
 bool SharedStrings::isEmpty() const
 {
     return m_stringList.isEmpty();
@@ -75,9 +93,11 @@ int SharedStrings::addSharedString(const RichString &string)
         return item.index;
     }
 
+    // Only new strings modify the part, the count attribute is informative
     int index = m_stringList.size();
     m_stringTable[string] = XlsxSharedStringInfo(index);
     m_stringList.append(string);
+    setModified();
     return index;
 }
 
@@ -118,6 +138,7 @@ void SharedStrings::removeSharedString(const RichString &string)
 
         m_stringList.removeAt(item.index);
         m_stringTable.remove(string);
+        setModified();
     }
 }
 
@@ -133,6 +154,28 @@ int SharedStrings::getSharedStringIndex(const RichString &string) const
     return -1;
 }
 
+/*
+  Returns whether the plain \a string is the one at \a index, which is
+  cheaper than looking the index of the string up.
+ */
+bool SharedStrings::isSharedString(int index, const QString &string) const
+{
+    if (index < 0 || index >= m_stringList.size())
+        return false;
+    const RichString &item = m_stringList[index];
+    return !item.isRichString() && item.toPlainString() == string;
+}
+
+/*
+  Returns whether the rich \a string is the one at \a index.
+ */
+bool SharedStrings::isSharedString(int index, const RichString &string) const
+{
+    if (index < 0 || index >= m_stringList.size())
+        return false;
+    return m_stringList[index] == string;
+}
+
 RichString SharedStrings::getSharedString(int index) const
 {
     if (index < m_stringList.count() && index >= 0)
@@ -212,6 +255,7 @@ void SharedStrings::writeRichStringPart_rPr(QXmlStreamWriter &writer, const Form
 
 void SharedStrings::saveToXmlFile(QIODevice *device) const
 {
+    XLSX_TRACE_SPAN("SharedStrings::saveToXmlFile");
     QXmlStreamWriter writer(device);
 
     if (m_stringList.size() != m_stringTable.size()) {
@@ -267,18 +311,25 @@ void SharedStrings::readString(QXmlStreamReader &reader)
     Q_ASSERT(reader.name() == QLatin1String("si"));
 
     RichString richString;
+    QString text; // of all the runs, when the rich text is not loaded
 
     while (!reader.atEnd()
            && !(reader.name() == QLatin1String("si")
                 && reader.tokenType() == QXmlStreamReader::EndElement)) {
         reader.readNextStartElement();
         if (reader.tokenType() == QXmlStreamReader::StartElement) {
-            if (reader.name() == QLatin1String("r"))
+            if (!m_richTextLoadEnabled) {
+                if (reader.name() == QLatin1String("t"))
+                    text += reader.readElementText();
+            } else if (reader.name() == QLatin1String("r")) {
                 readRichStringPart(reader, richString);
-            else if (reader.name() == QLatin1String("t"))
+            } else if (reader.name() == QLatin1String("t")) {
                 readPlainStringPart(reader, richString);
+            }
         }
     }
+    if (!m_richTextLoadEnabled)
+        richString.addFragment(text, Format());
 
     int idx = m_stringList.size();
     m_stringTable[richString] = XlsxSharedStringInfo(idx, 0);
@@ -381,8 +432,18 @@ Format SharedStrings::readRichStringPart_rPr(QXmlStreamReader &reader)
     return format;
 }
 
+/*
+  When disabled, the strings are loaded as plain text, the runs of rich
+  strings being joined without their fonts.
+ */
+void SharedStrings::setRichTextLoadEnabled(bool enable)
+{
+    m_richTextLoadEnabled = enable;
+}
+
 bool SharedStrings::loadFromXmlFile(QIODevice *device)
 {
+    XLSX_TRACE_SPAN("SharedStrings::loadFromXmlFile");
     QXmlStreamReader reader(device);
     int count = 0;
     bool hasUniqueCountAttr = true;
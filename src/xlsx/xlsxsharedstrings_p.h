@@ -66,7 +66,9 @@ class XLSX_AUTOTEST_EXPORT SharedStrings : public AbstractOOXmlFile
 {
 public:
     SharedStrings(CreateFlag flag);
+    SharedStrings(const SharedStrings &other);
     int count() const;
+    int uniqueCount() const;
     bool isEmpty() const;
 
     int addSharedString(const QString &string);
@@ -78,10 +80,13 @@ public:
     int getSharedStringIndex(const QString &string) const;
     int getSharedStringIndex(const RichString &string) const;
     RichString getSharedString(int index) const;
+    bool isSharedString(int index, const QString &string) const;
+    bool isSharedString(int index, const RichString &string) const;
     QList<RichString> getSharedStrings() const;
 
     void saveToXmlFile(QIODevice *device) const;
     bool loadFromXmlFile(QIODevice *device);
+    void setRichTextLoadEnabled(bool enable);
 
 private:
     void readString(QXmlStreamReader &reader); // <si>
@@ -93,6 +98,7 @@ private:
     QHash<RichString, XlsxSharedStringInfo> m_stringTable; // for fast lookup
     QList<RichString> m_stringList;
     int m_stringCount;
+    bool m_richTextLoadEnabled;
 };
 }
 #endif // XLSXSHAREDSTRINGS_H
@@ -25,7 +25,10 @@
 #include "xlsxstyles_p.h"
 #include "xlsxformat_p.h"
 #include "xlsxutility_p.h"
+#include "xlsxnumformatrenderer_p.h"
 #include "xlsxcolor_p.h"
+#include "xlsxtrace_p.h"
+#include "xlsxzipreader_p.h"
 #include <QXmlStreamWriter>
 #include <QXmlStreamReader>
 #include <QFile>
@@ -36,6 +39,110 @@
 
 namespace QXlsx {
 
+/*
+  Lookup tables between the enums of Format and their names in styles.xml.
+  They are built once, so that several documents can be loaded or saved
+  concurrently.
+*/
+struct StyleStrings
+{
+    StyleStrings();
+
+    QMap<int, QString> fillPatternStrings;
+    QMap<int, QString> borderStyleStrings;
+    QMap<QString, Format::FillPattern> fillPatternValues;
+    QMap<QString, Format::BorderStyle> borderStyleValues;
+    QMap<QString, Format::HorizontalAlignment> horizontalAlignmentValues;
+    QMap<QString, Format::VerticalAlignment> verticalAlignmentValues;
+};
+
+StyleStrings::StyleStrings()
+{
+    fillPatternStrings[Format::PatternNone] = QStringLiteral("none");
+    fillPatternStrings[Format::PatternSolid] = QStringLiteral("solid");
+    fillPatternStrings[Format::PatternMediumGray] = QStringLiteral("mediumGray");
+    fillPatternStrings[Format::PatternDarkGray] = QStringLiteral("darkGray");
+    fillPatternStrings[Format::PatternLightGray] = QStringLiteral("lightGray");
+    fillPatternStrings[Format::PatternDarkHorizontal] = QStringLiteral("darkHorizontal");
+    fillPatternStrings[Format::PatternDarkVertical] = QStringLiteral("darkVertical");
+    fillPatternStrings[Format::PatternDarkDown] = QStringLiteral("darkDown");
+    fillPatternStrings[Format::PatternDarkUp] = QStringLiteral("darkUp");
+    fillPatternStrings[Format::PatternDarkGrid] = QStringLiteral("darkGrid");
+    fillPatternStrings[Format::PatternDarkTrellis] = QStringLiteral("darkTrellis");
+    fillPatternStrings[Format::PatternLightHorizontal] = QStringLiteral("lightHorizontal");
+    fillPatternStrings[Format::PatternLightVertical] = QStringLiteral("lightVertical");
+    fillPatternStrings[Format::PatternLightDown] = QStringLiteral("lightDown");
+    fillPatternStrings[Format::PatternLightUp] = QStringLiteral("lightUp");
+    fillPatternStrings[Format::PatternLightTrellis] = QStringLiteral("lightTrellis");
+    fillPatternStrings[Format::PatternGray125] = QStringLiteral("gray125");
+    fillPatternStrings[Format::PatternGray0625] = QStringLiteral("gray0625");
+    fillPatternStrings[Format::PatternLightGrid] = QStringLiteral("lightGrid");
+
+    borderStyleStrings[Format::BorderNone] = QStringLiteral("none");
+    borderStyleStrings[Format::BorderThin] = QStringLiteral("thin");
+    borderStyleStrings[Format::BorderMedium] = QStringLiteral("medium");
+    borderStyleStrings[Format::BorderDashed] = QStringLiteral("dashed");
+    borderStyleStrings[Format::BorderDotted] = QStringLiteral("dotted");
+    borderStyleStrings[Format::BorderThick] = QStringLiteral("thick");
+    borderStyleStrings[Format::BorderDouble] = QStringLiteral("double");
+    borderStyleStrings[Format::BorderHair] = QStringLiteral("hair");
+    borderStyleStrings[Format::BorderMediumDashed] = QStringLiteral("mediumDashed");
+    borderStyleStrings[Format::BorderDashDot] = QStringLiteral("dashDot");
+    borderStyleStrings[Format::BorderMediumDashDot] = QStringLiteral("mediumDashDot");
+    borderStyleStrings[Format::BorderDashDotDot] = QStringLiteral("dashDotDot");
+    borderStyleStrings[Format::BorderMediumDashDotDot] = QStringLiteral("mediumDashDotDot");
+    borderStyleStrings[Format::BorderSlantDashDot] = QStringLiteral("slantDashDot");
+
+    fillPatternValues[QStringLiteral("none")] = Format::PatternNone;
+    fillPatternValues[QStringLiteral("solid")] = Format::PatternSolid;
+    fillPatternValues[QStringLiteral("mediumGray")] = Format::PatternMediumGray;
+    fillPatternValues[QStringLiteral("darkGray")] = Format::PatternDarkGray;
+    fillPatternValues[QStringLiteral("lightGray")] = Format::PatternLightGray;
+    fillPatternValues[QStringLiteral("darkHorizontal")] = Format::PatternDarkHorizontal;
+    fillPatternValues[QStringLiteral("darkVertical")] = Format::PatternDarkVertical;
+    fillPatternValues[QStringLiteral("darkDown")] = Format::PatternDarkDown;
+    fillPatternValues[QStringLiteral("darkUp")] = Format::PatternDarkUp;
+    fillPatternValues[QStringLiteral("darkGrid")] = Format::PatternDarkGrid;
+    fillPatternValues[QStringLiteral("darkTrellis")] = Format::PatternDarkTrellis;
+    fillPatternValues[QStringLiteral("lightHorizontal")] = Format::PatternLightHorizontal;
+    fillPatternValues[QStringLiteral("lightVertical")] = Format::PatternLightVertical;
+    fillPatternValues[QStringLiteral("lightDown")] = Format::PatternLightDown;
+    fillPatternValues[QStringLiteral("lightUp")] = Format::PatternLightUp;
+    fillPatternValues[QStringLiteral("lightTrellis")] = Format::PatternLightTrellis;
+    fillPatternValues[QStringLiteral("gray125")] = Format::PatternGray125;
+    fillPatternValues[QStringLiteral("gray0625")] = Format::PatternGray0625;
+    fillPatternValues[QStringLiteral("lightGrid")] = Format::PatternLightGrid;
+
+    borderStyleValues[QStringLiteral("none")] = Format::BorderNone;
+    borderStyleValues[QStringLiteral("thin")] = Format::BorderThin;
+    borderStyleValues[QStringLiteral("medium")] = Format::BorderMedium;
+    borderStyleValues[QStringLiteral("dashed")] = Format::BorderDashed;
+    borderStyleValues[QStringLiteral("dotted")] = Format::BorderDotted;
+    borderStyleValues[QStringLiteral("thick")] = Format::BorderThick;
+    borderStyleValues[QStringLiteral("double")] = Format::BorderDouble;
+    borderStyleValues[QStringLiteral("hair")] = Format::BorderHair;
+    borderStyleValues[QStringLiteral("mediumDashed")] = Format::BorderMediumDashed;
+    borderStyleValues[QStringLiteral("dashDot")] = Format::BorderDashDot;
+    borderStyleValues[QStringLiteral("mediumDashDot")] = Format::BorderMediumDashDot;
+    borderStyleValues[QStringLiteral("dashDotDot")] = Format::BorderDashDotDot;
+    borderStyleValues[QStringLiteral("mediumDashDotDot")] = Format::BorderMediumDashDotDot;
+    borderStyleValues[QStringLiteral("slantDashDot")] = Format::BorderSlantDashDot;
+
+    horizontalAlignmentValues.insert(QStringLiteral("left"), Format::AlignLeft);
+    horizontalAlignmentValues.insert(QStringLiteral("center"), Format::AlignHCenter);
+    horizontalAlignmentValues.insert(QStringLiteral("right"), Format::AlignRight);
+    horizontalAlignmentValues.insert(QStringLiteral("justify"), Format::AlignHJustify);
+    horizontalAlignmentValues.insert(QStringLiteral("centerContinuous"), Format::AlignHMerge);
+    horizontalAlignmentValues.insert(QStringLiteral("distributed"), Format::AlignHDistributed);
+
+    verticalAlignmentValues.insert(QStringLiteral("top"), Format::AlignTop);
+    verticalAlignmentValues.insert(QStringLiteral("center"), Format::AlignVCenter);
+    verticalAlignmentValues.insert(QStringLiteral("justify"), Format::AlignVJustify);
+    verticalAlignmentValues.insert(QStringLiteral("distributed"), Format::AlignVDistributed);
+}
+
+Q_GLOBAL_STATIC(StyleStrings, styleStrings)
+
 /*
   When loading from existing .xlsx file. we should create a clean styles object.
   otherwise, default formats should be added.
@@ -45,6 +152,7 @@ Styles::Styles(CreateFlag flag)
     : AbstractOOXmlFile(flag)
     , m_nextCustomNumFmtId(176)
     , m_isIndexedColorsDefault(true)
+    , m_defaultRenderer(new NumFormatRenderer)
     , m_emptyFormatAdded(false)
 {
     //! Fix me. Should the custom num fmt Id starts with 164 or 176 or others??
@@ -71,10 +179,73 @@ Styles::Styles(CreateFlag flag)
     }
 }
 
+/*
+  Copies the formats of \a other. The containers are implicitly shared, so
+  this is cheap until one of the copies adds a format.
+ */
+Styles::Styles(const Styles &other)
+    : AbstractOOXmlFile(F_NewFromScratch)
+    , m_builtinNumFmtsHash(other.m_builtinNumFmtsHash)
+    , m_customNumFmtIdMap(other.m_customNumFmtIdMap)
+    , m_customNumFmtsHash(other.m_customNumFmtsHash)
+    , m_nextCustomNumFmtId(other.m_nextCustomNumFmtId)
+    , m_fontsList(other.m_fontsList)
+    , m_fillsList(other.m_fillsList)
+    , m_bordersList(other.m_bordersList)
+    , m_fontsHash(other.m_fontsHash)
+    , m_fillsHash(other.m_fillsHash)
+    , m_bordersHash(other.m_bordersHash)
+    , m_indexedColors(other.m_indexedColors)
+    , m_isIndexedColorsDefault(other.m_isIndexedColorsDefault)
+    , m_xf_formatsList(other.m_xf_formatsList)
+    , m_xf_formatsHash(other.m_xf_formatsHash)
+    , m_xf_numberKindsList(other.m_xf_numberKindsList)
+    , m_numFmtKindsHash(other.m_numFmtKindsHash)
+    , m_xf_renderersList(other.m_xf_renderersList)
+    , m_numFmtRenderersHash(other.m_numFmtRenderersHash)
+    , m_defaultRenderer(other.m_defaultRenderer)
+    , m_dxf_formatsList(other.m_dxf_formatsList)
+    , m_dxf_formatsHash(other.m_dxf_formatsHash)
+    , m_emptyFormatAdded(other.m_emptyFormatAdded)
+{
+    setCachedEntry(other.cachedEntry());
+}
+
 Styles::~Styles()
 {
 }
 
+static void detachAll(QList<Format> &list)
+{
+    for (int i = 0; i < list.size(); ++i)
+        list[i].detach();
+}
+
+static void detachAll(QHash<QByteArray, Format> &hash)
+{
+    for (QHash<QByteArray, Format>::iterator it = hash.begin(); it != hash.end(); ++it)
+        it.value().detach();
+}
+
+/*
+  Gives every format of these styles its own data, which the styles they
+  were copied from no longer share. Used by the snapshots saved in another
+  thread, as the copied styles keep updating the indexes of their formats.
+ */
+void Styles::detachFormats()
+{
+    detachAll(m_fontsList);
+    detachAll(m_fillsList);
+    detachAll(m_bordersList);
+    detachAll(m_fontsHash);
+    detachAll(m_fillsHash);
+    detachAll(m_bordersHash);
+    detachAll(m_xf_formatsList);
+    detachAll(m_xf_formatsHash);
+    detachAll(m_dxf_formatsList);
+    detachAll(m_dxf_formatsHash);
+}
+
 Format Styles::xfFormat(int idx) const
 {
     if (idx < 0 || idx >= m_xf_formatsList.size())
@@ -83,6 +254,75 @@ Format Styles::xfFormat(int idx) const
     return m_xf_formatsList[idx];
 }
 
+/*
+  Returns the kind of the number format of the xf \a idx, classified once
+  when the xf was added.
+ */
+NumFormatParser::NumberKind Styles::xfNumberKind(int idx) const
+{
+    if (idx < 0 || idx >= m_xf_numberKindsList.size())
+        return NumFormatParser::Numeric;
+
+    return m_xf_numberKindsList[idx];
+}
+
+/*
+  Returns the kind of the number format of \a format, looked up by its xf
+  index when it has been added to these styles.
+ */
+NumFormatParser::NumberKind Styles::xfNumberKind(const Format &format) const
+{
+    if (format.xfIndexValid() && format.xfIndex() < m_xf_numberKindsList.size())
+        return m_xf_numberKindsList[format.xfIndex()];
+
+    if (format.hasProperty(FormatPrivate::P_NumFmt_FormatCode))
+        return NumFormatParser::kind(format.numberFormat());
+    if (format.hasProperty(FormatPrivate::P_NumFmt_Id))
+        return NumFormatParser::builtinKind(format.numberFormatIndex());
+    return NumFormatParser::Numeric;
+}
+
+/*
+  Returns the number format of the xf \a idx, compiled once when the xf was
+  added.
+ */
+QSharedPointer<const NumFormatRenderer> Styles::xfRenderer(int idx) const
+{
+    if (idx < 0 || idx >= m_xf_renderersList.size())
+        return m_defaultRenderer;
+
+    return m_xf_renderersList[idx];
+}
+
+/*
+  Returns the number format of \a format, looked up by its xf index when it
+  has been added to these styles, else by its numFmt id. Only the custom
+  format codes which were never added are compiled here.
+ */
+QSharedPointer<const NumFormatRenderer> Styles::xfRenderer(const Format &format) const
+{
+    if (format.xfIndexValid() && format.xfIndex() < m_xf_renderersList.size())
+        return m_xf_renderersList[format.xfIndex()];
+
+    if (format.hasProperty(FormatPrivate::P_NumFmt_Id)) {
+        QHash<int, QSharedPointer<const NumFormatRenderer>>::const_iterator it =
+            m_numFmtRenderersHash.constFind(format.numberFormatIndex());
+        // The id of a custom format code may be the one of another workbook
+        if (it != m_numFmtRenderersHash.constEnd()
+            && (!format.hasProperty(FormatPrivate::P_NumFmt_FormatCode)
+                || it.value()->formatCode() == format.numberFormat()))
+            return it.value();
+    }
+    if (format.hasProperty(FormatPrivate::P_NumFmt_FormatCode))
+        return QSharedPointer<const NumFormatRenderer>(
+            new NumFormatRenderer(format.numberFormat()));
+    const int id = format.numberFormatIndex();
+    if (id == 0)
+        return m_defaultRenderer;
+    return QSharedPointer<const NumFormatRenderer>(
+        new NumFormatRenderer(NumFormatRenderer::builtinFormatCode(id)));
+}
+
 Format Styles::dxfFormat(int idx) const
 {
     if (idx < 0 || idx >= m_dxf_formatsList.size())
@@ -200,6 +440,13 @@ void Styles::fixNumFmt(const Format &format)
 */
 void Styles::addXfFormat(const Format &format, bool force)
 {
+    // Most formats are known already, which leaves the styles unmodified
+    const int numFmtCount = m_customNumFmtIdMap.size();
+    const int fontCount = m_fontsList.size();
+    const int fillCount = m_fillsList.size();
+    const int borderCount = m_bordersList.size();
+    const int xfCount = m_xf_formatsList.size();
+
     if (format.isEmpty()) {
         // Try do something for empty Format.
         if (m_emptyFormatAdded && !force)
@@ -265,11 +512,72 @@ void Styles::addXfFormat(const Format &format, bool force)
     if (!m_xf_formatsHash.contains(format.formatKey()) || force) {
         m_xf_formatsList.append(format);
         m_xf_formatsHash[format.formatKey()] = format;
+        m_xf_numberKindsList.append(numberKind(format));
+        m_xf_renderersList.append(numberRenderer(format));
+    }
+
+    if (numFmtCount != m_customNumFmtIdMap.size() || fontCount != m_fontsList.size()
+        || fillCount != m_fillsList.size() || borderCount != m_bordersList.size()
+        || xfCount != m_xf_formatsList.size()) {
+        setModified();
+    }
+}
+
+/*
+  Returns the kind of the number format of \a format, classified once per
+  numFmt id.
+ */
+NumFormatParser::NumberKind Styles::numberKind(const Format &format)
+{
+    if (!format.hasProperty(FormatPrivate::P_NumFmt_Id)) {
+        if (format.hasProperty(FormatPrivate::P_NumFmt_FormatCode))
+            return NumFormatParser::kind(format.numberFormat());
+        return NumFormatParser::Numeric;
+    }
+
+    const int id = format.numberFormatIndex();
+    QHash<int, NumFormatParser::NumberKind>::const_iterator it = m_numFmtKindsHash.constFind(id);
+    if (it != m_numFmtKindsHash.constEnd())
+        return it.value();
+
+    NumFormatParser::NumberKind kind;
+    if (format.hasProperty(FormatPrivate::P_NumFmt_FormatCode))
+        kind = NumFormatParser::kind(format.numberFormat());
+    else
+        kind = NumFormatParser::builtinKind(id);
+    m_numFmtKindsHash.insert(id, kind);
+    return kind;
+}
+
+/*
+  Returns the number format of \a format, compiled once per numFmt id.
+ */
+QSharedPointer<const NumFormatRenderer> Styles::numberRenderer(const Format &format)
+{
+    if (!format.hasProperty(FormatPrivate::P_NumFmt_Id)) {
+        return QSharedPointer<const NumFormatRenderer>(
+            new NumFormatRenderer(format.numberFormat()));
     }
+
+    const int id = format.numberFormatIndex();
+    QHash<int, QSharedPointer<const NumFormatRenderer>>::const_iterator it =
+        m_numFmtRenderersHash.constFind(id);
+    if (it != m_numFmtRenderersHash.constEnd())
+        return it.value();
+
+    const QString formatCode = format.hasProperty(FormatPrivate::P_NumFmt_FormatCode)
+        ? format.numberFormat()
+        : NumFormatRenderer::builtinFormatCode(id);
+    QSharedPointer<const NumFormatRenderer> renderer(new NumFormatRenderer(formatCode));
+    m_numFmtRenderersHash.insert(id, renderer);
+    return renderer;
 }
 
 void Styles::addDxfFormat(const Format &format, bool force)
 {
+    const int numFmtCount = m_customNumFmtIdMap.size();
+    const int dxfCount = m_dxf_formatsList.size();
+
     // numFmt
     if (format.hasNumFmtData())
         fixNumFmt(format);
@@ -285,10 +593,14 @@ void Styles::addDxfFormat(const Format &format, bool force)
         m_dxf_formatsList.append(format);
         m_dxf_formatsHash[format.formatKey()] = format;
     }
+
+    if (numFmtCount != m_customNumFmtIdMap.size() || dxfCount != m_dxf_formatsList.size())
+        setModified();
 }
 
 void Styles::saveToXmlFile(QIODevice *device) const
 {
+    XLSX_TRACE_SPAN("Styles::saveToXmlFile");
     QXmlStreamWriter writer(device);
 
     writer.writeStartDocument(QStringLiteral("1.0"), true);
@@ -465,28 +777,7 @@ void Styles::writeFills(QXmlStreamWriter &writer) const
 
 void Styles::writeFill(QXmlStreamWriter &writer, const Format &fill, bool isDxf) const
 {
-    static QMap<int, QString> patternStrings;
-    if (patternStrings.isEmpty()) {
-        patternStrings[Format::PatternNone] = QStringLiteral("none");
-        patternStrings[Format::PatternSolid] = QStringLiteral("solid");
-        patternStrings[Format::PatternMediumGray] = QStringLiteral("mediumGray");
-        patternStrings[Format::PatternDarkGray] = QStringLiteral("darkGray");
-        patternStrings[Format::PatternLightGray] = QStringLiteral("lightGray");
-        patternStrings[Format::PatternDarkHorizontal] = QStringLiteral("darkHorizontal");
-        patternStrings[Format::PatternDarkVertical] = QStringLiteral("darkVertical");
-        patternStrings[Format::PatternDarkDown] = QStringLiteral("darkDown");
-        patternStrings[Format::PatternDarkUp] = QStringLiteral("darkUp");
-        patternStrings[Format::PatternDarkGrid] = QStringLiteral("darkGrid");
-        patternStrings[Format::PatternDarkTrellis] = QStringLiteral("darkTrellis");
-        patternStrings[Format::PatternLightHorizontal] = QStringLiteral("lightHorizontal");
-        patternStrings[Format::PatternLightVertical] = QStringLiteral("lightVertical");
-        patternStrings[Format::PatternLightDown] = QStringLiteral("lightDown");
-        patternStrings[Format::PatternLightUp] = QStringLiteral("lightUp");
-        patternStrings[Format::PatternLightTrellis] = QStringLiteral("lightTrellis");
-        patternStrings[Format::PatternGray125] = QStringLiteral("gray125");
-        patternStrings[Format::PatternGray0625] = QStringLiteral("gray0625");
-        patternStrings[Format::PatternLightGrid] = QStringLiteral("lightGrid");
-    }
+    const QMap<int, QString> &patternStrings = styleStrings()->fillPatternStrings;
 
     writer.writeStartElement(QStringLiteral("fill"));
     writer.writeStartElement(QStringLiteral("patternFill"));
@@ -575,23 +866,7 @@ void Styles::writeSubBorder(QXmlStreamWriter &writer, const QString &type, int s
         return;
     }
 
-    static QMap<int, QString> stylesString;
-    if (stylesString.isEmpty()) {
-        stylesString[Format::BorderNone] = QStringLiteral("none");
-        stylesString[Format::BorderThin] = QStringLiteral("thin");
-        stylesString[Format::BorderMedium] = QStringLiteral("medium");
-        stylesString[Format::BorderDashed] = QStringLiteral("dashed");
-        stylesString[Format::BorderDotted] = QStringLiteral("dotted");
-        stylesString[Format::BorderThick] = QStringLiteral("thick");
-        stylesString[Format::BorderDouble] = QStringLiteral("double");
-        stylesString[Format::BorderHair] = QStringLiteral("hair");
-        stylesString[Format::BorderMediumDashed] = QStringLiteral("mediumDashed");
-        stylesString[Format::BorderDashDot] = QStringLiteral("dashDot");
-        stylesString[Format::BorderMediumDashDot] = QStringLiteral("mediumDashDot");
-        stylesString[Format::BorderDashDotDot] = QStringLiteral("dashDotDot");
-        stylesString[Format::BorderMediumDashDotDot] = QStringLiteral("mediumDashDotDot");
-        stylesString[Format::BorderSlantDashDot] = QStringLiteral("slantDashDot");
-    }
+    const QMap<int, QString> &stylesString = styleStrings()->borderStyleStrings;
 
     writer.writeStartElement(type);
     writer.writeAttribute(QStringLiteral("style"), stylesString[style]);
@@ -904,28 +1179,7 @@ bool Styles::readFill(QXmlStreamReader &reader, Format &fill)
 {
     Q_ASSERT(reader.name() == QLatin1String("fill"));
 
-    static QMap<QString, Format::FillPattern> patternValues;
-    if (patternValues.isEmpty()) {
-        patternValues[QStringLiteral("none")] = Format::PatternNone;
-        patternValues[QStringLiteral("solid")] = Format::PatternSolid;
-        patternValues[QStringLiteral("mediumGray")] = Format::PatternMediumGray;
-        patternValues[QStringLiteral("darkGray")] = Format::PatternDarkGray;
-        patternValues[QStringLiteral("lightGray")] = Format::PatternLightGray;
-        patternValues[QStringLiteral("darkHorizontal")] = Format::PatternDarkHorizontal;
-        patternValues[QStringLiteral("darkVertical")] = Format::PatternDarkVertical;
-        patternValues[QStringLiteral("darkDown")] = Format::PatternDarkDown;
-        patternValues[QStringLiteral("darkUp")] = Format::PatternDarkUp;
-        patternValues[QStringLiteral("darkGrid")] = Format::PatternDarkGrid;
-        patternValues[QStringLiteral("darkTrellis")] = Format::PatternDarkTrellis;
-        patternValues[QStringLiteral("lightHorizontal")] = Format::PatternLightHorizontal;
-        patternValues[QStringLiteral("lightVertical")] = Format::PatternLightVertical;
-        patternValues[QStringLiteral("lightDown")] = Format::PatternLightDown;
-        patternValues[QStringLiteral("lightUp")] = Format::PatternLightUp;
-        patternValues[QStringLiteral("lightTrellis")] = Format::PatternLightTrellis;
-        patternValues[QStringLiteral("gray125")] = Format::PatternGray125;
-        patternValues[QStringLiteral("gray0625")] = Format::PatternGray0625;
-        patternValues[QStringLiteral("lightGrid")] = Format::PatternLightGrid;
-    }
+    const QMap<QString, Format::FillPattern> &patternValues = styleStrings()->fillPatternValues;
 
     while (!reader.atEnd()
            && !(reader.tokenType() == QXmlStreamReader::EndElement
@@ -1065,23 +1319,8 @@ bool Styles::readSubBorder(QXmlStreamReader &reader, const QString &name,
 {
     Q_ASSERT(reader.name() == name);
 
-    static QMap<QString, Format::BorderStyle> stylesStringsMap;
-    if (stylesStringsMap.isEmpty()) {
-        stylesStringsMap[QStringLiteral("none")] = Format::BorderNone;
-        stylesStringsMap[QStringLiteral("thin")] = Format::BorderThin;
-        stylesStringsMap[QStringLiteral("medium")] = Format::BorderMedium;
-        stylesStringsMap[QStringLiteral("dashed")] = Format::BorderDashed;
-        stylesStringsMap[QStringLiteral("dotted")] = Format::BorderDotted;
-        stylesStringsMap[QStringLiteral("thick")] = Format::BorderThick;
-        stylesStringsMap[QStringLiteral("double")] = Format::BorderDouble;
-        stylesStringsMap[QStringLiteral("hair")] = Format::BorderHair;
-        stylesStringsMap[QStringLiteral("mediumDashed")] = Format::BorderMediumDashed;
-        stylesStringsMap[QStringLiteral("dashDot")] = Format::BorderDashDot;
-        stylesStringsMap[QStringLiteral("mediumDashDot")] = Format::BorderMediumDashDot;
-        stylesStringsMap[QStringLiteral("dashDotDot")] = Format::BorderDashDotDot;
-        stylesStringsMap[QStringLiteral("mediumDashDotDot")] = Format::BorderMediumDashDotDot;
-        stylesStringsMap[QStringLiteral("slantDashDot")] = Format::BorderSlantDashDot;
-    }
+    const QMap<QString, Format::BorderStyle> &stylesStringsMap =
+        styleStrings()->borderStyleValues;
 
     QXmlStreamAttributes attributes = reader.attributes();
     if (attributes.hasAttribute(QLatin1String("style"))) {
@@ -1199,35 +1438,16 @@ bool Styles::readCellXfs(QXmlStreamReader &reader)
                         QXmlStreamAttributes alignAttrs = reader.attributes();
 
                         if (alignAttrs.hasAttribute(QLatin1String("horizontal"))) {
-                            static QMap<QString, Format::HorizontalAlignment> alignStringMap;
-                            if (alignStringMap.isEmpty()) {
-                                alignStringMap.insert(QStringLiteral("left"), Format::AlignLeft);
-                                alignStringMap.insert(QStringLiteral("center"),
-                                                      Format::AlignHCenter);
-                                alignStringMap.insert(QStringLiteral("right"), Format::AlignRight);
-                                alignStringMap.insert(QStringLiteral("justify"),
-                                                      Format::AlignHJustify);
-                                alignStringMap.insert(QStringLiteral("centerContinuous"),
-                                                      Format::AlignHMerge);
-                                alignStringMap.insert(QStringLiteral("distributed"),
-                                                      Format::AlignHDistributed);
-                            }
+                            const QMap<QString, Format::HorizontalAlignment> &alignStringMap =
+                                styleStrings()->horizontalAlignmentValues;
                             QString str = alignAttrs.value(QLatin1String("horizontal")).toString();
                             if (alignStringMap.contains(str))
                                 format.setHorizontalAlignment(alignStringMap[str]);
                         }
 
                         if (alignAttrs.hasAttribute(QLatin1String("vertical"))) {
-                            static QMap<QString, Format::VerticalAlignment> alignStringMap;
-                            if (alignStringMap.isEmpty()) {
-                                alignStringMap.insert(QStringLiteral("top"), Format::AlignTop);
-                                alignStringMap.insert(QStringLiteral("center"),
-                                                      Format::AlignVCenter);
-                                alignStringMap.insert(QStringLiteral("justify"),
-                                                      Format::AlignVJustify);
-                                alignStringMap.insert(QStringLiteral("distributed"),
-                                                      Format::AlignVDistributed);
-                            }
+                            const QMap<QString, Format::VerticalAlignment> &alignStringMap =
+                                styleStrings()->verticalAlignmentValues;
                             QString str = alignAttrs.value(QLatin1String("vertical")).toString();
                             if (alignStringMap.contains(str))
                                 format.setVerticalAlignment(alignStringMap[str]);
@@ -1357,6 +1577,7 @@ bool Styles::readIndexedColors(QXmlStreamReader &reader)
 
 bool Styles::loadFromXmlFile(QIODevice *device)
 {
+    XLSX_TRACE_SPAN("Styles::loadFromXmlFile");
     QXmlStreamReader reader(device);
     while (!reader.atEnd()) {
         QXmlStreamReader::TokenType token = reader.readNext();
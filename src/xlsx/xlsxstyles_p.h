@@ -39,6 +39,7 @@
 #include "xlsxglobal.h"
 #include "xlsxformat.h"
 #include "xlsxabstractooxmlfile.h"
+#include "xlsxnumformatparser_p.h"
 #include <QSharedPointer>
 #include <QHash>
 #include <QList>
@@ -55,6 +56,7 @@ namespace QXlsx {
 
 class Format;
 class XlsxColor;
+class NumFormatRenderer;
 
 struct XlsxFormatNumberData
 {
@@ -71,11 +73,17 @@ class XLSX_AUTOTEST_EXPORT Styles : public AbstractOOXmlFile
 {
 public:
     Styles(CreateFlag flag);
+    Styles(const Styles &other);
     ~Styles();
     void addXfFormat(const Format &format, bool force = false);
     Format xfFormat(int idx) const;
+    NumFormatParser::NumberKind xfNumberKind(int idx) const;
+    NumFormatParser::NumberKind xfNumberKind(const Format &format) const;
+    QSharedPointer<const NumFormatRenderer> xfRenderer(int idx) const;
+    QSharedPointer<const NumFormatRenderer> xfRenderer(const Format &format) const;
     void addDxfFormat(const Format &format, bool force = false);
     Format dxfFormat(int idx) const;
+    void detachFormats();
 
     void saveToXmlFile(QIODevice *device) const;
     bool loadFromXmlFile(QIODevice *device);
@@ -87,6 +95,8 @@ private:
     friend class ::StylesTest;
 
     void fixNumFmt(const Format &format);
+    NumFormatParser::NumberKind numberKind(const Format &format);
+    QSharedPointer<const NumFormatRenderer> numberRenderer(const Format &format);
 
     void writeNumFmts(QXmlStreamWriter &writer) const;
     void writeFonts(QXmlStreamWriter &writer) const;
@@ -133,6 +143,14 @@ private:
 
     QList<Format> m_xf_formatsList;
     QHash<QByteArray, Format> m_xf_formatsHash;
+    // The kind of the number format of each xf, and of each numFmt id
+    QVector<NumFormatParser::NumberKind> m_xf_numberKindsList;
+    QHash<int, NumFormatParser::NumberKind> m_numFmtKindsHash;
+    // The compiled number format of each xf, and of each numFmt id
+    QVector<QSharedPointer<const NumFormatRenderer>> m_xf_renderersList;
+    QHash<int, QSharedPointer<const NumFormatRenderer>> m_numFmtRenderersHash;
+    // The General format, of the formats which have no number format
+    QSharedPointer<const NumFormatRenderer> m_defaultRenderer;
 
     QList<Format> m_dxf_formatsList;
     QHash<QByteArray, Format> m_dxf_formatsHash;
@@ -0,0 +1,132 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "xlsxtrace_p.h"
+
+#ifdef XLSX_TRACE
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+Q_GLOBAL_STATIC(TraceRecorder, traceRecorder)
+
+TraceRecorder::TraceRecorder()
+    : m_fileName(QString::fromLocal8Bit(qgetenv("QTXLSX_TRACE_FILE")))
+    , m_recording(!m_fileName.isEmpty())
+{
+    m_clock.start();
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    if (!m_fileName.isEmpty())
+        writeToFile(m_fileName);
+}
+
+/*
+    Returns the recorder of the process, or 0 once it has been destroyed at exit.
+*/
+TraceRecorder *TraceRecorder::instance()
+{
+    return traceRecorder();
+}
+
+void TraceRecorder::setRecording(bool recording)
+{
+    m_recording.storeRelease(recording);
+}
+
+void TraceRecorder::addSpan(const char *name, const QString &detail, qint64 start, qint64 end)
+{
+    const Qt::HANDLE threadId = QThread::currentThreadId();
+
+    QMutexLocker locker(&m_mutex);
+    QHash<Qt::HANDLE, int>::const_iterator it = m_threads.constFind(threadId);
+    if (it == m_threads.constEnd())
+        it = m_threads.insert(threadId, m_threads.size() + 1);
+
+    Span span;
+    span.name = name;
+    span.detail = detail;
+    span.start = start;
+    span.duration = end - start;
+    span.thread = it.value();
+    m_spans.append(span);
+}
+
+void TraceRecorder::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_spans.clear();
+}
+
+QByteArray TraceRecorder::toJson() const
+{
+    const double pid = QCoreApplication::applicationPid();
+
+    QJsonArray events;
+    QMutexLocker locker(&m_mutex);
+    foreach (const Span &span, m_spans) {
+        QJsonObject event;
+        event.insert(QStringLiteral("name"), QLatin1String(span.name));
+        event.insert(QStringLiteral("cat"), QStringLiteral("xlsx"));
+        event.insert(QStringLiteral("ph"), QStringLiteral("X"));
+        // Timestamps of the trace event format are in microseconds
+        event.insert(QStringLiteral("ts"), span.start / 1000.0);
+        event.insert(QStringLiteral("dur"), span.duration / 1000.0);
+        event.insert(QStringLiteral("pid"), pid);
+        event.insert(QStringLiteral("tid"), span.thread);
+        if (!span.detail.isEmpty()) {
+            QJsonObject args;
+            args.insert(QStringLiteral("detail"), span.detail);
+            event.insert(QStringLiteral("args"), args);
+        }
+        events.append(event);
+    }
+    locker.unlock();
+
+    QJsonObject root;
+    root.insert(QStringLiteral("traceEvents"), events);
+    root.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool TraceRecorder::writeToFile(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(toJson()) != -1;
+}
+
+QT_END_NAMESPACE_XLSX
+
+#endif // XLSX_TRACE
@@ -0,0 +1,137 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef XLSXTRACE_P_H
+#define XLSXTRACE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+
+#ifdef XLSX_TRACE
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+/*
+    Collects the spans of the library in the Chrome trace event format, which
+    chrome://tracing and the Perfetto UI can open.
+
+    Recording starts when the QTXLSX_TRACE_FILE environment variable names a
+    file, the trace is then written to it when the process exits. It can also
+    be driven by setRecording() and writeToFile().
+*/
+class XLSX_AUTOTEST_EXPORT TraceRecorder
+{
+public:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    static TraceRecorder *instance();
+
+    bool isRecording() const { return m_recording.loadAcquire(); }
+    void setRecording(bool recording);
+    qint64 elapsed() const { return m_clock.nsecsElapsed(); }
+
+    void addSpan(const char *name, const QString &detail, qint64 start, qint64 end);
+    void clear();
+
+    QByteArray toJson() const;
+    bool writeToFile(const QString &fileName) const;
+
+private:
+    struct Span
+    {
+        const char *name;
+        QString detail;
+        qint64 start;
+        qint64 duration;
+        int thread;
+    };
+
+    mutable QMutex m_mutex;
+    QVector<Span> m_spans;
+    QHash<Qt::HANDLE, int> m_threads;
+    QElapsedTimer m_clock;
+    QString m_fileName;
+    QAtomicInt m_recording;
+};
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name, const QString &detail = QString())
+        : m_recorder(TraceRecorder::instance())
+        , m_name(name)
+        , m_start(-1)
+    {
+        if (m_recorder && m_recorder->isRecording()) {
+            m_detail = detail;
+            m_start = m_recorder->elapsed();
+        }
+    }
+    ~TraceSpan()
+    {
+        if (m_start != -1)
+            m_recorder->addSpan(m_name, m_detail, m_start, m_recorder->elapsed());
+    }
+
+private:
+    Q_DISABLE_COPY(TraceSpan)
+    TraceRecorder *m_recorder;
+    const char *m_name;
+    QString m_detail;
+    qint64 m_start;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#define XLSX_TRACE_SPAN(name) QXlsx::TraceSpan xlsxTraceSpan(name)
+#define XLSX_TRACE_SPAN_DETAIL(name, detail) QXlsx::TraceSpan xlsxTraceSpan(name, detail)
+
+#else
+
+// Without XLSX_TRACE the spans, and their arguments, are compiled out
+#define XLSX_TRACE_SPAN(name)
+#define XLSX_TRACE_SPAN_DETAIL(name, detail)
+
+#endif // XLSX_TRACE
+
+#endif // XLSXTRACE_P_H
@@ -34,6 +34,9 @@
 #include <QDateTime>
 #include <QDebug>
 
+#include <limits>
+#include <math.h>
+
 namespace QXlsx {
 
 bool parseXsdBoolean(const QString &value, bool defaultValue)
@@ -67,49 +70,143 @@ QString getRelFilePath(const QString &filePath)
                    + QLatin1String(".rels"));
 }
 
-double datetimeToNumber(const QDateTime &dt, bool is1904)
-{
-    // Note, for number 0, Excel2007 shown as 1900-1-0, which should be 1899-12-31
-    QDateTime epoch(is1904 ? QDate(1904, 1, 1) : QDate(1899, 12, 31), QTime(0, 0));
+/*
+  The serial numbers of Excel are naive local times: the number of days,
+  and fraction of day, since an epoch, without any time zone or daylight
+  saving time. The conversions are done on the number of days since
+  1970-01-01 with integer arithmetic only, and a time of day in
+  milliseconds, so that they do not depend on the time zone of the host.
+ */
+static const qint64 MSecsPerDay = 24 * 60 * 60 * 1000;
+static const qint64 Epoch1900 = -25568; // 1899-12-31, as serial number 0 is 1900-01-00
+static const qint64 Epoch1904 = -24107; // 1904-01-01
+static const qint64 JulianDayOf1970 = 2440588;
 
-    double excel_time = epoch.msecsTo(dt) / (1000 * 60 * 60 * 24.0);
+/*
+  Returns the number of days since 1970-01-01 of the given date of the
+  proleptic Gregorian calendar. The \a month may be out of [1, 12].
+ */
+qint64 daysFromCivil(int year, int month, int day)
+{
+    qint64 y = year + (month > 0 ? (month - 1) / 12 : (month - 12) / 12);
+    const int m = ((month - 1) % 12 + 12) % 12 + 1;
+    y -= m <= 2;
+    const qint64 era = (y >= 0 ? y : y - 399) / 400;
+    const qint64 yearOfEra = y - era * 400;
+    const qint64 dayOfYear = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + day - 1;
+    const qint64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
 
-#if QT_VERSION >= 0x050200
-    if (dt.isDaylightTime()) // Add one hour if the date is Daylight
-        excel_time += 1.0 / 24.0;
-#endif
+/*
+  Returns the date of the proleptic Gregorian calendar which is \a days
+  after 1970-01-01.
+ */
+void civilFromDays(qint64 days, int *year, int *month, int *day)
+{
+    days += 719468;
+    const qint64 era = (days >= 0 ? days : days - 146096) / 146097;
+    const qint64 dayOfEra = days - era * 146097;
+    const qint64 yearOfEra =
+        (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const qint64 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const qint64 mp = (5 * dayOfYear + 2) / 153;
+    *day = int(dayOfYear - (153 * mp + 2) / 5 + 1);
+    *month = int(mp < 10 ? mp + 3 : mp - 9);
+    *year = int(yearOfEra + era * 400 + (*month <= 2));
+}
 
-    if (!is1904 && excel_time > 59) { // 31+28
-        // Account for Excel erroneously treating 1900 as a leap year.
-        excel_time += 1;
-    }
+/*
+  Returns the serial number of the time \a msecs after the start of the
+  day \a days after 1970-01-01.
+ */
+double daysToNumber(qint64 days, qint64 msecs, bool is1904)
+{
+    qint64 serialDays = days - (is1904 ? Epoch1904 : Epoch1900);
+    // Account for Excel erroneously treating 1900 as a leap year.
+    if (!is1904 && serialDays > 59) // 31+28
+        ++serialDays;
+    return serialDays + double(msecs) / MSecsPerDay;
+}
 
-    return excel_time;
+/*
+  Returns the number of days since 1970-01-01 of the serial number \a num,
+  and stores the time of that day in \a msecs, rounded to the millisecond.
+ */
+qint64 daysFromNumber(double num, qint64 *msecs, bool is1904)
+{
+    const qint64 total = qint64(floor(num * MSecsPerDay + 0.5));
+    qint64 serialDays = total >= 0 ? total / MSecsPerDay : (total + 1) / MSecsPerDay - 1;
+    *msecs = total - serialDays * MSecsPerDay;
+    if (!is1904 && serialDays > 60)
+        --serialDays;
+    return serialDays + (is1904 ? Epoch1904 : Epoch1900);
 }
 
-double timeToNumber(const QTime &time)
+/*
+  Converts \a count days and times of day at once, see daysToNumber().
+ */
+void daysToNumbers(const qint64 *days, const qint64 *msecs, double *nums, int count, bool is1904)
 {
-    return QTime(0, 0).msecsTo(time) / (1000 * 60 * 60 * 24.0);
+    const qint64 epoch = is1904 ? Epoch1904 : Epoch1900;
+    const qint64 leapDay = is1904 ? std::numeric_limits<qint64>::max() : 59;
+    for (int i = 0; i < count; ++i) {
+        const qint64 serialDays = days[i] - epoch;
+        nums[i] = (serialDays + (serialDays > leapDay)) + double(msecs[i]) / MSecsPerDay;
+    }
 }
 
-QDateTime datetimeFromNumber(double num, bool is1904)
+/*
+  Converts \a count serial numbers at once, see daysFromNumber().
+ */
+void daysFromNumbers(const double *nums, qint64 *days, qint64 *msecs, int count, bool is1904)
 {
-    if (!is1904 && num > 60)
-        num = num - 1;
+    for (int i = 0; i < count; ++i)
+        days[i] = daysFromNumber(nums[i], msecs + i, is1904);
+}
 
-    qint64 msecs = static_cast<qint64>(num * 1000 * 60 * 60 * 24.0 + 0.5);
-    QDateTime epoch(is1904 ? QDate(1904, 1, 1) : QDate(1899, 12, 31), QTime(0, 0));
+/*
+  Returns the days since 1970-01-01 of the date of \a dt, and stores the
+  time of that day in \a msecs. The date and time are the ones shown by \a dt
+  in local time, or in its own time spec when \a naive is true.
+ */
+qint64 datetimeToDays(const QDateTime &dt, qint64 *msecs, bool naive)
+{
+    const QDateTime local = naive || dt.timeSpec() == Qt::LocalTime ? dt : dt.toLocalTime();
+    *msecs = QTime(0, 0).msecsTo(local.time());
+    return local.date().toJulianDay() - JulianDayOf1970;
+}
 
-    QDateTime dt = epoch.addMSecs(msecs);
+/*
+  Returns the serial number of the date and time of \a dt, as shown by \a dt
+  in local time, or in its own time spec when \a naive is true.
+ */
+double datetimeToNumber(const QDateTime &dt, bool is1904, bool naive)
+{
+    if (!dt.isValid())
+        return 0;
+    // Note, for number 0, Excel2007 shown as 1900-1-0, which should be 1899-12-31
+    qint64 msecs;
+    const qint64 days = datetimeToDays(dt, &msecs, naive);
+    return daysToNumber(days, msecs, is1904);
+}
 
-#if QT_VERSION >= 0x050200
-    // Remove one hour to see whether the date is Daylight
-    QDateTime dt2 = dt.addMSecs(-3600);
-    if (dt2.isDaylightTime())
-        return dt2;
-#endif
+double timeToNumber(const QTime &time)
+{
+    return double(QTime(0, 0).msecsTo(time)) / MSecsPerDay;
+}
 
-    return dt;
+/*
+  Returns the date and time of the serial number \a num with the time \a spec,
+  Qt::UTC being the one which always holds the date and time of the number
+  as they are.
+ */
+QDateTime datetimeFromNumber(double num, bool is1904, Qt::TimeSpec spec)
+{
+    qint64 msecs;
+    const qint64 days = daysFromNumber(num, &msecs, is1904);
+    return QDateTime(QDate::fromJulianDay(days + JulianDayOf1970),
+                     QTime(0, 0).addMSecs(int(msecs)), spec);
 }
 
 /*
@@ -185,28 +282,24 @@ bool isSpaceReserveNeeded(const QString &s)
 }
 
 /*
- * Convert shared formula for non-root cells.
- *
- * For example, if "B1:B10" have shared formula "=A1*A1", this function will return "=A2*A2"
- * for "B2" cell, "=A3*A3" for "B3" cell, etc.
+ * Split the formula into plain text segments and cell reference segments.
  *
- * Note, the formula "=A1*A1" for B1 can also be written as "=RC[-1]*RC[-1]", which is the same
- * for all other cells. In other words, this formula is shared.
+ * For example, "TAN(A1+$B2)" will be split into "TAN(", "A1", "+", "$B2", ")".
+ * Texts in quotes are never treated as cell reference.
  *
  * For long run, we need a formula parser.
  */
-QString convertSharedFormula(const QString &rootFormula, const CellReference &rootCell,
-                             const CellReference &cell)
+QVector<XlsxFormulaSegment> splitFormulaReferences(const QString &formula)
 {
-    // Find all the "$?[A-Z]+$?[0-9]+" patterns in the rootFormula.
-    QList<QPair<QString, int>> segments;
+    // Find all the "$?[A-Z]+$?[0-9]+" patterns in the formula.
+    QVector<XlsxFormulaSegment> segments;
 
     QString segment;
     bool inQuote = false;
     enum RefState { INVALID, PRE_AZ, AZ, PRE_09, _09 };
     RefState refState = INVALID;
     int refFlag = 0; // 0x00, 0x01, 0x02, 0x03 ==> A1, $A1, A$1, $A$1
-    foreach (QChar ch, rootFormula) {
+    foreach (QChar ch, formula) {
         if (inQuote) {
             segment.append(ch);
             if (ch == QLatin1Char('"'))
@@ -222,7 +315,7 @@ QString convertSharedFormula(const QString &rootFormula, const CellReference &ro
                     refState = PRE_09;
                     refFlag |= 0x02;
                 } else {
-                    segments.append(qMakePair(segment, refState == _09 ? refFlag : -1));
+                    segments.append(XlsxFormulaSegment(segment, refState == _09 ? refFlag : -1));
                     segment = QString(ch); // Start new segment.
                     refState = PRE_AZ;
                     refFlag = 0x01;
@@ -231,7 +324,7 @@ QString convertSharedFormula(const QString &rootFormula, const CellReference &ro
                 if (refState == PRE_AZ || refState == AZ) {
                     segment.append(ch);
                 } else {
-                    segments.append(qMakePair(segment, refState == _09 ? refFlag : -1));
+                    segments.append(XlsxFormulaSegment(segment, refState == _09 ? refFlag : -1));
                     segment = QString(ch); // Start new segment.
                     refFlag = 0x00;
                 }
@@ -245,7 +338,7 @@ QString convertSharedFormula(const QString &rootFormula, const CellReference &ro
                     refState = INVALID;
             } else {
                 if (refState == _09) {
-                    segments.append(qMakePair(segment, refFlag));
+                    segments.append(XlsxFormulaSegment(segment, refFlag));
                     segment = QString(ch); // Start new segment.
                 } else {
                     segment.append(ch);
@@ -256,26 +349,406 @@ QString convertSharedFormula(const QString &rootFormula, const CellReference &ro
     }
 
     if (!segment.isEmpty())
-        segments.append(qMakePair(segment, refState == _09 ? refFlag : -1));
-
-    // Replace "A1", "$A1", "A$1" segment with proper one.
-    QStringList result;
-    typedef QPair<QString, int> PairType;
-    foreach (PairType p, segments) {
-        // qDebug()<<p.first<<p.second;
-        if (p.second != -1 && p.second != 3) {
-            CellReference oldRef(p.first);
-            int row = p.second & 0x02 ? oldRef.row() : oldRef.row() - rootCell.row() + cell.row();
-            int col = p.second & 0x01 ? oldRef.column()
-                                      : oldRef.column() - rootCell.column() + cell.column();
-            result.append(CellReference(row, col).toString(p.second & 0x02, p.second & 0x01));
+        segments.append(XlsxFormulaSegment(segment, refState == _09 ? refFlag : -1));
+
+    return segments;
+}
+
+/*
+ * Shift the interval [\a first, \a last] of row or column indexes
+ * for \a count indexes inserted before \a index, or deleted from
+ * \a index on when \a count is negative. An interval which is partly
+ * deleted shrinks. Returns false if it is deleted completely.
+ */
+bool shiftIndexInterval(int *first, int *last, int index, int count)
+{
+    if (count > 0) {
+        if (*first >= index)
+            *first += count;
+        if (*last >= index)
+            *last += count;
+        return true;
+    }
+
+    const int end = index - count; // first index following the deleted ones
+    const int newFirst = *first < index ? *first : (*first >= end ? *first + count : index);
+    const int newLast = *last < index ? *last : (*last >= end ? *last + count : index - 1);
+    if (newFirst > newLast)
+        return false;
+    *first = newFirst;
+    *last = newLast;
+    return true;
+}
+
+/*
+ * Returns the name of the sheet qualifying a reference which starts
+ * at \a pos in \a formula, or a null string if it isn't qualified.
+ */
+static QString referenceSheetName(const QString &formula, int pos)
+{
+    if (pos < 2 || formula[pos - 1] != QLatin1Char('!'))
+        return QString();
+
+    int start = pos - 1;
+    if (formula[start - 1] == QLatin1Char('\'')) {
+        // Quoted name, which may contain escaped quotes
+        start -= 2;
+        while (start >= 0) {
+            if (formula[start] == QLatin1Char('\'')) {
+                if (start > 0 && formula[start - 1] == QLatin1Char('\''))
+                    start -= 2;
+                else
+                    break;
+            } else {
+                --start;
+            }
+        }
+        if (start < 0)
+            return QString();
+        return unescapeSheetName(formula.mid(start, pos - 1 - start));
+    }
+
+    while (start > 0) {
+        const QChar ch = formula[start - 1];
+        if (!ch.isLetterOrNumber() && ch != QLatin1Char('_') && ch != QLatin1Char('.'))
+            break;
+        --start;
+    }
+    return formula.mid(start, pos - 1 - start);
+}
+
+/*
+ * Returns the length of the whole row reference, such as 2:$5, or whole
+ * column reference, such as $A:C, which starts at \a pos of \a formula, or
+ * 0 if there is none. Its indexes are stored in \a first and \a last, and
+ * whether they are absolute in \a absFirst and \a absLast.
+ */
+static int lineReferenceLength(const QString &formula, int pos, bool rows, int *first, int *last,
+                               bool *absFirst, bool *absLast)
+{
+    int end = pos;
+    for (int part = 0; part < 2; ++part) {
+        bool *absolute = part == 0 ? absFirst : absLast;
+        *absolute = end < formula.size() && formula[end] == QLatin1Char('$');
+        if (*absolute)
+            ++end;
+        const int start = end;
+        while (end < formula.size()
+               && (rows ? formula[end] >= QLatin1Char('0') && formula[end] <= QLatin1Char('9')
+                        : formula[end] >= QLatin1Char('A') && formula[end] <= QLatin1Char('Z')))
+            ++end;
+        if (end == start || end - start > (rows ? 7 : 3))
+            return 0;
+        const QString name = formula.mid(start, end - start);
+        const int index = rows ? name.toInt() : CellReference(name + QLatin1Char('1')).column();
+        if (index < 1 || index > (rows ? 1048576 : 16384))
+            return 0;
+        *(part == 0 ? first : last) = index;
+        if (part == 0) {
+            if (end >= formula.size() || formula[end] != QLatin1Char(':'))
+                return 0;
+            ++end;
+        }
+    }
+
+    if (end < formula.size()) {
+        const QChar next = formula[end];
+        if (next.isLetterOrNumber() || next == QLatin1Char('_') || next == QLatin1Char('.')
+            || next == QLatin1Char('(') || next == QLatin1Char('!') || next == QLatin1Char('$'))
+            return 0;
+    }
+    return end - pos;
+}
+
+/*
+ * Rewrite the whole row references, such as 2:5, of \a formula when rows
+ * are shifted, or its whole column references, such as A:C, when columns
+ * are, as shiftFormulaReferences() does for cell references.
+ */
+static QString shiftLineReferences(const QString &formula, bool rows, int index, int count,
+                                   const QString &sheetName, bool homeSheet, int *minIndex,
+                                   int *maxIndex)
+{
+    if (!formula.contains(QLatin1Char(':')))
+        return formula;
+
+    const int maxIndexOfSheet = rows ? 1048576 : 16384;
+    QString result;
+    result.reserve(formula.size() + 8);
+    bool inString = false;
+    bool inSheetName = false;
+    int pos = 0;
+    while (pos < formula.size()) {
+        const QChar ch = formula[pos];
+        if (ch == QLatin1Char('"') && !inSheetName)
+            inString = !inString;
+        else if (ch == QLatin1Char('\'') && !inString)
+            inSheetName = !inSheetName;
+
+        int from = 0;
+        int to = 0;
+        bool absFirst = false;
+        bool absLast = false;
+        int length = 0;
+        if (!inString && !inSheetName) {
+            const QChar previous = pos > 0 ? formula[pos - 1] : QChar();
+            if (!previous.isLetterOrNumber() && previous != QLatin1Char('_')
+                && previous != QLatin1Char('.') && previous != QLatin1Char('$'))
+                length = lineReferenceLength(formula, pos, rows, &from, &to, &absFirst, &absLast);
+        }
+        if (length == 0) {
+            result.append(ch);
+            ++pos;
+            continue;
+        }
+
+        const QString qualifier = referenceSheetName(formula, pos);
+        const bool matched = qualifier.isNull()
+            ? homeSheet
+            : qualifier.compare(sheetName, Qt::CaseInsensitive) == 0;
+        if (!matched) {
+            result.append(formula.midRef(pos, length));
+            pos += length;
+            continue;
+        }
+
+        if (from > to) {
+            qSwap(from, to);
+            qSwap(absFirst, absLast);
+        }
+        if (minIndex)
+            *minIndex = qMin(*minIndex, from);
+        if (maxIndex)
+            *maxIndex = qMax(*maxIndex, to);
+        if (!shiftIndexInterval(&from, &to, index, count) || from > maxIndexOfSheet) {
+            result.append(QLatin1String("#REF!"));
+        } else {
+            to = qMin(to, maxIndexOfSheet);
+            QString firstName = rows ? QString::number(from) : CellReference(1, from).toString();
+            QString lastName = rows ? QString::number(to) : CellReference(1, to).toString();
+            if (!rows) {
+                // Drop the row of the cell reference giving the column name
+                firstName.chop(1);
+                lastName.chop(1);
+            }
+            if (absFirst)
+                result.append(QLatin1Char('$'));
+            result.append(firstName);
+            result.append(QLatin1Char(':'));
+            if (absLast)
+                result.append(QLatin1Char('$'));
+            result.append(lastName);
+        }
+        pos += length;
+    }
+    return result;
+}
+
+/*
+ * Rewrite the references of \a formula after \a count rows
+ * (\a orientation is Qt::Vertical) or columns have been inserted
+ * before \a index of the sheet \a sheetName, or deleted from \a index
+ * on when \a count is negative. Unqualified references only refer to
+ * that sheet if the formula belongs to it, i.e. \a homeSheet is true.
+ *
+ * References to deleted cells become #REF!, while ranges grow or shrink
+ * like in Excel, as do whole rows such as 2:5 and whole columns such as
+ * A:C. The lowest and highest row or column index referred
+ * to on the sheet before the change is stored in \a minIndex and
+ * \a maxIndex when given.
+ */
+QString shiftFormulaReferences(const QString &formula, Qt::Orientation orientation, int index,
+                               int count, const QString &sheetName, bool homeSheet,
+                               int *minIndex, int *maxIndex)
+{
+    const QVector<XlsxFormulaSegment> segments = splitFormulaReferences(formula);
+    const bool rows = orientation == Qt::Vertical;
+
+    // Position of every segment in the formula, and whether it is
+    // inside a quoted sheet name such as 'Q1 DATA'.
+    QVector<int> positions(segments.size());
+    QVector<bool> quoted(segments.size());
+    bool inString = false;
+    bool inSheetName = false;
+    int pos = 0;
+    for (int i = 0; i < segments.size(); ++i) {
+        positions[i] = pos;
+        quoted[i] = inSheetName;
+        foreach (QChar ch, segments[i].text) {
+            if (ch == QLatin1Char('"') && !inSheetName)
+                inString = !inString;
+            else if (ch == QLatin1Char('\'') && !inString)
+                inSheetName = !inSheetName;
+        }
+        pos += segments[i].text.size();
+    }
+
+    QString result;
+    result.reserve(formula.size() + 8);
+    for (int i = 0; i < segments.size(); ++i) {
+        const XlsxFormulaSegment &segment = segments[i];
+        // Function names such as LOG10 and sheet names such as SHEET1
+        // look like references too.
+        bool isReference = segment.refFlag != -1 && !quoted[i];
+        if (isReference && i + 1 < segments.size() && !segments[i + 1].text.isEmpty()) {
+            const QChar next = segments[i + 1].text.at(0);
+            isReference = next != QLatin1Char('(') && next != QLatin1Char('!');
+        }
+        if (isReference && positions[i] > 0) {
+            const QChar previous = formula[positions[i] - 1];
+            isReference = !previous.isLetterOrNumber() && previous != QLatin1Char('_')
+                && previous != QLatin1Char('.');
+        }
+        if (!isReference) {
+            result.append(segment.text);
+            continue;
+        }
+
+        const QString qualifier = referenceSheetName(formula, positions[i]);
+        const bool matched = qualifier.isNull()
+            ? homeSheet
+            : qualifier.compare(sheetName, Qt::CaseInsensitive) == 0;
+        const bool isRange = i + 2 < segments.size() && segments[i + 1].text == QLatin1String(":")
+            && segments[i + 2].refFlag != -1;
+        const int last = isRange ? i + 2 : i;
+
+        CellReference first(segment.text);
+        CellReference second(segments[last].text);
+        if (!matched || !first.isValid() || !second.isValid()) {
+            for (; i < last; ++i)
+                result.append(segments[i].text);
+            result.append(segments[last].text);
+            continue;
+        }
+
+        int from = rows ? first.row() : first.column();
+        int to = rows ? second.row() : second.column();
+        if (minIndex)
+            *minIndex = qMin(*minIndex, qMin(from, to));
+        if (maxIndex)
+            *maxIndex = qMax(*maxIndex, qMax(from, to));
+
+        bool valid;
+        if (from <= to) {
+            valid = shiftIndexInterval(&from, &to, index, count);
+        } else {
+            valid = shiftIndexInterval(&to, &from, index, count);
+        }
+
+        if (!valid) {
+            result.append(QLatin1String("#REF!"));
+        } else {
+            const int firstFlag = segment.refFlag;
+            const int lastFlag = segments[last].refFlag;
+            if (rows) {
+                first = CellReference(from, first.column());
+                second = CellReference(to, second.column());
+            } else {
+                first = CellReference(first.row(), from);
+                second = CellReference(second.row(), to);
+            }
+            result.append(first.toString(firstFlag & 0x02, firstFlag & 0x01));
+            if (isRange) {
+                result.append(QLatin1Char(':'));
+                result.append(second.toString(lastFlag & 0x02, lastFlag & 0x01));
+            }
+        }
+        i = last;
+    }
+
+    return shiftLineReferences(result, rows, index, count, sheetName, homeSheet, minIndex,
+                               maxIndex);
+}
+
+/*
+ * Convert shared formula for non-root cells.
+ *
+ * For example, if "B1:B10" have shared formula "=A1*A1", this function will return "=A2*A2"
+ * for "B2" cell, "=A3*A3" for "B3" cell, etc.
+ *
+ * Note, the formula "=A1*A1" for B1 can also be written as "=RC[-1]*RC[-1]", which is the same
+ * for all other cells. In other words, this formula is shared.
+ *
+ * Use SharedFormulaTemplate directly when more than one cell of the group will be converted.
+ */
+QString convertSharedFormula(const QString &rootFormula, const CellReference &rootCell,
+                             const CellReference &cell)
+{
+    return SharedFormulaTemplate(rootFormula, rootCell).expand(cell);
+}
+
+/*
+ * \internal
+ *
+ * The root formula of a shared formula group, tokenized once into literal
+ * texts and relative reference slots. Formula of other cells in the group
+ * can be generated by offsetting the slots.
+ */
+SharedFormulaTemplate::SharedFormulaTemplate()
+    : m_textLength(0)
+{
+}
+
+SharedFormulaTemplate::SharedFormulaTemplate(const QString &rootFormula,
+                                             const CellReference &rootCell)
+    : m_rootCell(rootCell)
+    , m_textLength(rootFormula.length())
+{
+    const QVector<XlsxFormulaSegment> segments = splitFormulaReferences(rootFormula);
+    m_slots.reserve(segments.size());
+
+    for (int i = 0; i < segments.size(); ++i) {
+        const XlsxFormulaSegment &segment = segments[i];
+        Slot slot;
+        slot.text = segment.text;
+        slot.refFlag = -1;
+        slot.row = -1;
+        slot.column = -1;
+
+        // "$A$1" never changes, so it is stored as plain text too.
+        if (segment.refFlag != -1 && segment.refFlag != 0x03) {
+            CellReference ref(segment.text);
+            if (ref.isValid()) {
+                slot.refFlag = segment.refFlag;
+                slot.row = ref.row();
+                slot.column = ref.column();
+            }
+        }
+
+        // Merge adjacent plain texts into one slot.
+        if (slot.refFlag == -1 && !m_slots.isEmpty() && m_slots.last().refFlag == -1)
+            m_slots.last().text.append(slot.text);
+        else
+            m_slots.append(slot);
+    }
+}
+
+bool SharedFormulaTemplate::isValid() const
+{
+    return m_rootCell.isValid();
+}
+
+QString SharedFormulaTemplate::expand(const CellReference &cell) const
+{
+    const int rowOffset = cell.row() - m_rootCell.row();
+    const int colOffset = cell.column() - m_rootCell.column();
+
+    QString result;
+    result.reserve(m_textLength + 8);
+    for (int i = 0; i < m_slots.size(); ++i) {
+        const Slot &slot = m_slots[i];
+        if (slot.refFlag == -1) {
+            result.append(slot.text);
         } else {
-            result.append(p.first);
+            const bool rowAbs = slot.refFlag & 0x02;
+            const bool colAbs = slot.refFlag & 0x01;
+            const int row = rowAbs ? slot.row : slot.row + rowOffset;
+            const int col = colAbs ? slot.column : slot.column + colOffset;
+            result.append(CellReference(row, col).toString(rowAbs, colAbs));
         }
     }
 
-    // OK
-    return result.join(QString());
+    return result;
 }
 
 } // namespace QXlsx
@@ -37,23 +37,37 @@
 //
 
 #include "xlsxglobal.h"
+#include "xlsxcellreference.h"
+#include <QString>
+#include <QVector>
 class QPoint;
-class QString;
 class QStringList;
 class QColor;
 class QDateTime;
 class QTime;
 
 namespace QXlsx {
-class CellReference;
 
 XLSX_AUTOTEST_EXPORT bool parseXsdBoolean(const QString &value, bool defaultValue = false);
 
 XLSX_AUTOTEST_EXPORT QStringList splitPath(const QString &path);
 XLSX_AUTOTEST_EXPORT QString getRelFilePath(const QString &filePath);
 
-XLSX_AUTOTEST_EXPORT double datetimeToNumber(const QDateTime &dt, bool is1904 = false);
-XLSX_AUTOTEST_EXPORT QDateTime datetimeFromNumber(double num, bool is1904 = false);
+XLSX_AUTOTEST_EXPORT qint64 daysFromCivil(int year, int month, int day);
+XLSX_AUTOTEST_EXPORT void civilFromDays(qint64 days, int *year, int *month, int *day);
+XLSX_AUTOTEST_EXPORT double daysToNumber(qint64 days, qint64 msecs, bool is1904 = false);
+XLSX_AUTOTEST_EXPORT qint64 daysFromNumber(double num, qint64 *msecs, bool is1904 = false);
+
+XLSX_AUTOTEST_EXPORT void daysToNumbers(const qint64 *days, const qint64 *msecs, double *nums,
+                                        int count, bool is1904 = false);
+XLSX_AUTOTEST_EXPORT void daysFromNumbers(const double *nums, qint64 *days, qint64 *msecs,
+                                          int count, bool is1904 = false);
+
+XLSX_AUTOTEST_EXPORT qint64 datetimeToDays(const QDateTime &dt, qint64 *msecs, bool naive = false);
+XLSX_AUTOTEST_EXPORT double datetimeToNumber(const QDateTime &dt, bool is1904 = false,
+                                             bool naive = false);
+XLSX_AUTOTEST_EXPORT QDateTime datetimeFromNumber(double num, bool is1904 = false,
+                                                  Qt::TimeSpec spec = Qt::LocalTime);
 XLSX_AUTOTEST_EXPORT double timeToNumber(const QTime &t);
 
 XLSX_AUTOTEST_EXPORT QString createSafeSheetName(const QString &nameProposal);
@@ -62,9 +76,53 @@ XLSX_AUTOTEST_EXPORT QString unescapeSheetName(const QString &sheetName);
 
 XLSX_AUTOTEST_EXPORT bool isSpaceReserveNeeded(const QString &string);
 
+struct XlsxFormulaSegment
+{
+    XlsxFormulaSegment(const QString &text = QString(), int refFlag = -1)
+        : text(text)
+        , refFlag(refFlag)
+    {
+    }
+
+    QString text;
+    int refFlag; // -1 for plain text, 0x00, 0x01, 0x02, 0x03 ==> A1, $A1, A$1, $A$1
+};
+
+XLSX_AUTOTEST_EXPORT QVector<XlsxFormulaSegment> splitFormulaReferences(const QString &formula);
+
 XLSX_AUTOTEST_EXPORT QString convertSharedFormula(const QString &rootFormula,
                                                   const CellReference &rootCell,
                                                   const CellReference &cell);
 
+XLSX_AUTOTEST_EXPORT bool shiftIndexInterval(int *first, int *last, int index, int count);
+XLSX_AUTOTEST_EXPORT QString shiftFormulaReferences(const QString &formula,
+                                                    Qt::Orientation orientation, int index,
+                                                    int count, const QString &sheetName,
+                                                    bool homeSheet, int *minIndex = 0,
+                                                    int *maxIndex = 0);
+
+class XLSX_AUTOTEST_EXPORT SharedFormulaTemplate
+{
+public:
+    SharedFormulaTemplate();
+    SharedFormulaTemplate(const QString &rootFormula, const CellReference &rootCell);
+
+    bool isValid() const;
+    QString expand(const CellReference &cell) const;
+
+private:
+    struct Slot
+    {
+        QString text;
+        int refFlag; // -1 for text which is copied verbatim
+        int row;
+        int column;
+    };
+
+    QVector<Slot> m_slots;
+    CellReference m_rootCell;
+    int m_textLength;
+};
+
 } // QXlsx
 #endif // XLSXUTILITY_H
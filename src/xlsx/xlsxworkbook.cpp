@@ -30,6 +30,7 @@
 #include "xlsxstyles_p.h"
 #include "xlsxformat.h"
 #include "xlsxworksheet_p.h"
+#include "xlsxcellarena_p.h"
 #include "xlsxformat_p.h"
 #include "xlsxmediafile_p.h"
 #include "xlsxutility_p.h"
@@ -39,6 +40,7 @@
 #include <QFile>
 #include <QBuffer>
 #include <QDir>
+#include <QHash>
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -57,8 +59,11 @@ WorkbookPrivate::WorkbookPrivate(Workbook *q, Workbook::CreateFlag flag)
     strings_to_numbers_enabled = false;
     strings_to_hyperlinks_enabled = true;
     html_to_richstring_enabled = false;
+    formula_calculation_enabled = false;
     date1904 = false;
+    naive_datetime_enabled = false;
     defaultDateFormat = QStringLiteral("yyyy-mm-dd");
+    valuesOnlyLoad = false;
     activesheetIndex = 0;
     firstsheet = 0;
     table_count = 0;
@@ -99,6 +104,38 @@ void Workbook::setDate1904(bool date1904)
     d->date1904 = date1904;
 }
 
+/*!
+  Returns whether dates and times are written and read as they are held,
+  without time zone conversion.
+
+  \sa setNaiveDateTimeEnabled()
+*/
+bool Workbook::isNaiveDateTimeEnabled() const
+{
+    Q_D(const Workbook);
+    return d->naive_datetime_enabled;
+}
+
+/*!
+  Enable the date and time of a QDateTime to be written as it holds them,
+  whatever its time spec, as a cell has no time zone. Cell::dateTime() then
+  returns a QDateTime in UTC holding the date and time of the cell, which
+  exist even when skipped by a daylight saving time change of the local
+  time zone.
+
+  By default a QDateTime in UTC or with an offset from UTC is converted to
+  local time before being written, and Cell::dateTime() returns a QDateTime
+  in local time.
+
+  \note This function should be called before any date/time
+  has been written or read.
+*/
+void Workbook::setNaiveDateTimeEnabled(bool enable)
+{
+    Q_D(Workbook);
+    d->naive_datetime_enabled = enable;
+}
+
 /*
   Enable the worksheet.write() method to convert strings
   to numbers, where possible, using float() in order to avoid
@@ -142,6 +179,26 @@ bool Workbook::isHtmlToRichStringEnabled() const
     return d->html_to_richstring_enabled;
 }
 
+/*
+  Enable the built-in formula engine to recalculate the formulas
+  of all the worksheets when the workbook is saved, so that the
+  cached results are correct for applications which don't
+  calculate formulas themselves.
+
+  The default is false
+ */
+void Workbook::setFormulaCalculationEnabled(bool enable)
+{
+    Q_D(Workbook);
+    d->formula_calculation_enabled = enable;
+}
+
+bool Workbook::isFormulaCalculationEnabled() const
+{
+    Q_D(const Workbook);
+    return d->formula_calculation_enabled;
+}
+
 QString Workbook::defaultDateFormat() const
 {
     Q_D(const Workbook);
@@ -264,6 +321,9 @@ AbstractSheet *Workbook::insertSheet(int index, const QString &name, AbstractShe
 
 /*!
  * Returns current active worksheet.
+ *
+ * A sheet is added when the workbook has none yet, so for a new workbook this
+ * is not a pure read. A loaded workbook always has at least one sheet.
  */
 AbstractSheet *Workbook::activeSheet() const
 {
@@ -315,11 +375,68 @@ bool Workbook::deleteSheet(int index)
         return false;
     if (index < 0 || index >= d->sheets.size())
         return false;
-    d->sheets.removeAt(index);
+
+    // Copies of the sheet may still share its cells
+    QSharedPointer<AbstractSheet> sheet = d->sheets.takeAt(index);
     d->sheetNames.removeAt(index);
+    if (sheet->sheetType() == AbstractSheet::ST_WorkSheet
+        && WorksheetPrivate::get(static_cast<Worksheet *>(sheet.data()))->cellArena->generation()) {
+        foreach (QSharedPointer<AbstractSheet> other,
+                 getSheetsByTypes(AbstractSheet::ST_WorkSheet)) {
+            WorksheetPrivate::get(static_cast<Worksheet *>(other.data()))
+                ->reparentCells(static_cast<Worksheet *>(sheet.data()));
+        }
+    }
     return true;
 }
 
+/*
+  Returns a frozen copy of the workbook, which an asynchronous save can
+  write while this workbook is modified. The cells, the formats and the
+  shared strings are implicitly shared with this workbook, while the
+  charts are copied.
+ */
+Workbook *Workbook::snapshot() const
+{
+    Q_D(const Workbook);
+    Workbook *workbook = new Workbook(F_NewFromScratch);
+    WorkbookPrivate *workbook_d = workbook->d_func();
+
+    workbook_d->sharedStrings = QSharedPointer<SharedStrings>(new SharedStrings(*d->sharedStrings));
+    workbook_d->styles = QSharedPointer<Styles>(new Styles(*d->styles));
+    workbook_d->theme = d->theme; // never modified
+    workbook_d->externalLinks = d->externalLinks; // never modified
+    workbook_d->mediaFiles = d->mediaFiles; // never modified, and indexed by their position
+    workbook_d->sheetNames = d->sheetNames;
+    workbook_d->definedNamesList = d->definedNamesList;
+    workbook_d->passthroughRelationships = d->passthroughRelationships;
+    workbook_d->pivotCaches = d->pivotCaches;
+
+    workbook_d->strings_to_numbers_enabled = d->strings_to_numbers_enabled;
+    workbook_d->strings_to_hyperlinks_enabled = d->strings_to_hyperlinks_enabled;
+    workbook_d->html_to_richstring_enabled = d->html_to_richstring_enabled;
+    workbook_d->formula_calculation_enabled = d->formula_calculation_enabled;
+    workbook_d->date1904 = d->date1904;
+    workbook_d->naive_datetime_enabled = d->naive_datetime_enabled;
+    workbook_d->defaultDateFormat = d->defaultDateFormat;
+    workbook_d->x_window = d->x_window;
+    workbook_d->y_window = d->y_window;
+    workbook_d->window_width = d->window_width;
+    workbook_d->window_height = d->window_height;
+    workbook_d->activesheetIndex = d->activesheetIndex;
+    workbook_d->firstsheet = d->firstsheet;
+    workbook_d->table_count = d->table_count;
+    workbook_d->last_worksheet_index = d->last_worksheet_index;
+    workbook_d->last_chartsheet_index = d->last_chartsheet_index;
+    workbook_d->last_sheet_id = d->last_sheet_id;
+
+    // The charts are added to the new workbook while the drawings are copied
+    foreach (const QSharedPointer<AbstractSheet> &sheet, d->sheets)
+        workbook_d->sheets.append(QSharedPointer<AbstractSheet>(sheet->snapshot(workbook)));
+
+    return workbook;
+}
+
 /*!
  * Moves the worksheet form \a srcIndex to \a distIndex.
  */
@@ -528,6 +645,15 @@ void Workbook::saveToXmlFile(QIODevice *device) const
         writer.writeEndElement(); // externalReferences
     }
 
+    // The parts we do not model keep their targets, under new ids
+    QHash<QString, QString> passthroughIds;
+    foreach (const XlsxRelationship &relationship, d->passthroughRelationships) {
+        d->relationships->addRelationship(relationship.type, relationship.target,
+                                          relationship.targetMode);
+        passthroughIds.insert(relationship.id,
+                              QStringLiteral("rId%1").arg(d->relationships->count()));
+    }
+
     if (!d->definedNamesList.isEmpty()) {
         writer.writeStartElement(QStringLiteral("definedNames"));
         foreach (XlsxDefineNameData data, d->definedNamesList) {
@@ -554,6 +680,17 @@ void Workbook::saveToXmlFile(QIODevice *device) const
     writer.writeAttribute(QStringLiteral("calcId"), QStringLiteral("124519"));
     writer.writeEndElement(); // calcPr
 
+    if (!d->pivotCaches.isEmpty()) {
+        writer.writeStartElement(QStringLiteral("pivotCaches"));
+        for (int i = 0; i < d->pivotCaches.size(); ++i) {
+            writer.writeEmptyElement(QStringLiteral("pivotCache"));
+            writer.writeAttribute(QStringLiteral("cacheId"), d->pivotCaches[i].first);
+            writer.writeAttribute(QStringLiteral("r:id"),
+                                  passthroughIds.value(d->pivotCaches[i].second));
+        }
+        writer.writeEndElement(); // pivotCaches
+    }
+
     writer.writeEndElement(); // workbook
     writer.writeEndDocument();
 
@@ -661,9 +798,34 @@ bool Workbook::loadFromXmlFile(QIODevice *device)
                 }
                 data.formula = reader.readElementText();
                 d->definedNamesList.append(data);
+            } else if (reader.name() == QLatin1String("pivotCache")) {
+                QXmlStreamAttributes attrs = reader.attributes();
+                d->pivotCaches.append(
+                    qMakePair(attrs.value(QLatin1String("cacheId")).toString(),
+                              attrs.value(QLatin1String("r:id")).toString()));
             }
         }
     }
+
+    // Keep the relationships to the parts we do not model, such as the
+    // vbaProject or the pivot caches, with targets valid from "xl/"
+    const QString dir = splitPath(filePath())[0];
+    foreach (XlsxRelationship relationship, d->relationships->allRelationships()) {
+        const QString type = relationship.type.mid(relationship.type.lastIndexOf(QLatin1Char('/')));
+        if (type == QLatin1String("/worksheet") || type == QLatin1String("/chartsheet")
+            || type == QLatin1String("/dialogsheet") || type == QLatin1String("/xlMacrosheet")
+            || type == QLatin1String("/externalLink") || type == QLatin1String("/theme")
+            || type == QLatin1String("/styles") || type == QLatin1String("/sharedStrings")
+            || type == QLatin1String("/calcChain")) {
+            continue; // modelled, or out of date once modified
+        }
+        if (dir != QLatin1String("xl") && relationship.targetMode != QLatin1String("External")
+            && !relationship.target.startsWith(QLatin1Char('/'))) {
+            relationship.target =
+                QLatin1Char('/') + QDir::cleanPath(dir + QLatin1Char('/') + relationship.target);
+        }
+        d->passthroughRelationships.append(relationship);
+    }
     return true;
 }
 
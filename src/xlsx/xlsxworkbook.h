@@ -75,12 +75,16 @@ public:
                     const QString &scope = QString());
     bool isDate1904() const;
     void setDate1904(bool date1904);
+    bool isNaiveDateTimeEnabled() const;
+    void setNaiveDateTimeEnabled(bool enable = true);
     bool isStringsToNumbersEnabled() const;
     void setStringsToNumbersEnabled(bool enable = true);
     bool isStringsToHyperlinksEnabled() const;
     void setStringsToHyperlinksEnabled(bool enable = true);
     bool isHtmlToRichStringEnabled() const;
     void setHtmlToRichStringEnabled(bool enable = true);
+    bool isFormulaCalculationEnabled() const;
+    void setFormulaCalculationEnabled(bool enable = true);
     QString defaultDateFormat() const;
     void setDefaultDateFormat(const QString &format);
 
@@ -91,6 +95,7 @@ public:
     QList<QSharedPointer<Chart>> chartFiles() const;
 
 private:
+    friend class Cell;
     friend class Worksheet;
     friend class Chartsheet;
     friend class WorksheetPrivate;
@@ -98,6 +103,7 @@ private:
     friend class DocumentPrivate;
 
     Workbook(Workbook::CreateFlag flag);
+    Workbook *snapshot() const;
 
     void saveToXmlFile(QIODevice *device) const;
     bool loadFromXmlFile(QIODevice *device);
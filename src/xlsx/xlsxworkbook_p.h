@@ -41,10 +41,12 @@
 #include "xlsxtheme_p.h"
 #include "xlsxsimpleooxmlfile_p.h"
 #include "xlsxrelationships_p.h"
+#include "xlsxcellrange.h"
 
 #include <QSharedPointer>
 #include <QPair>
 #include <QStringList>
+#include <QSet>
 
 namespace QXlsx {
 
@@ -85,12 +87,25 @@ public:
     QList<QSharedPointer<Chart>> chartFiles;
     QList<XlsxDefineNameData> definedNamesList;
 
+    // Relationships to the parts we do not model, which are saved as loaded,
+    // and the pivot caches among them by cacheId and relationship id
+    QList<XlsxRelationship> passthroughRelationships;
+    QList<QPair<QString, QString>> pivotCaches;
+
     bool strings_to_numbers_enabled;
     bool strings_to_hyperlinks_enabled;
     bool html_to_richstring_enabled;
+    bool formula_calculation_enabled;
     bool date1904;
+    bool naive_datetime_enabled;
     QString defaultDateFormat;
 
+    // Whether the sheets being loaded only keep what their cell values need,
+    // and the cells they keep when not empty
+    bool valuesOnlyLoad;
+    CellRange loadRange;
+    QSet<int> loadColumns;
+
     int x_window;
     int y_window;
     int window_width;
@@ -27,20 +27,26 @@
 #include "xlsxworksheet.h"
 #include "xlsxworksheet_p.h"
 #include "xlsxworkbook.h"
+#include "xlsxworkbook_p.h"
 #include "xlsxformat.h"
 #include "xlsxformat_p.h"
 #include "xlsxutility_p.h"
 #include "xlsxsharedstrings_p.h"
 #include "xlsxdrawing_p.h"
 #include "xlsxstyles_p.h"
+#include "xlsxnumformatrenderer_p.h"
 #include "xlsxcell.h"
 #include "xlsxcell_p.h"
+#include "xlsxcellarena_p.h"
 #include "xlsxcellrange.h"
 #include "xlsxconditionalformatting_p.h"
+#include "xlsxdatavalidation_p.h"
 #include "xlsxdrawinganchor_p.h"
 #include "xlsxchart.h"
 #include "xlsxcellformula.h"
 #include "xlsxcellformula_p.h"
+#include "xlsxformulaengine_p.h"
+#include "xlsxtrace_p.h"
 
 #include <QVariant>
 #include <QDateTime>
@@ -54,6 +60,8 @@
 #include <QXmlStreamReader>
 #include <QTextDocument>
 #include <QDir>
+#include <QHash>
+#include <QVector>
 
 #include <math.h>
 
@@ -73,6 +81,9 @@ WorksheetPrivate::WorksheetPrivate(Worksheet *p, Worksheet::CreateFlag flag)
     , showWhiteSpace(true)
     , urlPattern(QStringLiteral("^([fh]tt?ps?://)|(mailto:)|(file://)"))
 {
+    cellArena = new CellArena;
+    frozen = false;
+    rowSpansValid = true;
     previous_row = 0;
 
     outline_row_level = 0;
@@ -84,62 +95,61 @@ WorksheetPrivate::WorksheetPrivate(Worksheet *p, Worksheet::CreateFlag flag)
 
 WorksheetPrivate::~WorksheetPrivate()
 {
+    // The cells still shared with the copies of the sheet keep the arena
+    cellArena->release();
 }
 
 /*
-  Calculate the "spans" attribute of the <row> tag. This is an
-  XLSX optimisation and isn't strictly required. However, it
-  makes comparing files easier. The span is the same for each
-  block of 16 rows.
+  Extend the span of the band of 16 rows containing \a row, which is
+  the range of the columns used by these rows, to include \a column.
+  The "spans" attribute of the rows is an optimization hint for the
+  readers of the file, so it only needs to be a superset of the columns
+  used.
+ */
+void WorksheetPrivate::extendRowSpan(int row, int column)
+{
+    if (!rowSpansValid)
+        return;
+
+    QPair<int, int> &span = rowSpans[(row - 1) / 16];
+    if (span.first == 0 || column < span.first)
+        span.first = column;
+    if (column > span.second)
+        span.second = column;
+}
+
+/*
+  Rebuild the spans of all the bands of rows, which is only needed
+  when cells have been moved. Only the first and last cell of each
+  row have to be looked at.
  */
 void WorksheetPrivate::calculateSpans() const
 {
-    row_spans.clear();
-    int span_min = XLSX_COLUMN_MAX + 1;
-    int span_max = -1;
-
-    for (int row_num = dimension.firstRow(); row_num <= dimension.lastRow(); row_num++) {
-        if (cellTable.contains(row_num)) {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn();
-                 col_num++) {
-                if (cellTable[row_num].contains(col_num)) {
-                    if (span_max == -1) {
-                        span_min = col_num;
-                        span_max = col_num;
-                    } else {
-                        if (col_num < span_min)
-                            span_min = col_num;
-                        else if (col_num > span_max)
-                            span_max = col_num;
-                    }
-                }
-            }
-        }
-        if (comments.contains(row_num)) {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn();
-                 col_num++) {
-                if (comments[row_num].contains(col_num)) {
-                    if (span_max == -1) {
-                        span_min = col_num;
-                        span_max = col_num;
-                    } else {
-                        if (col_num < span_min)
-                            span_min = col_num;
-                        else if (col_num > span_max)
-                            span_max = col_num;
-                    }
-                }
-            }
-        }
+    if (rowSpansValid)
+        return;
 
-        if (row_num % 16 == 0 || row_num == dimension.lastRow()) {
-            if (span_max != -1) {
-                row_spans[row_num / 16] = QStringLiteral("%1:%2").arg(span_min).arg(span_max);
-                span_min = XLSX_COLUMN_MAX + 1;
-                span_max = -1;
-            }
-        }
+    rowSpans.clear();
+    for (QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator it = cellTable.constBegin();
+         it != cellTable.constEnd(); ++it) {
+        if (it->isEmpty())
+            continue;
+        QPair<int, int> &span = rowSpans[(it.key() - 1) / 16];
+        if (span.first == 0 || it->firstKey() < span.first)
+            span.first = it->firstKey();
+        if (it->lastKey() > span.second)
+            span.second = it->lastKey();
     }
+    for (QMap<int, QMap<int, QString>>::const_iterator it = comments.constBegin();
+         it != comments.constEnd(); ++it) {
+        if (it->isEmpty())
+            continue;
+        QPair<int, int> &span = rowSpans[(it.key() - 1) / 16];
+        if (span.first == 0 || it->firstKey() < span.first)
+            span.first = it->firstKey();
+        if (it->lastKey() > span.second)
+            span.second = it->lastKey();
+    }
+    rowSpansValid = true;
 }
 
 QString WorksheetPrivate::generateDimensionString() const
@@ -207,35 +217,52 @@ Worksheet *Worksheet::copy(const QString &distName, int distId) const
 {
     Q_D(const Worksheet);
     Worksheet *sheet = new Worksheet(distName, distId, d->workbook, F_NewFromScratch);
-    WorksheetPrivate *sheet_d = sheet->d_func();
-
-    sheet_d->dimension = d->dimension;
-
-    QMapIterator<int, QMap<int, QSharedPointer<Cell>>> it(d->cellTable);
-    while (it.hasNext()) {
-        it.next();
-        int row = it.key();
-        QMapIterator<int, QSharedPointer<Cell>> it2(it.value());
-        while (it2.hasNext()) {
-            it2.next();
-            int col = it2.key();
-
-            QSharedPointer<Cell> cell(new Cell(it2.value().data()));
-            cell->d_ptr->parent = sheet;
-
-            if (cell->cellType() == Cell::SharedStringType)
-                d->workbook->sharedStrings()->addSharedString(cell->d_ptr->richString);
-
-            sheet_d->cellTable[row][col] = cell;
-        }
-    }
+    d->shareContents(sheet->d_func());
+    return sheet;
+}
 
-    sheet_d->merges = d->merges;
-    //    sheet_d->rowsInfo = d->rowsInfo;
-    //    sheet_d->colsInfo = d->colsInfo;
-    //    sheet_d->colsInfoHelper = d->colsInfoHelper;
-    //    sheet_d->dataValidationsList = d->dataValidationsList;
-    //    sheet_d->conditionalFormattingList = d->conditionalFormattingList;
+/*!
+ * \internal
+ *
+ * Make a frozen copy of this sheet, with all its settings, for the
+ * snapshot \a workbook of an asynchronous save.
+ */
+Worksheet *Worksheet::snapshot(Workbook *workbook) const
+{
+    Q_D(const Worksheet);
+    Worksheet *sheet = new Worksheet(sheetName(), sheetId(), workbook, F_NewFromScratch);
+    sheet->setSheetState(sheetState());
+    WorksheetPrivate *sheet_d = sheet->d_func();
+    d->shareContents(sheet_d);
+
+    sheet_d->urlTable = d->urlTable;
+    sheet_d->previous_row = d->previous_row;
+    sheet_d->row_sizes = d->row_sizes;
+    sheet_d->col_sizes = d->col_sizes;
+    sheet_d->outline_row_level = d->outline_row_level;
+    sheet_d->outline_col_level = d->outline_col_level;
+    sheet_d->default_row_height = d->default_row_height;
+    sheet_d->default_row_zeroed = d->default_row_zeroed;
+    sheet_d->sheetFormatProps = d->sheetFormatProps;
+    sheet_d->windowProtection = d->windowProtection;
+    sheet_d->showFormulas = d->showFormulas;
+    sheet_d->showGridLines = d->showGridLines;
+    sheet_d->showRowColHeaders = d->showRowColHeaders;
+    sheet_d->showZeros = d->showZeros;
+    sheet_d->rightToLeft = d->rightToLeft;
+    sheet_d->tabSelected = d->tabSelected;
+    sheet_d->showRuler = d->showRuler;
+    sheet_d->showOutlineSymbols = d->showOutlineSymbols;
+    sheet_d->showWhiteSpace = d->showWhiteSpace;
+    if (d->drawing)
+        sheet_d->drawing = QSharedPointer<Drawing>(d->drawing->clone(sheet));
+    // The unmodified xml is saved again along with its relationships
+    *sheet_d->relationships = *d->relationships;
+    sheet_d->cachedEntry = d->cachedEntry;
+    sheet_d->passthroughRelationships = d->passthroughRelationships;
+    sheet_d->legacyDrawingId = d->legacyDrawingId;
+    sheet_d->legacyDrawingHFId = d->legacyDrawingHFId;
+    sheet_d->tablePartIds = d->tablePartIds;
 
     return sheet;
 }
@@ -262,6 +289,7 @@ bool Worksheet::isWindowProtected() const
 void Worksheet::setWindowProtected(bool protect)
 {
     Q_D(Worksheet);
+    setModified();
     d->windowProtection = protect;
 }
 
@@ -280,6 +308,7 @@ bool Worksheet::isFormulasVisible() const
 void Worksheet::setFormulasVisible(bool visible)
 {
     Q_D(Worksheet);
+    setModified();
     d->showFormulas = visible;
 }
 
@@ -298,6 +327,7 @@ bool Worksheet::isGridLinesVisible() const
 void Worksheet::setGridLinesVisible(bool visible)
 {
     Q_D(Worksheet);
+    setModified();
     d->showGridLines = visible;
 }
 
@@ -316,6 +346,7 @@ bool Worksheet::isRowColumnHeadersVisible() const
 void Worksheet::setRowColumnHeadersVisible(bool visible)
 {
     Q_D(Worksheet);
+    setModified();
     d->showRowColHeaders = visible;
 }
 
@@ -334,6 +365,7 @@ bool Worksheet::isRightToLeft() const
 void Worksheet::setRightToLeft(bool enable)
 {
     Q_D(Worksheet);
+    setModified();
     d->rightToLeft = enable;
 }
 
@@ -352,6 +384,7 @@ bool Worksheet::isZerosVisible() const
 void Worksheet::setZerosVisible(bool visible)
 {
     Q_D(Worksheet);
+    setModified();
     d->showZeros = visible;
 }
 
@@ -370,6 +403,7 @@ bool Worksheet::isSelected() const
 void Worksheet::setSelected(bool select)
 {
     Q_D(Worksheet);
+    setModified();
     d->tabSelected = select;
 }
 
@@ -388,6 +422,7 @@ bool Worksheet::isRulerVisible() const
 void Worksheet::setRulerVisible(bool visible)
 {
     Q_D(Worksheet);
+    setModified();
     d->showRuler = visible;
 }
 
@@ -406,6 +441,7 @@ bool Worksheet::isOutlineSymbolsVisible() const
 void Worksheet::setOutlineSymbolsVisible(bool visible)
 {
     Q_D(Worksheet);
+    setModified();
     d->showOutlineSymbols = visible;
 }
 
@@ -424,6 +460,7 @@ bool Worksheet::isWhiteSpaceVisible() const
 void Worksheet::setWhiteSpaceVisible(bool visible)
 {
     Q_D(Worksheet);
+    setModified();
     d->showWhiteSpace = visible;
 }
 
@@ -436,6 +473,7 @@ void Worksheet::setWhiteSpaceVisible(bool visible)
 bool Worksheet::write(int row, int column, const QVariant &value, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
 
     if (d->checkDimensions(row, column))
         return false;
@@ -520,6 +558,8 @@ QVariant Worksheet::read(const CellReference &row_column) const
 
 /*!
     Return the contents of the cell (\a row, \a column).
+
+    A date and time is returned as a QDateTime, see Cell::dateTime().
  */
 QVariant Worksheet::read(int row, int column) const
 {
@@ -536,12 +576,12 @@ QVariant Worksheet::read(int row, int column) const
             if (!cell->formula().formulaText().isEmpty()) {
                 return QVariant(QLatin1String("=") + cell->formula().formulaText());
             } else {
-                const CellFormula &rootFormula = d->sharedFormulaMap[cell->formula().sharedIndex()];
-                CellReference rootCellRef = rootFormula.reference().topLeft();
-                QString rootFormulaText = rootFormula.formulaText();
-                QString newFormulaText =
-                    convertSharedFormula(rootFormulaText, rootCellRef, CellReference(row, column));
-                return QVariant(QLatin1String("=") + newFormulaText);
+                QMap<int, SharedFormulaTemplate>::const_iterator it =
+                    d->sharedFormulaTemplates.constFind(cell->formula().sharedIndex());
+                if (it != d->sharedFormulaTemplates.constEnd()) {
+                    QString newFormulaText = it.value().expand(CellReference(row, column));
+                    return QVariant(QLatin1String("=") + newFormulaText);
+                }
             }
         }
     }
@@ -559,6 +599,33 @@ QVariant Worksheet::read(int row, int column) const
     return cell->value();
 }
 
+/*!
+ * \overload
+ * Returns the number of the cell \a row_column.
+ */
+double Worksheet::readDouble(const CellReference &row_column, bool *ok) const
+{
+    return readDouble(row_column.row(), row_column.column(), ok);
+}
+
+/*!
+ * Returns the number of the cell (\a row, \a column), or the cached result
+ * of its formula. Unlike read(), no QVariant is built and dates are not
+ * converted, so this is the fast way of reading numbers in a loop.
+ * If \a ok is not 0, \c *ok is set to false when the cell is not a number.
+ *
+ * \sa Cell::numericValue()
+ */
+double Worksheet::readDouble(int row, int column, bool *ok) const
+{
+    if (Cell *cell = cellAt(row, column))
+        return cell->numericValue(ok);
+
+    if (ok)
+        *ok = false;
+    return 0;
+}
+
 /*!
  * Returns the cell at the given \a row_column. If there
  * is no cell at the specified position, the function returns 0.
@@ -578,12 +645,117 @@ Cell *Worksheet::cellAt(const CellReference &row_column) const
 Cell *Worksheet::cellAt(int row, int column) const
 {
     Q_D(const Worksheet);
-    if (!d->cellTable.contains(row))
+    QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator it = d->cellTable.constFind(row);
+    if (it == d->cellTable.constEnd())
         return 0;
-    if (!d->cellTable[row].contains(column))
+    QMap<int, QSharedPointer<Cell>>::const_iterator cit = it->constFind(column);
+    if (cit == it->constEnd())
         return 0;
 
-    return d->cellTable[row][column].data();
+    return cit->data();
+}
+
+/*!
+ * Returns the cells of \a range as shown by their number formats, row by
+ * row, with an empty string for each blank cell.
+ *
+ * The number format of each style is compiled once, so this is the fast
+ * way of getting the texts of a whole column or table.
+ *
+ * \sa Cell::displayText()
+ */
+QStringList Worksheet::displayTexts(const CellRange &range) const
+{
+    Q_D(const Worksheet);
+    QStringList texts;
+    if (!range.isValid())
+        return texts;
+
+    const int columnCount = range.columnCount();
+    texts.reserve(range.rowCount() * columnCount);
+    Styles *styles = d->workbook->styles();
+    const bool is1904 = d->workbook->isDate1904();
+    QSharedPointer<const NumFormatRenderer> renderer;
+    int rendererXfIndex = -2;
+
+    for (int row = range.firstRow(); row <= range.lastRow(); ++row) {
+        const int first = texts.size();
+        for (int i = 0; i < columnCount; ++i)
+            texts.append(QString());
+
+        QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator it = d->cellTable.constFind(row);
+        if (it == d->cellTable.constEnd())
+            continue;
+        QMap<int, QSharedPointer<Cell>>::const_iterator cit = it->lowerBound(range.firstColumn());
+        for (; cit != it->constEnd() && cit.key() <= range.lastColumn(); ++cit) {
+            const Cell *cell = cit->data();
+            QString &text = texts[first + cit.key() - range.firstColumn()];
+            if (cell->cellType() != Cell::NumberType || !cell->value().isValid()) {
+                text = cell->displayText();
+                continue;
+            }
+            // Consecutive cells mostly share their style
+            const Format format = cell->format();
+            const int xfIndex = format.xfIndexValid() ? format.xfIndex() : -1;
+            if (xfIndex != rendererXfIndex || xfIndex == -1) {
+                renderer = styles->xfRenderer(format);
+                rendererXfIndex = xfIndex;
+            }
+            renderer->render(cell->value().toDouble(), text, is1904);
+        }
+    }
+    return texts;
+}
+
+/*!
+ * Returns the dates and times of the cells of \a range, row by row, as
+ * Cell::dateTime() does, with an invalid QDateTime for each cell which is
+ * not a date.
+ *
+ * The numbers of the cells are converted to dates in one pass, so this is
+ * the fast way of reading a whole column of dates.
+ */
+QList<QDateTime> Worksheet::readDateTimes(const CellRange &range) const
+{
+    Q_D(const Worksheet);
+    QList<QDateTime> dts;
+    if (!range.isValid())
+        return dts;
+
+    const int columnCount = range.columnCount();
+    const int count = range.rowCount() * columnCount;
+    QVector<double> values(count);
+    QVector<bool> isDate(count);
+    for (int row = range.firstRow(); row <= range.lastRow(); ++row) {
+        QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator it = d->cellTable.constFind(row);
+        if (it == d->cellTable.constEnd())
+            continue;
+        const int first = (row - range.firstRow()) * columnCount - range.firstColumn();
+        QMap<int, QSharedPointer<Cell>>::const_iterator cit = it->lowerBound(range.firstColumn());
+        for (; cit != it->constEnd() && cit.key() <= range.lastColumn(); ++cit) {
+            const Cell *cell = cit->data();
+            if (!cell->isDateTime())
+                continue;
+            values[first + cit.key()] = cell->value().toDouble();
+            isDate[first + cit.key()] = true;
+        }
+    }
+
+    QVector<qint64> days(count);
+    QVector<qint64> msecs(count);
+    daysFromNumbers(values.constData(), days.data(), msecs.data(), count,
+                    d->workbook->isDate1904());
+    const Qt::TimeSpec spec = d->workbook->isNaiveDateTimeEnabled() ? Qt::UTC : Qt::LocalTime;
+    const QDate epoch(1970, 1, 1);
+    dts.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        if (isDate[i])
+            dts.append(QDateTime(epoch.addDays(days[i]), QTime(0, 0).addMSecs(int(msecs[i])),
+                                 spec));
+        else
+            dts.append(QDateTime());
+    }
+    return dts;
 }
 
 Format WorksheetPrivate::cellFormat(int row, int col) const
@@ -617,6 +789,7 @@ bool Worksheet::writeString(const CellReference &row_column, const RichString &v
 bool Worksheet::writeString(int row, int column, const RichString &value, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
     //    QString content = value.toPlainString();
     if (d->checkDimensions(row, column))
         return false;
@@ -626,15 +799,16 @@ bool Worksheet::writeString(int row, int column, const RichString &value, const
     //        error = -2;
     //    }
 
-    d->sharedStrings()->addSharedString(value);
+    const int sst_idx = d->sharedStrings()->addSharedString(value);
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     if (value.fragmentCount() == 1 && value.fragmentFormat(0).isValid())
         fmt.mergeFormat(value.fragmentFormat(0));
     d->workbook->styles()->addXfFormat(fmt);
     QSharedPointer<Cell> cell =
-        QSharedPointer<Cell>(new Cell(value.toPlainString(), Cell::SharedStringType, fmt, this));
+        d->cellArena->createCell(value.toPlainString(), Cell::SharedStringType, fmt, this);
     cell->d_ptr->richString = value;
-    d->cellTable[row][column] = cell;
+    cell->d_ptr->sharedStringIndex = sst_idx;
+    d->setCell(row, column, cell);
     return true;
 }
 
@@ -660,6 +834,7 @@ bool Worksheet::writeString(const CellReference &row_column, const QString &valu
 bool Worksheet::writeString(int row, int column, const QString &value, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
     if (d->checkDimensions(row, column))
         return false;
 
@@ -692,6 +867,7 @@ bool Worksheet::writeInlineString(const CellReference &row_column, const QString
 bool Worksheet::writeInlineString(int row, int column, const QString &value, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
     // int error = 0;
     QString content = value;
     if (d->checkDimensions(row, column))
@@ -704,8 +880,7 @@ bool Worksheet::writeInlineString(int row, int column, const QString &value, con
 
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] =
-        QSharedPointer<Cell>(new Cell(value, Cell::InlineStringType, fmt, this));
+    d->setCell(row, column, d->cellArena->createCell(value, Cell::InlineStringType, fmt, this));
     return true;
 }
 
@@ -729,12 +904,13 @@ bool Worksheet::writeNumeric(const CellReference &row_column, double value, cons
 bool Worksheet::writeNumeric(int row, int column, double value, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
     if (d->checkDimensions(row, column))
         return false;
 
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::NumberType, fmt, this));
+    d->setCell(row, column, d->cellArena->createCell(value, Cell::NumberType, fmt, this));
     return true;
 }
 
@@ -760,6 +936,7 @@ bool Worksheet::writeFormula(int row, int column, const CellFormula &formula_, c
                              double result)
 {
     Q_D(Worksheet);
+    setModified();
     if (d->checkDimensions(row, column))
         return false;
 
@@ -774,12 +951,12 @@ bool Worksheet::writeFormula(int row, int column, const CellFormula &formula_, c
         while (d->sharedFormulaMap.contains(si))
             ++si;
         formula.d->si = si;
-        d->sharedFormulaMap[si] = formula;
+        d->addSharedFormula(formula);
     }
 
-    QSharedPointer<Cell> data = QSharedPointer<Cell>(new Cell(result, Cell::NumberType, fmt, this));
+    QSharedPointer<Cell> data = d->cellArena->createCell(result, Cell::NumberType, fmt, this);
     data->d_ptr->formula = formula;
-    d->cellTable[row][column] = data;
+    d->setCell(row, column, data);
 
     CellRange range = formula.reference();
     if (formula.formulaType() == CellFormula::SharedType) {
@@ -788,13 +965,14 @@ bool Worksheet::writeFormula(int row, int column, const CellFormula &formula_, c
         for (int r = range.firstRow(); r <= range.lastRow(); ++r) {
             for (int c = range.firstColumn(); c <= range.lastColumn(); ++c) {
                 if (!(r == row && c == column)) {
-                    if (Cell *cell = cellAt(r, c)) {
+                    if (Cell *cell = d->detachCell(r, c)) {
                         cell->d_ptr->formula = sf;
+                        d->cellChanged(r, c);
                     } else {
                         QSharedPointer<Cell> newCell =
-                            QSharedPointer<Cell>(new Cell(result, Cell::NumberType, fmt, this));
+                            d->cellArena->createCell(result, Cell::NumberType, fmt, this);
                         newCell->d_ptr->formula = sf;
-                        d->cellTable[r][c] = newCell;
+                        d->setCell(r, c, newCell);
                     }
                 }
             }
@@ -825,6 +1003,7 @@ bool Worksheet::writeBlank(const CellReference &row_column, const Format &format
 bool Worksheet::writeBlank(int row, int column, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
     if (d->checkDimensions(row, column))
         return false;
 
@@ -832,8 +1011,7 @@ bool Worksheet::writeBlank(int row, int column, const Format &format)
     d->workbook->styles()->addXfFormat(fmt);
 
     // Note: NumberType with an invalid QVariant value means blank.
-    d->cellTable[row][column] =
-        QSharedPointer<Cell>(new Cell(QVariant(), Cell::NumberType, fmt, this));
+    d->setCell(row, column, d->cellArena->createCell(QVariant(), Cell::NumberType, fmt, this));
 
     return true;
 }
@@ -857,12 +1035,13 @@ bool Worksheet::writeBool(const CellReference &row_column, bool value, const For
 bool Worksheet::writeBool(int row, int column, bool value, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
     if (d->checkDimensions(row, column))
         return false;
 
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::BooleanType, fmt, this));
+    d->setCell(row, column, d->cellArena->createCell(value, Cell::BooleanType, fmt, this));
 
     return true;
 }
@@ -883,10 +1062,15 @@ bool Worksheet::writeDateTime(const CellReference &row_column, const QDateTime &
 /*!
     Write a QDateTime \a dt to the cell (\a row, \a column) with the \a format.
     Returns true on success.
+
+    A QDateTime in UTC or with an offset from UTC is converted to local time
+    first, unless Workbook::isNaiveDateTimeEnabled() is true, in which case
+    the date and time are written as \a dt holds them.
  */
 bool Worksheet::writeDateTime(int row, int column, const QDateTime &dt, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
     if (d->checkDimensions(row, column))
         return false;
 
@@ -895,10 +1079,68 @@ bool Worksheet::writeDateTime(int row, int column, const QDateTime &dt, const Fo
         fmt.setNumberFormat(d->workbook->defaultDateFormat());
     d->workbook->styles()->addXfFormat(fmt);
 
-    double value = datetimeToNumber(dt, d->workbook->isDate1904());
+    double value = datetimeToNumber(dt, d->workbook->isDate1904(),
+                                    d->workbook->isNaiveDateTimeEnabled());
+
+    d->setCell(row, column, d->cellArena->createCell(value, Cell::NumberType, fmt, this));
+
+    return true;
+}
+
+/*!
+    Write the QDateTime values \a dts to the cells of \a range with the
+    \a format, row by row, as writeDateTime() does. Values beyond the end of
+    \a range are not written. Returns true on success.
 
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::NumberType, fmt, this));
+    The dates are converted to numbers in one pass, so this is the fast way
+    of writing a whole column of dates.
+ */
+bool Worksheet::writeDateTimes(const CellRange &range, const QList<QDateTime> &dts,
+                               const Format &format)
+{
+    Q_D(Worksheet);
+    if (!range.isValid())
+        return false;
+    const int columnCount = range.columnCount();
+    const int count = qMin(dts.size(), range.rowCount() * columnCount);
+    if (count == 0)
+        return true;
+    setModified();
+    if (d->checkDimensions(range.firstRow(), range.firstColumn())
+        || d->checkDimensions(range.firstRow() + (count - 1) / columnCount,
+                              count < columnCount ? range.firstColumn() + count - 1
+                                                  : range.lastColumn())) {
+        return false;
+    }
 
+    const bool naive = d->workbook->isNaiveDateTimeEnabled();
+    QVector<qint64> days(count);
+    QVector<qint64> msecs(count);
+    for (int i = 0; i < count; ++i)
+        days[i] = dts[i].isValid() ? datetimeToDays(dts[i], &msecs[i], naive) : 0;
+    QVector<double> values(count);
+    daysToNumbers(days.constData(), msecs.constData(), values.data(), count,
+                  d->workbook->isDate1904());
+
+    Format fmt = format;
+    if (fmt.isValid() && !fmt.isDateTimeFormat())
+        fmt.setNumberFormat(d->workbook->defaultDateFormat());
+    if (fmt.isValid())
+        d->workbook->styles()->addXfFormat(fmt);
+    for (int i = 0; i < count; ++i) {
+        const int row = range.firstRow() + i / columnCount;
+        const int column = range.firstColumn() + i % columnCount;
+        Format cellFmt = fmt;
+        if (!cellFmt.isValid()) {
+            cellFmt = d->cellFormat(row, column);
+            if (!cellFmt.isValid() || !cellFmt.isDateTimeFormat())
+                cellFmt.setNumberFormat(d->workbook->defaultDateFormat());
+            d->workbook->styles()->addXfFormat(cellFmt);
+        }
+        // An invalid QDateTime is written as 0, as by writeDateTime()
+        const double value = dts[i].isValid() ? values[i] : 0;
+        d->setCell(row, column, d->cellArena->createCell(value, Cell::NumberType, cellFmt, this));
+    }
     return true;
 }
 
@@ -922,6 +1164,7 @@ bool Worksheet::writeTime(const CellReference &row_column, const QTime &t, const
 bool Worksheet::writeTime(int row, int column, const QTime &t, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
     if (d->checkDimensions(row, column))
         return false;
 
@@ -930,8 +1173,7 @@ bool Worksheet::writeTime(int row, int column, const QTime &t, const Format &for
         fmt.setNumberFormat(QStringLiteral("hh:mm:ss"));
     d->workbook->styles()->addXfFormat(fmt);
 
-    d->cellTable[row][column] =
-        QSharedPointer<Cell>(new Cell(timeToNumber(t), Cell::NumberType, fmt, this));
+    d->setCell(row, column, d->cellArena->createCell(timeToNumber(t), Cell::NumberType, fmt, this));
 
     return true;
 }
@@ -958,6 +1200,7 @@ bool Worksheet::writeHyperlink(int row, int column, const QUrl &url, const Forma
                                const QString &display, const QString &tip)
 {
     Q_D(Worksheet);
+    setModified();
     if (d->checkDimensions(row, column))
         return false;
 
@@ -998,8 +1241,8 @@ bool Worksheet::writeHyperlink(int row, int column, const QUrl &url, const Forma
 
     // Write the hyperlink string as normal string.
     d->sharedStrings()->addSharedString(displayString);
-    d->cellTable[row][column] =
-        QSharedPointer<Cell>(new Cell(displayString, Cell::SharedStringType, fmt, this));
+    d->setCell(row, column,
+               d->cellArena->createCell(displayString, Cell::SharedStringType, fmt, this));
 
     // Store the hyperlink data in a separate table
     d->urlTable[row][column] = QSharedPointer<XlsxHyperlinkData>(new XlsxHyperlinkData(
@@ -1015,6 +1258,7 @@ bool Worksheet::writeHyperlink(int row, int column, const QUrl &url, const Forma
 bool Worksheet::addDataValidation(const DataValidation &validation)
 {
     Q_D(Worksheet);
+    setModified();
     if (validation.ranges().isEmpty() || validation.validationType() == DataValidation::None)
         return false;
 
@@ -1029,6 +1273,7 @@ bool Worksheet::addDataValidation(const DataValidation &validation)
 bool Worksheet::addConditionalFormatting(const ConditionalFormatting &cf)
 {
     Q_D(Worksheet);
+    setModified();
     if (cf.ranges().isEmpty())
         return false;
 
@@ -1049,6 +1294,7 @@ bool Worksheet::addConditionalFormatting(const ConditionalFormatting &cf)
 bool Worksheet::insertImage(int row, int column, const QImage &image)
 {
     Q_D(Worksheet);
+    setModified();
 
     if (image.isNull())
         return false;
@@ -1079,6 +1325,7 @@ bool Worksheet::insertImage(int row, int column, const QImage &image)
 Chart *Worksheet::insertChart(int row, int column, const QSize &size)
 {
     Q_D(Worksheet);
+    setModified();
 
     if (!d->drawing)
         d->drawing = QSharedPointer<Drawing>(new Drawing(this, F_NewFromScratch));
@@ -1110,6 +1357,7 @@ Chart *Worksheet::insertChart(int row, int column, const QSize &size)
 bool Worksheet::mergeCells(const CellRange &range, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
     if (range.rowCount() < 2 && range.columnCount() < 2)
         return false;
 
@@ -1122,10 +1370,9 @@ bool Worksheet::mergeCells(const CellRange &range, const Format &format)
     for (int row = range.firstRow(); row <= range.lastRow(); ++row) {
         for (int col = range.firstColumn(); col <= range.lastColumn(); ++col) {
             if (row == range.firstRow() && col == range.firstColumn()) {
-                Cell *cell = cellAt(row, col);
-                if (cell) {
+                if (cellAt(row, col)) {
                     if (format.isValid())
-                        cell->d_ptr->format = format;
+                        d->detachCell(row, col)->d_ptr->format = format;
                 } else {
                     writeBlank(row, col, format);
                 }
@@ -1146,6 +1393,7 @@ bool Worksheet::mergeCells(const CellRange &range, const Format &format)
 bool Worksheet::unmergeCells(const CellRange &range)
 {
     Q_D(Worksheet);
+    setModified();
     if (!d->merges.contains(range))
         return false;
 
@@ -1168,6 +1416,7 @@ QList<CellRange> Worksheet::mergedCells() const
 void Worksheet::saveToXmlFile(QIODevice *device) const
 {
     Q_D(const Worksheet);
+    XLSX_TRACE_SPAN_DETAIL("Worksheet::saveToXmlFile", sheetName());
     d->relationships->clear();
 
     QXmlStreamWriter writer(device);
@@ -1275,6 +1524,7 @@ void Worksheet::saveToXmlFile(QIODevice *device) const
     d->saveXmlDataValidations(writer);
     d->saveXmlHyperlinks(writer);
     d->saveXmlDrawings(writer);
+    d->saveXmlPassthroughParts(writer);
 
     writer.writeEndElement(); // worksheet
     writer.writeEndDocument();
@@ -1283,29 +1533,59 @@ void Worksheet::saveToXmlFile(QIODevice *device) const
 void WorksheetPrivate::saveXmlSheetData(QXmlStreamWriter &writer) const
 {
     calculateSpans();
-    for (int row_num = dimension.firstRow(); row_num <= dimension.lastRow(); row_num++) {
-        if (!(cellTable.contains(row_num) || comments.contains(row_num)
-              || rowsInfo.contains(row_num))) {
-            // Only process rows with cell data / comments / formatting
-            continue;
+
+    // Only the rows with cell data / comments / formatting are written, so
+    // walk the keys of the three maps in order instead of the whole
+    // dimension, which may be as large as A1:XFD1048576 for a sparse sheet.
+    typedef QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator CellRowIterator;
+    typedef QMap<int, QMap<int, QString>>::const_iterator CommentRowIterator;
+    typedef QMap<int, QSharedPointer<XlsxRowInfo>>::const_iterator RowInfoIterator;
+    CellRowIterator cellRow = cellTable.lowerBound(dimension.firstRow());
+    CommentRowIterator commentRow = comments.lowerBound(dimension.firstRow());
+    RowInfoIterator rowInfoIt = rowsInfo.lowerBound(dimension.firstRow());
+
+    XlsxCellStyleTable styles;
+    if (!colsInfoHelper.isEmpty()) {
+        styles.columnXfIndexes.fill(-1, colsInfoHelper.lastKey() + 1);
+        for (QMap<int, QSharedPointer<XlsxColumnInfo>>::const_iterator it =
+                 colsInfoHelper.constBegin();
+             it != colsInfoHelper.constEnd(); ++it) {
+            if (!it.value()->format.isEmpty())
+                styles.columnXfIndexes[it.key()] = it.value()->format.xfIndex();
         }
+    }
 
-        int span_index = (row_num - 1) / 16;
-        QString span;
-        if (row_spans.contains(span_index))
-            span = row_spans[span_index];
+    forever {
+        int row_num = XLSX_ROW_MAX + 1;
+        if (cellRow != cellTable.constEnd())
+            row_num = cellRow.key();
+        if (commentRow != comments.constEnd())
+            row_num = qMin(row_num, commentRow.key());
+        if (rowInfoIt != rowsInfo.constEnd())
+            row_num = qMin(row_num, rowInfoIt.key());
+        if (row_num > dimension.lastRow())
+            break;
+
+        const bool hasCells = cellRow != cellTable.constEnd() && cellRow.key() == row_num;
+        const bool hasRowInfo = rowInfoIt != rowsInfo.constEnd() && rowInfoIt.key() == row_num;
+        if (commentRow != comments.constEnd() && commentRow.key() == row_num)
+            ++commentRow;
 
         writer.writeStartElement(QStringLiteral("row"));
         writer.writeAttribute(QStringLiteral("r"), QString::number(row_num));
 
-        if (!span.isEmpty())
-            writer.writeAttribute(QStringLiteral("spans"), span);
+        QMap<int, QPair<int, int>>::const_iterator span = rowSpans.constFind((row_num - 1) / 16);
+        if (span != rowSpans.constEnd()) {
+            writer.writeAttribute(QStringLiteral("spans"),
+                                  QStringLiteral("%1:%2").arg(span->first).arg(span->second));
+        }
 
-        if (rowsInfo.contains(row_num)) {
-            QSharedPointer<XlsxRowInfo> rowInfo = rowsInfo[row_num];
+        styles.rowXfIndex = -1;
+        if (hasRowInfo) {
+            const QSharedPointer<XlsxRowInfo> &rowInfo = rowInfoIt.value();
             if (!rowInfo->format.isEmpty()) {
-                writer.writeAttribute(QStringLiteral("s"),
-                                      QString::number(rowInfo->format.xfIndex()));
+                styles.rowXfIndex = rowInfo->format.xfIndex();
+                writer.writeAttribute(QStringLiteral("s"), styles.xfIndexText(styles.rowXfIndex));
                 writer.writeAttribute(QStringLiteral("customFormat"), QStringLiteral("1"));
             }
             //! Todo: support customHeight from info struct
@@ -1324,23 +1604,24 @@ void WorksheetPrivate::saveXmlSheetData(QXmlStreamWriter &writer) const
                                       QString::number(rowInfo->outlineLevel));
             if (rowInfo->collapsed)
                 writer.writeAttribute(QStringLiteral("collapsed"), QStringLiteral("1"));
+            ++rowInfoIt;
         }
 
         // Write cell data if row contains filled cells
-        if (cellTable.contains(row_num)) {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn();
-                 col_num++) {
-                if (cellTable[row_num].contains(col_num)) {
-                    saveXmlCellData(writer, row_num, col_num, cellTable[row_num][col_num]);
-                }
+        if (hasCells) {
+            for (QMap<int, QSharedPointer<Cell>>::const_iterator it = cellRow->constBegin();
+                 it != cellRow->constEnd(); ++it) {
+                saveXmlCellData(writer, row_num, it.key(), it.value(), styles);
             }
+            ++cellRow;
         }
         writer.writeEndElement(); // row
     }
 }
 
 void WorksheetPrivate::saveXmlCellData(QXmlStreamWriter &writer, int row, int col,
-                                       QSharedPointer<Cell> cell) const
+                                       const QSharedPointer<Cell> &cell,
+                                       XlsxCellStyleTable &styles) const
 {
     // This is the innermost loop so efficiency is important.
     QString cell_pos = CellReference(row, col).toString();
@@ -1349,22 +1630,17 @@ void WorksheetPrivate::saveXmlCellData(QXmlStreamWriter &writer, int row, int co
     writer.writeAttribute(QStringLiteral("r"), cell_pos);
 
     // Style used by the cell, row or col
-    if (!cell->format().isEmpty())
-        writer.writeAttribute(QStringLiteral("s"), QString::number(cell->format().xfIndex()));
-    else if (rowsInfo.contains(row) && !rowsInfo[row]->format.isEmpty())
-        writer.writeAttribute(QStringLiteral("s"),
-                              QString::number(rowsInfo[row]->format.xfIndex()));
-    else if (colsInfoHelper.contains(col) && !colsInfoHelper[col]->format.isEmpty())
-        writer.writeAttribute(QStringLiteral("s"),
-                              QString::number(colsInfoHelper[col]->format.xfIndex()));
+    const Format &format = cell->d_ptr->format;
+    int xfIndex = styles.rowXfIndex;
+    if (!format.isEmpty())
+        xfIndex = format.xfIndex();
+    else if (xfIndex == -1)
+        xfIndex = styles.columnXfIndex(col);
+    if (xfIndex != -1)
+        writer.writeAttribute(QStringLiteral("s"), styles.xfIndexText(xfIndex));
 
     if (cell->cellType() == Cell::SharedStringType) {
-        int sst_idx;
-        if (cell->isRichString())
-            sst_idx = sharedStrings()->getSharedStringIndex(cell->d_ptr->richString);
-        else
-            sst_idx = sharedStrings()->getSharedStringIndex(cell->value().toString());
-
+        const int sst_idx = cell->d_ptr->sharedStringIndexIn(workbook->sharedStrings());
         writer.writeAttribute(QStringLiteral("t"), QStringLiteral("s"));
         writer.writeTextElement(QStringLiteral("v"), QString::number(sst_idx));
     } else if (cell->cellType() == Cell::InlineStringType) {
@@ -1410,8 +1686,15 @@ void WorksheetPrivate::saveXmlCellData(QXmlStreamWriter &writer, int row, int co
         writer.writeTextElement(QStringLiteral("v"), cell->value().toString());
     } else if (cell->cellType() == Cell::BooleanType) {
         writer.writeAttribute(QStringLiteral("t"), QStringLiteral("b"));
+        if (cell->hasFormula())
+            cell->formula().saveToXml(writer);
         writer.writeTextElement(QStringLiteral("v"),
                                 cell->value().toBool() ? QStringLiteral("1") : QStringLiteral("0"));
+    } else if (cell->cellType() == Cell::ErrorType) {
+        writer.writeAttribute(QStringLiteral("t"), QStringLiteral("e"));
+        if (cell->hasFormula())
+            cell->formula().saveToXml(writer);
+        writer.writeTextElement(QStringLiteral("v"), cell->value().toString());
     }
     writer.writeEndElement(); // c
 }
@@ -1499,6 +1782,38 @@ void WorksheetPrivate::saveXmlDrawings(QXmlStreamWriter &writer) const
                           QStringLiteral("rId%1").arg(relationships->count()));
 }
 
+/*
+  Adds the relationships to the parts we do not model, and writes the
+  elements referring to them, with their new ids.
+*/
+void WorksheetPrivate::saveXmlPassthroughParts(QXmlStreamWriter &writer) const
+{
+    QHash<QString, QString> ids;
+    foreach (const XlsxRelationship &relationship, passthroughRelationships) {
+        relationships->addRelationship(relationship.type, relationship.target,
+                                       relationship.targetMode);
+        ids.insert(relationship.id, QStringLiteral("rId%1").arg(relationships->count()));
+    }
+
+    if (ids.contains(legacyDrawingId)) {
+        writer.writeEmptyElement(QStringLiteral("legacyDrawing"));
+        writer.writeAttribute(QStringLiteral("r:id"), ids[legacyDrawingId]);
+    }
+    if (ids.contains(legacyDrawingHFId)) {
+        writer.writeEmptyElement(QStringLiteral("legacyDrawingHF"));
+        writer.writeAttribute(QStringLiteral("r:id"), ids[legacyDrawingHFId]);
+    }
+    if (!tablePartIds.isEmpty()) {
+        writer.writeStartElement(QStringLiteral("tableParts"));
+        writer.writeAttribute(QStringLiteral("count"), QString::number(tablePartIds.size()));
+        foreach (const QString &id, tablePartIds) {
+            writer.writeEmptyElement(QStringLiteral("tablePart"));
+            writer.writeAttribute(QStringLiteral("r:id"), ids.value(id));
+        }
+        writer.writeEndElement(); // tableParts
+    }
+}
+
 void WorksheetPrivate::splitColsInfo(int colFirst, int colLast)
 {
     // Split current columnInfo, for example, if "A:H" has been set,
@@ -1576,6 +1891,251 @@ QList<int> WorksheetPrivate ::getColumnIndexes(int colFirst, int colLast)
     return nodes;
 }
 
+/*
+  Register the root \a formula of a shared formula group. The formula is
+  tokenized only once here, so that reading the other cells of the group
+  can generate their formulas by offsetting the cell references.
+ */
+void WorksheetPrivate::addSharedFormula(const CellFormula &formula)
+{
+    sharedFormulaMap[formula.sharedIndex()] = formula;
+    sharedFormulaTemplates[formula.sharedIndex()] =
+        SharedFormulaTemplate(formula.formulaText(), formula.reference().topLeft());
+}
+
+/*
+  Store \a cell at (\a row, \a column), keeping the dimension and the
+  row spans of the sheet up to date.
+ */
+void WorksheetPrivate::setCell(int row, int column, const QSharedPointer<Cell> &cell)
+{
+    cellTable[row][column] = cell;
+    checkDimensions(row, column);
+    extendRowSpan(row, column);
+    cellChanged(row, column);
+}
+
+/*
+  Must be called whenever the cell at (\a row, \a column) has been
+  replaced or modified in place.
+ */
+void WorksheetPrivate::cellChanged(int row, int column)
+{
+    if (formulaEngine)
+        formulaEngine->cellChanged(row, column);
+}
+
+/*
+  Returns the cell at (\a row, \a column) for being modified in place.
+  Cells may be shared with copies of the sheet, in which case the cell
+  is duplicated first. Returns 0 if the cell doesn't exist.
+ */
+Cell *WorksheetPrivate::detachCell(int row, int column)
+{
+    QMap<int, QMap<int, QSharedPointer<Cell>>>::iterator it = cellTable.find(row);
+    if (it == cellTable.end())
+        return 0;
+    QMap<int, QSharedPointer<Cell>>::iterator cit = it->find(column);
+    if (cit == it->end())
+        return 0;
+
+    detachCell(*cit);
+    return cit->data();
+}
+
+void WorksheetPrivate::detachCell(QSharedPointer<Cell> &cell)
+{
+    Q_Q(Worksheet);
+    // Cells created since the sheet was last shared are only held by it
+    if (cell->d_ptr->parent == q && cell->d_ptr->generation == cellArena->generation())
+        return;
+
+    QSharedPointer<Cell> copy = cellArena->createCell(cell.data());
+    copy->d_ptr->parent = q;
+    cell = copy;
+}
+
+/*
+  Make this sheet the parent of the shared cells whose parent is
+  \a oldParent, which is about to be deleted. Other copies of that sheet may
+  hold the same cells, so they are still copied before being modified.
+ */
+void WorksheetPrivate::reparentCells(const Worksheet *oldParent)
+{
+    Q_Q(Worksheet);
+    typedef QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator RowIterator;
+    typedef QMap<int, QSharedPointer<Cell>>::const_iterator CellIterator;
+    for (RowIterator it = cellTable.constBegin(); it != cellTable.constEnd(); ++it) {
+        for (CellIterator cit = it->constBegin(); cit != it->constEnd(); ++cit) {
+            if ((*cit)->d_ptr->parent == oldParent) {
+                (*cit)->d_ptr->parent = q;
+                (*cit)->d_ptr->generation = -1;
+            }
+        }
+    }
+}
+
+/*
+  Make this sheet the parent of all its cells, copying the ones which
+  another sheet created, so that they no longer refer to that sheet.
+  When \a formatCopies is given, the copied cells and the row and column
+  settings also get formats of their own, one for each format key, so that
+  nothing is shared any longer with the sheet this one was copied from.
+ */
+void WorksheetPrivate::adoptCells(QHash<QByteArray, Format> *formatCopies)
+{
+    Q_Q(Worksheet);
+    typedef QMap<int, QMap<int, QSharedPointer<Cell>>>::iterator RowIterator;
+    typedef QMap<int, QSharedPointer<Cell>>::iterator CellIterator;
+    for (RowIterator it = cellTable.begin(); it != cellTable.end(); ++it) {
+        for (CellIterator cit = it->begin(); cit != it->end(); ++cit) {
+            if ((*cit)->d_ptr->parent != q) {
+                QSharedPointer<Cell> copy = cellArena->createCell(cit->data());
+                copy->d_ptr->parent = q;
+                if (formatCopies)
+                    ownFormat(copy->d_ptr->format, formatCopies);
+                *cit = copy;
+            }
+        }
+    }
+
+    // The row and column settings are copied with the sheet already
+    if (formatCopies) {
+        foreach (const QSharedPointer<XlsxRowInfo> &info, rowsInfo)
+            ownFormat(info->format, formatCopies);
+        foreach (const QSharedPointer<XlsxColumnInfo> &info, colsInfo)
+            ownFormat(info->format, formatCopies);
+    }
+}
+
+/*
+  Replaces \a format by the copy of it kept in \a formatCopies.
+ */
+void WorksheetPrivate::ownFormat(Format &format, QHash<QByteArray, Format> *formatCopies)
+{
+    if (!format.isValid())
+        return;
+    const QByteArray key = format.formatKey();
+    QHash<QByteArray, Format>::const_iterator it = formatCopies->constFind(key);
+    if (it == formatCopies->constEnd()) {
+        format.detach();
+        formatCopies->insert(key, format);
+    } else {
+        format = it.value();
+    }
+}
+
+/*
+  Starts a new generation of cells. The current cells are shared with a copy
+  of the cell table, so both sheets detach them before modifying them in
+  place from now on, while the cells created later are not.
+ */
+void WorksheetPrivate::markCellsShared() const
+{
+    // The generation is advanced atomically, as iterators call this from the
+    // const read paths of several threads. A frozen sheet is never modified.
+    if (!frozen)
+        cellArena->nextGeneration();
+}
+
+/*
+  Gives \a sheet_d the cells and the cell level settings of this sheet.
+ */
+void WorksheetPrivate::shareContents(WorksheetPrivate *sheet_d) const
+{
+    sheet_d->dimension = dimension;
+    sheet_d->rowSpans = rowSpans;
+    sheet_d->rowSpansValid = rowSpansValid;
+
+    // The rows of cells are implicitly shared, so only the rows which
+    // are modified later get duplicated.
+    sheet_d->cellTable = cellTable;
+    markCellsShared();
+
+    sheet_d->merges = merges;
+    sheet_d->comments = comments;
+    sheet_d->sharedFormulaMap = sharedFormulaMap;
+    sheet_d->sharedFormulaTemplates = sharedFormulaTemplates;
+    sheet_d->dataValidationsList = dataValidationsList;
+    sheet_d->conditionalFormattingList = conditionalFormattingList;
+
+    // Row and column settings are modified in place, so they can't be shared.
+    for (QMap<int, QSharedPointer<XlsxRowInfo>>::const_iterator it = rowsInfo.constBegin();
+         it != rowsInfo.constEnd(); ++it) {
+        sheet_d->rowsInfo.insert(sheet_d->rowsInfo.constEnd(), it.key(),
+                                 QSharedPointer<XlsxRowInfo>(new XlsxRowInfo(*it.value())));
+    }
+    QHash<XlsxColumnInfo *, QSharedPointer<XlsxColumnInfo>> colsInfoCopies;
+    foreach (const QSharedPointer<XlsxColumnInfo> &info, colsInfo) {
+        QSharedPointer<XlsxColumnInfo> copy(new XlsxColumnInfo(*info));
+        colsInfoCopies.insert(info.data(), copy);
+        sheet_d->colsInfo.insert(copy->firstColumn, copy);
+    }
+    for (QMap<int, QSharedPointer<XlsxColumnInfo>>::const_iterator it =
+             colsInfoHelper.constBegin();
+         it != colsInfoHelper.constEnd(); ++it) {
+        sheet_d->colsInfoHelper.insert(sheet_d->colsInfoHelper.constEnd(), it.key(),
+                                       colsInfoCopies.value(it.value().data()));
+    }
+}
+
+/*
+  Stores \a result as the value of the formula cell (\a row, \a column),
+  and returns whether it changed. An unchanged cell is left alone, so it
+  is not detached.
+ */
+bool WorksheetPrivate::setFormulaResult(int row, int column, const FormulaValue &result)
+{
+    Q_Q(Worksheet);
+    Cell::CellType type;
+    QVariant value;
+    switch (result.type) {
+    case FormulaValue::Number:
+        type = Cell::NumberType;
+        value = result.number;
+        break;
+    case FormulaValue::Boolean:
+        type = Cell::BooleanType;
+        value = result.number != 0;
+        break;
+    case FormulaValue::String:
+        type = Cell::StringType;
+        value = result.text;
+        break;
+    case FormulaValue::Error:
+        type = Cell::ErrorType;
+        value = result.text;
+        break;
+    default: // A reference to an empty cell gives 0
+        type = Cell::NumberType;
+        value = 0.0;
+        break;
+    }
+
+    const Cell *current = q->cellAt(row, column);
+    if (!current)
+        return false;
+    if (current->d_ptr->cellType == type && current->d_ptr->value.type() == value.type()
+        && current->d_ptr->value == value)
+        return false;
+
+    CellPrivate *cell = detachCell(row, column)->d_func();
+    cell->cellType = type;
+    cell->value = value;
+    return true;
+}
+
+/*
+  Recalculates the formulas whose precedents have changed, and returns
+  whether the result of one of them changed.
+ */
+bool WorksheetPrivate::recalculate()
+{
+    if (!formulaEngine)
+        formulaEngine = QSharedPointer<FormulaEngine>(new FormulaEngine(this));
+    return formulaEngine->recalculate();
+}
+
 /*!
   Sets width in characters of a \a range of columns to \a width.
   Returns true on success.
@@ -1621,6 +2181,7 @@ bool Worksheet::setColumnHidden(const CellRange &range, bool hidden)
 bool Worksheet::setColumnWidth(int colFirst, int colLast, double width)
 {
     Q_D(Worksheet);
+    setModified();
 
     QList<QSharedPointer<XlsxColumnInfo>> columnInfoList = d->getColumnInfoList(colFirst, colLast);
     foreach (QSharedPointer<XlsxColumnInfo> columnInfo, columnInfoList)
@@ -1637,6 +2198,7 @@ bool Worksheet::setColumnWidth(int colFirst, int colLast, double width)
 bool Worksheet::setColumnFormat(int colFirst, int colLast, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
 
     QList<QSharedPointer<XlsxColumnInfo>> columnInfoList = d->getColumnInfoList(colFirst, colLast);
     foreach (QSharedPointer<XlsxColumnInfo> columnInfo, columnInfoList)
@@ -1657,6 +2219,7 @@ bool Worksheet::setColumnFormat(int colFirst, int colLast, const Format &format)
 bool Worksheet::setColumnHidden(int colFirst, int colLast, bool hidden)
 {
     Q_D(Worksheet);
+    setModified();
 
     QList<QSharedPointer<XlsxColumnInfo>> columnInfoList = d->getColumnInfoList(colFirst, colLast);
     foreach (QSharedPointer<XlsxColumnInfo> columnInfo, columnInfoList)
@@ -1671,12 +2234,12 @@ bool Worksheet::setColumnHidden(int colFirst, int colLast, bool hidden)
 double Worksheet::columnWidth(int column)
 {
     Q_D(Worksheet);
+    if (!d->isColumnRangeValid(column, column))
+        return d->sheetFormatProps.defaultColWidth;
 
-    QList<QSharedPointer<XlsxColumnInfo>> columnInfoList = d->getColumnInfoList(column, column);
-    if (columnInfoList.count() == 1)
-        return columnInfoList.at(0)->width;
-
-    return d->sheetFormatProps.defaultColWidth;
+    // Read without splitting the column settings, which would modify the sheet
+    const QSharedPointer<XlsxColumnInfo> info = d->colsInfoHelper.value(column);
+    return info ? info->width : 0;
 }
 
 /*!
@@ -1685,10 +2248,9 @@ double Worksheet::columnWidth(int column)
 Format Worksheet::columnFormat(int column)
 {
     Q_D(Worksheet);
-
-    QList<QSharedPointer<XlsxColumnInfo>> columnInfoList = d->getColumnInfoList(column, column);
-    if (columnInfoList.count() == 1)
-        return columnInfoList.at(0)->format;
+    const QSharedPointer<XlsxColumnInfo> info = d->colsInfoHelper.value(column);
+    if (info && d->isColumnRangeValid(column, column))
+        return info->format;
 
     return Format();
 }
@@ -1699,10 +2261,9 @@ Format Worksheet::columnFormat(int column)
 bool Worksheet::isColumnHidden(int column)
 {
     Q_D(Worksheet);
-
-    QList<QSharedPointer<XlsxColumnInfo>> columnInfoList = d->getColumnInfoList(column, column);
-    if (columnInfoList.count() == 1)
-        return columnInfoList.at(0)->hidden;
+    const QSharedPointer<XlsxColumnInfo> info = d->colsInfoHelper.value(column);
+    if (info && d->isColumnRangeValid(column, column))
+        return info->hidden;
 
     return false;
 }
@@ -1717,6 +2278,7 @@ bool Worksheet::isColumnHidden(int column)
 bool Worksheet::setRowHeight(int rowFirst, int rowLast, double height)
 {
     Q_D(Worksheet);
+    setModified();
 
     QList<QSharedPointer<XlsxRowInfo>> rowInfoList = d->getRowInfoList(rowFirst, rowLast);
 
@@ -1737,6 +2299,7 @@ bool Worksheet::setRowHeight(int rowFirst, int rowLast, double height)
 bool Worksheet::setRowFormat(int rowFirst, int rowLast, const Format &format)
 {
     Q_D(Worksheet);
+    setModified();
 
     QList<QSharedPointer<XlsxRowInfo>> rowInfoList = d->getRowInfoList(rowFirst, rowLast);
 
@@ -1756,6 +2319,7 @@ bool Worksheet::setRowFormat(int rowFirst, int rowLast, const Format &format)
 bool Worksheet::setRowHidden(int rowFirst, int rowLast, bool hidden)
 {
     Q_D(Worksheet);
+    setModified();
 
     QList<QSharedPointer<XlsxRowInfo>> rowInfoList = d->getRowInfoList(rowFirst, rowLast);
     foreach (QSharedPointer<XlsxRowInfo> rowInfo, rowInfoList)
@@ -1812,6 +2376,7 @@ bool Worksheet::isRowHidden(int row)
 bool Worksheet::groupRows(int rowFirst, int rowLast, bool collapsed)
 {
     Q_D(Worksheet);
+    setModified();
 
     for (int row = rowFirst; row <= rowLast; ++row) {
         if (d->rowsInfo.contains(row)) {
@@ -1852,6 +2417,7 @@ bool Worksheet::groupColumns(const CellRange &range, bool collapsed)
 bool Worksheet::groupColumns(int colFirst, int colLast, bool collapsed)
 {
     Q_D(Worksheet);
+    setModified();
 
     d->splitColsInfo(colFirst, colLast);
 
@@ -1902,6 +2468,414 @@ bool Worksheet::groupColumns(int colFirst, int colLast, bool collapsed)
     return false;
 }
 
+/*!
+    Inserts \a count empty rows before \a row. The cells, merged cells,
+    hyperlinks, comments, row settings, data validations and conditional
+    formats below are moved down, and the formulas referring to them
+    are updated, including the references to whole rows such as 2:5 and
+    the formulas of data validations and conditional formats.
+
+    Returns false if \a row is not valid, or if cells would be moved
+    beyond the last row of the worksheet.
+
+    \sa deleteRows(), insertColumns()
+ */
+bool Worksheet::insertRows(int row, int count)
+{
+    Q_D(Worksheet);
+    setModified();
+    if (row < 1 || row > XLSX_ROW_MAX || count < 1)
+        return false;
+    if (d->dimension.isValid() && d->dimension.lastRow() >= row
+        && d->dimension.lastRow() > XLSX_ROW_MAX - count)
+        return false;
+
+    return d->shiftCells(Qt::Vertical, row, count);
+}
+
+/*!
+    Deletes \a count rows starting from \a row. The rows below are
+    moved up, and references to the deleted cells become \c{#REF!}.
+
+    Returns false if \a row is not valid.
+
+    \sa insertRows(), deleteColumns()
+ */
+bool Worksheet::deleteRows(int row, int count)
+{
+    Q_D(Worksheet);
+    setModified();
+    if (row < 1 || row > XLSX_ROW_MAX || count < 1)
+        return false;
+
+    return d->shiftCells(Qt::Vertical, row, -qMin(count, XLSX_ROW_MAX - row + 1));
+}
+
+/*!
+    Inserts \a count empty columns before \a column. The cells, merged
+    cells, hyperlinks, comments, column settings, data validations and
+    conditional formats to the right are moved, and the formulas referring
+    to them are updated, including the references to whole columns such as
+    A:C and the formulas of data validations and conditional formats.
+
+    Returns false if \a column is not valid, or if cells would be moved
+    beyond the last column of the worksheet.
+
+    \sa deleteColumns(), insertRows()
+ */
+bool Worksheet::insertColumns(int column, int count)
+{
+    Q_D(Worksheet);
+    setModified();
+    if (column < 1 || column > XLSX_COLUMN_MAX || count < 1)
+        return false;
+    if (d->dimension.isValid() && d->dimension.lastColumn() >= column
+        && d->dimension.lastColumn() > XLSX_COLUMN_MAX - count)
+        return false;
+
+    return d->shiftCells(Qt::Horizontal, column, count);
+}
+
+/*!
+    Deletes \a count columns starting from \a column. The columns to the
+    right are moved left, and references to the deleted cells become
+    \c{#REF!}.
+
+    Returns false if \a column is not valid.
+
+    \sa insertColumns(), deleteRows()
+ */
+bool Worksheet::deleteColumns(int column, int count)
+{
+    Q_D(Worksheet);
+    setModified();
+    if (column < 1 || column > XLSX_COLUMN_MAX || count < 1)
+        return false;
+
+    return d->shiftCells(Qt::Horizontal, column,
+                         -qMin(count, XLSX_COLUMN_MAX - column + 1));
+}
+
+/*
+  Move the keys of \a map which are not less than \a index by \a count,
+  or drop them when they are deleted. Only the moved entries are
+  touched, and the values, e.g. the cells of a whole row, are moved
+  as they are.
+ */
+template <typename T>
+static void shiftKeys(QMap<int, T> &map, int index, int count, int limit)
+{
+    typename QMap<int, T>::iterator it = map.lowerBound(index);
+    if (it == map.end())
+        return;
+
+    const int end = count > 0 ? index : index - count;
+    QList<QPair<int, T>> moved;
+    while (it != map.end()) {
+        if (it.key() >= end && it.key() + count <= limit)
+            moved.append(qMakePair(it.key() + count, it.value()));
+        it = map.erase(it);
+    }
+    for (int i = 0; i < moved.size(); ++i)
+        map.insert(map.constEnd(), moved[i].first, moved[i].second);
+}
+
+template <typename T>
+static void shiftColumnKeys(QMap<int, QMap<int, T>> &table, int index, int count)
+{
+    typename QMap<int, QMap<int, T>>::iterator it = table.begin();
+    while (it != table.end()) {
+        if (it->lowerBound(index) != it->end()) {
+            shiftKeys(*it, index, count, XLSX_COLUMN_MAX);
+            if (it->isEmpty()) {
+                it = table.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
+}
+
+static CellRange shiftRange(const CellRange &range, Qt::Orientation orientation, int index,
+                            int count)
+{
+    const bool rows = orientation == Qt::Vertical;
+    int first = rows ? range.firstRow() : range.firstColumn();
+    int last = rows ? range.lastRow() : range.lastColumn();
+    if (!shiftIndexInterval(&first, &last, index, count))
+        return CellRange();
+    if (rows)
+        return CellRange(first, range.firstColumn(), qMin(last, XLSX_ROW_MAX), range.lastColumn());
+    return CellRange(range.firstRow(), first, range.lastRow(), qMin(last, XLSX_COLUMN_MAX));
+}
+
+static QList<CellRange> shiftRanges(const QList<CellRange> &ranges, Qt::Orientation orientation,
+                                    int index, int count)
+{
+    QList<CellRange> result;
+    foreach (const CellRange &range, ranges) {
+        const CellRange shifted = shiftRange(range, orientation, index, count);
+        if (shifted.isValid())
+            result.append(shifted);
+    }
+    return result;
+}
+
+/*
+  Insert (\a count > 0) or delete \a count rows or columns at \a index.
+ */
+bool WorksheetPrivate::shiftCells(Qt::Orientation orientation, int index, int count)
+{
+    Q_Q(Worksheet);
+    const bool rows = orientation == Qt::Vertical;
+
+    // Formulas are rewritten first, while shared formula groups can
+    // still be expanded at their current position.
+    shiftFormulas(name, orientation, index, count);
+    formulaEngine.clear();
+    if (workbook) {
+        foreach (QSharedPointer<AbstractSheet> sheet,
+                 workbook->getSheetsByTypes(AbstractSheet::ST_WorkSheet)) {
+            if (sheet.data() == q)
+                continue;
+            WorksheetPrivate *sheet_d = get(static_cast<Worksheet *>(sheet.data()));
+            if (sheet_d->shiftFormulas(name, orientation, index, count))
+                sheet_d->formulaEngine.clear();
+        }
+    }
+
+    if (rows) {
+        shiftKeys(cellTable, index, count, XLSX_ROW_MAX);
+        shiftKeys(comments, index, count, XLSX_ROW_MAX);
+        shiftKeys(urlTable, index, count, XLSX_ROW_MAX);
+        shiftKeys(rowsInfo, index, count, XLSX_ROW_MAX);
+    } else {
+        shiftColumnKeys(cellTable, index, count);
+        shiftColumnKeys(comments, index, count);
+        shiftColumnKeys(urlTable, index, count);
+
+        QMap<int, QSharedPointer<XlsxColumnInfo>> shiftedColsInfo;
+        colsInfoHelper.clear();
+        foreach (QSharedPointer<XlsxColumnInfo> info, colsInfo) {
+            int first = info->firstColumn;
+            int last = info->lastColumn;
+            if (!shiftIndexInterval(&first, &last, index, count) || first > XLSX_COLUMN_MAX)
+                continue;
+            info->firstColumn = first;
+            info->lastColumn = qMin(last, XLSX_COLUMN_MAX);
+            shiftedColsInfo.insert(first, info);
+            for (int c = info->firstColumn; c <= info->lastColumn; ++c)
+                colsInfoHelper[c] = info;
+        }
+        colsInfo = shiftedColsInfo;
+    }
+
+    QList<CellRange> shiftedMerges;
+    foreach (const CellRange &range, merges) {
+        const CellRange shifted = shiftRange(range, orientation, index, count);
+        if (shifted.isValid() && (shifted.rowCount() > 1 || shifted.columnCount() > 1))
+            shiftedMerges.append(shifted);
+    }
+    merges = shiftedMerges;
+
+    for (int i = dataValidationsList.size() - 1; i >= 0; --i) {
+        DataValidation &validation = dataValidationsList[i];
+        validation.d->ranges = shiftRanges(validation.ranges(), orientation, index, count);
+        if (validation.d->ranges.isEmpty())
+            dataValidationsList.removeAt(i);
+    }
+    for (int i = conditionalFormattingList.size() - 1; i >= 0; --i) {
+        ConditionalFormatting &cf = conditionalFormattingList[i];
+        cf.d->ranges = shiftRanges(cf.ranges(), orientation, index, count);
+        if (cf.d->ranges.isEmpty())
+            conditionalFormattingList.removeAt(i);
+    }
+
+    if (dimension.isValid())
+        dimension = shiftRange(dimension, orientation, index, count);
+    rowSpansValid = false;
+
+    return true;
+}
+
+/*
+  Returns \a formula with its references shifted as shiftFormulaReferences()
+  does. A formula of another sheet which doesn't mention \a sheetName, as
+  \a quotedName when it has quotes, is returned as it is without being
+  parsed.
+ */
+static QString shiftFormula(const QString &formula, Qt::Orientation orientation, int index,
+                            int count, const QString &sheetName, const QString &quotedName,
+                            bool homeSheet)
+{
+    if (formula.isEmpty() || (!homeSheet && !formula.contains(quotedName, Qt::CaseInsensitive)))
+        return formula;
+    return shiftFormulaReferences(formula, orientation, index, count, sheetName, homeSheet);
+}
+
+/*
+  Update the formulas of this sheet after \a count rows or columns have
+  been inserted, or deleted when negative, at \a index of the sheet
+  named \a sheetName, which may be this one. Returns true if any formula
+  has been changed, in which case the sheet is marked modified.
+ */
+bool WorksheetPrivate::shiftFormulas(const QString &sheetName, Qt::Orientation orientation,
+                                     int index, int count)
+{
+    Q_Q(Worksheet);
+    const bool homeSheet = sheetName == name;
+    const bool rows = orientation == Qt::Vertical;
+    const int end = count > 0 ? index : index - count;
+    QString quotedName = sheetName;
+    quotedName.replace(QLatin1String("'"), QLatin1String("''"));
+    bool changed = false;
+
+    // A shared formula stays shared only when all the cells of the group
+    // and all the cells they refer to are moved by the same amount,
+    // otherwise each cell of the group gets its own formula.
+    QList<int> unsharedGroups;
+    for (QMap<int, CellFormula>::const_iterator it = sharedFormulaMap.constBegin();
+         it != sharedFormulaMap.constEnd(); ++it) {
+        const CellRange group = it.value().reference();
+        if (!group.isValid())
+            continue;
+        if (!homeSheet && !it.value().formulaText().contains(quotedName, Qt::CaseInsensitive))
+            continue;
+        int minIndex = XLSX_ROW_MAX + 1;
+        int maxIndex = 0;
+        shiftFormulaReferences(it.value().formulaText(), orientation, index, count, sheetName,
+                               homeSheet, &minIndex, &maxIndex);
+        shiftFormulaReferences(
+            sharedFormulaTemplates.value(it.key()).expand(group.bottomRight()), orientation,
+            index, count, sheetName, homeSheet, &minIndex, &maxIndex);
+        if (homeSheet) {
+            minIndex = qMin(minIndex, rows ? group.firstRow() : group.firstColumn());
+            maxIndex = qMax(maxIndex, rows ? group.lastRow() : group.lastColumn());
+        }
+        if (maxIndex == 0 || maxIndex < index || minIndex >= end)
+            continue;
+        unsharedGroups.append(it.key());
+    }
+
+    foreach (int si, unsharedGroups) {
+        const CellRange group = sharedFormulaMap[si].reference();
+        const SharedFormulaTemplate formulaTemplate = sharedFormulaTemplates.value(si);
+        for (int row = group.firstRow(); row <= group.lastRow(); ++row) {
+            for (int col = group.firstColumn(); col <= group.lastColumn(); ++col) {
+                const Cell *current = q->cellAt(row, col);
+                if (!current || current->formula().formulaType() != CellFormula::SharedType
+                    || current->formula().sharedIndex() != si)
+                    continue;
+                Cell *cell = detachCell(row, col);
+                CellFormula formula(formulaTemplate.expand(CellReference(row, col)));
+                formula.d->ca = cell->d_ptr->formula.d->ca;
+                cell->d_ptr->formula = formula;
+            }
+        }
+        sharedFormulaMap.remove(si);
+        sharedFormulaTemplates.remove(si);
+        changed = true;
+    }
+
+    QList<QPair<CellReference, CellFormula>> shiftedFormulas;
+    typedef QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator RowIterator;
+    typedef QMap<int, QSharedPointer<Cell>>::const_iterator CellIterator;
+    for (RowIterator it = cellTable.constBegin(); it != cellTable.constEnd(); ++it) {
+        for (CellIterator cit = it->constBegin(); cit != it->constEnd(); ++cit) {
+            const Cell *cell = cit->data();
+            if (!cell->hasFormula())
+                continue;
+            // Cells of a shared formula follow the root cell
+            const CellFormula &formula = cell->d_ptr->formula;
+            if (formula.formulaText().isEmpty())
+                continue;
+
+            const QString text = shiftFormula(formula.formulaText(), orientation, index, count,
+                                              sheetName, quotedName, homeSheet);
+            CellRange reference = formula.reference();
+            if (homeSheet && reference.isValid())
+                reference = shiftRange(reference, orientation, index, count);
+            if (text == formula.formulaText() && reference == formula.reference())
+                continue;
+
+            CellFormula shifted(text, reference, formula.formulaType());
+            shifted.d->si = formula.d->si;
+            shifted.d->ca = formula.d->ca;
+            if (formula.formulaType() == CellFormula::SharedType)
+                addSharedFormula(shifted);
+            shiftedFormulas.append(qMakePair(CellReference(it.key(), cit.key()), shifted));
+        }
+    }
+
+    // Cells shared with copies of the sheet are detached once the
+    // iteration is done.
+    for (int i = 0; i < shiftedFormulas.size(); ++i) {
+        const CellReference &pos = shiftedFormulas[i].first;
+        detachCell(pos.row(), pos.column())->d_ptr->formula = shiftedFormulas[i].second;
+        changed = true;
+    }
+
+    // The formulas of data validations and conditional formats are relative
+    // to the first cell of their ranges, which are moved by shiftCells()
+    for (int i = 0; i < dataValidationsList.size(); ++i) {
+        const DataValidation &validation = dataValidationsList.at(i);
+        const QString formula1 = shiftFormula(validation.formula1(), orientation, index, count,
+                                              sheetName, quotedName, homeSheet);
+        const QString formula2 = shiftFormula(validation.formula2(), orientation, index, count,
+                                              sheetName, quotedName, homeSheet);
+        if (formula1 == validation.formula1() && formula2 == validation.formula2())
+            continue;
+        dataValidationsList[i].setFormula1(formula1);
+        dataValidationsList[i].setFormula2(formula2);
+        changed = true;
+    }
+    for (int i = 0; i < conditionalFormattingList.size(); ++i) {
+        const ConditionalFormatting &cf = conditionalFormattingList.at(i);
+        for (int j = 0; j < cf.d->cfRules.size(); ++j) {
+            const XlsxCfRuleData &rule = *cf.d->cfRules.at(j);
+            XlsxCfRuleData shifted(rule);
+            bool ruleChanged = false;
+            for (int attr = XlsxCfRuleData::A_formula1; attr <= XlsxCfRuleData::A_formula3;
+                 ++attr) {
+                if (!rule.attrs.contains(attr))
+                    continue;
+                const QString formula = rule.attrs[attr].toString();
+                const QString text = shiftFormula(formula, orientation, index, count, sheetName,
+                                                  quotedName, homeSheet);
+                if (text != formula) {
+                    shifted.attrs[attr] = text;
+                    ruleChanged = true;
+                }
+            }
+            for (int attr = XlsxCfRuleData::A_cfvo1; attr <= XlsxCfRuleData::A_cfvo3; ++attr) {
+                if (!rule.attrs.contains(attr))
+                    continue;
+                XlsxCfVoData cfvo = rule.attrs[attr].value<XlsxCfVoData>();
+                if (cfvo.type != ConditionalFormatting::VOT_Formula)
+                    continue;
+                const QString text = shiftFormula(cfvo.value, orientation, index, count,
+                                                  sheetName, quotedName, homeSheet);
+                if (text != cfvo.value) {
+                    cfvo.value = text;
+                    shifted.attrs[attr] = QVariant::fromValue(cfvo);
+                    ruleChanged = true;
+                }
+            }
+            if (!ruleChanged)
+                continue;
+            // The rules are shared with the copies of the sheet
+            conditionalFormattingList[i].d->cfRules[j] =
+                QSharedPointer<XlsxCfRuleData>(new XlsxCfRuleData(shifted));
+            changed = true;
+        }
+    }
+
+    // The xml kept for an incremental save no longer holds the formulas
+    if (changed)
+        q->setModified();
+    return changed;
+}
+
 /*!
     Return the range that contains cell data.
  */
@@ -1911,6 +2885,26 @@ CellRange Worksheet::dimension() const
     return d->dimension;
 }
 
+/*!
+    Recalculates the formulas of the worksheet whose precedents have
+    changed since the last recalculation, and stores their results as
+    the values of the formula cells.
+
+    Only the commonly used functions are supported, such as SUM(),
+    AVERAGE(), MIN(), MAX(), COUNT(), IF(), VLOOKUP(), INDEX(),
+    MATCH() and the basic text and date functions. Formulas using
+    other functions evaluate to the error \c{#NAME?}. Array formulas
+    keep the result they were written with.
+
+    \sa Workbook::setFormulaCalculationEnabled()
+ */
+void Worksheet::recalculate()
+{
+    Q_D(Worksheet);
+    if (d->recalculate())
+        setModified();
+}
+
 /*
  Convert the height of a cell from user's units to pixels. If the
  height hasn't been set by the user we use the default value. If
@@ -1953,14 +2947,39 @@ int WorksheetPrivate::colPixelsSize(int col) const
 void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
 {
     Q_Q(Worksheet);
+    XLSX_TRACE_SPAN_DETAIL("Worksheet::loadXmlSheetData", q->sheetName());
     Q_ASSERT(reader.name() == QLatin1String("sheetData"));
 
+    // The "r" attributes of rows and cells are optional, missing ones
+    // follow the previous row or cell.
+    int currentRow = 0;
+    int currentColumn = 0;
+
+    // A values only load keeps the formats of the dates and times only
+    const bool valuesOnly = workbook->d_func()->valuesOnlyLoad;
+
+    // The rows and cells out of the projection are skipped unread
+    const CellRange &range = workbook->d_func()->loadRange;
+    const QSet<int> &columns = workbook->d_func()->loadColumns;
+    const bool projected = range.isValid() || !columns.isEmpty();
+
     while (!reader.atEnd()
            && !(reader.name() == QLatin1String("sheetData")
                 && reader.tokenType() == QXmlStreamReader::EndElement)) {
         if (reader.readNextStartElement()) {
             if (reader.name() == QLatin1String("row")) {
                 QXmlStreamAttributes attributes = reader.attributes();
+                if (attributes.hasAttribute(QLatin1String("r")))
+                    currentRow = attributes.value(QLatin1String("r")).toString().toInt();
+                else
+                    ++currentRow;
+                currentColumn = 0;
+
+                if (range.isValid()
+                    && (currentRow < range.firstRow() || currentRow > range.lastRow())) {
+                    skipProjectedXml(reader);
+                    continue;
+                }
 
                 if (attributes.hasAttribute(QLatin1String("customFormat"))
                     || attributes.hasAttribute(QLatin1String("customHeight"))
@@ -1994,23 +3013,32 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                         info->outlineLevel =
                             attributes.value(QLatin1String("outlineLevel")).toString().toInt();
 
-                    //"r" is optional too.
-                    if (attributes.hasAttribute(QLatin1String("r"))) {
-                        int row = attributes.value(QLatin1String("r")).toString().toInt();
-                        rowsInfo[row] = info;
-                    }
+                    if (currentRow > 0 && currentRow <= XLSX_ROW_MAX)
+                        rowsInfo[currentRow] = info;
                 }
 
             } else if (reader.name() == QLatin1String("c")) { // Cell
                 QXmlStreamAttributes attributes = reader.attributes();
-                QString r = attributes.value(QLatin1String("r")).toString();
-                CellReference pos(r);
+                CellReference pos(attributes.value(QLatin1String("r")).toString());
+                if (!pos.isValid())
+                    pos = CellReference(currentRow, currentColumn + 1);
+                currentColumn = pos.column();
+
+                if ((range.isValid()
+                     && (currentColumn < range.firstColumn()
+                         || currentColumn > range.lastColumn()))
+                    || (!columns.isEmpty() && !columns.contains(currentColumn))) {
+                    skipProjectedXml(reader);
+                    continue;
+                }
 
                 // get format
                 Format format;
                 if (attributes.hasAttribute(QLatin1String("s"))) { //"s" == style index
                     int idx = attributes.value(QLatin1String("s")).toString().toInt();
-                    format = workbook->styles()->xfFormat(idx);
+                    if (!valuesOnly
+                        || NumFormatParser::isDateTimeKind(workbook->styles()->xfNumberKind(idx)))
+                        format = workbook->styles()->xfFormat(idx);
                     ////Empty format exists in styles xf table of real .xlsx files, see issue #65.
                     // if (!format.isValid())
                     //    qDebug()<<QStringLiteral("<c s=\"%1\">Invalid style index:
@@ -2034,7 +3062,7 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                         cellType = Cell::NumberType;
                 }
 
-                QSharedPointer<Cell> cell(new Cell(QVariant(), cellType, format, q));
+                QSharedPointer<Cell> cell = cellArena->createCell(QVariant(), cellType, format, q);
                 while (!reader.atEnd()
                        && !(reader.name() == QLatin1String("c")
                             && reader.tokenType() == QXmlStreamReader::EndElement)) {
@@ -2044,7 +3072,7 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                             formula.loadFromXml(reader);
                             if (formula.formulaType() == CellFormula::SharedType
                                 && !formula.formulaText().isEmpty()) {
-                                sharedFormulaMap[formula.sharedIndex()] = formula;
+                                addSharedFormula(formula);
                             }
                         } else if (reader.name() == QLatin1String("v")) {
                             QString value = reader.readElementText();
@@ -2053,6 +3081,7 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                                 sharedStrings()->incRefByStringIndex(sst_idx);
                                 RichString rs = sharedStrings()->getSharedString(sst_idx);
                                 cell->d_func()->value = rs.toPlainString();
+                                cell->d_func()->sharedStringIndex = sst_idx;
                                 if (rs.isRichString())
                                     cell->d_func()->richString = rs;
                             } else if (cellType == Cell::NumberType) {
@@ -2083,10 +3112,41 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                         }
                     }
                 }
-                cellTable[pos.row()][pos.column()] = cell;
+                if (pos.isValid())
+                    setCell(pos.row(), pos.column(), cell);
             }
         }
     }
+
+    // The dimension is the one of the cells loaded, see validateDimension()
+    if (projected)
+        dimension = CellRange();
+}
+
+/*
+  Skips the row or cell element the reader is at, which is out of the
+  projection of the load. The masters of the shared formulas are still
+  registered, as the loaded cells of their groups are generated from them.
+ */
+void WorksheetPrivate::skipProjectedXml(QXmlStreamReader &reader)
+{
+    int depth = 1;
+    while (depth > 0 && !reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::StartElement) {
+            if (reader.name() == QLatin1String("f")
+                && reader.attributes().value(QLatin1String("t")) == QLatin1String("shared")) {
+                CellFormula formula;
+                formula.loadFromXml(reader); // up to the end of the element
+                if (!formula.formulaText().isEmpty())
+                    addSharedFormula(formula);
+            } else {
+                ++depth;
+            }
+        } else if (token == QXmlStreamReader::EndElement) {
+            --depth;
+        }
+    }
 }
 
 void WorksheetPrivate::loadXmlColumnsInfo(QXmlStreamReader &reader)
@@ -2333,6 +3393,7 @@ QList<QSharedPointer<XlsxRowInfo>> WorksheetPrivate::getRowInfoList(int rowFirst
 bool Worksheet::loadFromXmlFile(QIODevice *device)
 {
     Q_D(Worksheet);
+    const bool valuesOnly = workbook()->d_func()->valuesOnlyLoad;
 
     QXmlStreamReader reader(device);
     while (!reader.atEnd()) {
@@ -2352,6 +3413,11 @@ bool Worksheet::loadFromXmlFile(QIODevice *device)
                 d->loadXmlSheetData(reader);
             } else if (reader.name() == QLatin1String("mergeCells")) {
                 d->loadXmlMergeCells(reader);
+            } else if (valuesOnly
+                       && (reader.name() == QLatin1String("dataValidations")
+                           || reader.name() == QLatin1String("conditionalFormatting")
+                           || reader.name() == QLatin1String("drawing"))) {
+                reader.skipCurrentElement();
             } else if (reader.name() == QLatin1String("dataValidations")) {
                 d->loadXmlDataValidations(reader);
             } else if (reader.name() == QLatin1String("conditionalFormatting")) {
@@ -2367,6 +3433,13 @@ bool Worksheet::loadFromXmlFile(QIODevice *device)
                     QDir::cleanPath(splitPath(filePath())[0] + QLatin1String("/") + name);
                 d->drawing = QSharedPointer<Drawing>(new Drawing(this, F_LoadFromExists));
                 d->drawing->setFilePath(path);
+            } else if (reader.name() == QLatin1String("legacyDrawing")) {
+                d->legacyDrawingId = reader.attributes().value(QLatin1String("r:id")).toString();
+            } else if (reader.name() == QLatin1String("legacyDrawingHF")) {
+                d->legacyDrawingHFId =
+                    reader.attributes().value(QLatin1String("r:id")).toString();
+            } else if (reader.name() == QLatin1String("tablePart")) {
+                d->tablePartIds.append(reader.attributes().value(QLatin1String("r:id")).toString());
             } else if (reader.name() == QLatin1String("extLst")) {
                 // Todo: add extLst support
                 while (!reader.atEnd()
@@ -2379,9 +3452,32 @@ bool Worksheet::loadFromXmlFile(QIODevice *device)
     }
 
     d->validateDimension();
+    d->loadPassthroughRelationships();
     return true;
 }
 
+/*
+  Keeps the relationships to the parts we do not model, so that they can be
+  saved along with the sheet, with targets valid from "xl/worksheets/".
+ */
+void WorksheetPrivate::loadPassthroughRelationships()
+{
+    const QString dir = splitPath(filePathInPackage)[0];
+    foreach (XlsxRelationship relationship, relationships->allRelationships()) {
+        if (relationship.type.endsWith(QLatin1String("/hyperlink"))
+            || relationship.type.endsWith(QLatin1String("/drawing"))) {
+            continue;
+        }
+        if (dir != QLatin1String("xl/worksheets")
+            && relationship.targetMode != QLatin1String("External")
+            && !relationship.target.startsWith(QLatin1Char('/'))) {
+            relationship.target =
+                QLatin1Char('/') + QDir::cleanPath(dir + QLatin1Char('/') + relationship.target);
+        }
+        passthroughRelationships.append(relationship);
+    }
+}
+
 /*
  *  Documents imported from Google Docs does not contain dimension data.
  */
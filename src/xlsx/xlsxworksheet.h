@@ -62,6 +62,8 @@ public:
     bool write(int row, int column, const QVariant &value, const Format &format = Format());
     QVariant read(const CellReference &row_column) const;
     QVariant read(int row, int column) const;
+    double readDouble(const CellReference &row_column, bool *ok = 0) const;
+    double readDouble(int row, int column, bool *ok = 0) const;
     bool writeString(const CellReference &row_column, const QString &value,
                      const Format &format = Format());
     bool writeString(int row, int column, const QString &value, const Format &format = Format());
@@ -86,6 +88,8 @@ public:
     bool writeDateTime(const CellReference &row_column, const QDateTime &dt,
                        const Format &format = Format());
     bool writeDateTime(int row, int column, const QDateTime &dt, const Format &format = Format());
+    bool writeDateTimes(const CellRange &range, const QList<QDateTime> &dts,
+                        const Format &format = Format());
     bool writeTime(const CellReference &row_column, const QTime &t,
                    const Format &format = Format());
     bool writeTime(int row, int column, const QTime &t, const Format &format = Format());
@@ -101,6 +105,8 @@ public:
 
     Cell *cellAt(const CellReference &row_column) const;
     Cell *cellAt(int row, int column) const;
+    QStringList displayTexts(const CellRange &range) const;
+    QList<QDateTime> readDateTimes(const CellRange &range) const;
 
     bool insertImage(int row, int column, const QImage &image);
     Chart *insertChart(int row, int column, const QSize &size);
@@ -130,7 +136,13 @@ public:
     bool groupRows(int rowFirst, int rowLast, bool collapsed = true);
     bool groupColumns(int colFirst, int colLast, bool collapsed = true);
     bool groupColumns(const CellRange &range, bool collapsed = true);
+
+    bool insertRows(int row, int count = 1);
+    bool deleteRows(int row, int count = 1);
+    bool insertColumns(int column, int count = 1);
+    bool deleteColumns(int column, int count = 1);
     CellRange dimension() const;
+    void recalculate();
 
     bool isWindowProtected() const;
     void setWindowProtected(bool protect);
@@ -161,6 +173,7 @@ private:
     friend class ::WorksheetTest;
     Worksheet(const QString &sheetName, int sheetId, Workbook *book, CreateFlag flag);
     Worksheet *copy(const QString &distName, int distId) const;
+    Worksheet *snapshot(Workbook *workbook) const;
 
     void saveToXmlFile(QIODevice *device) const;
     bool loadFromXmlFile(QIODevice *device);
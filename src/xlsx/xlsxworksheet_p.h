@@ -42,10 +42,12 @@
 #include "xlsxdatavalidation.h"
 #include "xlsxconditionalformatting.h"
 #include "xlsxcellformula.h"
+#include "xlsxutility_p.h"
 
 #include <QImage>
 #include <QSharedPointer>
 #include <QRegularExpression>
+#include <QVector>
 
 class QXmlStreamWriter;
 class QXmlStreamReader;
@@ -57,6 +59,9 @@ const int XLSX_COLUMN_MAX = 16384;
 const int XLSX_STRING_MAX = 32767;
 
 class SharedStrings;
+class FormulaEngine;
+class CellArena;
+struct FormulaValue;
 
 struct XlsxHyperlinkData
 {
@@ -154,45 +159,100 @@ struct XlsxColumnInfo
     bool collapsed;
 };
 
+/*
+  Default xf indexes of the columns and of the row being written, and the
+  text of the "s" attribute of each xf index, resolved once per save so
+  that choosing the style of a cell is a plain array access.
+ */
+struct XlsxCellStyleTable
+{
+    XlsxCellStyleTable()
+        : rowXfIndex(-1)
+    {
+    }
+
+    int columnXfIndex(int column) const
+    {
+        return column < columnXfIndexes.size() ? columnXfIndexes.at(column) : -1;
+    }
+
+    const QString &xfIndexText(int index)
+    {
+        if (index >= xfIndexTexts.size()) {
+            const int size = xfIndexTexts.size();
+            xfIndexTexts.resize(index + 1);
+            for (int i = size; i <= index; ++i)
+                xfIndexTexts[i] = QString::number(i);
+        }
+        return xfIndexTexts.at(index);
+    }
+
+    QVector<int> columnXfIndexes;
+    QVector<QString> xfIndexTexts;
+    int rowXfIndex;
+};
+
 class XLSX_AUTOTEST_EXPORT WorksheetPrivate : public AbstractSheetPrivate
 {
     Q_DECLARE_PUBLIC(Worksheet)
 public:
     WorksheetPrivate(Worksheet *p, Worksheet::CreateFlag flag);
     ~WorksheetPrivate();
+    static WorksheetPrivate *get(Worksheet *sheet) { return sheet->d_func(); }
+    static const WorksheetPrivate *get(const Worksheet *sheet) { return sheet->d_func(); }
     int checkDimensions(int row, int col, bool ignore_row = false, bool ignore_col = false);
     Format cellFormat(int row, int col) const;
     QString generateDimensionString() const;
+    void extendRowSpan(int row, int column);
     void calculateSpans() const;
     void splitColsInfo(int colFirst, int colLast);
     void validateDimension();
 
     void saveXmlSheetData(QXmlStreamWriter &writer) const;
     void saveXmlCellData(QXmlStreamWriter &writer, int row, int col,
-                         QSharedPointer<Cell> cell) const;
+                         const QSharedPointer<Cell> &cell, XlsxCellStyleTable &styles) const;
     void saveXmlMergeCells(QXmlStreamWriter &writer) const;
     void saveXmlHyperlinks(QXmlStreamWriter &writer) const;
     void saveXmlDrawings(QXmlStreamWriter &writer) const;
+    void saveXmlPassthroughParts(QXmlStreamWriter &writer) const;
     void saveXmlDataValidations(QXmlStreamWriter &writer) const;
     int rowPixelsSize(int row) const;
     int colPixelsSize(int col) const;
 
     void loadXmlSheetData(QXmlStreamReader &reader);
+    void skipProjectedXml(QXmlStreamReader &reader);
     void loadXmlColumnsInfo(QXmlStreamReader &reader);
     void loadXmlMergeCells(QXmlStreamReader &reader);
     void loadXmlDataValidations(QXmlStreamReader &reader);
     void loadXmlSheetFormatProps(QXmlStreamReader &reader);
     void loadXmlSheetViews(QXmlStreamReader &reader);
     void loadXmlHyperlinks(QXmlStreamReader &reader);
+    void loadPassthroughRelationships();
 
     QList<QSharedPointer<XlsxRowInfo>> getRowInfoList(int rowFirst, int rowLast);
     QList<QSharedPointer<XlsxColumnInfo>> getColumnInfoList(int colFirst, int colLast);
     QList<int> getColumnIndexes(int colFirst, int colLast);
     bool isColumnRangeValid(int colFirst, int colLast);
+    void addSharedFormula(const CellFormula &formula);
+    void setCell(int row, int column, const QSharedPointer<Cell> &cell);
+    void cellChanged(int row, int column);
+    Cell *detachCell(int row, int column);
+    void detachCell(QSharedPointer<Cell> &cell);
+    void reparentCells(const Worksheet *oldParent);
+    void adoptCells(QHash<QByteArray, Format> *formatCopies = 0);
+    static void ownFormat(Format &format, QHash<QByteArray, Format> *formatCopies);
+    void shareContents(WorksheetPrivate *sheet_d) const;
+    void markCellsShared() const;
+    bool setFormulaResult(int row, int column, const FormulaValue &result);
+    bool recalculate();
+    bool shiftCells(Qt::Orientation orientation, int index, int count);
+    bool shiftFormulas(const QString &sheetName, Qt::Orientation orientation, int index,
+                       int count);
 
     SharedStrings *sharedStrings() const;
 
     QMap<int, QMap<int, QSharedPointer<Cell>>> cellTable;
+    CellArena *cellArena; // which allocates the cells of the sheet
     QMap<int, QMap<int, QString>> comments;
     QMap<int, QMap<int, QSharedPointer<XlsxHyperlinkData>>> urlTable;
     QList<CellRange> merges;
@@ -202,12 +262,25 @@ public:
 
     QList<DataValidation> dataValidationsList;
     QList<ConditionalFormatting> conditionalFormattingList;
+
+    // Relationships to the parts we do not model, such as comments or
+    // tables, and the ids of those the sheet refers to, as loaded
+    QList<XlsxRelationship> passthroughRelationships;
+    QString legacyDrawingId;
+    QString legacyDrawingHFId;
+    QStringList tablePartIds;
     QMap<int, CellFormula> sharedFormulaMap;
+    QMap<int, SharedFormulaTemplate> sharedFormulaTemplates;
+    QSharedPointer<FormulaEngine> formulaEngine;
+    // Set on the sheets of a template, which are shared but never modified
+    bool frozen;
 
     CellRange dimension;
     int previous_row;
 
-    mutable QMap<int, QString> row_spans;
+    // First and last column used by each band of 16 rows
+    mutable QMap<int, QPair<int, int>> rowSpans;
+    mutable bool rowSpansValid;
     QMap<int, double> row_sizes;
     QMap<int, double> col_sizes;
 
@@ -24,20 +24,55 @@
 ****************************************************************************/
 
 #include "xlsxzipreader_p.h"
+#include "xlsxtrace_p.h"
 
 #include <private/qzipreader_p.h>
 #include <QtCore/qvector.h>
+#include <QFile>
+#include <QtEndian>
 
 namespace QXlsx {
 
+/*
+  The entries are inflated by QZipReader. The central directory is also
+  read here, to find where the stored data of each entry is, as
+  QZipReader doesn't give it: entry() returns that data as it is, for
+  ZipWriter::addEntry() to copy an unmodified part.
+ */
+
+enum {
+    LocalHeaderSignature = 0x04034b50,
+    CentralHeaderSignature = 0x02014b50,
+    EndOfDirectorySignature = 0x06054b50,
+    LocalHeaderSize = 30,
+    CentralHeaderSize = 46,
+    EndOfDirectorySize = 22,
+    EncryptedFlag = 0x0001,
+    Utf8NamesFlag = 0x0800
+};
+
+static quint16 readUShort(const char *data)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data));
+}
+
+static quint32 readUInt(const char *data)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data));
+}
+
 ZipReader::ZipReader(const QString &filePath)
-    : m_reader(new QZipReader(filePath))
+    : m_file(new QFile(filePath))
+    , m_device(m_file.data())
 {
+    m_file->open(QIODevice::ReadOnly);
+    m_reader.reset(new QZipReader(m_device));
     init();
 }
 
 ZipReader::ZipReader(QIODevice *device)
-    : m_reader(new QZipReader(device))
+    : m_device(device)
+    , m_reader(new QZipReader(device))
 {
     init();
 }
@@ -48,11 +83,72 @@ ZipReader::~ZipReader()
 
 void ZipReader::init()
 {
+    XLSX_TRACE_SPAN("ZipReader::init");
     auto allFiles = m_reader->fileInfoList();
     foreach (const QZipReader::FileInfo &fi, allFiles) {
         if (fi.isFile)
             m_filePaths.append(fi.filePath);
     }
+    readCentralDirectory();
+}
+
+/*
+  Finds the end of central directory record at the end of the package,
+  which may be followed by a comment, and lists the entries.
+ */
+void ZipReader::readCentralDirectory()
+{
+    if (!m_device->isOpen() || m_device->isSequential())
+        return;
+
+    const qint64 size = m_device->size();
+    const qint64 tailSize = qMin<qint64>(size, EndOfDirectorySize + 0xffff);
+    if (tailSize < EndOfDirectorySize || !m_device->seek(size - tailSize))
+        return;
+    const QByteArray tail = m_device->read(tailSize);
+    int end = tail.size() - EndOfDirectorySize;
+    while (end >= 0 && readUInt(tail.constData() + end) != EndOfDirectorySignature)
+        --end;
+    if (end < 0)
+        return;
+
+    const int entryCount = readUShort(tail.constData() + end + 10);
+    const quint32 directorySize = readUInt(tail.constData() + end + 12);
+    const quint32 directoryOffset = readUInt(tail.constData() + end + 16);
+    if (!m_device->seek(directoryOffset))
+        return;
+    const QByteArray directory = m_device->read(directorySize);
+
+    int pos = 0;
+    for (int i = 0; i < entryCount; ++i) {
+        if (pos + CentralHeaderSize > directory.size())
+            break;
+        const char *header = directory.constData() + pos;
+        if (readUInt(header) != CentralHeaderSignature)
+            break;
+        const int nameLength = readUShort(header + 28);
+        const int extraLength = readUShort(header + 30);
+        const int commentLength = readUShort(header + 32);
+        if (pos + CentralHeaderSize + nameLength > directory.size())
+            break;
+
+        EntryInfo info;
+        info.flags = readUShort(header + 8);
+        info.compressionMethod = readUShort(header + 10);
+        info.dosTime = readUInt(header + 12);
+        info.crc32 = readUInt(header + 16);
+        info.compressedSize = readUInt(header + 20);
+        info.uncompressedSize = readUInt(header + 24);
+        info.localHeaderOffset = readUInt(header + 42);
+
+        // Decoded like QZipReader does, so that the paths match
+        const char *name = header + CentralHeaderSize;
+        const QString path = info.flags & Utf8NamesFlag
+                                 ? QString::fromUtf8(name, nameLength)
+                                 : QString::fromLocal8Bit(name, nameLength);
+        m_entries.insert(path, info);
+        pos += CentralHeaderSize + nameLength + extraLength + commentLength;
+    }
 }
 
 bool ZipReader::exists() const
@@ -67,7 +163,46 @@ QStringList ZipReader::filePaths() const
 
 QByteArray ZipReader::fileData(const QString &fileName) const
 {
+    XLSX_TRACE_SPAN_DETAIL("ZipReader::fileData", fileName);
     return m_reader->fileData(fileName);
 }
 
+/*
+  Returns the entry \a fileName as it is stored, without inflating it, or
+  an invalid entry if it can't be copied as it is, such as an encrypted one.
+ */
+ZipEntry ZipReader::entry(const QString &fileName) const
+{
+    XLSX_TRACE_SPAN_DETAIL("ZipReader::entry", fileName);
+    ZipEntry entry;
+    QHash<QString, EntryInfo>::const_iterator it = m_entries.constFind(fileName);
+    if (it == m_entries.constEnd() || it->flags & EncryptedFlag)
+        return entry;
+    if (it->compressionMethod != 0 && it->compressionMethod != 8)
+        return entry;
+
+    // The sizes of the local header may be left out, in favor of a data
+    // descriptor, so those of the central directory are used
+    if (!m_device->seek(it->localHeaderOffset))
+        return entry;
+    const QByteArray header = m_device->read(LocalHeaderSize);
+    if (header.size() != LocalHeaderSize || readUInt(header.constData()) != LocalHeaderSignature)
+        return entry;
+    const qint64 dataOffset = qint64(it->localHeaderOffset) + LocalHeaderSize
+                              + readUShort(header.constData() + 26)
+                              + readUShort(header.constData() + 28);
+    if (!m_device->seek(dataOffset))
+        return entry;
+    entry.data = m_device->read(it->compressedSize);
+    if (entry.data.size() != int(it->compressedSize))
+        return ZipEntry();
+
+    entry.valid = true;
+    entry.compressionMethod = it->compressionMethod;
+    entry.crc32 = it->crc32;
+    entry.uncompressedSize = it->uncompressedSize;
+    entry.dosTime = it->dosTime;
+    return entry;
+}
+
 } // namespace QXlsx
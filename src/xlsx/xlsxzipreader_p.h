@@ -38,13 +38,40 @@
 //
 
 #include "xlsxglobal.h"
+#include <QHash>
 #include <QScopedPointer>
 #include <QStringList>
 class QZipReader;
 class QIODevice;
+class QFile;
 
 namespace QXlsx {
 
+/*
+  An entry of a zip package as it is stored, which can be written to another
+  package without being inflated and deflated again.
+ */
+struct ZipEntry
+{
+    ZipEntry()
+        : valid(false)
+        , compressionMethod(0)
+        , crc32(0)
+        , uncompressedSize(0)
+        , dosTime(0)
+    {
+    }
+
+    bool isValid() const { return valid; }
+
+    bool valid;
+    QByteArray data; // stored or deflated
+    quint16 compressionMethod; // 0 when stored, 8 when deflated
+    quint32 crc32; // of the uncompressed data
+    quint32 uncompressedSize;
+    quint32 dosTime; // of the last modification, the date in the high word
+};
+
 class XLSX_AUTOTEST_EXPORT ZipReader
 {
 public:
@@ -54,12 +81,30 @@ public:
     bool exists() const;
     QStringList filePaths() const;
     QByteArray fileData(const QString &fileName) const;
+    ZipEntry entry(const QString &fileName) const;
 
 private:
     Q_DISABLE_COPY(ZipReader)
     void init();
+    void readCentralDirectory();
+
+    // Where an entry is, as listed by the central directory
+    struct EntryInfo
+    {
+        quint32 localHeaderOffset;
+        quint32 compressedSize;
+        quint32 uncompressedSize;
+        quint32 crc32;
+        quint32 dosTime;
+        quint16 compressionMethod;
+        quint16 flags;
+    };
+
+    QScopedPointer<QFile> m_file; // when opened by path
+    QIODevice *m_device;
     QScopedPointer<QZipReader> m_reader;
     QStringList m_filePaths;
+    QHash<QString, EntryInfo> m_entries;
 };
 
 } // namespace QXlsx
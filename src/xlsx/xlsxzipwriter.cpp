@@ -23,46 +23,234 @@
 **
 ****************************************************************************/
 #include "xlsxzipwriter_p.h"
-#include <QDebug>
-#include <private/qzipwriter_p.h>
+#include "xlsxtrace_p.h"
+#include <QDateTime>
+#include <QFile>
+#include <QtEndian>
+
+#include <string.h>
 
 namespace QXlsx {
 
+/*
+  Writes the zip package itself rather than through QZipWriter, so that an
+  entry read by ZipReader::entry() can be copied as it is stored, without
+  being inflated and deflated again. The entries are written one after
+  the other, and the central directory once the package is closed.
+ */
+
+enum {
+    LocalHeaderSignature = 0x04034b50,
+    CentralHeaderSignature = 0x02014b50,
+    EndOfDirectorySignature = 0x06054b50,
+    LocalHeaderSize = 30,
+    CentralHeaderSize = 46,
+    EndOfDirectorySize = 22,
+    VersionNeeded = 20, // deflate
+    Utf8NamesFlag = 0x0800,
+    Stored = 0,
+    Deflated = 8
+};
+
+static void writeUShort(char *data, quint16 value)
+{
+    qToLittleEndian<quint16>(value, reinterpret_cast<uchar *>(data));
+}
+
+static void writeUInt(char *data, quint32 value)
+{
+    qToLittleEndian<quint32>(value, reinterpret_cast<uchar *>(data));
+}
+
+namespace {
+
+struct Crc32Table
+{
+    Crc32Table()
+    {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = crc & 1 ? 0xedb88320 ^ (crc >> 1) : crc >> 1;
+            values[i] = crc;
+        }
+    }
+
+    quint32 values[256];
+};
+
+} // namespace
+
+static quint32 crc32(const QByteArray &data)
+{
+    static const Crc32Table table;
+    quint32 crc = 0xffffffff;
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    for (const uchar *end = p + data.size(); p != end; ++p)
+        crc = table.values[(crc ^ *p) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffff;
+}
+
+/*
+  Returns the raw deflate stream of \a data. qCompress() wraps it in the
+  size of the data, a zlib header and an Adler-32 checksum.
+ */
+static QByteArray deflate(const QByteArray &data)
+{
+    QByteArray compressed = qCompress(data);
+    if (compressed.size() < 10)
+        return QByteArray();
+    compressed.chop(4);
+    compressed.remove(0, 6);
+    return compressed;
+}
+
+static quint32 currentDosTime()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDate date = now.date();
+    const QTime time = now.time();
+    const quint32 dosDate =
+        (qMax(date.year() - 1980, 0) << 9) | (date.month() << 5) | date.day();
+    const quint32 dosTime = (time.hour() << 11) | (time.minute() << 5) | (time.second() / 2);
+    return (dosDate << 16) | dosTime;
+}
+
 ZipWriter::ZipWriter(const QString &filePath)
+    : m_file(new QFile(filePath))
+    , m_device(m_file.data())
 {
-    m_writer = new QZipWriter(filePath, QIODevice::WriteOnly);
-    m_writer->setCompressionPolicy(QZipWriter::AutoCompress);
+    m_file->open(QIODevice::WriteOnly);
+    init();
 }
 
 ZipWriter::ZipWriter(QIODevice *device)
+    : m_device(device)
 {
-    m_writer = new QZipWriter(device);
-    m_writer->setCompressionPolicy(QZipWriter::AutoCompress);
+    init();
 }
 
 ZipWriter::~ZipWriter()
 {
-    delete m_writer;
+    close();
+}
+
+void ZipWriter::init()
+{
+    m_offset = m_device->isSequential() ? 0 : m_device->pos();
+    m_dosTime = currentDosTime();
+    m_error = !m_device->isWritable();
+    m_closed = false;
 }
 
 bool ZipWriter::error() const
 {
-    return m_writer->status() != QZipWriter::NoError;
+    return m_error;
+}
+
+void ZipWriter::writeData(const QByteArray &data)
+{
+    if (m_device->write(data) != data.size())
+        m_error = true;
+    m_offset += data.size();
+}
+
+ZipEntry ZipWriter::addFile(const QString &filePath, QIODevice *device)
+{
+    return addFile(filePath, device->readAll());
 }
 
-void ZipWriter::addFile(const QString &filePath, QIODevice *device)
+/*
+  Adds the \a data as the entry \a filePath, deflated unless that doesn't
+  make it smaller. Returns the entry as it is stored, to be added again
+  by addEntry() to a later package.
+ */
+ZipEntry ZipWriter::addFile(const QString &filePath, const QByteArray &data)
 {
-    m_writer->addFile(filePath, device);
+    XLSX_TRACE_SPAN_DETAIL("ZipWriter::addFile", filePath);
+    ZipEntry entry;
+    entry.valid = true;
+    entry.data = deflate(data);
+    entry.compressionMethod = Deflated;
+    if (entry.data.isNull() || entry.data.size() >= data.size()) {
+        entry.data = data;
+        entry.compressionMethod = Stored;
+    }
+    entry.crc32 = crc32(data);
+    entry.uncompressedSize = data.size();
+    entry.dosTime = m_dosTime;
+    addEntry(filePath, entry);
+    return entry;
+}
+
+/*
+  Adds the \a entry, as stored by another package, as \a filePath.
+ */
+void ZipWriter::addEntry(const QString &filePath, const ZipEntry &entry)
+{
+    XLSX_TRACE_SPAN_DETAIL("ZipWriter::addEntry", filePath);
+    Q_ASSERT(entry.isValid() && !m_closed);
+    const QByteArray name = filePath.toUtf8();
+
+    QByteArray header(LocalHeaderSize, '\0');
+    char *h = header.data();
+    writeUInt(h, LocalHeaderSignature);
+    writeUShort(h + 4, VersionNeeded);
+    writeUShort(h + 6, Utf8NamesFlag);
+    writeUShort(h + 8, entry.compressionMethod);
+    writeUInt(h + 10, entry.dosTime);
+    writeUInt(h + 14, entry.crc32);
+    writeUInt(h + 18, entry.data.size());
+    writeUInt(h + 22, entry.uncompressedSize);
+    writeUShort(h + 26, name.size());
+    writeUShort(h + 28, 0);
+
+    QByteArray central(CentralHeaderSize, '\0');
+    char *c = central.data();
+    writeUInt(c, CentralHeaderSignature);
+    writeUShort(c + 4, VersionNeeded);
+    memcpy(c + 6, h + 4, 26); // from the version needed to the name length
+    writeUInt(c + 42, quint32(m_offset));
+    m_centralDirectory += central;
+    m_centralDirectory += name;
+
+    writeData(header + name);
+    writeData(entry.data);
+    m_filePaths.append(filePath);
 }
 
-void ZipWriter::addFile(const QString &filePath, const QByteArray &data)
+QStringList ZipWriter::filePaths() const
 {
-    m_writer->addFile(filePath, data);
+    return m_filePaths;
 }
 
+/*
+  Writes the central directory, and closes the file opened by path.
+ */
 void ZipWriter::close()
 {
-    m_writer->close();
+    if (m_closed)
+        return;
+    XLSX_TRACE_SPAN("ZipWriter::close");
+    m_closed = true;
+    if (!m_error)
+        writeEndOfDirectory();
+    if (m_file)
+        m_file->close();
+}
+
+void ZipWriter::writeEndOfDirectory()
+{
+    QByteArray end(EndOfDirectorySize, '\0');
+    char *e = end.data();
+    writeUInt(e, EndOfDirectorySignature);
+    writeUShort(e + 8, m_filePaths.size());
+    writeUShort(e + 10, m_filePaths.size());
+    writeUInt(e + 12, m_centralDirectory.size());
+    writeUInt(e + 16, quint32(m_offset));
+    writeData(m_centralDirectory);
+    writeData(end);
+    m_centralDirectory.clear();
 }
 
 } // namespace QXlsx
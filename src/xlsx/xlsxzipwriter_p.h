@@ -36,26 +36,44 @@
 // We mean it.
 //
 
+#include "xlsxglobal.h"
+#include "xlsxzipreader_p.h"
+#include <QScopedPointer>
 #include <QString>
+#include <QStringList>
 class QIODevice;
-class QZipWriter;
+class QFile;
 
 namespace QXlsx {
 
-class ZipWriter
+class XLSX_AUTOTEST_EXPORT ZipWriter
 {
 public:
     explicit ZipWriter(const QString &filePath);
     explicit ZipWriter(QIODevice *device);
     ~ZipWriter();
 
-    void addFile(const QString &filePath, QIODevice *device);
-    void addFile(const QString &filePath, const QByteArray &data);
+    ZipEntry addFile(const QString &filePath, QIODevice *device);
+    ZipEntry addFile(const QString &filePath, const QByteArray &data);
+    void addEntry(const QString &filePath, const ZipEntry &entry);
+    QStringList filePaths() const;
     bool error() const;
     void close();
 
 private:
-    QZipWriter *m_writer;
+    Q_DISABLE_COPY(ZipWriter)
+    void init();
+    void writeData(const QByteArray &data);
+    void writeEndOfDirectory();
+
+    QScopedPointer<QFile> m_file; // when opened by path
+    QIODevice *m_device;
+    QStringList m_filePaths;
+    QByteArray m_centralDirectory;
+    qint64 m_offset; // of the next entry in the device
+    quint32 m_dosTime; // of the entries added by addFile()
+    bool m_error;
+    bool m_closed;
 };
 
 } // namespace QXlsx
@@ -7,10 +7,17 @@ SUBDIRS=\
     propscore \
     propsapp \
     document \
+    documenttemplate \
     sharedstrings \
     styles \
     format \
     richstring \
     xlsxconditionalformatting \
     cellreference \
+    celliterator \
+    formulaengine \
+    numformatrenderer \
     cmake
+
+#The trace test needs a library built with CONFIG+=xlsx_trace
+xlsx_trace:SUBDIRS += trace
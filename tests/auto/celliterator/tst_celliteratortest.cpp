@@ -0,0 +1,183 @@
+#include "xlsxcelliterator.h"
+#include "xlsxworksheet.h"
+#include "xlsxcellrange.h"
+#include "xlsxcellreference.h"
+#include "xlsxformat.h"
+#include <QString>
+#include <QtTest>
+
+using namespace QXlsx;
+
+class CellIteratorTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    CellIteratorTest();
+
+private Q_SLOTS:
+    void testRowMajor();
+    void testColumnMajor();
+    void testRange();
+    void testEmpty();
+    void testRowCursor();
+    void testSnapshot();
+
+private:
+    static QStringList visit(CellIterator &it);
+};
+
+CellIteratorTest::CellIteratorTest()
+{
+}
+
+QStringList CellIteratorTest::visit(CellIterator &it)
+{
+    QStringList cells;
+    while (it.next())
+        cells.append(CellReference(it.row(), it.column()).toString() + "=" + it.value().toString());
+    return cells;
+}
+
+void CellIteratorTest::testRowMajor()
+{
+    Worksheet sheet("", 1, 0, Worksheet::F_NewFromScratch);
+    sheet.write("C1", 3);
+    sheet.write("A1", 1);
+    sheet.write("B3", "b3");
+    sheet.write("A10000", 10000);
+
+    CellIterator it(&sheet);
+    QCOMPARE(visit(it), QStringList() << "A1=1"
+                                      << "C1=3"
+                                      << "B3=b3"
+                                      << "A10000=10000");
+    QVERIFY(!it.cell());
+    QVERIFY(!it.next());
+
+    it.toFront();
+    QVERIFY(it.next());
+    QCOMPARE(it.row(), 1);
+    QCOMPARE(it.column(), 1);
+    QCOMPARE(it.cell(), sheet.cellAt("A1"));
+    QCOMPARE(it.cellType(), Cell::NumberType);
+}
+
+void CellIteratorTest::testColumnMajor()
+{
+    Worksheet sheet("", 1, 0, Worksheet::F_NewFromScratch);
+    sheet.write("C1", 3);
+    sheet.write("A1", 1);
+    sheet.write("B3", "b3");
+    sheet.write("A10000", 10000);
+
+    CellIterator it(&sheet, CellIterator::ColumnMajor);
+    QCOMPARE(visit(it), QStringList() << "A1=1"
+                                      << "A10000=10000"
+                                      << "B3=b3"
+                                      << "C1=3");
+    QVERIFY(!it.next());
+    it.toFront();
+    QVERIFY(it.next());
+    QCOMPARE(it.row(), 1);
+    QCOMPARE(it.column(), 1);
+}
+
+void CellIteratorTest::testRange()
+{
+    Worksheet sheet("", 1, 0, Worksheet::F_NewFromScratch);
+    for (int row = 1; row <= 5; ++row) {
+        for (int col = 1; col <= 5; ++col)
+            sheet.write(row, col, row * 10 + col);
+    }
+
+    CellIterator it(&sheet, CellRange("B2:C3"));
+    QCOMPARE(visit(it), QStringList() << "B2=22"
+                                      << "C2=23"
+                                      << "B3=32"
+                                      << "C3=33");
+
+    CellIterator columns(&sheet, CellRange("D4:E5"), CellIterator::ColumnMajor);
+    QCOMPARE(visit(columns), QStringList() << "D4=44"
+                                           << "D5=54"
+                                           << "E4=45"
+                                           << "E5=55");
+}
+
+void CellIteratorTest::testEmpty()
+{
+    Worksheet sheet("", 1, 0, Worksheet::F_NewFromScratch);
+    CellIterator it(&sheet);
+    QVERIFY(!it.next());
+    QCOMPARE(it.row(), 0);
+    QVERIFY(!it.value().isValid());
+
+    sheet.write("A1", 1);
+    CellIterator outside(&sheet, CellRange("B2:C3"));
+    QVERIFY(!outside.next());
+
+    RowCursor cursor(&sheet, CellRange("B1:C3"));
+    QVERIFY(!cursor.nextRow());
+    QVERIFY(!cursor.next());
+}
+
+void CellIteratorTest::testRowCursor()
+{
+    Worksheet sheet("", 1, 0, Worksheet::F_NewFromScratch);
+    sheet.write("A1", 1);
+    sheet.write("C1", 3);
+    sheet.write("D2", 4);
+    sheet.write("B5", 5);
+    sheet.write("C5", 6);
+
+    RowCursor cursor(&sheet, CellRange("B1:D5"));
+    QStringList rows;
+    while (cursor.nextRow()) {
+        QStringList cells;
+        while (cursor.next())
+            cells.append(cursor.value().toString());
+        QVERIFY(!cursor.next());
+        rows.append(QString::number(cursor.row()) + ":" + cells.join(","));
+    }
+    QCOMPARE(rows, QStringList() << "1:3"
+                                 << "2:4"
+                                 << "5:5,6");
+    QVERIFY(!cursor.nextRow());
+
+    // Rows may be left before their last cell
+    RowCursor firsts(&sheet);
+    QStringList firstCells;
+    while (firsts.nextRow() && firsts.next())
+        firstCells.append(CellReference(firsts.row(), firsts.column()).toString());
+    QCOMPARE(firstCells, QStringList() << "A1"
+                                       << "D2"
+                                       << "B5");
+}
+
+void CellIteratorTest::testSnapshot()
+{
+    Worksheet sheet("", 1, 0, Worksheet::F_NewFromScratch);
+    sheet.write("A1", 1);
+    sheet.write("A2", 2);
+
+    CellIterator it(&sheet);
+    sheet.write("A3", 3);
+    sheet.write("A1", "changed");
+    QCOMPARE(visit(it), QStringList() << "A1=1"
+                                      << "A2=2");
+
+    // Cells modified in place by the sheet are copied first
+    Format format;
+    format.setFontBold(true);
+    QVERIFY(sheet.mergeCells("A2:B2", format));
+    QCOMPARE(sheet.cellAt("A2")->format(), format);
+    it.toFront();
+    QVERIFY(it.next());
+    QVERIFY(it.next());
+    QCOMPARE(it.row(), 2);
+    QVERIFY(!it.cell()->format().isValid());
+}
+
+QTEST_APPLESS_MAIN(CellIteratorTest)
+
+#include "tst_celliteratortest.moc"
@@ -1,7 +1,10 @@
-QT       += testlib xlsx # xlsx-private
+QT       += testlib xlsx xlsx-private
 CONFIG += testcase
 DEFINES += XLSX_TEST
 
+#testConcurrentRead is meant to be run with ThreadSanitizer, see src/xlsx/xlsx.pro.
+xlsx_tsan:CONFIG += sanitizer sanitize_thread
+
 TARGET = tst_document
 CONFIG   += console
 CONFIG   -= app_bundle
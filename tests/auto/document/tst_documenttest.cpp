@@ -2,7 +2,17 @@
 #include "xlsxcell.h"
 #include "xlsxformat.h"
 #include "xlsxcellformula.h"
+#include "xlsxcellrange.h"
+#include "xlsxrichstring.h"
+#include "xlsxdatavalidation.h"
+#include "xlsxconditionalformatting.h"
+#include "xlsxworkbook.h"
+#include "xlsxworksheet.h"
+#include "xlsxcelliterator.h"
+#include "private/xlsxzipreader_p.h"
+#include "private/xlsxzipwriter_p.h"
 #include <QString>
+#include <QThread>
 #include <QtTest>
 
 QTXLSX_USE_NAMESPACE
@@ -28,6 +38,17 @@ private Q_SLOTS:
     void testMoveWorksheet();
     void testDeleteWorksheet();
     void testCopyWorksheet();
+    void testCopyWorksheetIsIndependent();
+
+    void testStatistics();
+    void testSaveAsync();
+    void testLoadAsync();
+    void testIncrementalSave();
+    void testIncrementalSaveShiftedFormulas();
+    void testPassthroughParts();
+    void testValuesOnlyLoad();
+    void testLoadRange();
+    void testConcurrentRead();
 };
 
 DocumentTest::DocumentTest()
@@ -342,6 +363,39 @@ void DocumentTest::testCopyWorksheet()
     QCOMPARE(xlsx1.read("A3").toBool(), true);
 }
 
+void DocumentTest::testCopyWorksheetIsIndependent()
+{
+    Document xlsx1;
+    xlsx1.write("A1", 1);
+    xlsx1.write("A2", 2);
+    xlsx1.write("B1", "=A1+A2");
+    xlsx1.write("C1", QDate(2014, 6, 1));
+    xlsx1.setColumnWidth(1, 20.0);
+    xlsx1.copySheet("Sheet1", "Copy");
+
+    xlsx1.write("A1", 10);
+    Format format;
+    format.setFontBold(true);
+    xlsx1.mergeCells("A2:B2", format);
+    xlsx1.setColumnWidth(1, 30.0);
+
+    xlsx1.selectSheet("Copy");
+    QCOMPARE(xlsx1.read("A1").toInt(), 1);
+    QVERIFY(!xlsx1.cellAt("A2")->format().fontBold());
+    QCOMPARE(xlsx1.cellAt("B1")->formula().formulaText(), QString("A1+A2"));
+    QCOMPARE(xlsx1.columnWidth(1), 20.0);
+
+    xlsx1.write("A2", 5);
+    xlsx1.selectSheet("Sheet1");
+    QCOMPARE(xlsx1.read("A2").toInt(), 2);
+    QVERIFY(xlsx1.cellAt("A2")->format().fontBold());
+
+    // The cells shared with the deleted sheet are still valid
+    xlsx1.deleteSheet("Sheet1");
+    xlsx1.selectSheet("Copy");
+    QCOMPARE(xlsx1.read("C1").toDate(), QDate(2014, 6, 1));
+}
+
 void DocumentTest::testDeleteWorksheet()
 {
     Document xlsx1;
@@ -360,6 +414,607 @@ void DocumentTest::testDeleteWorksheet()
     QCOMPARE(xlsx1.sheetNames(), QStringList()<<"Sheet3");
 }
 
+void DocumentTest::testStatistics()
+{
+    Document xlsx1;
+    QVERIFY(!xlsx1.isStatisticsEnabled());
+    QVERIFY(!xlsx1.statistics().isValid());
+    for (int row = 1; row <= 100; ++row) {
+        xlsx1.write(row, 1, row);
+        xlsx1.write(row, 2, QString("Item %1").arg(row % 10));
+    }
+
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+    xlsx1.saveAs(&device);
+    QVERIFY(!xlsx1.statistics().isValid());
+
+    xlsx1.setStatisticsEnabled(true);
+    device.close();
+    device.setData(QByteArray());
+    device.open(QIODevice::WriteOnly);
+    xlsx1.saveAs(&device);
+
+    DocumentStatistics saved = xlsx1.statistics();
+    QCOMPARE(saved.operation(), DocumentStatistics::SaveOperation);
+    QCOMPARE(saved.cellCount(), qint64(200));
+    QCOMPARE(saved.stringCount(), 10);
+    QCOMPARE(saved.stringReferenceCount(), 100);
+    QCOMPARE(saved.packageSize(), qint64(device.data().size()));
+    DocumentStatistics::Part sheet = saved.part("xl/worksheets/sheet1.xml");
+    QCOMPARE(sheet.path, QString("xl/worksheets/sheet1.xml"));
+    QVERIFY(sheet.uncompressedSize > 0);
+    QVERIFY(sheet.compressedSize > 0);
+    QVERIFY(sheet.compressionRatio() > 1);
+    QVERIFY(!saved.part("xl/sharedStrings.xml").path.isEmpty());
+    QVERIFY(!saved.part("[Content_Types].xml").path.isEmpty());
+    QVERIFY(saved.largestPartSize() >= sheet.uncompressedSize);
+    QVERIFY(saved.wallTime() >= saved.zipWallTime());
+
+    QJsonObject json = QJsonDocument::fromJson(saved.toJson()).object();
+    QCOMPARE(json.value("operation").toString(), QString("save"));
+    QCOMPARE(json.value("cellCount").toDouble(), 200.0);
+    QCOMPARE(json.value("parts").toArray().size(), saved.parts().size());
+
+    device.close();
+    device.open(QIODevice::ReadOnly);
+    Document xlsx2(&device);
+    QVERIFY(!xlsx2.statistics().isValid());
+    device.close();
+
+    device.open(QIODevice::ReadOnly);
+    xlsx2.setStatisticsEnabled(true);
+    QVERIFY(xlsx2.load(&device));
+    DocumentStatistics loaded = xlsx2.statistics();
+    QCOMPARE(loaded.operation(), DocumentStatistics::LoadOperation);
+    QCOMPARE(loaded.cellCount(), qint64(200));
+    QCOMPARE(loaded.stringCount(), 10);
+    QCOMPARE(loaded.part("xl/worksheets/sheet1.xml").uncompressedSize, sheet.uncompressedSize);
+    QCOMPARE(loaded.part("xl/worksheets/sheet1.xml").compressedSize, qint64(-1));
+}
+
+void DocumentTest::testSaveAsync()
+{
+    Document xlsx1;
+    Format bold;
+    bold.setFontBold(true);
+    for (int row = 1; row <= 1000; ++row) {
+        xlsx1.write(row, 1, row);
+        xlsx1.write(row, 2, QString("Item %1").arg(row));
+    }
+    xlsx1.write("C1", "Bold", bold);
+    xlsx1.addSheet("Second");
+    xlsx1.write("A1", 2.5);
+    xlsx1.selectSheet("Sheet1");
+
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+    QFuture<bool> future = xlsx1.saveAsync(&device);
+
+    // The saved document is not affected by the changes made meanwhile
+    xlsx1.write("A1", "Changed");
+    xlsx1.write("B2", QString("New string"));
+    xlsx1.write("C1", "Italic");
+    xlsx1.write("D5", 42);
+    xlsx1.deleteSheet("Second");
+
+    future.waitForFinished();
+    QVERIFY(future.result());
+    QCOMPARE(future.progressValue(), future.progressMaximum());
+    QCOMPARE(future.progressMaximum(), 3);
+
+    device.close();
+    device.open(QIODevice::ReadOnly);
+    Document xlsx2(&device);
+    QCOMPARE(xlsx2.sheetNames(), QStringList() << "Sheet1" << "Second");
+    QCOMPARE(xlsx2.read("A1").toInt(), 1);
+    QCOMPARE(xlsx2.read("B2").toString(), QString("Item 2"));
+    QCOMPARE(xlsx2.read("C1").toString(), QString("Bold"));
+    QVERIFY(xlsx2.cellAt("C1")->format().fontBold());
+    QVERIFY(!xlsx2.cellAt("D5"));
+    QCOMPARE(xlsx2.read("B1000").toString(), QString("Item 1000"));
+    xlsx2.selectSheet("Second");
+    QCOMPARE(xlsx2.read("A1").toDouble(), 2.5);
+
+    QCOMPARE(xlsx1.read("A1").toString(), QString("Changed"));
+    QCOMPARE(xlsx1.sheetNames(), QStringList() << "Sheet1");
+
+    // Destroying the document waits for its pending saves, and the formats
+    // added meanwhile do not change the ones of the saved copy
+    QBuffer device3;
+    device3.open(QIODevice::WriteOnly);
+    QFuture<bool> future3;
+    {
+        Document xlsx3;
+        for (int row = 1; row <= 1000; ++row)
+            xlsx3.write(row, 1, row, bold);
+        future3 = xlsx3.saveAsync(&device3);
+        Format italic;
+        italic.setFontItalic(true);
+        for (int row = 1; row <= 1000; ++row)
+            xlsx3.write(row, 2, row, italic);
+    }
+    QVERIFY(future3.isFinished());
+    QVERIFY(future3.result());
+    device3.close();
+    device3.open(QIODevice::ReadOnly);
+    Document xlsx4(&device3);
+    QVERIFY(xlsx4.cellAt("A1000")->format().fontBold());
+    QVERIFY(!xlsx4.cellAt("B1"));
+}
+
+void DocumentTest::testLoadAsync()
+{
+    Document xlsx1;
+    xlsx1.write("A1", "First");
+    xlsx1.addSheet("Second");
+    for (int row = 1; row <= 1000; ++row)
+        xlsx1.write(row, 1, row);
+    xlsx1.addSheet("Third");
+    xlsx1.write("B2", 3.5);
+
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+    xlsx1.saveAs(&device);
+    device.close();
+
+    device.open(QIODevice::ReadOnly);
+    Document xlsx2;
+    xlsx2.write("Z9", "Discarded");
+    QSignalSpy spy(&xlsx2, SIGNAL(sheetLoaded(int)));
+    QFuture<bool> future = xlsx2.loadAsync(&device);
+    future.waitForFinished();
+    QVERIFY(future.result());
+    QCOMPARE(future.progressMaximum(), 3);
+    QCOMPARE(future.progressValue(), 3);
+
+    QTRY_COMPARE(spy.count(), 3);
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(spy.at(i).at(0).toInt(), i);
+
+    QCOMPARE(xlsx2.sheetNames(), QStringList() << "Sheet1" << "Second" << "Third");
+    QCOMPARE(xlsx2.read("A1").toString(), QString("First"));
+    QVERIFY(!xlsx2.cellAt("Z9"));
+    xlsx2.selectSheet("Second");
+    QCOMPARE(xlsx2.read("A1000").toInt(), 1000);
+    xlsx2.selectSheet("Third");
+    QCOMPARE(xlsx2.read("B2").toDouble(), 3.5);
+
+    // The document can be used while loading, the loaded contents replace
+    // the changes made meanwhile
+    QBuffer device2;
+    device2.setData(device.data());
+    device2.open(QIODevice::ReadOnly);
+    Document xlsx3;
+    QFuture<bool> future3 = xlsx3.loadAsync(&device2);
+    xlsx3.write("A1", "Meanwhile");
+    xlsx3.sheetNames();
+    future3.waitForFinished();
+    QVERIFY(future3.result());
+    QCOMPARE(xlsx3.sheetNames(), QStringList() << "Sheet1" << "Second" << "Third");
+    QCOMPARE(xlsx3.read("A1").toString(), QString("First"));
+
+    // A load which can not be started leaves an empty document behind
+    QFuture<bool> failed = xlsx2.loadAsync(QStringLiteral("nonexistent.xlsx"));
+    failed.waitForFinished();
+    QVERIFY(!failed.result());
+    QVERIFY(xlsx2.sheetNames().isEmpty());
+}
+
+void DocumentTest::testIncrementalSave()
+{
+    QBuffer device1;
+    {
+        Document xlsx;
+        xlsx.setIncrementalSaveEnabled(true);
+        xlsx.write("A1", "Kept");
+        xlsx.write("A2", 2);
+        xlsx.write("A3", "http://qt-project.org"); // an external hyperlink
+        xlsx.addSheet("Changed");
+        xlsx.write("A1", "Old");
+
+        QBuffer first;
+        first.open(QIODevice::WriteOnly);
+        QVERIFY(xlsx.saveAs(&first));
+
+        Format bold;
+        bold.setFontBold(true);
+        xlsx.write("B1", "New", bold);
+        device1.open(QIODevice::WriteOnly);
+        QVERIFY(xlsx.saveAs(&device1));
+        device1.close();
+    }
+
+    // The parts kept on load are saved again, along with the modified ones
+    device1.open(QIODevice::ReadOnly);
+    Document xlsx;
+    xlsx.setIncrementalSaveEnabled(true);
+    QVERIFY(xlsx.loadAsync(&device1).result());
+    xlsx.write("A2", "Another");
+
+    // Reading the settings of a column, or recalculating a sheet whose
+    // results do not change, does not modify it
+    Worksheet *kept = static_cast<Worksheet *>(xlsx.sheet("Sheet1"));
+    const ZipEntry keptEntry = kept->cachedEntry();
+    QVERIFY(keptEntry.isValid());
+    QCOMPARE(kept->columnWidth(2), 0.0);
+    QVERIFY(!kept->columnFormat(2).isValid());
+    QVERIFY(!kept->isColumnHidden(2));
+    xlsx.workbook()->setFormulaCalculationEnabled();
+
+    QBuffer device2;
+    device2.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx.saveAs(&device2));
+    device2.close();
+
+    // The unmodified sheet is copied as it was stored, still compressed
+    QCOMPARE(kept->cachedEntry().data, keptEntry.data);
+    device2.open(QIODevice::ReadOnly);
+    const ZipEntry savedEntry = ZipReader(&device2).entry("xl/worksheets/sheet1.xml");
+    QVERIFY(savedEntry.isValid());
+    QCOMPARE(savedEntry.data, keptEntry.data);
+    QCOMPARE(savedEntry.crc32, keptEntry.crc32);
+    QCOMPARE(savedEntry.dosTime, keptEntry.dosTime);
+    device2.close();
+
+    device2.open(QIODevice::ReadOnly);
+    Document xlsx2(&device2);
+    QCOMPARE(xlsx2.read("A1").toString(), QString("Kept"));
+    QCOMPARE(xlsx2.read("A2").toInt(), 2);
+    QCOMPARE(xlsx2.read("A3").toString(), QString("http://qt-project.org"));
+    xlsx2.selectSheet("Changed");
+    QCOMPARE(xlsx2.read("A1").toString(), QString("Old"));
+    QCOMPARE(xlsx2.read("B1").toString(), QString("New"));
+    QVERIFY(xlsx2.cellAt("B1")->format().fontBold());
+    QCOMPARE(xlsx2.read("A2").toString(), QString("Another"));
+}
+
+void DocumentTest::testIncrementalSaveShiftedFormulas()
+{
+    Document xlsx;
+    xlsx.setIncrementalSaveEnabled(true);
+    xlsx.write("A5", 5);
+    xlsx.addSheet("Sheet2");
+    xlsx.write("A1", "=Sheet1!A5");
+
+    QBuffer first;
+    first.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx.saveAs(&first));
+
+    // Inserting rows in a sheet rewrites the formulas of the other sheets
+    QVERIFY(static_cast<Worksheet *>(xlsx.sheet("Sheet1"))->insertRows(3, 2));
+    QVERIFY(!xlsx.sheet("Sheet2")->cachedEntry().isValid());
+
+    QBuffer second;
+    second.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx.saveAs(&second));
+    second.close();
+
+    second.open(QIODevice::ReadOnly);
+    Document xlsx2(&second);
+    QVERIFY(xlsx2.selectSheet("Sheet2"));
+    QCOMPARE(xlsx2.read("A1").toString(), QString("=Sheet1!A7"));
+}
+
+void DocumentTest::testPassthroughParts()
+{
+    QBuffer plain;
+    {
+        Document xlsx;
+        xlsx.write("A1", "Commented");
+        plain.open(QIODevice::WriteOnly);
+        QVERIFY(xlsx.saveAs(&plain));
+        plain.close();
+    }
+
+    // Add a vbaProject, custom properties and comments the library does not model
+    const QByteArray vba("\x01\x02vba\x00\xff", 7);
+    const QByteArray custom("<Properties/>");
+    const QByteArray comments("<comments/>");
+    const QByteArray vml("<xml/>");
+    QBuffer device1;
+    {
+        plain.open(QIODevice::ReadOnly);
+        QXlsx::ZipReader reader(&plain);
+        device1.open(QIODevice::WriteOnly);
+        QXlsx::ZipWriter writer(&device1);
+        foreach (const QString &path, reader.filePaths()) {
+            QByteArray data = reader.fileData(path);
+            if (path == QLatin1String("_rels/.rels")) {
+                data.replace("</Relationships>",
+                             "<Relationship Id=\"rId9\" Type=\"http://schemas.openxmlformats.org/"
+                             "officeDocument/2006/relationships/custom-properties\" "
+                             "Target=\"docProps/custom.xml\"/></Relationships>");
+            } else if (path == QLatin1String("xl/_rels/workbook.xml.rels")) {
+                data.replace("</Relationships>",
+                             "<Relationship Id=\"rId99\" Type=\"http://schemas.microsoft.com/"
+                             "office/2006/relationships/vbaProject\" "
+                             "Target=\"vbaProject.bin\"/></Relationships>");
+            } else if (path == QLatin1String("xl/worksheets/sheet1.xml")) {
+                data.replace("</worksheet>", "<legacyDrawing r:id=\"rId2\"/></worksheet>");
+            } else if (path == QLatin1String("[Content_Types].xml")) {
+                data.replace("</Types>",
+                             "<Override PartName=\"/xl/vbaProject.bin\" "
+                             "ContentType=\"application/vnd.ms-office.vbaProject\"/>"
+                             "<Override PartName=\"/xl/comments1.xml\" ContentType=\"application/"
+                             "vnd.openxmlformats-officedocument.spreadsheetml.comments+xml\"/>"
+                             "</Types>");
+                data.replace("application/vnd.openxmlformats-officedocument.spreadsheetml.sheet."
+                             "main+xml",
+                             "application/vnd.ms-excel.sheet.macroEnabled.main+xml");
+            }
+            writer.addFile(path, data);
+        }
+        writer.addFile("xl/worksheets/_rels/sheet1.xml.rels",
+                       "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/"
+                       "relationships\"><Relationship Id=\"rId1\" Type=\"http://schemas."
+                       "openxmlformats.org/officeDocument/2006/relationships/comments\" "
+                       "Target=\"../comments1.xml\"/><Relationship Id=\"rId2\" Type=\"http://"
+                       "schemas.openxmlformats.org/officeDocument/2006/relationships/vmlDrawing\" "
+                       "Target=\"../drawings/vmlDrawing1.vml\"/></Relationships>");
+        writer.addFile("xl/vbaProject.bin", vba);
+        writer.addFile("docProps/custom.xml", custom);
+        writer.addFile("xl/comments1.xml", comments);
+        writer.addFile("xl/drawings/vmlDrawing1.vml", vml);
+        writer.close();
+        device1.close();
+    }
+
+    device1.open(QIODevice::ReadOnly);
+    Document xlsx(&device1);
+    xlsx.write("B1", "Changed"); // the sheet xml is generated again
+    xlsx.addSheet("Second");
+
+    QBuffer device2;
+    device2.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx.saveAs(&device2));
+    device2.close();
+
+    device2.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&device2);
+    QCOMPARE(reader.fileData("xl/vbaProject.bin"), vba);
+    QCOMPARE(reader.fileData("docProps/custom.xml"), custom);
+    QCOMPARE(reader.fileData("xl/comments1.xml"), comments);
+    QCOMPARE(reader.fileData("xl/drawings/vmlDrawing1.vml"), vml);
+    QVERIFY(reader.fileData("_rels/.rels").contains("docProps/custom.xml"));
+    QVERIFY(reader.fileData("xl/_rels/workbook.xml.rels").contains("vbaProject.bin"));
+    QByteArray rels = reader.fileData("xl/worksheets/_rels/sheet1.xml.rels");
+    QVERIFY(rels.contains("../comments1.xml"));
+    QVERIFY(rels.contains("../drawings/vmlDrawing1.vml"));
+    QByteArray sheet = reader.fileData("xl/worksheets/sheet1.xml");
+    QVERIFY(sheet.contains("<legacyDrawing r:id=\"rId2\"/>"));
+    QByteArray types = reader.fileData("[Content_Types].xml");
+    QVERIFY(types.contains("/xl/comments1.xml"));
+    QVERIFY(types.contains("vnd.ms-excel.sheet.macroEnabled.main+xml"));
+    QVERIFY(!reader.filePaths().contains("xl/worksheets/_rels/sheet2.xml.rels"));
+}
+
+void DocumentTest::testValuesOnlyLoad()
+{
+    QBuffer device;
+    {
+        Document xlsx;
+        Format bold;
+        bold.setFontBold(true);
+        xlsx.write("A1", "Bold", bold);
+        xlsx.write("A2", QDate(2014, 3, 1));
+        RichString rich;
+        rich.addFragment("Rich", bold);
+        rich.addFragment(" text", Format());
+        xlsx.currentWorksheet()->writeString("A3", rich);
+        DataValidation validation(DataValidation::Whole);
+        validation.addRange("B1:B3");
+        xlsx.addDataValidation(validation);
+        ConditionalFormatting cf;
+        cf.addHighlightCellsRule(ConditionalFormatting::Highlight_Equal, "1", bold);
+        cf.addRange("A1:A3");
+        xlsx.addConditionalFormatting(cf);
+        xlsx.insertChart(5, 2, QSize(300, 300));
+
+        device.open(QIODevice::WriteOnly);
+        QVERIFY(xlsx.saveAs(&device));
+        device.close();
+    }
+
+    device.open(QIODevice::ReadOnly);
+    Document xlsx;
+    xlsx.setValuesOnlyLoadEnabled(true);
+    QVERIFY(xlsx.load(&device));
+    QCOMPARE(xlsx.read("A1").toString(), QString("Bold"));
+    QVERIFY(!xlsx.cellAt("A1")->format().isValid());
+    QCOMPARE(xlsx.read("A2"), QVariant(QDate(2014, 3, 1)));
+    QCOMPARE(xlsx.read("A3").toString(), QString("Rich text"));
+    QVERIFY(!xlsx.cellAt("A3")->isRichString());
+    QVERIFY(xlsx.workbook()->chartFiles().isEmpty());
+
+    QBuffer saved;
+    saved.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx.saveAs(&saved));
+    saved.close();
+    saved.open(QIODevice::ReadOnly);
+    ZipReader reader(&saved);
+    QByteArray sheet = reader.fileData("xl/worksheets/sheet1.xml");
+    QVERIFY(!sheet.contains("dataValidations"));
+    QVERIFY(!sheet.contains("conditionalFormatting"));
+    QVERIFY(!sheet.contains("drawing"));
+}
+
+void DocumentTest::testLoadRange()
+{
+    QBuffer device;
+    {
+        Document xlsx;
+        for (int row = 1; row <= 10; ++row) {
+            for (int col = 1; col <= 5; ++col)
+                xlsx.write(row, col, QString("%1-%2").arg(row).arg(col));
+        }
+        device.open(QIODevice::WriteOnly);
+        QVERIFY(xlsx.saveAs(&device));
+        device.close();
+    }
+
+    device.open(QIODevice::ReadOnly);
+    Document xlsx;
+    xlsx.setLoadRange(CellRange(3, 2, 6, 4));
+    xlsx.setLoadColumns(QList<int>() << 2 << 4 << 5);
+    QVERIFY(xlsx.loadAsync(&device).result());
+    QCOMPARE(xlsx.dimension(), CellRange(3, 2, 6, 4));
+    QCOMPARE(xlsx.read(3, 2).toString(), QString("3-2"));
+    QCOMPARE(xlsx.read(6, 4).toString(), QString("6-4"));
+    QVERIFY(!xlsx.cellAt(3, 3)); // not one of the columns
+    QVERIFY(!xlsx.cellAt(3, 5)); // out of the range
+    QVERIFY(!xlsx.cellAt(2, 2));
+    QVERIFY(!xlsx.cellAt(7, 4));
+    device.close();
+
+    // Without a range, the columns alone select the cells
+    device.open(QIODevice::ReadOnly);
+    xlsx.setLoadRange(CellRange());
+    xlsx.setLoadColumns(QList<int>() << 5);
+    QVERIFY(xlsx.loadAsync(&device).result());
+    QCOMPARE(xlsx.dimension(), CellRange(1, 5, 10, 5));
+    QCOMPARE(xlsx.read(10, 5).toString(), QString("10-5"));
+    QVERIFY(!xlsx.cellAt(10, 4));
+    device.close();
+
+    // The synchronous load projects too, and the cells of a shared formula
+    // keep their formula when its master cell is out of the range
+    QBuffer formulas;
+    {
+        Document source;
+        source.currentWorksheet()->writeFormula(
+            "B1", CellFormula("A1*2", CellRange("B1:B10"), CellFormula::SharedType));
+        formulas.open(QIODevice::WriteOnly);
+        QVERIFY(source.saveAs(&formulas));
+        formulas.close();
+    }
+    formulas.open(QIODevice::ReadOnly);
+    xlsx.setLoadRange(CellRange(3, 1, 6, 2));
+    xlsx.setLoadColumns(QList<int>());
+    QVERIFY(xlsx.load(&formulas));
+    QVERIFY(!xlsx.cellAt(1, 2));
+    QCOMPARE(xlsx.read(3, 2).toString(), QString("=A3*2"));
+    QCOMPARE(xlsx.read(6, 2).toString(), QString("=A6*2"));
+}
+
+// Reads every cell of the current sheet, the way several threads of a
+// viewer would, and keeps the first text which differs from the expected.
+class CellReader : public QThread
+{
+public:
+    CellReader(const Document *xlsx, const QStringList &expected, const QStringList &texts)
+        : xlsx(xlsx)
+        , expected(expected)
+        , texts(texts)
+    {
+    }
+
+    static QString describe(const Document *xlsx, int row, int col)
+    {
+        Cell *cell = xlsx->cellAt(row, col);
+        if (!cell)
+            return QString();
+        return CellReference(row, col).toString() + QLatin1Char('=')
+            + xlsx->read(row, col).toString() + QLatin1Char('|') + cell->displayText()
+            + QLatin1Char('|') + cell->format().numberFormat() + QLatin1Char('|')
+            + QString::number(xlsx->currentWorksheet()->readDouble(row, col)) + QLatin1Char('|')
+            + QString::number(cell->sharedStringIndex());
+    }
+
+    // Compares the cell an iterator is at with the one of cellAt()
+    bool check(int row, int col, Cell *cell)
+    {
+        const QString text = describe(xlsx, row, col);
+        if (cell != xlsx->cellAt(row, col) || text != expected[(row - 1) * 4 + col - 1]) {
+            mismatch = text;
+            return false;
+        }
+        return true;
+    }
+
+    void run()
+    {
+        const Worksheet *sheet = xlsx->currentWorksheet();
+        for (int round = 0; round < 20 && mismatch.isEmpty(); ++round) {
+            for (int i = 0; i < expected.size(); ++i) {
+                QString text = describe(xlsx, i / 4 + 1, i % 4 + 1);
+                if (text != expected[i]) {
+                    mismatch = text;
+                    return;
+                }
+            }
+
+            CellIterator it(sheet);
+            while (it.next()) {
+                if (!check(it.row(), it.column(), it.cell()))
+                    return;
+            }
+            RowCursor cursor(sheet);
+            while (cursor.nextRow()) {
+                while (cursor.next()) {
+                    if (!check(cursor.row(), cursor.column(), cursor.cell()))
+                        return;
+                }
+            }
+
+            const QStringList displayTexts = sheet->displayTexts(CellRange(1, 1, 100, 4));
+            if (displayTexts != texts) {
+                mismatch = displayTexts.join(QLatin1Char(','));
+                return;
+            }
+        }
+    }
+
+    const Document *xlsx;
+    QStringList expected;
+    QStringList texts;
+    QString mismatch;
+};
+
+void DocumentTest::testConcurrentRead()
+{
+    QBuffer device;
+    {
+        Document xlsx;
+        Format money;
+        money.setNumberFormat("#,##0.000");
+        Format bold;
+        bold.setFontBold(true);
+        for (int row = 1; row <= 100; ++row) {
+            xlsx.write(row, 1, row * 1000.5, money);
+            xlsx.write(row, 2, QString("Text %1").arg(row % 7), bold);
+            xlsx.write(row, 3, QDate(2014, 1, 1).addDays(row));
+            xlsx.write(row, 4, QString("=A%1*2").arg(row));
+        }
+        device.open(QIODevice::WriteOnly);
+        QVERIFY(xlsx.saveAs(&device));
+        device.close();
+    }
+
+    device.open(QIODevice::ReadOnly);
+    const Document xlsx(&device);
+    QStringList expected;
+    for (int row = 1; row <= 100; ++row) {
+        for (int col = 1; col <= 4; ++col)
+            expected.append(CellReader::describe(&xlsx, row, col));
+    }
+    QCOMPARE(expected[0], QString("A1=1000.5|1,000.500|#,##0.000|1000.5|-1"));
+    QCOMPARE(xlsx.cellAt(1, 2)->sharedStringIndex(), 0);
+    const QStringList texts = xlsx.currentWorksheet()->displayTexts(CellRange(1, 1, 100, 4));
+    QCOMPARE(texts[0], QString("1,000.500"));
+
+    QList<CellReader *> readers;
+    for (int i = 0; i < 4; ++i)
+        readers.append(new CellReader(&xlsx, expected, texts));
+    foreach (CellReader *reader, readers)
+        reader->start();
+    foreach (CellReader *reader, readers)
+        reader->wait();
+    foreach (CellReader *reader, readers)
+        QCOMPARE(reader->mismatch, QString());
+    qDeleteAll(readers);
+}
+
 QTEST_APPLESS_MAIN(DocumentTest)
 
 #include "tst_documenttest.moc"
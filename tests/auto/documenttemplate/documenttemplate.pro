@@ -0,0 +1,13 @@
+QT       += testlib xlsx xlsx-private
+CONFIG += testcase
+DEFINES += XLSX_TEST
+
+TARGET = tst_documenttemplatetest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += tst_documenttemplatetest.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
@@ -0,0 +1,156 @@
+#include "xlsxdocumenttemplate.h"
+#include "xlsxdocument.h"
+#include "xlsxcell.h"
+#include "xlsxformat.h"
+#include "private/xlsxzipreader_p.h"
+#include <QString>
+#include <QtTest>
+
+using namespace QXlsx;
+
+class DocumentTemplateTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    DocumentTemplateTest();
+
+private Q_SLOTS:
+    void testFromDevice();
+    void testIndependentCopies();
+    void testFromDocument();
+    void testInvalid();
+
+private:
+    static QByteArray templateData();
+    static QByteArray saved(Document &xlsx);
+};
+
+DocumentTemplateTest::DocumentTemplateTest()
+{
+}
+
+QByteArray DocumentTemplateTest::templateData()
+{
+    Document xlsx;
+    Format header;
+    header.setFontBold(true);
+    xlsx.write("A1", "Name", header);
+    xlsx.write("B1", "Amount", header);
+    xlsx.setColumnWidth(1, 30);
+    xlsx.addSheet("Terms");
+    xlsx.selectSheet("Terms");
+    xlsx.write("A1", "Payable within 30 days");
+    xlsx.selectSheet("Sheet1");
+    return saved(xlsx);
+}
+
+QByteArray DocumentTemplateTest::saved(Document &xlsx)
+{
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+    xlsx.saveAs(&device);
+    return device.data();
+}
+
+void DocumentTemplateTest::testFromDevice()
+{
+    QByteArray data = templateData();
+    QBuffer device(&data);
+    device.open(QIODevice::ReadOnly);
+    DocumentTemplate invoice(&device);
+    QVERIFY(invoice.isValid());
+
+    Document xlsx(invoice);
+    QCOMPARE(xlsx.sheetNames(), QStringList() << "Sheet1" << "Terms");
+    QCOMPARE(xlsx.read("A1").toString(), QString("Name"));
+    QVERIFY(xlsx.cellAt("A1")->format().fontBold());
+    QCOMPARE(xlsx.columnWidth(1), 30.0);
+    xlsx.write("A2", "Debao");
+    xlsx.write("B2", 12.5);
+
+    // The parts left unmodified are saved from the xml of the template
+    QByteArray result = saved(xlsx);
+    QBuffer resultDevice(&result);
+    resultDevice.open(QIODevice::ReadOnly);
+    ZipReader resultReader(&resultDevice);
+    device.reset();
+    ZipReader templateReader(&device);
+    QCOMPARE(resultReader.fileData("xl/styles.xml"), templateReader.fileData("xl/styles.xml"));
+    QCOMPARE(resultReader.fileData("xl/worksheets/sheet2.xml"),
+             templateReader.fileData("xl/worksheets/sheet2.xml"));
+    QVERIFY(resultReader.fileData("xl/worksheets/sheet1.xml")
+            != templateReader.fileData("xl/worksheets/sheet1.xml"));
+
+    resultDevice.reset();
+    Document reloaded(&resultDevice);
+    QCOMPARE(reloaded.read("A1").toString(), QString("Name"));
+    QCOMPARE(reloaded.read("A2").toString(), QString("Debao"));
+    QCOMPARE(reloaded.read("B2").toDouble(), 12.5);
+}
+
+void DocumentTemplateTest::testIndependentCopies()
+{
+    QByteArray data = templateData();
+    QBuffer device(&data);
+    device.open(QIODevice::ReadOnly);
+    DocumentTemplate invoice(&device);
+
+    Document xlsx1(invoice);
+    Document xlsx2(invoice);
+    xlsx1.write("A1", "Customer");
+    xlsx1.write("A2", 1);
+    xlsx2.write("A2", 2);
+    xlsx2.deleteSheet("Terms");
+
+    QCOMPARE(xlsx1.read("A1").toString(), QString("Customer"));
+    QCOMPARE(xlsx2.read("A1").toString(), QString("Name"));
+    QCOMPARE(xlsx1.read("A2").toInt(), 1);
+    QCOMPARE(xlsx2.read("A2").toInt(), 2);
+    QCOMPARE(xlsx1.sheetNames().size(), 2);
+
+    // Nor is the template modified
+    Document xlsx3(invoice);
+    QCOMPARE(xlsx3.read("A1").toString(), QString("Name"));
+    QVERIFY(!xlsx3.cellAt("A2"));
+    QCOMPARE(xlsx3.sheetNames().size(), 2);
+}
+
+void DocumentTemplateTest::testFromDocument()
+{
+    Document *source = new Document;
+    Format money;
+    money.setNumberFormat("0.000");
+    source->write("A1", 1.5, money);
+    DocumentTemplate report(source);
+    source->write("A1", 2.5, money);
+    delete source;
+
+    // The cells are owned by the template once the source is gone
+    Document xlsx(report);
+    QCOMPARE(xlsx.read("A1").toDouble(), 1.5);
+    QCOMPARE(xlsx.cellAt("A1")->displayText(), QString("1.500"));
+
+    QByteArray result = saved(xlsx);
+    QBuffer resultDevice(&result);
+    resultDevice.open(QIODevice::ReadOnly);
+    Document reloaded(&resultDevice);
+    QCOMPARE(reloaded.read("A1").toDouble(), 1.5);
+}
+
+void DocumentTemplateTest::testInvalid()
+{
+    DocumentTemplate none;
+    QVERIFY(!none.isValid());
+    DocumentTemplate missing(QStringLiteral("nonexistent.xlsx"));
+    QVERIFY(!missing.isValid());
+
+    Document xlsx(missing);
+    QVERIFY(xlsx.sheetNames().isEmpty());
+    xlsx.write("A1", "Hello");
+    QCOMPARE(xlsx.read("A1").toString(), QString("Hello"));
+}
+
+QTEST_APPLESS_MAIN(DocumentTemplateTest)
+
+#include "tst_documenttemplatetest.moc"
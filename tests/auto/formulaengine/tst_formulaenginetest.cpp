@@ -0,0 +1,259 @@
+#include "xlsxdocument.h"
+#include "xlsxworkbook.h"
+#include "xlsxworksheet.h"
+#include "xlsxcell.h"
+#include "xlsxcellformula.h"
+#include "xlsxcellrange.h"
+#include <QString>
+#include <QDate>
+#include <QBuffer>
+#include <QtTest>
+
+class FormulaEngineTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    FormulaEngineTest();
+
+private Q_SLOTS:
+    void testEvaluate_data();
+    void testEvaluate();
+    void testIncrementalRecalculation();
+    void testRangeDependents();
+    void testSharedFormula();
+    void testCircularReference();
+    void testParallelLevels();
+    void testCalculateOnSave();
+    void testCrossSheetOnSave();
+};
+
+FormulaEngineTest::FormulaEngineTest()
+{
+}
+
+void FormulaEngineTest::testEvaluate_data()
+{
+    QTest::addColumn<QString>("formula");
+    QTest::addColumn<QVariant>("result");
+
+    QTest::newRow("arithmetic") << "1+2*3-4/2" << QVariant(5.0);
+    QTest::newRow("power") << "-2^2" << QVariant(4.0);
+    QTest::newRow("percent") << "50%*A1" << QVariant(0.5);
+    QTest::newRow("division by zero") << "1/0" << QVariant("#DIV/0!");
+    QTest::newRow("comparison") << "A1<A2" << QVariant(true);
+    QTest::newRow("concatenation") << "\"a\"&A3&1" << QVariant("ahello1");
+    QTest::newRow("sum") << "SUM(A1:A3,10)" << QVariant(13.0);
+    QTest::newRow("average") << "AVERAGE(A1:A3)" << QVariant(1.5);
+    QTest::newRow("min") << "MIN(A1:A2)" << QVariant(1.0);
+    QTest::newRow("max") << "MAX(A:A)" << QVariant(2.0);
+    QTest::newRow("count") << "COUNT(A1:A3)" << QVariant(2.0);
+    QTest::newRow("counta") << "COUNTA(A1:A3)" << QVariant(3.0);
+    QTest::newRow("if") << "IF(A1>1,\"big\",\"small\")" << QVariant("small");
+    QTest::newRow("and") << "AND(A1,A2>1)" << QVariant(true);
+    QTest::newRow("not") << "NOT(OR(A1>5,FALSE))" << QVariant(true);
+    QTest::newRow("iferror") << "IFERROR(1/0,-1)" << QVariant(-1.0);
+    QTest::newRow("vlookup exact") << "VLOOKUP(\"b\",C1:D3,2,FALSE)" << QVariant(20.0);
+    QTest::newRow("vlookup approximate") << "VLOOKUP(\"bb\",C1:D3,2)" << QVariant(20.0);
+    QTest::newRow("vlookup missing") << "VLOOKUP(\"z\",C1:D3,2,FALSE)" << QVariant("#N/A");
+    QTest::newRow("index") << "INDEX(C1:D3,3,2)" << QVariant(30.0);
+    QTest::newRow("match") << "MATCH(\"c\",C1:C3,0)" << QVariant(3.0);
+    QTest::newRow("index match") << "INDEX(D1:D3,MATCH(\"a\",C1:C3,0))" << QVariant(10.0);
+    QTest::newRow("text") << "UPPER(LEFT(A3,2))&MID(A3,3,2)&LEN(A3)" << QVariant("HEll5");
+    QTest::newRow("trim") << "TRIM(\"  a  b \")" << QVariant("a b");
+    QTest::newRow("date") << "DATE(2014,2,1)" << QVariant(41671.0);
+    QTest::newRow("year") << "YEAR(DATE(2014,14,1))" << QVariant(2015.0);
+    QTest::newRow("date negative year") << "DATE(-1,1,1)" << QVariant("#NUM!");
+    QTest::newRow("date huge day") << "DATE(2014,1,10000000000)" << QVariant("#NUM!");
+    QTest::newRow("date past 9999") << "DATE(9999,13,1)" << QVariant("#NUM!");
+    QTest::newRow("round") << "ROUND(2.345,2)+MOD(-3,2)" << QVariant(3.35);
+    QTest::newRow("other sheet") << "'Data Sheet'!A1*2" << QVariant(200.0);
+    QTest::newRow("unknown function") << "FOO(1)" << QVariant("#NAME?");
+}
+
+void FormulaEngineTest::testEvaluate()
+{
+    QFETCH(QString, formula);
+    QFETCH(QVariant, result);
+
+    QXlsx::Document xlsx;
+    xlsx.write("A1", 1);
+    xlsx.write("A2", 2);
+    xlsx.write("A3", "hello");
+    xlsx.write("C1", "a");
+    xlsx.write("C2", "b");
+    xlsx.write("C3", "c");
+    xlsx.write("D1", 10);
+    xlsx.write("D2", 20);
+    xlsx.write("D3", 30);
+    xlsx.addSheet("Data Sheet");
+    xlsx.selectSheet("Data Sheet");
+    xlsx.write("A1", 100);
+    xlsx.selectSheet("Sheet1");
+
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    sheet->writeFormula("F1", QXlsx::CellFormula(formula));
+    sheet->recalculate();
+
+    const QVariant value = sheet->cellAt("F1")->value();
+    if (result.type() == QVariant::Double)
+        QCOMPARE(value.toDouble(), result.toDouble());
+    else
+        QCOMPARE(value, result);
+}
+
+void FormulaEngineTest::testIncrementalRecalculation()
+{
+    QXlsx::Document xlsx;
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    sheet->writeNumeric("A1", 1);
+    sheet->writeFormula("B1", QXlsx::CellFormula("A1*2"));
+    sheet->writeFormula("C1", QXlsx::CellFormula("B1+SUM(A1:A10)"));
+    sheet->recalculate();
+    QCOMPARE(sheet->cellAt("C1")->value().toDouble(), 3.0);
+
+    sheet->writeNumeric("A1", 5);
+    sheet->writeNumeric("A5", 100);
+    sheet->recalculate();
+    QCOMPARE(sheet->cellAt("B1")->value().toDouble(), 10.0);
+    QCOMPARE(sheet->cellAt("C1")->value().toDouble(), 115.0);
+
+    // Replacing a formula updates its dependents too
+    sheet->writeFormula("B1", QXlsx::CellFormula("A1*3"));
+    sheet->recalculate();
+    QCOMPARE(sheet->cellAt("C1")->value().toDouble(), 120.0);
+}
+
+void FormulaEngineTest::testRangeDependents()
+{
+    QXlsx::Document xlsx;
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    sheet->writeFormula("B1", QXlsx::CellFormula("SUM(A60:A70)")); // two blocks of rows
+    sheet->writeFormula("C1", QXlsx::CellFormula("SUM(A1:A100000)")); // too many blocks
+    sheet->writeFormula("F1", QXlsx::CellFormula("SUM(A1:E3)"));
+    sheet->recalculate();
+
+    sheet->writeNumeric("A64", 1);
+    sheet->writeNumeric("A65", 2);
+    sheet->writeNumeric("A99999", 4);
+    sheet->writeNumeric("E2", 8);
+    sheet->recalculate();
+    QCOMPARE(sheet->cellAt("B1")->value().toDouble(), 3.0);
+    QCOMPARE(sheet->cellAt("C1")->value().toDouble(), 7.0);
+    QCOMPARE(sheet->cellAt("F1")->value().toDouble(), 18.0); // with B1 and C1
+
+    // A replaced formula no longer depends on its former range
+    sheet->writeFormula("B1", QXlsx::CellFormula("SUM(A1:A2)"));
+    sheet->writeNumeric("A65", 16);
+    sheet->writeNumeric("A2", 32);
+    sheet->recalculate();
+    QCOMPARE(sheet->cellAt("B1")->value().toDouble(), 32.0);
+    QCOMPARE(sheet->cellAt("C1")->value().toDouble(), 53.0);
+}
+
+void FormulaEngineTest::testSharedFormula()
+{
+    QXlsx::Document xlsx;
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    for (int row = 1; row <= 10; ++row)
+        sheet->writeNumeric(row, 1, row);
+    sheet->writeFormula("B1", QXlsx::CellFormula("A1*2+SUM($A$1:A1)", "B1:B10",
+                                                 QXlsx::CellFormula::SharedType));
+    sheet->recalculate();
+    QCOMPARE(sheet->cellAt("B1")->value().toDouble(), 3.0);
+    QCOMPARE(sheet->cellAt("B10")->value().toDouble(), 75.0);
+
+    sheet->writeNumeric("A10", 0);
+    sheet->recalculate();
+    QCOMPARE(sheet->cellAt("B10")->value().toDouble(), 45.0);
+    QCOMPARE(sheet->cellAt("B9")->value().toDouble(), 63.0);
+}
+
+void FormulaEngineTest::testCircularReference()
+{
+    QXlsx::Document xlsx;
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    sheet->writeFormula("A1", QXlsx::CellFormula("B1+1"), QXlsx::Format(), 7);
+    sheet->writeFormula("B1", QXlsx::CellFormula("A1+1"), QXlsx::Format(), 7);
+    sheet->writeFormula("C1", QXlsx::CellFormula("D1+1"));
+    sheet->writeNumeric("D1", 1);
+    sheet->recalculate();
+    QCOMPARE(sheet->cellAt("A1")->value().toDouble(), 0.0);
+    QCOMPARE(sheet->cellAt("B1")->value().toDouble(), 0.0);
+    QCOMPARE(sheet->cellAt("C1")->value().toDouble(), 2.0);
+}
+
+void FormulaEngineTest::testParallelLevels()
+{
+    QXlsx::Document xlsx;
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    const int rows = 2000;
+    for (int row = 1; row <= rows; ++row) {
+        sheet->writeNumeric(row, 1, row);
+        sheet->writeFormula(row, 2, QXlsx::CellFormula(QString("A%1*A%1").arg(row)));
+        sheet->writeFormula(row, 3, QXlsx::CellFormula(QString("B%1-A%1").arg(row)));
+    }
+    sheet->writeFormula(1, 4, QXlsx::CellFormula(QString("SUM(C1:C%1)").arg(rows)));
+    sheet->recalculate();
+
+    double expected = 0;
+    for (int row = 1; row <= rows; ++row) {
+        QCOMPARE(sheet->cellAt(row, 3)->value().toDouble(), double(row) * row - row);
+        expected += double(row) * row - row;
+    }
+    QCOMPARE(sheet->cellAt(1, 4)->value().toDouble(), expected);
+}
+
+void FormulaEngineTest::testCalculateOnSave()
+{
+    QByteArray xlsxData;
+    {
+        QXlsx::Document xlsx;
+        xlsx.workbook()->setFormulaCalculationEnabled();
+        xlsx.write("A1", 6);
+        xlsx.write("A2", "=A1*7");
+        xlsx.write("A3", "=A1>5");
+        xlsx.write("A4", "=\"x\"&A1");
+        xlsx.write("A5", "=A1/0");
+        QBuffer buffer(&xlsxData);
+        xlsx.saveAs(&buffer);
+    }
+
+    QBuffer buffer(&xlsxData);
+    QXlsx::Document xlsx(&buffer);
+    QCOMPARE(xlsx.cellAt("A2")->value().toDouble(), 42.0);
+    QCOMPARE(xlsx.cellAt("A3")->value(), QVariant(true));
+    QCOMPARE(xlsx.cellAt("A3")->formula(), QXlsx::CellFormula("A1>5"));
+    QCOMPARE(xlsx.cellAt("A4")->value(), QVariant("x6"));
+    QCOMPARE(xlsx.cellAt("A5")->cellType(), QXlsx::Cell::ErrorType);
+    QCOMPARE(xlsx.cellAt("A5")->value(), QVariant("#DIV/0!"));
+    QCOMPARE(xlsx.cellAt("A5")->formula(), QXlsx::CellFormula("A1/0"));
+}
+
+// A sheet referring to the results of a following sheet is calculated again
+void FormulaEngineTest::testCrossSheetOnSave()
+{
+    QByteArray xlsxData;
+    {
+        QXlsx::Document xlsx;
+        xlsx.workbook()->setFormulaCalculationEnabled();
+        xlsx.write("A1", "=Sheet2!A1*2");
+        xlsx.addSheet("Sheet2");
+        xlsx.write("A1", "=Sheet3!A1+1");
+        xlsx.addSheet("Sheet3");
+        xlsx.write("A1", "=B1+1");
+        xlsx.write("B1", 3);
+        QBuffer buffer(&xlsxData);
+        xlsx.saveAs(&buffer);
+    }
+
+    QBuffer buffer(&xlsxData);
+    QXlsx::Document xlsx(&buffer);
+    QCOMPARE(xlsx.cellAt("A1")->value().toDouble(), 10.0);
+    xlsx.selectSheet("Sheet2");
+    QCOMPARE(xlsx.cellAt("A1")->value().toDouble(), 5.0);
+}
+
+QTEST_APPLESS_MAIN(FormulaEngineTest)
+
+#include "tst_formulaenginetest.moc"
@@ -0,0 +1,13 @@
+QT       += testlib xlsx xlsx-private
+CONFIG += testcase
+DEFINES += XLSX_TEST
+
+TARGET = tst_numformatrenderertest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += tst_numformatrenderertest.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
@@ -0,0 +1,160 @@
+#include "private/xlsxnumformatrenderer_p.h"
+#include "xlsxdocument.h"
+#include "xlsxformat.h"
+#include "xlsxworksheet.h"
+#include "xlsxcell.h"
+#include "xlsxcellrange.h"
+#include <QString>
+#include <QtTest>
+
+using namespace QXlsx;
+
+class NumFormatRendererTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    NumFormatRendererTest();
+
+private Q_SLOTS:
+    void testRender_data();
+    void testRender();
+    void testRender1904();
+    void testRenderText();
+    void testRenderBatch();
+    void testBuiltinFormatCode();
+    void testDisplayText();
+};
+
+NumFormatRendererTest::NumFormatRendererTest()
+{
+}
+
+void NumFormatRendererTest::testRender_data()
+{
+    QTest::addColumn<QString>("formatCode");
+    QTest::addColumn<double>("value");
+    QTest::addColumn<QString>("text");
+
+    QTest::newRow("general") << "General" << 1234.5 << "1234.5";
+    QTest::newRow("general negative") << "General" << -0.25 << "-0.25";
+    QTest::newRow("general digits") << "General" << 1.0 / 3 << "0.333333333";
+    QTest::newRow("general scientific") << "General" << 123456789012.0 << "1.23457E+11";
+    QTest::newRow("integer") << "0" << 2.5 << "3";
+    QTest::newRow("integer negative") << "0" << -2.5 << "-3";
+    QTest::newRow("decimals") << "0.00" << 3.14159 << "3.14";
+    QTest::newRow("decimals rounding") << "0.00" << 1.005 << "1.01";
+    QTest::newRow("leading zeros") << "000" << 7.0 << "007";
+    QTest::newRow("optional decimals") << "0.0#" << 1.5 << "1.5";
+    QTest::newRow("aligned") << "???.??" << 1.5 << "  1.5 ";
+    QTest::newRow("grouping") << "#,##0" << 1234567.0 << "1,234,567";
+    QTest::newRow("grouping decimals") << "#,##0.00" << -1234.5 << "-1,234.50";
+    QTest::newRow("scaling") << "#,##0," << 1234567.0 << "1,235";
+    QTest::newRow("percent") << "0%" << 0.256 << "26%";
+    QTest::newRow("scientific") << "0.00E+00" << 12345.0 << "1.23E+04";
+    QTest::newRow("scientific negative exponent") << "0.00E+00" << 0.00012 << "1.20E-04";
+    QTest::newRow("engineering") << "##0.0E+0" << 12345.0 << "12.3E+3";
+    QTest::newRow("fraction") << "# ?/?" << 1.5 << "1 1/2";
+    QTest::newRow("fraction whole") << "# ?/?" << 5.0 << "5    ";
+    QTest::newRow("fraction two digits") << "# ?\?/??" << 0.3333333 << "  1/3 ";
+    QTest::newRow("fraction fixed") << "# ?/4" << 2.25 << "2 1/4";
+    QTest::newRow("sections negative") << "$#,##0_);($#,##0)" << -1234.0 << "($1,234)";
+    QTest::newRow("sections positive") << "$#,##0_);($#,##0)" << 1234.0 << "$1,234 ";
+    QTest::newRow("sections zero") << "0;-0;\"zero\"" << 0.0 << "zero";
+    QTest::newRow("condition") << "[>=100]\"big\" 0;0" << 150.0 << "big 150";
+    QTest::newRow("condition else") << "[>=100]\"big\" 0;0" << 5.0 << "5";
+    QTest::newRow("color") << "[Red]0.0" << -1.25 << "-1.3";
+    QTest::newRow("literal") << "0.0 \"kg\"" << 3.0 << "3.0 kg";
+    QTest::newRow("currency") << "[$$-409]#,##0.00" << 5.0 << "$5.00";
+    QTest::newRow("date") << "yyyy-mm-dd" << 44197.0 << "2021-01-01";
+    QTest::newRow("short date") << "m/d/yy" << 44197.5 << "1/1/21";
+    QTest::newRow("month name") << "d-mmm-yy" << 45000.0 << "15-Mar-23";
+    QTest::newRow("long date") << "dddd, mmmm d, yyyy" << 45000.0 << "Wednesday, March 15, 2023";
+    QTest::newRow("1900-01-00") << "yyyy-mm-dd" << 0.0 << "1900-01-00";
+    QTest::newRow("1900-02-29") << "yyyy-mm-dd" << 60.0 << "1900-02-29";
+    QTest::newRow("1900-03-01") << "yyyy-mm-dd" << 61.0 << "1900-03-01";
+    QTest::newRow("time") << "h:mm:ss" << 0.5 + 1.0 / 86400 << "12:00:01";
+    QTest::newRow("time rounding") << "yyyy-mm-dd hh:mm:ss" << 44197.999999 << "2021-01-02 00:00:00";
+    QTest::newRow("am/pm") << "h:mm AM/PM" << 0.75 << "6:00 PM";
+    QTest::newRow("midnight") << "h AM/PM" << 0.0 << "12 AM";
+    QTest::newRow("elapsed") << "[h]:mm:ss" << 1.5 << "36:00:00";
+    QTest::newRow("sub second") << "mm:ss.0" << 61.25 / 86400 << "01:01.3";
+    QTest::newRow("negative date") << "yyyy-mm-dd" << -1.0 << "-1";
+    QTest::newRow("text only") << "@" << 3.5 << "3.5";
+}
+
+void NumFormatRendererTest::testRender()
+{
+    QFETCH(QString, formatCode);
+    QFETCH(double, value);
+    QFETCH(QString, text);
+
+    NumFormatRenderer renderer(formatCode);
+    QCOMPARE(renderer.render(value), text);
+}
+
+void NumFormatRendererTest::testRender1904()
+{
+    NumFormatRenderer renderer(QStringLiteral("yyyy-mm-dd dddd"));
+    QCOMPARE(renderer.render(0, true), QStringLiteral("1904-01-01 Friday"));
+    QCOMPARE(renderer.render(1, false), QStringLiteral("1900-01-01 Sunday"));
+}
+
+void NumFormatRendererTest::testRenderText()
+{
+    QCOMPARE(NumFormatRenderer(QStringLiteral("0;-0;0;\"<\"@\">\"")).renderText("x"),
+             QStringLiteral("<x>"));
+    QCOMPARE(NumFormatRenderer(QStringLiteral("0.00")).renderText("x"), QStringLiteral("x"));
+}
+
+void NumFormatRendererTest::testRenderBatch()
+{
+    NumFormatRenderer renderer(QStringLiteral("#,##0.0"));
+    const double values[] = { 1, 1234.56, -0.04 };
+    QStringList texts;
+    renderer.render(values, 3, texts);
+    QCOMPARE(texts, QStringList() << "1.0"
+                                  << "1,234.6"
+                                  << "-0.0");
+}
+
+void NumFormatRendererTest::testBuiltinFormatCode()
+{
+    QCOMPARE(NumFormatRenderer::builtinFormatCode(0), QStringLiteral("General"));
+    QCOMPARE(NumFormatRenderer::builtinFormatCode(4), QStringLiteral("#,##0.00"));
+    QCOMPARE(NumFormatRenderer::builtinFormatCode(14), QStringLiteral("m/d/yyyy"));
+    QCOMPARE(NumFormatRenderer::builtinFormatCode(46), QStringLiteral("[h]:mm:ss"));
+}
+
+void NumFormatRendererTest::testDisplayText()
+{
+    Document xlsx;
+    Format money;
+    money.setNumberFormat("#,##0.00");
+    Format builtin;
+    builtin.setNumberFormatIndex(10);
+    xlsx.write("A1", 1234.5, money);
+    xlsx.write("B1", 0.125, builtin);
+    xlsx.write("C1", true);
+    xlsx.write("D1", "text");
+    xlsx.write("A2", 2.0, money);
+
+    QCOMPARE(xlsx.cellAt("A1")->displayText(), QStringLiteral("1,234.50"));
+    QCOMPARE(xlsx.cellAt("B1")->displayText(), QStringLiteral("12.50%"));
+    QCOMPARE(xlsx.cellAt("C1")->displayText(), QStringLiteral("TRUE"));
+    QCOMPARE(xlsx.cellAt("D1")->displayText(), QStringLiteral("text"));
+
+    QStringList texts = xlsx.currentWorksheet()->displayTexts(CellRange("A1:D2"));
+    QCOMPARE(texts, QStringList() << "1,234.50"
+                                  << "12.50%"
+                                  << "TRUE"
+                                  << "text"
+                                  << "2.00"
+                                  << ""
+                                  << ""
+                                  << "");
+}
+
+QTEST_APPLESS_MAIN(NumFormatRendererTest)
+
+#include "tst_numformatrenderertest.moc"
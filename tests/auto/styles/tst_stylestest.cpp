@@ -1,6 +1,7 @@
 #include "private/xlsxstyles_p.h"
 #include "xlsxformat.h"
 #include "private/xlsxformat_p.h"
+#include "private/xlsxnumformatrenderer_p.h"
 #include <QString>
 #include <QtTest>
 #include <QXmlStreamReader>
@@ -17,6 +18,9 @@ private Q_SLOTS:
     void testAddXfFormat();
     void testAddXfFormat2();
     void testSolidFillBackgroundColor();
+    void testXfNumberKind_data();
+    void testXfNumberKind();
+    void testXfRendererShared();
 
     void testWriteBorders();
 
@@ -70,6 +74,58 @@ void StylesTest::testAddXfFormat2()
     QCOMPARE(format2.numberFormatIndex(), 176);
 }
 
+void StylesTest::testXfNumberKind_data()
+{
+    QTest::addColumn<QString>("numFmt");
+    QTest::addColumn<int>("kind");
+
+    QTest::newRow("General") << QString("General") << int(QXlsx::NumFormatParser::Numeric);
+    QTest::newRow("percent") << QString("0.00%") << int(QXlsx::NumFormatParser::Numeric);
+    QTest::newRow("text") << QString("@") << int(QXlsx::NumFormatParser::Text);
+    QTest::newRow("builtin date") << QString("m/d/yy") << int(QXlsx::NumFormatParser::Date);
+    QTest::newRow("builtin time") << QString("h:mm AM/PM") << int(QXlsx::NumFormatParser::Time);
+    QTest::newRow("builtin datetime") << QString("m/d/yy h:mm") << int(QXlsx::NumFormatParser::DateTime);
+    QTest::newRow("date") << QString("yyyy-mm-dd") << int(QXlsx::NumFormatParser::Date);
+    QTest::newRow("months") << QString("mmmm") << int(QXlsx::NumFormatParser::Date);
+    QTest::newRow("minutes") << QString("mm:ss.0") << int(QXlsx::NumFormatParser::Time);
+    QTest::newRow("datetime") << QString("dd/mm/yyyy hh:mm") << int(QXlsx::NumFormatParser::DateTime);
+    QTest::newRow("duration") << QString("[hh]:mm:ss") << int(QXlsx::NumFormatParser::Duration);
+    QTest::newRow("quoted") << QString("0 \"days\"") << int(QXlsx::NumFormatParser::Numeric);
+}
+
+void StylesTest::testXfNumberKind()
+{
+    QFETCH(QString, numFmt);
+    QFETCH(int, kind);
+
+    QXlsx::Styles styles(QXlsx::Styles::F_NewFromScratch);
+    QXlsx::Format format;
+    format.setNumberFormat(numFmt);
+    styles.addXfFormat(format);
+
+    QCOMPARE(int(styles.xfNumberKind(format.xfIndex())), kind);
+    QCOMPARE(int(styles.xfNumberKind(format)), kind);
+    QCOMPARE(int(styles.xfNumberKind(0)), int(QXlsx::NumFormatParser::Numeric));
+}
+
+// The formats never added to the styles do not compile their renderer again
+void StylesTest::testXfRendererShared()
+{
+    QXlsx::Styles styles(QXlsx::Styles::F_NewFromScratch);
+    QXlsx::Format general;
+    QVERIFY(styles.xfRenderer(general) == styles.xfRenderer(QXlsx::Format()));
+    QVERIFY(styles.xfRenderer(general) == styles.xfRenderer(-1));
+    QCOMPARE(styles.xfRenderer(general)->formatCode(), QStringLiteral("General"));
+
+    QXlsx::Format added;
+    added.setNumberFormatIndex(10);
+    styles.addXfFormat(added);
+    QXlsx::Format another;
+    another.setNumberFormatIndex(10);
+    QVERIFY(styles.xfRenderer(another) == styles.xfRenderer(added));
+    QCOMPARE(styles.xfRenderer(another)->render(0.5), QStringLiteral("50.00%"));
+}
+
 // For a solid fill, Excel reverses the role of foreground and background colours
 void StylesTest::testSolidFillBackgroundColor()
 {
@@ -0,0 +1,13 @@
+QT       += testlib xlsx xlsx-private
+CONFIG += testcase
+DEFINES += XLSX_TEST XLSX_TRACE
+
+TARGET = tst_tracetest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += tst_tracetest.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
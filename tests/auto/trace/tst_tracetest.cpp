@@ -0,0 +1,78 @@
+#include "xlsxdocument.h"
+#include "private/xlsxtrace_p.h"
+#include <QBuffer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+#include <QtTest>
+
+using namespace QXlsx;
+
+class TraceTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    TraceTest();
+
+private Q_SLOTS:
+    void testRecordSave();
+};
+
+TraceTest::TraceTest()
+{
+}
+
+void TraceTest::testRecordSave()
+{
+    TraceRecorder *recorder = TraceRecorder::instance();
+    QVERIFY(recorder);
+    recorder->clear();
+    recorder->setRecording(true);
+    QVERIFY(recorder->isRecording());
+
+    Document xlsx;
+    xlsx.write("A1", "Hello");
+    xlsx.write("A2", 12.5);
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx.saveAs(&device));
+
+    recorder->setRecording(false);
+    QVERIFY(!recorder->isRecording());
+    // Spans are not recorded once recording is off
+    xlsx.saveAs(&device);
+
+    const QJsonObject root = QJsonDocument::fromJson(recorder->toJson()).object();
+    const QJsonArray events = root.value("traceEvents").toArray();
+    QVERIFY(!events.isEmpty());
+
+    QStringList names;
+    foreach (const QJsonValue &value, events) {
+        const QJsonObject event = value.toObject();
+        QCOMPARE(event.value("ph").toString(), QString("X"));
+        QCOMPARE(event.value("cat").toString(), QString("xlsx"));
+        QVERIFY(event.value("dur").toDouble() >= 0);
+        names.append(event.value("name").toString());
+        if (names.last() == QLatin1String("Worksheet::saveToXmlFile"))
+            QCOMPARE(event.value("args").toObject().value("detail").toString(),
+                     QString("Sheet1"));
+    }
+    QCOMPARE(names.count("Document::savePackage"), 1);
+    QCOMPARE(names.count("Worksheet::saveToXmlFile"), 1);
+    QVERIFY(names.contains("SharedStrings::saveToXmlFile"));
+    QVERIFY(names.contains("Styles::saveToXmlFile"));
+    QVERIFY(names.contains("ZipWriter::close"));
+
+    recorder->clear();
+    QVERIFY(QJsonDocument::fromJson(recorder->toJson())
+                .object()
+                .value("traceEvents")
+                .toArray()
+                .isEmpty());
+}
+
+QTEST_APPLESS_MAIN(TraceTest)
+
+#include "tst_tracetest.moc"
@@ -45,6 +45,10 @@ private Q_SLOTS:
     void test_datetimeFromNumber_data();
     void test_datetimeFromNumber();
 
+    void test_daysFromCivil_data();
+    void test_daysFromCivil();
+    void test_daysToNumbers();
+
     void test_createSafeSheetName_data();
     void test_createSafeSheetName();
 
@@ -53,6 +57,9 @@ private Q_SLOTS:
 
     void test_convertSharedFormula_data();
     void test_convertSharedFormula();
+
+    void test_shiftFormulaReferences_data();
+    void test_shiftFormulaReferences();
 };
 
 UtilityTest::UtilityTest()
@@ -74,6 +81,7 @@ void UtilityTest::test_datetimeToNumber_data()
 
     QTest::newRow("1904: 0") << QDateTime(QDate(1904, 1, 1), QTime(0,0)) << true << 0.0;
     QTest::newRow("1904: 1.25") << QDateTime(QDate(1904, 1, 2), QTime(6, 0)) << true << 1.25;
+    QTest::newRow("UTC") << QDateTime(QDate(2014, 2, 1), QTime(18, 0), Qt::UTC) << false << 41671.75;
 }
 
 void UtilityTest::test_datetimeToNumber()
@@ -82,7 +90,9 @@ void UtilityTest::test_datetimeToNumber()
     QFETCH(bool, is1904);
     QFETCH(double, num);
 
-    QCOMPARE(QXlsx::datetimeToNumber(dt, is1904), num);
+    QCOMPARE(QXlsx::datetimeToNumber(dt, is1904, true), num);
+    QCOMPARE(QXlsx::datetimeToNumber(dt, is1904),
+             QXlsx::datetimeToNumber(dt.toLocalTime(), is1904, true));
 }
 
 void UtilityTest::test_timeToNumber_data()
@@ -127,6 +137,51 @@ void UtilityTest::test_datetimeFromNumber()
     QFETCH(double, num);
 
     QCOMPARE(QXlsx::datetimeFromNumber(num, is1904), dt);
+    QCOMPARE(QXlsx::datetimeFromNumber(num, is1904, Qt::UTC),
+             QDateTime(dt.date(), dt.time(), Qt::UTC));
+}
+
+void UtilityTest::test_daysFromCivil_data()
+{
+    QTest::addColumn<QDate>("date");
+    QTest::addColumn<qint64>("days");
+
+    QTest::newRow("1970-01-01") << QDate(1970, 1, 1) << qint64(0);
+    QTest::newRow("1899-12-31") << QDate(1899, 12, 31) << qint64(-25568);
+    QTest::newRow("1904-01-01") << QDate(1904, 1, 1) << qint64(-24107);
+    QTest::newRow("2000-02-29") << QDate(2000, 2, 29) << qint64(11016);
+    QTest::newRow("9999-12-31") << QDate(9999, 12, 31) << qint64(2932896);
+}
+
+void UtilityTest::test_daysFromCivil()
+{
+    QFETCH(QDate, date);
+    QFETCH(qint64, days);
+
+    QCOMPARE(QXlsx::daysFromCivil(date.year(), date.month(), date.day()), days);
+    int year, month, day;
+    QXlsx::civilFromDays(days, &year, &month, &day);
+    QCOMPARE(QDate(year, month, day), date);
+}
+
+void UtilityTest::test_daysToNumbers()
+{
+    const qint64 days[] = { QXlsx::daysFromCivil(1900, 2, 28), QXlsx::daysFromCivil(1900, 3, 1),
+                            QXlsx::daysFromCivil(2014, 14, 1) };
+    const qint64 msecs[] = { 0, 6 * 60 * 60 * 1000, 12 * 60 * 60 * 1000 };
+    double nums[3];
+    QXlsx::daysToNumbers(days, msecs, nums, 3);
+    QCOMPARE(nums[0], 59.0);
+    QCOMPARE(nums[1], 61.25);
+    QCOMPARE(nums[2], 42036.5);
+
+    qint64 days2[3];
+    qint64 msecs2[3];
+    QXlsx::daysFromNumbers(nums, days2, msecs2, 3);
+    for (int i = 0; i < 3; ++i) {
+        QCOMPARE(days2[i], days[i]);
+        QCOMPARE(msecs2[i], msecs[i]);
+    }
 }
 
 void UtilityTest::test_createSafeSheetName_data()
@@ -218,6 +273,44 @@ void UtilityTest::test_convertSharedFormula()
 
     QCOMPARE(QXlsx::convertSharedFormula(original, rootCell, cell), result);
 }
+
+void UtilityTest::test_shiftFormulaReferences_data()
+{
+    QTest::addColumn<QString>("original");
+    QTest::addColumn<bool>("rows");
+    QTest::addColumn<int>("index");
+    QTest::addColumn<int>("count");
+    QTest::addColumn<QString>("result");
+
+    QTest::newRow("[Insert row]") << QString("A1+A2*$B$3")<<true<<2<<1<<QString("A1+A3*$B$4");
+    QTest::newRow("[Insert column]") << QString("A1+B2*$C3")<<false<<2<<2<<QString("A1+D2*$E3");
+    QTest::newRow("[Grow range]") << QString("SUM(A1:A3)")<<true<<2<<1<<QString("SUM(A1:A4)");
+    QTest::newRow("[Delete row]") << QString("A1+A2+A3")<<true<<2<<-1<<QString("A1+#REF!+A2");
+    QTest::newRow("[Shrink range]") << QString("SUM(A1:A3)")<<true<<2<<-1<<QString("SUM(A1:A2)");
+    QTest::newRow("[Delete range]") << QString("SUM(A2:A3)")<<true<<2<<-2<<QString("SUM(#REF!)");
+    QTest::newRow("[Function]") << QString("LOG10(A2)")<<true<<1<<1<<QString("LOG10(A3)");
+    QTest::newRow("[Quote]") << QString("CONCATENATE(\"A2\",A2)")<<true<<1<<1<<QString("CONCATENATE(\"A2\",A3)");
+    QTest::newRow("[Home sheet]") << QString("Data!A2+A2")<<true<<1<<1<<QString("Data!A3+A3");
+    QTest::newRow("[Other sheet]") << QString("Other!A2+'Data'!A2")<<true<<1<<1<<QString("Other!A2+'Data'!A3");
+    QTest::newRow("[Whole rows]") << QString("SUM(2:$4)+SUM(A:A)")<<true<<3<<2<<QString("SUM(2:$6)+SUM(A:A)");
+    QTest::newRow("[Whole columns]") << QString("SUM($B:C)+A1:B2")<<false<<1<<1<<QString("SUM($C:D)+B1:C2");
+    QTest::newRow("[Delete whole rows]") << QString("SUM(2:3)+SUM(Data!5:5)")<<true<<2<<-2<<QString("SUM(#REF!)+SUM(Data!3:3)");
+    QTest::newRow("[Other sheet rows]") << QString("SUM(Other!2:3)")<<true<<1<<1<<QString("SUM(Other!2:3)");
+}
+
+void UtilityTest::test_shiftFormulaReferences()
+{
+    QFETCH(QString, original);
+    QFETCH(bool, rows);
+    QFETCH(int, index);
+    QFETCH(int, count);
+    QFETCH(QString, result);
+
+    QCOMPARE(QXlsx::shiftFormulaReferences(original, rows ? Qt::Vertical : Qt::Horizontal, index,
+                                           count, QString("Data"), true),
+             result);
+}
+
 QTEST_APPLESS_MAIN(UtilityTest)
 
 #include "tst_utilitytest.moc"
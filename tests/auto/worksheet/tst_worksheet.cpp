@@ -1,15 +1,21 @@
 #include <QBuffer>
 #include <QtTest>
+#include <QThread>
 #include <QXmlStreamReader>
 
 #include "xlsxworksheet.h"
 #include "xlsxcell.h"
 #include "xlsxcellrange.h"
 #include "xlsxdatavalidation.h"
+#include "xlsxconditionalformatting.h"
+#include "xlsxformat.h"
 #include "private/xlsxworksheet_p.h"
+#include "private/xlsxcellarena_p.h"
 #include "private/xlsxsharedstrings_p.h"
 #include "xlsxrichstring.h"
 #include "xlsxcellformula.h"
+#include "xlsxdocument.h"
+#include "xlsxworkbook.h"
 
 class WorksheetTest : public QObject
 {
@@ -21,6 +27,7 @@ public:
 private Q_SLOTS:
     void testEmptySheet();
     void testDimension();
+    void testRowSpans();
     void testSheetView();
     void testSetColumn();
 
@@ -29,8 +36,18 @@ private Q_SLOTS:
     void testWriteDataValidations();
     void testMerge();
     void testUnMerge();
+    void testInsertDeleteRows();
+    void testInsertDeleteColumns();
+    void testInsertRowsFormulaReferences();
+    void testCellArena();
+    void testCellArenaSharedCells();
+    void testCellShareGeneration();
+    void testCellArenaReleaseFromThread();
+    void testTypedAccessors();
+    void testDateTimes();
 
     void testReadSheetData();
+    void testReadSheetDataWithoutReferences();
     void testReadColsInfo();
     void testReadRowsInfo();
     void testReadMergeCells();
@@ -69,6 +86,29 @@ void WorksheetTest::testDimension()
     QCOMPARE(sheet.dimension(), QXlsx::CellRange(2, 2, 10000, 10000));
 }
 
+void WorksheetTest::testRowSpans()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.write("B2", 1);
+    sheet.write("D16", 2);
+    sheet.write("E17", 3);
+    sheet.write("XFD1048576", 4);
+
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY(xmldata.contains("<row r=\"2\" spans=\"2:4\">"));
+    QVERIFY(xmldata.contains("<row r=\"16\" spans=\"2:4\">"));
+    QVERIFY(xmldata.contains("<row r=\"17\" spans=\"5:5\">"));
+    QVERIFY(xmldata.contains("<row r=\"1048576\" spans=\"16384:16384\">"));
+    QCOMPARE(sheet.dimension(), QXlsx::CellRange("B2:XFD1048576"));
+
+    // Moved cells get their spans recalculated
+    QVERIFY(sheet.deleteRows(1));
+    xmldata = sheet.saveToXmlData();
+    QVERIFY(xmldata.contains("<row r=\"1\" spans=\"2:5\">"));
+    QVERIFY(xmldata.contains("<row r=\"16\" spans=\"2:5\">"));
+    QVERIFY(xmldata.contains("<row r=\"1048575\" spans=\"16384:16384\">"));
+}
+
 void WorksheetTest::testSheetView()
 {
     QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
@@ -181,6 +221,273 @@ void WorksheetTest::testUnMerge()
     QVERIFY2(!xmldata.contains("<mergeCell"), "");
 }
 
+void WorksheetTest::testInsertDeleteRows()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.write("A1", 1);
+    sheet.write("A2", 2);
+    sheet.write("A3", 3);
+    sheet.write("B1", "=SUM(A1:A3)*$A$2");
+    sheet.write("B4", "=A3+A1");
+    sheet.mergeCells("C2:D3");
+
+    QVERIFY(sheet.insertRows(2, 2));
+    QCOMPARE(sheet.read("A1").toInt(), 1);
+    QVERIFY(!sheet.cellAt("A2"));
+    QCOMPARE(sheet.read("A4").toInt(), 2);
+    QCOMPARE(sheet.read("A5").toInt(), 3);
+    QCOMPARE(sheet.cellAt("B1")->formula().formulaText(), QString("SUM(A1:A5)*$A$4"));
+    QCOMPARE(sheet.cellAt("B6")->formula().formulaText(), QString("A5+A1"));
+    QCOMPARE(sheet.mergedCells(), QList<QXlsx::CellRange>() << QXlsx::CellRange("C4:D5"));
+    QCOMPARE(sheet.dimension(), QXlsx::CellRange("A1:D6"));
+
+    QVERIFY(sheet.deleteRows(4));
+    QCOMPARE(sheet.read("A4").toInt(), 3);
+    QCOMPARE(sheet.cellAt("B1")->formula().formulaText(), QString("SUM(A1:A4)*#REF!"));
+    QCOMPARE(sheet.cellAt("B5")->formula().formulaText(), QString("A4+A1"));
+    QCOMPARE(sheet.mergedCells(), QList<QXlsx::CellRange>() << QXlsx::CellRange("C4:D4"));
+
+    QVERIFY(!sheet.insertRows(0));
+    QVERIFY(!sheet.insertRows(1, 1048576));
+}
+
+void WorksheetTest::testInsertDeleteColumns()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.write("A1", 1);
+    sheet.write("B1", 2);
+    sheet.write("C1", 3);
+    sheet.write("A2", "=A1+C1");
+    sheet.writeFormula("B2", QXlsx::CellFormula("B1*2", QXlsx::CellRange("B2:C2"),
+                                                   QXlsx::CellFormula::SharedType));
+    sheet.setColumnWidth(2, 3, 20.0);
+
+    QVERIFY(sheet.insertColumns(2));
+    QCOMPARE(sheet.read("A1").toInt(), 1);
+    QVERIFY(!sheet.cellAt("B1"));
+    QCOMPARE(sheet.read("C1").toInt(), 2);
+    QCOMPARE(sheet.read("D1").toInt(), 3);
+    QCOMPARE(sheet.cellAt("A2")->formula().formulaText(), QString("A1+D1"));
+    QCOMPARE(sheet.cellAt("C2")->formula().formulaText(), QString("C1*2"));
+    QCOMPARE(sheet.cellAt("C2")->formula().reference(), QXlsx::CellRange("C2:D2"));
+    QCOMPARE(sheet.columnWidth(2), sheet.columnWidth(1));
+    QCOMPARE(sheet.columnWidth(3), 20.0);
+    QCOMPARE(sheet.columnWidth(4), 20.0);
+
+    // The shared formula can't stay shared once part of its group is deleted
+    QVERIFY(sheet.deleteColumns(3));
+    QCOMPARE(sheet.read("C1").toInt(), 3);
+    QCOMPARE(sheet.cellAt("A2")->formula().formulaText(), QString("A1+C1"));
+    QCOMPARE(sheet.cellAt("C2")->formula().formulaType(), QXlsx::CellFormula::NormalType);
+    QCOMPARE(sheet.cellAt("C2")->formula().formulaText(), QString("C1*2"));
+}
+
+void WorksheetTest::testInsertRowsFormulaReferences()
+{
+    QXlsx::Document xlsx;
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    xlsx.addSheet("Data");
+    QXlsx::Worksheet *data = static_cast<QXlsx::Worksheet *>(xlsx.sheet("Data"));
+    sheet->write("A1", "=SUM(3:5)+SUM(Data!2:4)");
+    sheet->write("B1", "=SUM(B:C)+SUM(\"3:5\")");
+    QXlsx::DataValidation validation(QXlsx::DataValidation::Whole,
+                                     QXlsx::DataValidation::LessThan, "A4");
+    validation.addCell("C2");
+    sheet->addDataValidation(validation);
+    QXlsx::DataValidation list(QXlsx::DataValidation::List, QXlsx::DataValidation::Between,
+                               "Data!$A$1:$A$5");
+    list.addCell("C3");
+    sheet->addDataValidation(list);
+    QXlsx::ConditionalFormatting cf;
+    QXlsx::Format red;
+    red.setFontColor(Qt::red);
+    cf.addHighlightCellsRule(QXlsx::ConditionalFormatting::Highlight_Expression, "$A4>0", red);
+    cf.addRange("D1:D10");
+    sheet->addConditionalFormatting(cf);
+
+    QVERIFY(sheet->insertRows(4, 2));
+    QCOMPARE(sheet->cellAt("A1")->formula().formulaText(), QString("SUM(3:7)+SUM(Data!2:4)"));
+    QCOMPARE(sheet->cellAt("B1")->formula().formulaText(), QString("SUM(B:C)+SUM(\"3:5\")"));
+    QCOMPARE(sheet->d_func()->dataValidationsList[0].formula1(), QString("A6"));
+    QCOMPARE(sheet->d_func()->dataValidationsList[1].formula1(), QString("Data!$A$1:$A$5"));
+    QVERIFY(sheet->saveToXmlData().contains("<formula>$A6&gt;0</formula>"));
+    // The conditional format added is a copy, which keeps its rule
+    QCOMPARE(cf.ranges().first(), QXlsx::CellRange("D1:D10"));
+
+    QVERIFY(data->insertRows(1));
+    QCOMPARE(sheet->cellAt("A1")->formula().formulaText(), QString("SUM(3:7)+SUM(Data!3:5)"));
+    QCOMPARE(sheet->d_func()->dataValidationsList[1].formula1(), QString("Data!$A$2:$A$6"));
+
+    QVERIFY(sheet->insertColumns(1));
+    QCOMPARE(sheet->cellAt("C1")->formula().formulaText(), QString("SUM(C:D)+SUM(\"3:5\")"));
+    sheet->write("F1", "=COUNT(D:D)");
+    QVERIFY(sheet->deleteColumns(4));
+    QCOMPARE(sheet->cellAt("C1")->formula().formulaText(), QString("SUM(C:C)+SUM(\"3:5\")"));
+    QCOMPARE(sheet->cellAt("E1")->formula().formulaText(), QString("COUNT(#REF!)"));
+}
+
+void WorksheetTest::testCellArena()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    QXlsx::CellArena *arena = sheet.d_func()->cellArena;
+    for (int row = 1; row <= 1000; ++row)
+        sheet.write(row, 1, row);
+    QCOMPARE(arena->cellCount(), 1000);
+    QCOMPARE(arena->chunkCount(), 2);
+
+    // Overwritten cells give their records back
+    for (int row = 1; row <= 1000; ++row)
+        sheet.write(row, 1, "text");
+    QCOMPARE(arena->cellCount(), 1000);
+    QCOMPARE(arena->chunkCount(), 2);
+    QCOMPARE(sheet.cellAt(1000, 1)->value().toString(), QString("text"));
+
+    QVERIFY(sheet.deleteRows(1, 500));
+    QCOMPARE(arena->cellCount(), 500);
+}
+
+void WorksheetTest::testCellArenaSharedCells()
+{
+    // The cells shared with a copy outlive the sheet which allocated them
+    QXlsx::Document xlsx;
+    xlsx.addSheet("Sheet1");
+    for (int row = 1; row <= 100; ++row)
+        xlsx.write(row, 1, row);
+    QVERIFY(xlsx.copySheet("Sheet1", "Sheet2"));
+    QVERIFY(xlsx.deleteSheet("Sheet1"));
+    QVERIFY(xlsx.selectSheet("Sheet2"));
+    QCOMPARE(xlsx.read(100, 1).toInt(), 100);
+
+    xlsx.write(1, 1, "changed");
+    QCOMPARE(xlsx.read(1, 1).toString(), QString("changed"));
+}
+
+void WorksheetTest::testCellShareGeneration()
+{
+    QXlsx::Document xlsx;
+    xlsx.write("A1", 1);
+    xlsx.write("A2", 2);
+    QVERIFY(xlsx.copySheet("Sheet1", "Copy"));
+    xlsx.write("A3", 3);
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    QXlsx::WorksheetPrivate *d = QXlsx::WorksheetPrivate::get(sheet);
+
+    // The cells held by the copy are copied once before being modified
+    const QXlsx::Cell *shared = sheet->cellAt("A1");
+    QXlsx::Format format;
+    format.setFontBold(true);
+    QVERIFY(sheet->mergeCells("A1:B1", format));
+    QXlsx::Cell *cell = sheet->cellAt("A1");
+    QVERIFY(cell != shared);
+    QCOMPARE(cell->format(), format);
+    QCOMPARE(d->detachCell(1, 1), cell);
+    QXlsx::Worksheet *copy = static_cast<QXlsx::Worksheet *>(xlsx.sheet("Copy"));
+    QVERIFY(!copy->cellAt("A1")->format().isValid());
+
+    // The cells created after the copy are modified in place
+    const QXlsx::Cell *own = sheet->cellAt("A3");
+    QCOMPARE(d->detachCell(3, 1), own);
+
+    // Another copy shares the cells again
+    QVERIFY(xlsx.copySheet("Sheet1", "Copy2"));
+    QVERIFY(d->detachCell(3, 1) != own);
+    QVERIFY(d->detachCell(1, 1) != cell);
+}
+
+// Drops the last references on cells, like the thread of an asynchronous save
+class CellReleaser : public QThread
+{
+public:
+    void run() { cells.clear(); }
+
+    QList<QSharedPointer<QXlsx::Cell>> cells;
+};
+
+void WorksheetTest::testCellArenaReleaseFromThread()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    QXlsx::CellArena *arena = sheet.d_func()->cellArena;
+    CellReleaser releaser;
+    for (int i = 0; i < 2000; ++i) {
+        releaser.cells.append(
+            arena->createCell(i, QXlsx::Cell::NumberType, QXlsx::Format(), &sheet));
+    }
+
+    // The sheet allocates while the other thread releases
+    releaser.start();
+    for (int row = 1; row <= 2000; ++row)
+        sheet.write(row, 1, row);
+    releaser.wait();
+    QCOMPARE(arena->cellCount(), 2000);
+
+    // The released records are reused
+    int chunks = arena->chunkCount();
+    for (int row = 1; row <= 2000; ++row)
+        sheet.write(row, 1, "text");
+    QCOMPARE(arena->chunkCount(), chunks);
+    QCOMPARE(arena->cellCount(), 2000);
+    QCOMPARE(sheet.cellAt(2000, 1)->value().toString(), QString("text"));
+}
+
+void WorksheetTest::testTypedAccessors()
+{
+    QXlsx::Document xlsx;
+    QXlsx::Format format;
+    format.setNumberFormat("0.00");
+    xlsx.write("A1", 1.5, format);
+    xlsx.write("A2", "first");
+    xlsx.write("A3", "second");
+    xlsx.write("A4", true);
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+
+    bool ok = false;
+    QCOMPARE(sheet->readDouble(1, 1, &ok), 1.5);
+    QVERIFY(ok);
+    QCOMPARE(sheet->readDouble("A2", &ok), 0.0);
+    QVERIFY(!ok);
+    sheet->readDouble(1, 10, &ok);
+    QVERIFY(!ok);
+
+    QXlsx::Cell *cell = sheet->cellAt("A1");
+    QCOMPARE(cell->numericValue(&ok), 1.5);
+    QVERIFY(ok);
+    QCOMPARE(cell->xfIndex(), format.xfIndex());
+    QCOMPARE(cell->sharedStringIndex(), -1);
+    QVERIFY(cell->stringView().isNull());
+
+    QCOMPARE(sheet->cellAt("A2")->sharedStringIndex(), 0);
+    QCOMPARE(sheet->cellAt("A3")->sharedStringIndex(), 1);
+    QCOMPARE(sheet->cellAt("A3")->stringView().toString(), QString("second"));
+    QCOMPARE(sheet->cellAt("A4")->xfIndex(), 0);
+    QVERIFY(!sheet->cellAt("A4")->numericValue(&ok) && !ok);
+}
+
+void WorksheetTest::testDateTimes()
+{
+    QXlsx::Document xlsx;
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    const QDateTime utc(QDate(2014, 2, 1), QTime(18, 0), Qt::UTC);
+    sheet->writeDateTime(1, 1, utc);
+    QCOMPARE(sheet->cellAt(1, 1)->dateTime(), utc.toLocalTime());
+
+    QList<QDateTime> dts;
+    dts << QDateTime(QDate(2014, 2, 1), QTime(6, 0)) << QDateTime(QDate(1900, 3, 1))
+        << QDateTime(QDate(2001, 12, 31), QTime(23, 59, 59));
+    QVERIFY(sheet->writeDateTimes(QXlsx::CellRange("B1:C2"), dts));
+    QCOMPARE(sheet->cellAt("C1")->dateTime(), dts[1]);
+    QVERIFY(!sheet->cellAt("C2"));
+    QCOMPARE(sheet->dimension(), QXlsx::CellRange("A1:C2"));
+    QList<QDateTime> read = sheet->readDateTimes(QXlsx::CellRange("B1:C2"));
+    QCOMPARE(read.mid(0, 3), dts);
+    QVERIFY(!read[3].isValid());
+
+    xlsx.workbook()->setNaiveDateTimeEnabled();
+    sheet->writeDateTime(1, 1, utc);
+    QCOMPARE(sheet->cellAt(1, 1)->dateTime(), utc);
+    QCOMPARE(sheet->cellAt(1, 1)->dateTime().timeSpec(), Qt::UTC);
+    QCOMPARE(sheet->readDateTimes(QXlsx::CellRange("A1")), QList<QDateTime>() << utc);
+}
+
 void WorksheetTest::testReadSheetData()
 {
     const QByteArray xmlData = "<sheetData>"
@@ -231,6 +538,27 @@ void WorksheetTest::testReadSheetData()
     QCOMPARE(sheet.cellAt("E3")->value().toString(), QStringLiteral("#DIV/0!"));
 }
 
+void WorksheetTest::testReadSheetDataWithoutReferences()
+{
+    // "r" is optional for both rows and cells
+    const QByteArray xmlData = "<sheetData>"
+            "<row><c><v>1</v></c><c><v>2</v></c></row>"
+            "<row r=\"3\"><c r=\"C3\"><v>3</v></c><c><v>4</v></c></row>"
+            "<row><c><v>5</v></c></row>"
+            "</sheetData>";
+    QXmlStreamReader reader(xmlData);
+    reader.readNextStartElement();//current node is sheetData
+
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_LoadFromExists);
+    sheet.d_func()->loadXmlSheetData(reader);
+
+    QCOMPARE(sheet.read("A1").toInt(), 1);
+    QCOMPARE(sheet.read("B1").toInt(), 2);
+    QCOMPARE(sheet.read("C3").toInt(), 3);
+    QCOMPARE(sheet.read("D3").toInt(), 4);
+    QCOMPARE(sheet.read("A4").toInt(), 5);
+}
+
 void WorksheetTest::testReadColsInfo()
 {
     const QByteArray xmlData = "<cols>"
@@ -7,6 +7,7 @@
 QT       += testlib xlsx xlsx-private
 CONFIG += testcase
 DEFINES += XLSX_TEST
+xlsx_tsan:CONFIG += sanitizer sanitize_thread
 
 TARGET = tst_worksheet
 CONFIG   += console
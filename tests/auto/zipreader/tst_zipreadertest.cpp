@@ -1,4 +1,5 @@
 #include "private/xlsxzipreader_p.h"
+#include "private/xlsxzipwriter_p.h"
 #include <QString>
 #include <QtTest>
 #include <QBuffer>
@@ -14,6 +15,7 @@ public:
     
 private Q_SLOTS:
     void testFileList();
+    void testEntryCopy();
 };
 
 ZipReaderTest::ZipReaderTest()
@@ -35,6 +37,47 @@ void ZipReaderTest::testFileList()
     QCOMPARE(reader.fileData("qt/xlsx.txt"), QByteArray("Xlsx"));
 }
 
+void ZipReaderTest::testEntryCopy()
+{
+    QByteArray data(fileContent, sizeof(fileContent) - 1);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer);
+
+    QXlsx::ZipEntry hello = reader.entry("hello.txt");
+    QVERIFY(hello.isValid());
+    QCOMPARE(hello.compressionMethod, quint16(0));
+    QCOMPARE(hello.crc32, quint32(0xF7D18982));
+    QCOMPARE(hello.data, QByteArray("Hello"));
+    QVERIFY(!reader.entry("missing.txt").isValid());
+
+    // Entries are copied as they are stored, next to deflated ones
+    const QByteArray text(4000, 'x');
+    QByteArray copied;
+    QBuffer copyBuffer(&copied);
+    copyBuffer.open(QIODevice::WriteOnly);
+    QXlsx::ZipEntry deflated;
+    {
+        QXlsx::ZipWriter writer(&copyBuffer);
+        writer.addEntry("hello.txt", hello);
+        deflated = writer.addFile("text.txt", text);
+        writer.close();
+        QVERIFY(!writer.error());
+    }
+    QCOMPARE(deflated.compressionMethod, quint16(8));
+    QVERIFY(deflated.data.size() < text.size());
+    copyBuffer.close();
+
+    copyBuffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader copyReader(&copyBuffer);
+    QCOMPARE(copyReader.filePaths(), QStringList() << "hello.txt"
+                                                   << "text.txt");
+    QCOMPARE(copyReader.fileData("hello.txt"), QByteArray("Hello"));
+    QCOMPARE(copyReader.fileData("text.txt"), text);
+    QCOMPARE(copyReader.entry("hello.txt").dosTime, hello.dosTime);
+    QCOMPARE(copyReader.entry("text.txt").data, deflated.data);
+}
+
 QTEST_APPLESS_MAIN(ZipReaderTest)
 
 #include "tst_zipreadertest.moc"
@@ -1,3 +1,7 @@
 TEMPLATE = subdirs
 SUBDIRS += \
-    xmlspace
+    xmlspace \
+    sharedformula \
+    sparsesheet \
+    workloads \
+    corpusgen
@@ -0,0 +1,11 @@
+QT       += xlsx xlsx-private
+DEFINES += XLSX_TEST
+
+TARGET = corpusgen
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += main.cpp
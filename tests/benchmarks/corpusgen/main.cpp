@@ -0,0 +1,415 @@
+/*
+  Generates large workbooks to be used as benchmark fixtures.
+
+  The cells and styles of the workbooks only depend on the seed and the
+  size parameters, so the same corpus can be regenerated anywhere. The
+  files are not identical from one run to the next though: the modified
+  date of docProps/core.xml and the timestamps of the zip entries are
+  those of the save. Besides the workbooks written through Document, some
+  "foreign" variants are produced by rewriting the saved package into
+  valid forms this library doesn't write itself, as other producers do,
+  and "malformed" ones into forms the schema doesn't allow, which readers
+  may still meet.
+
+  Usage: corpusgen [options] [shape...]
+ */
+
+#include "xlsxdocument.h"
+#include "xlsxworksheet.h"
+#include "xlsxformat.h"
+#include "xlsxrichstring.h"
+#include "xlsxcellformula.h"
+#include "xlsxcellrange.h"
+#include "xlsxcellreference.h"
+#include "private/xlsxzipreader_p.h"
+#include "private/xlsxzipwriter_p.h"
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+QTXLSX_USE_NAMESPACE
+
+/*
+  xorshift64* generator, so that the corpus doesn't depend on the
+  implementation of the C library's rand().
+ */
+class Random
+{
+public:
+    explicit Random(quint64 seed)
+        : m_state(seed * Q_UINT64_C(0x9E3779B97F4A7C15) + 1)
+    {
+    }
+
+    quint32 next()
+    {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return quint32((m_state * Q_UINT64_C(0x2545F4914F6CDD1D)) >> 32);
+    }
+
+    // Returns a number in [0, bound)
+    int bounded(int bound) { return int((quint64(next()) * quint64(bound)) >> 32); }
+
+    QString word(int minLength, int maxLength)
+    {
+        const int length = minLength + bounded(maxLength - minLength + 1);
+        QString text(length, Qt::Uninitialized);
+        for (int i = 0; i < length; ++i)
+            text[i] = QLatin1Char(char('a' + bounded(26)));
+        return text;
+    }
+
+private:
+    quint64 m_state;
+};
+
+struct Options
+{
+    quint64 seed;
+    int rows;
+    int columns;
+    int sheets;
+    int styles;
+    int fragments;
+};
+
+static Format randomFormat(Random &random)
+{
+    Format format;
+    format.setFontBold(random.bounded(2));
+    format.setFontItalic(random.bounded(2));
+    format.setFontSize(8 + random.bounded(12));
+    format.setFontColor(QColor(random.bounded(256), random.bounded(256), random.bounded(256)));
+    if (random.bounded(2))
+        format.setPatternBackgroundColor(
+            QColor(random.bounded(256), random.bounded(256), random.bounded(256)));
+    format.setNumberFormatIndex(random.bounded(50));
+    return format;
+}
+
+// Cells scattered over the whole A1:XFD1048576 range
+static void generateWideSparse(Document &xlsx, Random &random, const Options &options)
+{
+    const qint64 count = qint64(options.rows) * options.columns;
+    for (qint64 i = 0; i < count; ++i) {
+        const int row = 1 + random.bounded(1048576);
+        const int column = 1 + random.bounded(16384);
+        if (random.bounded(4))
+            xlsx.write(row, column, random.next() / 1000.0);
+        else
+            xlsx.write(row, column, random.word(3, 12));
+    }
+    // Make the dimension span the whole sheet
+    xlsx.write(1, 1, 0);
+    xlsx.write(1048576, 16384, 0);
+}
+
+// Unique rich text strings made of many fragments
+static void generateRichStrings(Document &xlsx, Random &random, const Options &options)
+{
+    QList<Format> formats;
+    for (int i = 0; i < 32; ++i)
+        formats.append(randomFormat(random));
+
+    for (int row = 1; row <= options.rows; ++row) {
+        for (int column = 1; column <= options.columns; ++column) {
+            RichString text;
+            for (int i = 0; i < options.fragments; ++i)
+                text.addFragment(random.word(1, 10) + QLatin1Char(' '),
+                                 formats[random.bounded(formats.size())]);
+            xlsx.write(row, column, QVariant::fromValue(text));
+        }
+    }
+}
+
+// Dense cells using thousands of distinct formats
+static void generateStyles(Document &xlsx, Random &random, const Options &options)
+{
+    QList<Format> formats;
+    for (int i = 0; i < options.styles; ++i)
+        formats.append(randomFormat(random));
+
+    for (int row = 1; row <= options.rows; ++row) {
+        for (int column = 1; column <= options.columns; ++column)
+            xlsx.write(row, column, random.bounded(100000),
+                       formats[random.bounded(formats.size())]);
+    }
+}
+
+// A column of values and one shared formula group per other column
+static void generateSharedFormulas(Document &xlsx, Random &random, const Options &options)
+{
+    for (int row = 1; row <= options.rows; ++row)
+        xlsx.write(row, 1, random.bounded(1000));
+
+    Worksheet *sheet = xlsx.currentWorksheet();
+    for (int column = 2; column <= options.columns; ++column) {
+        const QString text = QStringLiteral("%1*%2+SUM($A$1:A1)")
+                                 .arg(CellReference(1, column - 1).toString())
+                                 .arg(1 + random.bounded(9));
+        sheet->writeFormula(1, column,
+                            CellFormula(text, CellRange(1, column, options.rows, column),
+                                        CellFormula::SharedType));
+    }
+}
+
+// Many sheets of moderate size
+static void generateManySheets(Document &xlsx, Random &random, const Options &options)
+{
+    const int rows = qMax(1, options.rows / options.sheets);
+    for (int i = 0; i < options.sheets; ++i) {
+        if (i > 0)
+            xlsx.addSheet();
+        for (int row = 1; row <= rows; ++row) {
+            for (int column = 1; column <= options.columns; ++column) {
+                if (column % 3)
+                    xlsx.write(row, column, random.next() / 1000.0);
+                else
+                    xlsx.write(row, column, random.word(3, 12));
+            }
+        }
+    }
+}
+
+// Strings stored inline in the cells instead of in the shared string table
+static void generateInlineStrings(Document &xlsx, Random &random, const Options &options)
+{
+    Worksheet *sheet = xlsx.currentWorksheet();
+    for (int row = 1; row <= options.rows; ++row) {
+        for (int column = 1; column <= options.columns; ++column)
+            sheet->writeInlineString(row, column, random.word(3, 24));
+    }
+}
+
+static void generateMixed(Document &xlsx, Random &random, const Options &options)
+{
+    for (int row = 1; row <= options.rows; ++row) {
+        for (int column = 1; column <= options.columns; ++column) {
+            switch (random.bounded(3)) {
+            case 0:
+                xlsx.write(row, column, random.next() / 1000.0);
+                break;
+            case 1:
+                xlsx.write(row, column, random.word(3, 12));
+                break;
+            default:
+                xlsx.write(row, column, bool(random.bounded(2)));
+                break;
+            }
+        }
+    }
+}
+
+/*
+  Copy the sheet XML without the "r" attributes of the rows and cells,
+  which are optional.
+ */
+static QByteArray removeCellReferences(const QByteArray &data)
+{
+    QByteArray result;
+    QXmlStreamReader reader(data);
+    QXmlStreamWriter writer(&result);
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()
+            && (reader.name() == QLatin1String("row") || reader.name() == QLatin1String("c"))) {
+            writer.writeStartElement(reader.namespaceUri().toString(), reader.name().toString());
+            foreach (const QXmlStreamNamespaceDeclaration &declaration,
+                     reader.namespaceDeclarations())
+                writer.writeNamespace(declaration.namespaceUri().toString(),
+                                      declaration.prefix().toString());
+            foreach (const QXmlStreamAttribute &attribute, reader.attributes()) {
+                if (attribute.name() != QLatin1String("r"))
+                    writer.writeAttribute(attribute);
+            }
+        } else if (!reader.hasError()) {
+            writer.writeCurrentToken(reader);
+        }
+    }
+    return result;
+}
+
+/*
+  Reverse the order of the sections of the style sheet, such as the
+  fonts, fills and cellXfs. The schema requires them in order, so the
+  result is malformed, but tolerant readers accept it.
+ */
+static QByteArray reverseStyleSections(const QByteArray &data)
+{
+    const QString text = QString::fromUtf8(data);
+    QXmlStreamReader reader(text);
+    QList<QPair<qint64, qint64>> sections;
+    qint64 previous = 0;
+    qint64 start = 0;
+    int depth = 0;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            if (++depth == 2)
+                start = previous;
+        } else if (reader.isEndElement()) {
+            if (depth-- == 2)
+                sections.append(qMakePair(start, reader.characterOffset()));
+        }
+        previous = reader.characterOffset();
+    }
+    if (sections.size() < 2)
+        return data;
+
+    QString result = text.left(sections.first().first);
+    for (int i = sections.size() - 1; i >= 0; --i)
+        result += text.mid(sections[i].first, sections[i].second - sections[i].first);
+    result += text.mid(sections.last().second);
+    return result.toUtf8();
+}
+
+/*
+  Rewrite the parts of the package \a fileName whose path starts with
+  \a prefix using \a transform.
+ */
+static bool rewritePackage(const QString &fileName, const QString &prefix,
+                           QByteArray (*transform)(const QByteArray &))
+{
+    QByteArray package;
+    {
+        ZipReader reader(fileName);
+        if (!reader.exists())
+            return false;
+        QBuffer buffer(&package);
+        buffer.open(QIODevice::WriteOnly);
+        ZipWriter writer(&buffer);
+        foreach (const QString &path, reader.filePaths()) {
+            const QByteArray data = reader.fileData(path);
+            writer.addFile(path, path.startsWith(prefix) ? transform(data) : data);
+        }
+        writer.close();
+        if (writer.error())
+            return false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    return file.write(package) == package.size();
+}
+
+typedef void (*Generator)(Document &, Random &, const Options &);
+
+struct Shape
+{
+    const char *name;
+    Generator generate;
+    const char *rewrittenPrefix;
+    QByteArray (*rewrite)(const QByteArray &);
+};
+
+static const Shape shapes[] = {
+    { "wide-sparse", generateWideSparse, 0, 0 },
+    { "rich-sst", generateRichStrings, 0, 0 },
+    { "styles", generateStyles, 0, 0 },
+    { "shared-formulas", generateSharedFormulas, 0, 0 },
+    { "many-sheets", generateManySheets, 0, 0 },
+    { "foreign-no-refs", generateMixed, "xl/worksheets/", removeCellReferences },
+    { "foreign-inline-strings", generateInlineStrings, 0, 0 },
+    { "malformed-unordered-styles", generateStyles, "xl/styles.xml", reverseStyleSections },
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList shapeNames;
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); ++i)
+        shapeNames.append(QString::fromLatin1(shapes[i].name));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Generates large workbooks for benchmarks."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(
+        QStringLiteral("shape"),
+        QStringLiteral("Workbook shapes to generate, all by default: %1")
+            .arg(shapeNames.join(QStringLiteral(", "))));
+    QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("Random seed."),
+                                  QStringLiteral("n"), QStringLiteral("1"));
+    QCommandLineOption rowsOption(QStringLiteral("rows"), QStringLiteral("Rows per sheet."),
+                                  QStringLiteral("n"), QStringLiteral("10000"));
+    QCommandLineOption columnsOption(QStringLiteral("columns"),
+                                     QStringLiteral("Columns per sheet."), QStringLiteral("n"),
+                                     QStringLiteral("10"));
+    QCommandLineOption sheetsOption(QStringLiteral("sheets"),
+                                    QStringLiteral("Sheets of the many-sheets shape."),
+                                    QStringLiteral("n"), QStringLiteral("100"));
+    QCommandLineOption stylesOption(QStringLiteral("styles"),
+                                    QStringLiteral("Distinct formats of the styles shapes."),
+                                    QStringLiteral("n"), QStringLiteral("4000"));
+    QCommandLineOption fragmentsOption(QStringLiteral("fragments"),
+                                       QStringLiteral("Fragments per rich text string."),
+                                       QStringLiteral("n"), QStringLiteral("8"));
+    QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Output directory."),
+                                    QStringLiteral("dir"), QStringLiteral("."));
+    parser.addOption(seedOption);
+    parser.addOption(rowsOption);
+    parser.addOption(columnsOption);
+    parser.addOption(sheetsOption);
+    parser.addOption(stylesOption);
+    parser.addOption(fragmentsOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    Options options;
+    options.seed = parser.value(seedOption).toULongLong();
+    options.rows = qMax(1, parser.value(rowsOption).toInt());
+    options.columns = qBound(1, parser.value(columnsOption).toInt(), 16384);
+    options.sheets = qMax(1, parser.value(sheetsOption).toInt());
+    options.styles = qMax(1, parser.value(stylesOption).toInt());
+    options.fragments = qMax(1, parser.value(fragmentsOption).toInt());
+
+    QStringList requested = parser.positionalArguments();
+    if (requested.isEmpty())
+        requested = shapeNames;
+
+    QDir output(parser.value(outputOption));
+    if (!output.mkpath(QStringLiteral("."))) {
+        qWarning("Can't create the output directory");
+        return 1;
+    }
+
+    foreach (const QString &name, requested) {
+        const int index = shapeNames.indexOf(name);
+        if (index == -1) {
+            qWarning("Unknown shape %s", qPrintable(name));
+            return 1;
+        }
+        const Shape &shape = shapes[index];
+
+        // Each shape has its own sequence, so that generating a subset
+        // of the shapes gives the same files.
+        Random random(options.seed * 31 + index);
+        Document xlsx;
+        xlsx.setDocumentProperty(QStringLiteral("created"),
+                                 QStringLiteral("2014-01-01T00:00:00Z"));
+        shape.generate(xlsx, random, options);
+
+        const QString fileName =
+            output.filePath(QStringLiteral("%1-s%2.xlsx").arg(name).arg(options.seed));
+        if (!xlsx.saveAs(fileName)) {
+            qWarning("Can't write %s", qPrintable(fileName));
+            return 1;
+        }
+        if (shape.rewrite
+            && !rewritePackage(fileName, QLatin1String(shape.rewrittenPrefix), shape.rewrite)) {
+            qWarning("Can't rewrite %s", qPrintable(fileName));
+            return 1;
+        }
+        qDebug("%s", qPrintable(fileName));
+    }
+
+    return 0;
+}
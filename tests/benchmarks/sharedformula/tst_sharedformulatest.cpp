@@ -0,0 +1,86 @@
+#include "xlsxdocument.h"
+#include "xlsxworksheet.h"
+#include "xlsxcellformula.h"
+#include "xlsxcellrange.h"
+#include "private/xlsxutility_p.h"
+#include <QBuffer>
+#include <QtTest>
+
+QTXLSX_USE_NAMESPACE
+
+class SharedFormulaTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    SharedFormulaTest();
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testConvertSharedFormula();
+    void testExpandTemplate();
+    void testReadSharedFormulaCells();
+
+private:
+    QByteArray m_xlsxData;
+    static const int cellCount = 1000000;
+};
+
+SharedFormulaTest::SharedFormulaTest()
+{
+}
+
+void SharedFormulaTest::initTestCase()
+{
+    // One shared formula group of 1M cells, loaded from file so that
+    // the non-root cells only contain the shared index.
+    Document xlsx;
+    CellFormula formula("A1*2+SUM($C$1:C1)", CellRange(1, 2, cellCount, 2),
+                        CellFormula::SharedType);
+    xlsx.currentWorksheet()->writeFormula(1, 2, formula);
+
+    QBuffer buffer(&m_xlsxData);
+    buffer.open(QIODevice::WriteOnly);
+    xlsx.saveAs(&buffer);
+}
+
+void SharedFormulaTest::testConvertSharedFormula()
+{
+    const QString rootFormula = QStringLiteral("A1*2+SUM($C$1:C1)");
+    const CellReference rootCell(1, 2);
+
+    QBENCHMARK {
+        for (int row = 1; row <= 10000; ++row)
+            convertSharedFormula(rootFormula, rootCell, CellReference(row, 2));
+    }
+}
+
+void SharedFormulaTest::testExpandTemplate()
+{
+    const SharedFormulaTemplate formulaTemplate(QStringLiteral("A1*2+SUM($C$1:C1)"),
+                                                CellReference(1, 2));
+
+    QBENCHMARK {
+        for (int row = 1; row <= 10000; ++row)
+            formulaTemplate.expand(CellReference(row, 2));
+    }
+}
+
+void SharedFormulaTest::testReadSharedFormulaCells()
+{
+    QBuffer buffer(&m_xlsxData);
+    buffer.open(QIODevice::ReadOnly);
+    Document xlsx(&buffer);
+    QCOMPARE(xlsx.read(cellCount, 2).toString(),
+             QStringLiteral("=A%1*2+SUM($C$1:C%1)").arg(cellCount));
+
+    QBENCHMARK {
+        for (int row = 1; row <= cellCount; ++row)
+            xlsx.read(row, 2);
+    }
+}
+
+QTEST_MAIN(SharedFormulaTest)
+
+#include "tst_sharedformulatest.moc"
@@ -0,0 +1,72 @@
+#include "xlsxdocument.h"
+#include "xlsxworksheet.h"
+#include "xlsxformat.h"
+#include <QBuffer>
+#include <QtTest>
+
+QTXLSX_USE_NAMESPACE
+
+class SparseSheetTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    SparseSheetTest();
+
+private Q_SLOTS:
+    void testSave_data();
+    void testSave();
+};
+
+SparseSheetTest::SparseSheetTest()
+{
+}
+
+void SparseSheetTest::testSave_data()
+{
+    QTest::addColumn<QString>("layout");
+
+    QTest::newRow("corners") << QString("corners");
+    QTest::newRow("diagonal") << QString("diagonal");
+    QTest::newRow("scattered rows") << QString("scattered rows");
+    QTest::newRow("wide row") << QString("wide row");
+    QTest::newRow("row formats") << QString("row formats");
+}
+
+void SparseSheetTest::testSave()
+{
+    QFETCH(QString, layout);
+
+    // Each layout has a dimension far larger than the number of cells
+    Document xlsx;
+    if (layout == QLatin1String("corners")) {
+        xlsx.write(1, 1, 1);
+        xlsx.write(1048576, 16384, 2);
+    } else if (layout == QLatin1String("diagonal")) {
+        for (int i = 1; i <= 16384; ++i)
+            xlsx.write(i * 64, i, i);
+    } else if (layout == QLatin1String("scattered rows")) {
+        for (int row = 1; row <= 1048576; row += 997)
+            xlsx.write(row, (row % 16384) + 1, row);
+    } else if (layout == QLatin1String("wide row")) {
+        for (int col = 1; col <= 16384; col += 128)
+            xlsx.write(1, col, col);
+        xlsx.write(1048576, 1, 0);
+    } else {
+        Format format;
+        format.setFontBold(true);
+        for (int row = 1; row <= 1048576; row += 4096)
+            xlsx.setRowFormat(row, format);
+        xlsx.write(1, 16384, 0);
+    }
+
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        xlsx.saveAs(&buffer);
+    }
+}
+
+QTEST_MAIN(SparseSheetTest)
+
+#include "tst_sparsesheettest.moc"
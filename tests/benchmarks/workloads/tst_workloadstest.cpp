@@ -0,0 +1,292 @@
+#include "xlsxdocument.h"
+#include "xlsxworksheet.h"
+#include "xlsxformat.h"
+#include "xlsxchart.h"
+#include "xlsxcellrange.h"
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QtTest>
+
+#if defined(Q_OS_WIN)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+QTXLSX_USE_NAMESPACE
+
+/*
+  Benchmarks of the common workloads. Besides the time measured by
+  QBENCHMARK, each test reports the throughput of its fastest iteration
+  and the peak resident set size of the process.
+
+  The workbooks of 10M cells are only used when the environment variable
+  QTXLSX_BENCHMARK_LARGE is set, as they need several GB of memory.
+ */
+
+static qint64 peakResidentSetSize()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return -1;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#if defined(Q_OS_MAC)
+    return usage.ru_maxrss;
+#else
+    return qint64(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return -1;
+#endif
+}
+
+class Throughput
+{
+public:
+    Throughput()
+        : m_nsecs(-1)
+    {
+    }
+
+    void start() { m_timer.start(); }
+
+    void stop()
+    {
+        const qint64 nsecs = m_timer.nsecsElapsed();
+        if (m_nsecs < 0 || nsecs < m_nsecs)
+            m_nsecs = nsecs;
+    }
+
+    void report(const char *unit, qint64 count, qint64 bytes = 0) const
+    {
+        if (m_nsecs <= 0)
+            return;
+        const double secs = m_nsecs / 1e9;
+        QString text =
+            QStringLiteral("%1 %2/s").arg(count / secs, 0, 'f', 0).arg(QLatin1String(unit));
+        if (bytes > 0)
+            text += QStringLiteral(", %1 MB/s").arg(bytes / secs / 1e6, 0, 'f', 1);
+        text += QStringLiteral(", peak RSS %1 MB").arg(peakResidentSetSize() / 1e6, 0, 'f', 1);
+        qDebug("%s: %s", QTest::currentDataTag() ? QTest::currentDataTag() : "",
+               qPrintable(text));
+    }
+
+private:
+    QElapsedTimer m_timer;
+    qint64 m_nsecs;
+};
+
+enum Layout { Numbers, Strings, SharedStrings, Styles };
+
+static void fillSheet(Document &xlsx, Layout layout, int rows, int columns)
+{
+    QList<Format> formats;
+    if (layout == Styles) {
+        for (int i = 0; i < 64; ++i) {
+            Format format;
+            format.setFontBold(i & 1);
+            format.setFontItalic(i & 2);
+            format.setPatternBackgroundColor(QColor::fromHsv(i * 5, 255, 255));
+            format.setNumberFormatIndex(i % 4);
+            formats.append(format);
+        }
+    }
+
+    for (int row = 1; row <= rows; ++row) {
+        for (int col = 1; col <= columns; ++col) {
+            switch (layout) {
+            case Numbers:
+                xlsx.write(row, col, row * 0.5 + col);
+                break;
+            case Strings: // Unique strings, each one a new shared string
+                xlsx.write(row, col, QStringLiteral("Cell %1-%2").arg(row).arg(col));
+                break;
+            case SharedStrings: // Heavily repeated strings
+                xlsx.write(row, col, QStringLiteral("Category %1").arg((row + col) % 100));
+                break;
+            case Styles:
+                xlsx.write(row, col, row + col, formats[(row * columns + col) % formats.size()]);
+                break;
+            }
+        }
+    }
+}
+
+class WorkloadsTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    WorkloadsTest();
+
+private Q_SLOTS:
+    void testWrite_data();
+    void testWrite();
+    void testSave_data();
+    void testSave();
+    void testLoad_data();
+    void testLoad();
+    void testImages();
+    void testCharts();
+};
+
+WorkloadsTest::WorkloadsTest()
+{
+}
+
+void WorkloadsTest::testWrite_data()
+{
+    QTest::addColumn<int>("layout");
+    QTest::addColumn<int>("rows");
+
+    QTest::newRow("numbers 100k") << int(Numbers) << 10000;
+    QTest::newRow("strings 100k") << int(Strings) << 10000;
+    QTest::newRow("shared strings 100k") << int(SharedStrings) << 10000;
+    QTest::newRow("styled 100k") << int(Styles) << 10000;
+}
+
+void WorkloadsTest::testWrite()
+{
+    QFETCH(int, layout);
+    QFETCH(int, rows);
+    const int columns = 10;
+
+    Throughput throughput;
+    QBENCHMARK {
+        Document xlsx;
+        throughput.start();
+        fillSheet(xlsx, Layout(layout), rows, columns);
+        throughput.stop();
+    }
+    throughput.report("cells", qint64(rows) * columns);
+}
+
+static void addSizeRows(int layout, const char *name)
+{
+    QTest::newRow(QByteArray(name).append(" 1M").constData()) << layout << 100000;
+    if (qEnvironmentVariableIsSet("QTXLSX_BENCHMARK_LARGE"))
+        QTest::newRow(QByteArray(name).append(" 10M").constData()) << layout << 1000000;
+}
+
+void WorkloadsTest::testSave_data()
+{
+    QTest::addColumn<int>("layout");
+    QTest::addColumn<int>("rows");
+
+    addSizeRows(Numbers, "numbers");
+    addSizeRows(SharedStrings, "shared strings");
+    addSizeRows(Styles, "styled");
+}
+
+void WorkloadsTest::testSave()
+{
+    QFETCH(int, layout);
+    QFETCH(int, rows);
+    const int columns = 10;
+
+    Document xlsx;
+    fillSheet(xlsx, Layout(layout), rows, columns);
+
+    Throughput throughput;
+    qint64 bytes = 0;
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        throughput.start();
+        xlsx.saveAs(&buffer);
+        throughput.stop();
+        bytes = buffer.size();
+    }
+    throughput.report("cells", qint64(rows) * columns, bytes);
+}
+
+void WorkloadsTest::testLoad_data()
+{
+    testSave_data();
+}
+
+void WorkloadsTest::testLoad()
+{
+    QFETCH(int, layout);
+    QFETCH(int, rows);
+    const int columns = 10;
+
+    QByteArray data;
+    {
+        Document xlsx;
+        fillSheet(xlsx, Layout(layout), rows, columns);
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        xlsx.saveAs(&buffer);
+    }
+
+    Throughput throughput;
+    QBENCHMARK {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        throughput.start();
+        Document xlsx(&buffer);
+        throughput.stop();
+        QVERIFY(xlsx.cellAt(rows, columns));
+    }
+    throughput.report("cells", qint64(rows) * columns, data.size());
+}
+
+void WorkloadsTest::testImages()
+{
+    const int count = 100;
+    QImage image(256, 256, QImage::Format_RGB32);
+    image.fill(Qt::darkCyan);
+
+    Throughput throughput;
+    qint64 bytes = 0;
+    QBENCHMARK {
+        throughput.start();
+        Document xlsx;
+        for (int i = 0; i < count; ++i)
+            xlsx.insertImage(i * 20 + 1, 1, image);
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        xlsx.saveAs(&buffer);
+        throughput.stop();
+        bytes = buffer.size();
+    }
+    throughput.report("images", count, bytes);
+}
+
+void WorkloadsTest::testCharts()
+{
+    const int count = 100;
+    const int rows = 100;
+
+    Throughput throughput;
+    qint64 bytes = 0;
+    QBENCHMARK {
+        throughput.start();
+        Document xlsx;
+        fillSheet(xlsx, Numbers, rows, 4);
+        for (int i = 0; i < count; ++i) {
+            Chart *chart = xlsx.insertChart(i * 20 + 1, 6, QSize(300, 300));
+            chart->setChartType(i % 2 ? Chart::CT_Line : Chart::CT_Bar);
+            chart->addSeries(CellRange(1, 1, rows, 4));
+        }
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        xlsx.saveAs(&buffer);
+        throughput.stop();
+        bytes = buffer.size();
+    }
+    throughput.report("charts", count, bytes);
+}
+
+QTEST_MAIN(WorkloadsTest)
+
+#include "tst_workloadstest.moc"
@@ -0,0 +1,14 @@
+QT       += testlib xlsx xlsx-private
+CONFIG += testcase
+DEFINES += XLSX_TEST
+
+TARGET = tst_workloadstest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+win32:LIBS += -lpsapi
+
+SOURCES += tst_workloadstest.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"